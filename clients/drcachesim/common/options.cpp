@@ -193,6 +193,68 @@ droption_t<bool> op_coherence(
     DROPTION_SCOPE_FRONTEND, "coherence", false, "Model coherence for private caches",
     "Writes to cache lines will invalidate other private caches that hold that line.");
 
+droption_t<unsigned int> op_snoop_filter_entries(
+    DROPTION_SCOPE_FRONTEND, "snoop_filter_entries", 0,
+    "Capacity of the coherence directory",
+    "Specifies the number of entries in the snoop filter used with -coherence.  The "
+    "default of 0 models a perfect directory that tracks every line held in a private "
+    "cache.  A non-zero power of 2 instead models a set-associative sparse directory "
+    "(see -snoop_filter_assoc) whose evictions invalidate the evicted line in all "
+    "caches holding it.  A bounded directory also bounds the simulator's memory use.");
+
+droption_t<unsigned int> op_snoop_filter_assoc(
+    DROPTION_SCOPE_FRONTEND, "snoop_filter_assoc", 16,
+    "Associativity of the coherence directory",
+    "Specifies the associativity of the snoop filter when -snoop_filter_entries is "
+    "non-zero.  Must be a power of 2.");
+
+droption_t<unsigned int> op_L1I_latency(
+    DROPTION_SCOPE_FRONTEND, "L1I_latency", 4, "Instruction cache hit latency in cycles",
+    "Specifies the hit latency of each L1 instruction cache, used for timing estimates "
+    "when -memory_latency is non-zero.");
+
+droption_t<unsigned int> op_L1D_latency(
+    DROPTION_SCOPE_FRONTEND, "L1D_latency", 4, "Data cache hit latency in cycles",
+    "Specifies the hit latency of each L1 data cache, used for timing estimates "
+    "when -memory_latency is non-zero.");
+
+droption_t<unsigned int> op_LL_latency(
+    DROPTION_SCOPE_FRONTEND, "LL_latency", 40, "Last-level cache hit latency in cycles",
+    "Specifies the hit latency of the last-level cache, used for timing estimates "
+    "when -memory_latency is non-zero.");
+
+droption_t<unsigned int> op_memory_latency(
+    DROPTION_SCOPE_FRONTEND, "memory_latency", 0,
+    "Memory latency in cycles; enables timing estimates",
+    "If non-zero, enables timing estimates in the cache simulator.  Each access's "
+    "latency is the sum of the hit latencies of the levels it reaches, plus this "
+    "memory latency if it misses in the last level.  Each core is modeled as "
+    "dispatching one instruction per cycle, stalling on instruction fetch misses, on "
+    "data load misses once all -mshrs miss status holding registers are busy, and once "
+    "the oldest outstanding load miss is -rob_size instructions old.  Stores are "
+    "assumed to be fully buffered.  The estimated cycles, CPI, memory-level "
+    "parallelism, and stall cycles per load PC and per thread are reported.");
+
+droption_t<unsigned int> op_mshrs(
+    DROPTION_SCOPE_FRONTEND, "mshrs", 10, "Outstanding data misses per core",
+    "Specifies the number of miss status holding registers per core, which bounds the "
+    "number of outstanding L1 data cache misses for timing estimates.");
+
+droption_t<unsigned int> op_rob_size(
+    DROPTION_SCOPE_FRONTEND, "rob_size", 224, "Reorder buffer entries per core",
+    "Specifies the number of instructions that can be dispatched past an outstanding "
+    "load miss before the core stalls, for timing estimates.");
+
+droption_t<unsigned int> op_miss_attribution_top(
+    DROPTION_SCOPE_FRONTEND, "miss_attribution_top", 0,
+    "Report the top N missing PCs per cache",
+    "If non-zero, the cache simulator counts each cache's demand misses by the program "
+    "counter of the instruction responsible (the instruction's own address for "
+    "instruction fetches) and reports the PCs with the most misses, up to this many, "
+    "with each cache's statistics.  This avoids post-processing a large "
+    "-LL_miss_file when looking for the code responsible for misses.  The PCs can be "
+    "mapped to functions with a symbolizer such as the symquery tool.");
+
 droption_t<bool> op_use_physical(
     DROPTION_SCOPE_CLIENT, "use_physical", false, "Use physical addresses if possible",
     "If available, the default virtual addresses will be translated to physical.  "
@@ -249,10 +311,13 @@ droption_t<bool> op_online_instr_types(
 
 droption_t<std::string> op_replace_policy(
     DROPTION_SCOPE_FRONTEND, "replace_policy", REPLACE_POLICY_LRU,
-    "Cache replacement policy (LRU, LFU, FIFO)",
+    "Cache replacement policy (LRU, LFU, FIFO, SRRIP, BRRIP, DRRIP, RANDOM, PLRU)",
     "Specifies the replacement policy for "
     "caches. Supported policies: LRU (Least Recently Used), LFU (Least Frequently Used), "
-    "FIFO (First-In-First-Out).");
+    "FIFO (First-In-First-Out), SRRIP (Static Re-Reference Interval Prediction), BRRIP "
+    "(Bimodal RRIP), DRRIP (Dynamic RRIP, which picks between SRRIP and BRRIP by set "
+    "dueling), RANDOM, and PLRU (tree Pseudo-LRU).  The '" POLICY_COMPARE "' "
+    "simulator type simulates all of these at once for comparison.");
 
 droption_t<std::string> op_data_prefetcher(
     DROPTION_SCOPE_FRONTEND, "data_prefetcher", PREFETCH_POLICY_NEXTLINE,
@@ -297,13 +362,43 @@ droption_t<std::string>
                           "Specifies the replacement policy for TLBs. "
                           "Supported policies: LFU (Least Frequently Used).");
 
+droption_t<std::string> op_TLB_page_map(
+    DROPTION_SCOPE_FRONTEND, "TLB_page_map", "",
+    "File mapping address ranges to page sizes",
+    "Specifies a file listing virtual address ranges backed by pages whose size differs "
+    "from -page_size, such as 2M or 1G huge pages.  Each line has the form "
+    "\"<start>-<end> <page_size>\" with hexadecimal addresses as in /proc/self/maps "
+    "and a page size with an optional K, M, or G suffix.  Ranges must be aligned to "
+    "their page size.  Addresses outside of all ranges use -page_size.  Comparing "
+    "results with and without huge page ranges estimates the benefit of huge pages.");
+
+droption_t<unsigned int> op_TLB_walk_latency(
+    DROPTION_SCOPE_FRONTEND, "TLB_walk_latency", 0,
+    "Cycles per page table access on a walk",
+    "If non-zero, enables modeling of the page table walk performed on each L2 TLB "
+    "miss, with each memory access made by the walk charged this many cycles.  The "
+    "walk statistics, including total walk cycles, are printed with each core's TLB "
+    "results.");
+
+droption_t<unsigned int> op_TLB_walk_cache_entries(
+    DROPTION_SCOPE_FRONTEND, "TLB_walk_cache_entries", 32,
+    "Entries per paging-structure cache level",
+    "Specifies the number of entries in each level of the fully associative "
+    "paging-structure caches consulted by a page table walk (see -TLB_walk_latency). "
+    "These caches hold upper-level page table entries so that a walk can skip reading "
+    "those levels from memory.  0 disables the paging-structure caches.");
+
 droption_t<std::string> op_simulator_type(
     DROPTION_SCOPE_FRONTEND, "simulator_type", CPU_CACHE,
-    "Simulator type (" CPU_CACHE ", " MISS_ANALYZER ", " TLB ", " REUSE_DIST
-    ", " REUSE_TIME ", " HISTOGRAM ", " VIEW ", " FUNC_VIEW ", or " BASIC_COUNTS ").",
+    "Simulator type (" CPU_CACHE ", " MISS_ANALYZER ", " POLICY_COMPARE ", " TLB
+    ", " REUSE_DIST ", " REUSE_TIME ", " HISTOGRAM ", " VIEW ", " FUNC_VIEW
+    ", or " BASIC_COUNTS ").",
     "Specifies the type of the simulator. "
-    "Supported types: " CPU_CACHE ", " MISS_ANALYZER ", " TLB ", " REUSE_DIST
-    ", " REUSE_TIME ", " HISTOGRAM "or " BASIC_COUNTS ".");
+    "Supported types: " CPU_CACHE ", " MISS_ANALYZER ", " POLICY_COMPARE ", " TLB
+    ", " REUSE_DIST ", " REUSE_TIME ", " HISTOGRAM "or " BASIC_COUNTS ".  The "
+    POLICY_COMPARE " type simulates the cache hierarchy configured by the cache "
+    "options once for each supported -replace_policy in a single pass and compares "
+    "their miss rates.");
 
 droption_t<unsigned int> op_verbose(DROPTION_SCOPE_ALL, "verbose", 0, 0, 64,
                                     "Verbosity level",
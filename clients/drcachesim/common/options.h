@@ -39,10 +39,16 @@
 #define REPLACE_POLICY_LRU "LRU"
 #define REPLACE_POLICY_LFU "LFU"
 #define REPLACE_POLICY_FIFO "FIFO"
+#define REPLACE_POLICY_SRRIP "SRRIP"
+#define REPLACE_POLICY_BRRIP "BRRIP"
+#define REPLACE_POLICY_DRRIP "DRRIP"
+#define REPLACE_POLICY_RANDOM "RANDOM"
+#define REPLACE_POLICY_PLRU "PLRU"
 #define PREFETCH_POLICY_NEXTLINE "nextline"
 #define PREFETCH_POLICY_NONE "none"
 #define CPU_CACHE "cache"
 #define MISS_ANALYZER "miss_analyzer"
+#define POLICY_COMPARE "policy_compare"
 #define TLB "TLB"
 #define HISTOGRAM "histogram"
 #define REUSE_DIST "reuse_distance"
@@ -82,6 +88,15 @@ extern droption_t<bool> op_L0_filter;
 extern droption_t<bytesize_t> op_L0D_size;
 extern droption_t<bool> op_instr_only_trace;
 extern droption_t<bool> op_coherence;
+extern droption_t<unsigned int> op_snoop_filter_entries;
+extern droption_t<unsigned int> op_snoop_filter_assoc;
+extern droption_t<unsigned int> op_L1I_latency;
+extern droption_t<unsigned int> op_L1D_latency;
+extern droption_t<unsigned int> op_LL_latency;
+extern droption_t<unsigned int> op_memory_latency;
+extern droption_t<unsigned int> op_mshrs;
+extern droption_t<unsigned int> op_rob_size;
+extern droption_t<unsigned int> op_miss_attribution_top;
 extern droption_t<bool> op_use_physical;
 extern droption_t<unsigned int> op_virt2phys_freq;
 extern droption_t<bool> op_cpu_scheduling;
@@ -99,6 +114,9 @@ extern droption_t<unsigned int> op_TLB_L1D_assoc;
 extern droption_t<unsigned int> op_TLB_L2_entries;
 extern droption_t<unsigned int> op_TLB_L2_assoc;
 extern droption_t<std::string> op_TLB_replace_policy;
+extern droption_t<std::string> op_TLB_page_map;
+extern droption_t<unsigned int> op_TLB_walk_latency;
+extern droption_t<unsigned int> op_TLB_walk_cache_entries;
 extern droption_t<std::string> op_simulator_type;
 extern droption_t<unsigned int> op_verbose;
 extern droption_t<bool> op_show_func_trace;
@@ -155,6 +155,46 @@ config_reader_t::configure(const std::string &config_file, cache_simulator_knobs
             } else {
                 knobs.model_coherence = false;
             }
+        } else if (param == "memory_latency") {
+            // Memory latency in cycles.  Non-zero enables timing estimates.
+            if (!(fin_ >> knobs.memory_latency)) {
+                ERRMSG("Error reading memory_latency from "
+                       "the configuration file\n");
+                return false;
+            }
+        } else if (param == "mshrs") {
+            // Outstanding L1 data misses per core, for timing estimates.
+            if (!(fin_ >> knobs.num_mshrs) || knobs.num_mshrs == 0) {
+                ERRMSG("Error reading mshrs from the configuration file\n");
+                return false;
+            }
+        } else if (param == "rob_size") {
+            // Reorder buffer entries per core, for timing estimates.
+            if (!(fin_ >> knobs.rob_size) || knobs.rob_size == 0) {
+                ERRMSG("Error reading rob_size from the configuration file\n");
+                return false;
+            }
+        } else if (param == "miss_attribution_top") {
+            // Number of top-missing PCs to report per cache.
+            if (!(fin_ >> knobs.miss_attribution_top)) {
+                ERRMSG("Error reading miss_attribution_top from "
+                       "the configuration file\n");
+                return false;
+            }
+        } else if (param == "snoop_filter_entries") {
+            // Capacity of the coherence directory, or 0 for a perfect directory.
+            if (!(fin_ >> knobs.snoop_filter_entries)) {
+                ERRMSG("Error reading snoop_filter_entries from "
+                       "the configuration file\n");
+                return false;
+            }
+        } else if (param == "snoop_filter_assoc") {
+            // Associativity of a bounded coherence directory.
+            if (!(fin_ >> knobs.snoop_filter_assoc)) {
+                ERRMSG("Error reading snoop_filter_assoc from "
+                       "the configuration file\n");
+                return false;
+            }
         } else {
             // A cache unit.
             cache_params_t cache;
@@ -278,7 +318,8 @@ config_reader_t::configure_cache(cache_params_t &cache)
             }
         } else if (param == "replace_policy") {
             // Cache replacement policy: REPLACE_POLICY_LRU (default),
-            // REPLACE_POLICY_LFU or REPLACE_POLICY_FIFO.
+            // REPLACE_POLICY_LFU, REPLACE_POLICY_FIFO, one of the RRIP variants,
+            // REPLACE_POLICY_RANDOM, or REPLACE_POLICY_PLRU.
             if (!(fin_ >> cache.replace_policy)) {
                 ERRMSG("Error reading cache replace_policy from "
                        "the configuration file\n");
@@ -287,7 +328,12 @@ config_reader_t::configure_cache(cache_params_t &cache)
             if (cache.replace_policy != REPLACE_POLICY_NON_SPECIFIED &&
                 cache.replace_policy != REPLACE_POLICY_LRU &&
                 cache.replace_policy != REPLACE_POLICY_LFU &&
-                cache.replace_policy != REPLACE_POLICY_FIFO) {
+                cache.replace_policy != REPLACE_POLICY_FIFO &&
+                cache.replace_policy != REPLACE_POLICY_SRRIP &&
+                cache.replace_policy != REPLACE_POLICY_BRRIP &&
+                cache.replace_policy != REPLACE_POLICY_DRRIP &&
+                cache.replace_policy != REPLACE_POLICY_RANDOM &&
+                cache.replace_policy != REPLACE_POLICY_PLRU) {
                 ERRMSG("Unknown replacement policy: %s\n", cache.replace_policy.c_str());
                 return false;
             }
@@ -311,6 +357,13 @@ config_reader_t::configure_cache(cache_params_t &cache)
                        "the configuration file\n");
                 return false;
             }
+        } else if (param == "latency") {
+            // Hit latency in cycles, used for timing estimates.
+            if (!(fin_ >> cache.latency)) {
+                ERRMSG("Error reading cache latency from "
+                       "the configuration file\n");
+                return false;
+            }
         } else {
             ERRMSG("Unknown cache configuration setting '%s'\n", param.c_str());
             return false;
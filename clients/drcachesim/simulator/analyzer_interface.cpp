@@ -111,6 +111,15 @@ get_cache_simulator_knobs()
     knobs->LL_assoc = op_LL_assoc.get_value();
     knobs->LL_miss_file = op_LL_miss_file.get_value();
     knobs->model_coherence = op_coherence.get_value();
+    knobs->snoop_filter_entries = op_snoop_filter_entries.get_value();
+    knobs->snoop_filter_assoc = op_snoop_filter_assoc.get_value();
+    knobs->L1I_latency = op_L1I_latency.get_value();
+    knobs->L1D_latency = op_L1D_latency.get_value();
+    knobs->LL_latency = op_LL_latency.get_value();
+    knobs->memory_latency = op_memory_latency.get_value();
+    knobs->num_mshrs = op_mshrs.get_value();
+    knobs->rob_size = op_rob_size.get_value();
+    knobs->miss_attribution_top = op_miss_attribution_top.get_value();
     knobs->replace_policy = op_replace_policy.get_value();
     knobs->data_prefetcher = op_data_prefetcher.get_value();
     knobs->skip_refs = op_skip_refs.get_value();
@@ -138,6 +147,9 @@ drmemtrace_analysis_tool_create()
         return cache_miss_analyzer_create(*knobs, op_miss_count_threshold.get_value(),
                                           op_miss_frac_threshold.get_value(),
                                           op_confidence_threshold.get_value());
+    } else if (op_simulator_type.get_value() == POLICY_COMPARE) {
+        cache_simulator_knobs_t *knobs = get_cache_simulator_knobs();
+        return policy_compare_create(*knobs);
     } else if (op_simulator_type.get_value() == TLB) {
         tlb_simulator_knobs_t knobs;
         knobs.num_cores = op_num_cores.get_value();
@@ -149,6 +161,9 @@ drmemtrace_analysis_tool_create()
         knobs.TLB_L2_entries = op_TLB_L2_entries.get_value();
         knobs.TLB_L2_assoc = op_TLB_L2_assoc.get_value();
         knobs.TLB_replace_policy = op_TLB_replace_policy.get_value();
+        knobs.TLB_page_map = op_TLB_page_map.get_value();
+        knobs.TLB_walk_latency = op_TLB_walk_latency.get_value();
+        knobs.TLB_walk_cache_entries = op_TLB_walk_cache_entries.get_value();
         knobs.skip_refs = op_skip_refs.get_value();
         knobs.warmup_refs = op_warmup_refs.get_value();
         knobs.warmup_fraction = op_warmup_fraction.get_value();
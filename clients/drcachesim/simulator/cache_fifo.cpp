@@ -84,5 +84,8 @@ cache_fifo_t::replace_which_way(int block_idx)
             return i;
         }
     }
-    return -1;
+    // An invalidation cleared the replacement pointer: restart it from the first
+    // block rather than returning an invalid way.
+    get_caching_device_block(block_idx, 1 & (associativity_ - 1)).counter_ = 1;
+    return 0;
 }
@@ -0,0 +1,85 @@
+/* **********************************************************
+ * Copyright (c) 2020 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "cache_plru.h"
+
+// For tree pseudo-LRU, each set keeps a binary tree over its ways with one bit
+// per internal node, stored as a heap: node 1 is the root, node n's children are
+// nodes 2n and 2n+1, and way w is the leaf associativity_ + w.  A node's bit
+// points toward the child subtree to evict from next.  An access points every
+// node on the way's path away from it, and the victim is found by following the
+// bits down from the root.  This needs one fewer bit than ways per set, which is
+// why hardware uses it in place of true LRU.
+
+bool
+cache_plru_t::init(int associativity, int block_size, int total_size,
+                   caching_device_t *parent, caching_device_stats_t *stats,
+                   prefetcher_t *prefetcher, bool inclusive, bool coherent_cache, int id,
+                   snoop_filter_t *snoop_filter,
+                   const std::vector<caching_device_t *> &children)
+{
+    // The tree bits of a set must fit in one word.
+    if (associativity > 64)
+        return false;
+    if (!cache_t::init(associativity, block_size, total_size, parent, stats, prefetcher,
+                       inclusive, coherent_cache, id, snoop_filter, children))
+        return false;
+    tree_bits_.assign(blocks_per_set_, 0);
+    return true;
+}
+
+void
+cache_plru_t::access_update(int line_idx, int way)
+{
+    uint64_t &bits = tree_bits_[line_idx >> assoc_bits_];
+    for (int node = associativity_ + way; node > 1; node >>= 1) {
+        // Point the parent at the sibling subtree.
+        if ((node & 1) == 0)
+            bits |= 1ULL << (node >> 1);
+        else
+            bits &= ~(1ULL << (node >> 1));
+    }
+}
+
+int
+cache_plru_t::replace_which_way(int line_idx)
+{
+    for (int way = 0; way < associativity_; ++way) {
+        if (get_caching_device_block(line_idx, way).tag_ == TAG_INVALID)
+            return way;
+    }
+    uint64_t bits = tree_bits_[line_idx >> assoc_bits_];
+    int node = 1;
+    while (node < associativity_)
+        node = 2 * node + (int)((bits >> node) & 1);
+    return node - associativity_;
+}
@@ -0,0 +1,126 @@
+/* **********************************************************
+ * Copyright (c) 2020 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include "cache_rrip.h"
+
+// For RRIP, the cache line counter holds a 2-bit re-reference prediction value
+// (RRPV): 0 predicts a near-immediate re-reference and RRPV_MAX a distant one.
+// A hit resets the RRPV to 0.  The victim is the first line predicted distant,
+// aging the whole set until one is found.  SRRIP inserts new lines with a long
+// (RRPV_MAX - 1) prediction; BRRIP inserts them as distant except for one in every
+// BIP_THROTTLE fills, which resists thrashing by working sets larger than the cache.
+// DRRIP dedicates a few leader sets to each and has the remaining follower sets
+// use whichever policy misses less in its leaders, as tracked by psel_.
+
+static const int RRPV_MAX = 3;
+static const unsigned int BIP_THROTTLE = 32;
+static const int PSEL_MAX = 1023;
+static const int LEADER_SETS = 32;
+
+cache_rrip_t::cache_rrip_t(rrip_mode_t mode)
+    : mode_(mode)
+    , fill_line_idx_(-1)
+    , fill_way_(-1)
+    , fill_rrpv_(RRPV_MAX)
+    , bimodal_fills_(0)
+    , psel_(PSEL_MAX / 2)
+{
+}
+
+void
+cache_rrip_t::access_update(int line_idx, int way)
+{
+    if (line_idx == fill_line_idx_ && way == fill_way_) {
+        get_caching_device_block(line_idx, way).counter_ = fill_rrpv_;
+        fill_line_idx_ = -1;
+        return;
+    }
+    get_caching_device_block(line_idx, way).counter_ = 0;
+}
+
+bool
+cache_rrip_t::use_bimodal_insertion(int line_idx)
+{
+    if (mode_ != RRIP_DYNAMIC)
+        return mode_ == RRIP_BIMODAL;
+    // Each constituency of sets contributes one leader set for each policy.
+    int set = line_idx >> assoc_bits_;
+    int constituency = blocks_per_set_ / LEADER_SETS;
+    if (constituency < 2)
+        constituency = 2;
+    int offset = set % constituency;
+    if (offset == 0) {
+        // A static-insertion leader missed.
+        if (psel_ < PSEL_MAX)
+            ++psel_;
+        return false;
+    }
+    if (offset == 1) {
+        // A bimodal-insertion leader missed.
+        if (psel_ > 0)
+            --psel_;
+        return true;
+    }
+    return psel_ > PSEL_MAX / 2;
+}
+
+int
+cache_rrip_t::replace_which_way(int line_idx)
+{
+    fill_line_idx_ = line_idx;
+    if (use_bimodal_insertion(line_idx))
+        fill_rrpv_ = (++bimodal_fills_ % BIP_THROTTLE == 0) ? RRPV_MAX - 1 : RRPV_MAX;
+    else
+        fill_rrpv_ = RRPV_MAX - 1;
+    int max_rrpv = -1;
+    int max_way = 0;
+    for (int way = 0; way < associativity_; ++way) {
+        caching_device_block_t &block = get_caching_device_block(line_idx, way);
+        if (block.tag_ == TAG_INVALID) {
+            fill_way_ = way;
+            return way;
+        }
+        if (block.counter_ > max_rrpv) {
+            max_rrpv = block.counter_;
+            max_way = way;
+        }
+    }
+    // Rather than aging the set repeatedly until a line reaches RRPV_MAX, age it
+    // once by the amount the oldest line needs, which gives the same result.
+    if (max_rrpv < RRPV_MAX) {
+        int delta = RRPV_MAX - max_rrpv;
+        for (int way = 0; way < associativity_; ++way)
+            get_caching_device_block(line_idx, way).counter_ += delta;
+    }
+    fill_way_ = max_way;
+    return max_way;
+}
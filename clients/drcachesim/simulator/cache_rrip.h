@@ -0,0 +1,75 @@
+/* **********************************************************
+ * Copyright (c) 2020 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* cache_rrip: represents a single hardware cache with re-reference interval
+ * prediction (RRIP) replacement: static (SRRIP), bimodal (BRRIP), or dynamic
+ * (DRRIP), which picks between the other two via set dueling.
+ */
+
+#ifndef _CACHE_RRIP_H_
+#define _CACHE_RRIP_H_ 1
+
+#include "cache.h"
+
+enum rrip_mode_t {
+    RRIP_STATIC,
+    RRIP_BIMODAL,
+    RRIP_DYNAMIC,
+};
+
+class cache_rrip_t : public cache_t {
+public:
+    explicit cache_rrip_t(rrip_mode_t mode);
+
+protected:
+    void
+    access_update(int line_idx, int way) override;
+    int
+    replace_which_way(int line_idx) override;
+
+    // Returns whether a fill into the set starting at line_idx uses bimodal
+    // insertion, updating the set dueling selector if the set is a leader.
+    bool
+    use_bimodal_insertion(int line_idx);
+
+    rrip_mode_t mode_;
+    // The fill pending from replace_which_way(), consumed by access_update().
+    int fill_line_idx_;
+    int fill_way_;
+    int fill_rrpv_;
+    // Counts bimodal fills to insert every BIP_THROTTLE-th one at a near distance.
+    unsigned int bimodal_fills_;
+    // The set dueling policy selector, where high values favor bimodal insertion.
+    int psel_;
+};
+
+#endif /* _CACHE_RRIP_H_ */
@@ -30,6 +30,8 @@
  * DAMAGE.
  */
 
+#include <algorithm>
+#include <iomanip>
 #include <iostream>
 #include <iterator>
 #include <string>
@@ -46,6 +48,9 @@
 #include "cache.h"
 #include "cache_lru.h"
 #include "cache_fifo.h"
+#include "cache_plru.h"
+#include "cache_random.h"
+#include "cache_rrip.h"
 #include "cache_simulator.h"
 #include "droption.h"
 
@@ -154,10 +159,17 @@ cache_simulator_t::cache_simulator_t(const cache_simulator_knobs_t &knobs)
         all_caches_[cache_name] = l1_icaches_[i];
         cache_name = "L1_D_Cache_" + std::to_string(i);
         all_caches_[cache_name] = l1_dcaches_[i];
+        l1_icaches_[i]->set_latency(knobs_.L1I_latency, 0);
+        l1_dcaches_[i]->set_latency(knobs_.L1D_latency, 0);
     }
+    llc->set_latency(knobs_.LL_latency, knobs_.memory_latency);
+    if (!init_timing())
+        return;
+    init_miss_attribution();
 
     if (knobs_.model_coherence &&
-        !snoop_filter_->init(snooped_caches_, total_snooped_caches)) {
+        !snoop_filter_->init(snooped_caches_, total_snooped_caches,
+                             knobs_.snoop_filter_entries, knobs_.snoop_filter_assoc)) {
         ERRMSG("Usage error: failed to initialize snoop filter.\n");
         success_ = false;
         return;
@@ -319,6 +331,11 @@ cache_simulator_t::cache_simulator_t(const std::string &config_file)
             return;
         }
 
+        cache->set_latency(cache_config.latency,
+                           cache_config.parent == CACHE_PARENT_MEMORY
+                               ? knobs_.memory_latency
+                               : 0);
+
         // Next snooped cache should have a different ID.
         if (is_snooped) {
             snooped_caches_[snoop_id] = cache;
@@ -351,11 +368,40 @@ cache_simulator_t::cache_simulator_t(const std::string &config_file)
             other_caches_[cache_name] = cache;
         }
     }
-    if (knobs_.model_coherence && !snoop_filter_->init(snooped_caches_, snoop_id)) {
+    if (knobs_.model_coherence &&
+        !snoop_filter_->init(snooped_caches_, snoop_id, knobs_.snoop_filter_entries,
+                             knobs_.snoop_filter_assoc)) {
         ERRMSG("Usage error: failed to initialize snoop filter.\n");
         success_ = false;
         return;
     }
+    if (!init_timing())
+        return;
+    init_miss_attribution();
+}
+
+void
+cache_simulator_t::init_miss_attribution()
+{
+    for (auto &caches_it : all_caches_)
+        caches_it.second->get_stats()->set_miss_attribution(knobs_.miss_attribution_top);
+}
+
+bool
+cache_simulator_t::init_timing()
+{
+    if (knobs_.memory_latency == 0)
+        return true;
+    timing_.resize(knobs_.num_cores);
+    for (auto &timing : timing_) {
+        if (!timing.init(knobs_.num_mshrs, knobs_.rob_size)) {
+            error_string_ = "Usage error: failed to initialize timing estimates.  "
+                            "Ensure mshrs and rob_size are non-zero.";
+            success_ = false;
+            return false;
+        }
+    }
+    return true;
 }
 
 cache_simulator_t::~cache_simulator_t()
@@ -441,6 +487,10 @@ cache_simulator_t::process_memref(const memref_t &memref)
                       << memref.instr.size << "\n";
         }
         l1_icaches_[core]->request(memref);
+        if (!timing_.empty() && type_is_instr(memref.instr.type)) {
+            timing_[core].instr_fetch(memref, l1_icaches_[core]->get_last_latency(),
+                                      l1_icaches_[core]->get_hit_latency());
+        }
     } else if (memref.data.type == TRACE_TYPE_READ ||
                memref.data.type == TRACE_TYPE_WRITE ||
                // We may potentially handle prefetches differently.
@@ -453,6 +503,10 @@ cache_simulator_t::process_memref(const memref_t &memref)
                       << (void *)memref.data.addr << " x" << memref.data.size << "\n";
         }
         l1_dcaches_[core]->request(memref);
+        if (!timing_.empty() && memref.data.type == TRACE_TYPE_READ) {
+            timing_[core].data_load(memref, l1_dcaches_[core]->get_last_latency(),
+                                    l1_dcaches_[core]->get_hit_latency());
+        }
     } else if (memref.flush.type == TRACE_TYPE_INSTR_FLUSH) {
         if (knobs_.verbose >= 3) {
             std::cerr << "::" << memref.data.pid << "." << memref.data.tid << ":: "
@@ -488,6 +542,8 @@ cache_simulator_t::process_memref(const memref_t &memref)
             cache_t *cache = cache_it.second;
             cache->get_stats()->reset();
         }
+        for (auto &timing : timing_)
+            timing.reset();
         if (knobs_.verbose >= 1) {
             std::cerr << "Cache simulation warmed up\n";
         }
@@ -556,6 +612,11 @@ cache_simulator_t::print_results()
                 std::cerr << "  unified L1 stats:" << std::endl;
                 l1_icaches_[i]->get_stats()->print_stats("    ");
             }
+            if (!timing_.empty()) {
+                timing_[i].drain();
+                std::cerr << "  Timing estimates:" << std::endl;
+                timing_[i].print_stats("    ");
+            }
         }
     }
 
@@ -575,9 +636,60 @@ cache_simulator_t::print_results()
         snoop_filter_->print_stats();
     }
 
+    if (!timing_.empty())
+        print_stall_attribution();
+
     return true;
 }
 
+void
+cache_simulator_t::print_stall_attribution()
+{
+    const size_t report_top = 10;
+    std::unordered_map<addr_t, int_least64_t> by_pc;
+    std::unordered_map<memref_tid_t, int_least64_t> by_thread;
+    for (const auto &timing : timing_) {
+        for (const auto &it : timing.get_stalls_by_pc())
+            by_pc[it.first] += it.second;
+        for (const auto &it : timing.get_stalls_by_thread())
+            by_thread[it.first] += it.second;
+    }
+    std::vector<std::pair<addr_t, int_least64_t>> top_pcs(by_pc.begin(), by_pc.end());
+    std::sort(top_pcs.begin(), top_pcs.end(),
+              [](const std::pair<addr_t, int_least64_t> &l,
+                 const std::pair<addr_t, int_least64_t> &r) {
+                  return l.second > r.second ||
+                      (l.second == r.second && l.first < r.first);
+              });
+    if (top_pcs.size() > report_top)
+        top_pcs.resize(report_top);
+    std::vector<std::pair<memref_tid_t, int_least64_t>> threads(by_thread.begin(),
+                                                                 by_thread.end());
+    std::sort(threads.begin(), threads.end());
+
+    std::cerr.imbue(std::locale("")); // Add commas, at least for my locale.
+    std::cerr << "Estimated stall cycles by PC (top " << report_top << "):" << std::endl;
+    for (const auto &it : top_pcs) {
+        std::cerr << "    " << std::setw(18) << std::left << to_hex_string(it.first)
+                  << std::setw(20) << std::right << it.second << std::endl;
+    }
+    std::cerr << "Estimated stall cycles by thread:" << std::endl;
+    for (const auto &it : threads) {
+        std::cerr << "    " << std::setw(18) << std::left << it.first << std::setw(20)
+                  << std::right << it.second << std::endl;
+    }
+    std::cerr.imbue(std::locale("C")); // Reset to avoid affecting later prints.
+}
+
+const cache_t *
+cache_simulator_t::get_cache(const std::string &name) const
+{
+    auto it = all_caches_.find(name);
+    if (it == all_caches_.end())
+        return nullptr;
+    return it->second;
+}
+
 cache_t *
 cache_simulator_t::create_cache(const std::string &policy)
 {
@@ -588,9 +700,22 @@ cache_simulator_t::create_cache(const std::string &policy)
         return new cache_t;
     if (policy == REPLACE_POLICY_FIFO) // set to FIFO
         return new cache_fifo_t;
+    if (policy == REPLACE_POLICY_SRRIP)
+        return new cache_rrip_t(RRIP_STATIC);
+    if (policy == REPLACE_POLICY_BRRIP)
+        return new cache_rrip_t(RRIP_BIMODAL);
+    if (policy == REPLACE_POLICY_DRRIP)
+        return new cache_rrip_t(RRIP_DYNAMIC);
+    if (policy == REPLACE_POLICY_RANDOM)
+        return new cache_random_t;
+    if (policy == REPLACE_POLICY_PLRU)
+        return new cache_plru_t;
 
     // undefined replacement policy
     ERRMSG("Usage error: undefined replacement policy. "
-           "Please choose " REPLACE_POLICY_LRU " or " REPLACE_POLICY_LFU ".\n");
+           "Please choose " REPLACE_POLICY_LRU ", " REPLACE_POLICY_LFU
+           ", " REPLACE_POLICY_FIFO ", " REPLACE_POLICY_SRRIP ", " REPLACE_POLICY_BRRIP
+           ", " REPLACE_POLICY_DRRIP ", " REPLACE_POLICY_RANDOM
+           ", or " REPLACE_POLICY_PLRU ".\n");
     return NULL;
 }
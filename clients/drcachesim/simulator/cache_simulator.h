@@ -37,10 +37,12 @@
 #define _CACHE_SIMULATOR_H_ 1
 
 #include <unordered_map>
+#include <vector>
 #include "simulator.h"
 #include "cache_simulator_create.h"
 #include "cache_stats.h"
 #include "cache.h"
+#include "core_timing.h"
 #include "snoop_filter.h"
 
 class cache_simulator_t : public simulator_t {
@@ -60,6 +62,12 @@ public:
     bool
     print_results() override;
 
+    // Returns the cache with the given name, or nullptr if there is none.
+    // The L1 caches configured by knobs are named "L1_I_Cache_<core>" and
+    // "L1_D_Cache_<core>", and their shared LLC is named "LL".
+    const cache_t *
+    get_cache(const std::string &name) const;
+
     // Exposed to make it easy to test
     bool
     check_warmed_up();
@@ -71,6 +79,15 @@ protected:
     virtual cache_t *
     create_cache(const std::string &policy);
 
+    // Sets up timing estimates if enabled by the knobs.  Returns false on failure.
+    bool
+    init_timing();
+    // Enables per-PC miss counting in every cache if requested by the knobs.
+    void
+    init_miss_attribution();
+    void
+    print_stall_attribution();
+
     cache_simulator_knobs_t knobs_;
 
     // Implement a set of ICaches and DCaches with pointer arrays.
@@ -91,6 +108,9 @@ protected:
     // Snoop filter tracks ownership of cache lines across private caches.
     snoop_filter_t *snoop_filter_ = nullptr;
 
+    // Per-core timing estimates, empty unless enabled.
+    std::vector<core_timing_t> timing_;
+
 private:
     bool is_warmed_up_;
 };
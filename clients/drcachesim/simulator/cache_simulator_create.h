@@ -60,6 +60,8 @@ struct cache_simulator_knobs_t {
         , LL_assoc(16)
         , LL_miss_file("")
         , model_coherence(false)
+        , snoop_filter_entries(0)
+        , snoop_filter_assoc(16)
         , replace_policy("LRU")
         , data_prefetcher("nextline")
         , skip_refs(0)
@@ -68,6 +70,13 @@ struct cache_simulator_knobs_t {
         , sim_refs(1ULL << 63)
         , cpu_scheduling(false)
         , verbose(0)
+        , L1I_latency(4)
+        , L1D_latency(4)
+        , LL_latency(40)
+        , memory_latency(0)
+        , num_mshrs(10)
+        , rob_size(224)
+        , miss_attribution_top(0)
     {
     }
     unsigned int num_cores;
@@ -80,6 +89,8 @@ struct cache_simulator_knobs_t {
     unsigned int LL_assoc;
     std::string LL_miss_file;
     bool model_coherence;
+    unsigned int snoop_filter_entries;
+    unsigned int snoop_filter_assoc;
     std::string replace_policy;
     std::string data_prefetcher;
     uint64_t skip_refs;
@@ -88,6 +99,16 @@ struct cache_simulator_knobs_t {
     uint64_t sim_refs;
     bool cpu_scheduling;
     unsigned int verbose;
+    // Timing estimates are enabled by a non-zero memory_latency.  The latencies are
+    // in cycles.
+    unsigned int L1I_latency;
+    unsigned int L1D_latency;
+    unsigned int LL_latency;
+    unsigned int memory_latency;
+    unsigned int num_mshrs;
+    unsigned int rob_size;
+    // The number of top-missing PCs to report per cache, or 0 to disable.
+    unsigned int miss_attribution_top;
 };
 
 /** Creates an instance of a cache simulator with a 2-level hierarchy. */
@@ -107,4 +128,12 @@ cache_miss_analyzer_create(const cache_simulator_knobs_t &knobs,
                            unsigned int miss_count_threshold, double miss_frac_threshold,
                            double confidence_threshold);
 
+/**
+ * Creates an instance of a tool that simulates the 2-level hierarchy described by
+ * \p knobs once for each supported replacement policy, in a single pass over the
+ * trace, and compares their miss rates.  The replace_policy knob is ignored.
+ */
+analysis_tool_t *
+policy_compare_create(const cache_simulator_knobs_t &knobs);
+
 #endif /* _CACHE_SIMULATOR_CREATE_H_ */
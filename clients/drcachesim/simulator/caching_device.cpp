@@ -42,6 +42,9 @@ caching_device_t::caching_device_t()
     : blocks_(NULL)
     , stats_(NULL)
     , prefetcher_(NULL)
+    , hit_latency_(0)
+    , memory_latency_(0)
+    , last_latency_(0)
 {
     /* Empty. */
 }
@@ -111,6 +114,7 @@ caching_device_t::request(const memref_t &memref_in)
     addr_t final_addr = memref_in.data.addr + memref_in.data.size - 1 /*avoid overflow*/;
     addr_t final_tag = compute_tag(final_addr);
     addr_t tag = compute_tag(memref_in.data.addr);
+    int latency = hit_latency_;
 
     // Optimization: check last tag if single-block
     if (tag == final_tag && tag == last_tag_ && memref_in.data.type != TRACE_TYPE_WRITE) {
@@ -122,6 +126,7 @@ caching_device_t::request(const memref_t &memref_in)
         if (parent_ != NULL)
             parent_->stats_->child_access(memref_in, true, cache_block);
         access_update(last_block_idx_, last_way_);
+        last_latency_ = latency;
         return;
     }
 
@@ -172,7 +177,10 @@ caching_device_t::request(const memref_t &memref_in)
             if (parent_ != NULL) {
                 parent_->stats_->child_access(memref, false, cache_block);
                 parent_->request(memref);
-            }
+                if (hit_latency_ + parent_->last_latency_ > latency)
+                    latency = hit_latency_ + parent_->last_latency_;
+            } else if (hit_latency_ + memory_latency_ > latency)
+                latency = hit_latency_ + memory_latency_;
             if (snoop_filter_ != NULL) {
                 // Update snoop filter, other private caches invalidated on write.
                 snoop_filter_->snoop(tag, id_, (memref.data.type == TRACE_TYPE_WRITE));
@@ -236,6 +244,8 @@ caching_device_t::request(const memref_t &memref_in)
         last_way_ = way;
         last_block_idx_ = block_idx;
     }
+    // Set this last, as a prefetch above issues its own request.
+    last_latency_ = latency;
 }
 
 void
@@ -99,6 +99,27 @@ public:
     {
         return double(loaded_blocks_) / num_blocks_;
     }
+    // For timing estimates: hit_latency is the cycles to look up this device, and
+    // memory_latency is added on misses in a device without a parent.
+    void
+    set_latency(int hit_latency, int memory_latency)
+    {
+        hit_latency_ = hit_latency;
+        memory_latency_ = memory_latency;
+    }
+    int
+    get_hit_latency() const
+    {
+        return hit_latency_;
+    }
+    // Returns the estimated cycles taken by the most recent request(), including
+    // any parent devices and memory.  Blocks of a multi-block request are assumed
+    // to be fetched in parallel.
+    int
+    get_last_latency() const
+    {
+        return last_latency_;
+    }
 
 protected:
     virtual void
@@ -161,6 +182,10 @@ protected:
     addr_t last_tag_;
     int last_way_;
     int last_block_idx_;
+
+    int hit_latency_;
+    int memory_latency_;
+    int last_latency_;
 };
 
 #endif /* _CACHING_DEVICE_H_ */
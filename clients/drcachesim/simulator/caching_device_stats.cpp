@@ -34,6 +34,7 @@
 #include <iostream>
 #include <iomanip>
 #include "caching_device_stats.h"
+#include "../common/utils.h"
 
 caching_device_stats_t::caching_device_stats_t(const std::string &miss_file,
                                                bool warmup_enabled, bool is_coherent)
@@ -48,6 +49,7 @@ caching_device_stats_t::caching_device_stats_t(const std::string &miss_file,
     , num_child_hits_at_reset_(0)
     , warmup_enabled_(warmup_enabled)
     , is_coherent_(is_coherent)
+    , miss_attribution_top_(0)
     , file_(nullptr)
 {
     if (miss_file.empty()) {
@@ -87,6 +89,8 @@ caching_device_stats_t::access(const memref_t &memref, bool hit,
         num_hits_++;
     else {
         num_misses_++;
+        if (miss_attribution_top_ > 0)
+            miss_pcs_.add_miss(get_miss_pc(memref));
         if (dump_misses_)
             dump_miss(memref);
     }
@@ -101,19 +105,22 @@ caching_device_stats_t::child_access(const memref_t &memref, bool hit,
     // else being computed in access()
 }
 
+addr_t
+caching_device_stats_t::get_miss_pc(const memref_t &memref)
+{
+    if (type_is_instr(memref.data.type))
+        return memref.instr.addr;
+    // data ref: others shouldn't get here
+    assert(type_is_prefetch(memref.data.type) || memref.data.type == TRACE_TYPE_READ ||
+           memref.data.type == TRACE_TYPE_WRITE);
+    return memref.data.pc;
+}
+
 void
 caching_device_stats_t::dump_miss(const memref_t &memref)
 {
-    addr_t pc, addr;
-    if (type_is_instr(memref.data.type))
-        pc = memref.instr.addr;
-    else { // data ref: others shouldn't get here
-        assert(type_is_prefetch(memref.data.type) ||
-               memref.data.type == TRACE_TYPE_READ ||
-               memref.data.type == TRACE_TYPE_WRITE);
-        pc = memref.data.pc;
-    }
-    addr = memref.data.addr;
+    addr_t pc = get_miss_pc(memref);
+    addr_t addr = memref.data.addr;
 #ifdef HAS_ZLIB
     gzprintf(file_, "0x%zx,0x%zx\n", pc, addr);
 #else
@@ -181,6 +188,22 @@ caching_device_stats_t::print_child_stats(std::string prefix)
     }
 }
 
+void
+caching_device_stats_t::print_miss_attribution(std::string prefix)
+{
+    if (miss_attribution_top_ == 0 || miss_pcs_.size() == 0)
+        return;
+    std::cerr << prefix << "Top " << miss_attribution_top_ << " of "
+              << miss_pcs_.size() << " PCs by misses:" << std::endl;
+    for (const auto &pc_misses : miss_pcs_.top(miss_attribution_top_)) {
+        std::cerr << prefix << "  " << std::setw(18) << std::left
+                  << to_hex_string(pc_misses.first) << std::setw(18) << std::right
+                  << pc_misses.second << std::setw(10) << std::fixed
+                  << std::setprecision(2)
+                  << ((float)pc_misses.second * 100 / num_misses_) << "%" << std::endl;
+    }
+}
+
 void
 caching_device_stats_t::print_stats(std::string prefix)
 {
@@ -191,6 +214,7 @@ caching_device_stats_t::print_stats(std::string prefix)
     print_counts(prefix);
     print_rates(prefix);
     print_child_stats(prefix);
+    print_miss_attribution(prefix);
     std::cerr.imbue(std::locale("C")); // Reset to avoid affecting later prints.
 }
 
@@ -205,6 +229,7 @@ caching_device_stats_t::reset()
     num_child_hits_ = 0;
     num_inclusive_invalidates_ = 0;
     num_coherence_invalidates_ = 0;
+    miss_pcs_.clear();
 }
 
 void
@@ -43,6 +43,7 @@
 #    include <zlib.h>
 #endif
 #include "memref.h"
+#include "pc_miss_table.h"
 
 enum invalidation_type_t {
     INVALIDATION_INCLUSIVE,
@@ -72,6 +73,25 @@ public:
     virtual void
     reset();
 
+    int_least64_t
+    get_hits() const
+    {
+        return num_hits_;
+    }
+    int_least64_t
+    get_misses() const
+    {
+        return num_misses_;
+    }
+
+    // Enables counting misses per PC, reporting the top_n PCs with print_stats().
+    // A top_n of 0 disables counting.
+    void
+    set_miss_attribution(unsigned int top_n)
+    {
+        miss_attribution_top_ = top_n;
+    }
+
     virtual bool operator!()
     {
         return !success_;
@@ -94,9 +114,15 @@ protected:
     virtual void
     print_child_stats(std::string prefix); // child/total info
 
+    virtual void
+    print_miss_attribution(std::string prefix); // top missing PCs
+
     virtual void
     dump_miss(const memref_t &memref);
 
+    static addr_t
+    get_miss_pc(const memref_t &memref);
+
     int_least64_t num_hits_;
     int_least64_t num_misses_;
     int_least64_t num_child_hits_;
@@ -115,6 +141,10 @@ protected:
     // Print out write invalidations if cache is coherent.
     bool is_coherent_;
 
+    // Misses by PC, counted only if miss_attribution_top_ is non-zero.
+    unsigned int miss_attribution_top_;
+    pc_miss_table_t miss_pcs_;
+
     // We provide a feature of dumping misses to a file.
     bool dump_misses_;
 #ifdef HAS_ZLIB
@@ -0,0 +1,183 @@
+/* **********************************************************
+ * Copyright (c) 2020 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+#include "core_timing.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+core_timing_t::core_timing_t()
+    : num_mshrs_(1)
+    , rob_size_(1)
+{
+    reset();
+}
+
+bool
+core_timing_t::init(int num_mshrs, int rob_size)
+{
+    if (num_mshrs <= 0 || rob_size <= 0)
+        return false;
+    num_mshrs_ = num_mshrs;
+    rob_size_ = rob_size;
+    reset();
+    return true;
+}
+
+void
+core_timing_t::reset()
+{
+    cycle_ = 0;
+    num_instrs_ = 0;
+    pending_.clear();
+    mshrs_.clear();
+    num_long_loads_ = 0;
+    total_miss_latency_ = 0;
+    miss_busy_cycles_ = 0;
+    miss_busy_until_ = 0;
+    stall_ifetch_ = 0;
+    stall_rob_ = 0;
+    stall_mshr_ = 0;
+    stalls_by_pc_.clear();
+    stalls_by_thread_.clear();
+}
+
+void
+core_timing_t::stall_until(int_least64_t cycle, addr_t pc, memref_tid_t tid,
+                           int_least64_t &category)
+{
+    if (cycle <= cycle_)
+        return;
+    int_least64_t stall = cycle - cycle_;
+    cycle_ = cycle;
+    category += stall;
+    stalls_by_pc_[pc] += stall;
+    stalls_by_thread_[tid] += stall;
+}
+
+void
+core_timing_t::retire_completed()
+{
+    while (!pending_.empty() && pending_.front().complete_cycle <= cycle_)
+        pending_.pop_front();
+    // MSHRs are few, so a linear scan is cheaper than a heap.
+    mshrs_.erase(std::remove_if(mshrs_.begin(), mshrs_.end(),
+                                [this](int_least64_t done) { return done <= cycle_; }),
+                 mshrs_.end());
+}
+
+void
+core_timing_t::instr_fetch(const memref_t &memref, int latency, int l1_latency)
+{
+    ++num_instrs_;
+    ++cycle_;
+    if (latency > l1_latency) {
+        stall_until(cycle_ + latency - l1_latency, memref.instr.addr, memref.instr.tid,
+                    stall_ifetch_);
+    }
+    // The oldest incomplete load blocks dispatch once the ROB fills behind it.
+    while (!pending_.empty() && pending_.front().instr_idx + rob_size_ <= num_instrs_) {
+        const pending_load_t &oldest = pending_.front();
+        stall_until(oldest.complete_cycle, oldest.pc, oldest.tid, stall_rob_);
+        pending_.pop_front();
+    }
+}
+
+void
+core_timing_t::data_load(const memref_t &memref, int latency, int l1_latency)
+{
+    if (latency <= l1_latency)
+        return;
+    retire_completed();
+    if ((int)mshrs_.size() >= num_mshrs_) {
+        auto earliest = std::min_element(mshrs_.begin(), mshrs_.end());
+        stall_until(*earliest, memref.data.pc, memref.data.tid, stall_mshr_);
+        retire_completed();
+    }
+    int_least64_t complete = cycle_ + latency;
+    mshrs_.push_back(complete);
+    pending_load_t load;
+    load.instr_idx = num_instrs_;
+    load.complete_cycle = complete;
+    load.pc = memref.data.pc;
+    load.tid = memref.data.tid;
+    pending_.push_back(load);
+    ++num_long_loads_;
+    total_miss_latency_ += latency;
+    // Issue cycles never decrease, so the busy intervals are a running union.
+    int_least64_t busy_start = std::max(cycle_, miss_busy_until_);
+    if (complete > busy_start) {
+        miss_busy_cycles_ += complete - busy_start;
+        miss_busy_until_ = complete;
+    }
+}
+
+void
+core_timing_t::drain()
+{
+    while (!pending_.empty()) {
+        const pending_load_t &oldest = pending_.front();
+        stall_until(oldest.complete_cycle, oldest.pc, oldest.tid, stall_rob_);
+        pending_.pop_front();
+    }
+    mshrs_.clear();
+}
+
+void
+core_timing_t::print_stats(std::string prefix)
+{
+    std::cerr.imbue(std::locale("")); // Add commas, at least for my locale.
+    std::cerr << prefix << std::setw(18) << std::left << "Instructions:" << std::setw(20)
+              << std::right << num_instrs_ << std::endl;
+    std::cerr << prefix << std::setw(18) << std::left << "Est. cycles:" << std::setw(20)
+              << std::right << cycle_ << std::endl;
+    if (num_instrs_ > 0) {
+        std::cerr << prefix << std::setw(18) << std::left << "Est. CPI:" << std::setw(20)
+                  << std::fixed << std::setprecision(2) << std::right
+                  << ((double)cycle_ / num_instrs_) << std::endl;
+    }
+    std::cerr << prefix << std::setw(18) << std::left << "Ifetch stalls:" << std::setw(20)
+              << std::right << stall_ifetch_ << std::endl;
+    std::cerr << prefix << std::setw(18) << std::left << "ROB-full stalls:"
+              << std::setw(20) << std::right << stall_rob_ << std::endl;
+    std::cerr << prefix << std::setw(18) << std::left << "MSHR-full stalls:"
+              << std::setw(20) << std::right << stall_mshr_ << std::endl;
+    std::cerr << prefix << std::setw(18) << std::left << "L1D miss loads:"
+              << std::setw(20) << std::right << num_long_loads_ << std::endl;
+    if (miss_busy_cycles_ > 0) {
+        std::cerr << prefix << std::setw(18) << std::left << "Est. MLP:" << std::setw(20)
+                  << std::fixed << std::setprecision(2) << std::right
+                  << ((double)total_miss_latency_ / miss_busy_cycles_) << std::endl;
+    }
+    std::cerr.imbue(std::locale("C")); // Reset to avoid affecting later prints.
+}
@@ -0,0 +1,124 @@
+/* **********************************************************
+ * Copyright (c) 2020 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+/* core_timing: estimates the cycles a core spends stalled on cache misses.
+ */
+
+#ifndef _CORE_TIMING_H_
+#define _CORE_TIMING_H_ 1
+
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "memref.h"
+
+// This is a simple first-order model of an out-of-order core, not a pipeline
+// simulator.  Instructions dispatch at one per cycle.  Hits in an L1 cache are
+// assumed to be hidden by the pipeline.  Instruction fetches that miss the L1
+// stall dispatch for their extra latency.  Loads that miss the L1 issue to one
+// of a limited number of miss status holding registers (MSHRs), stalling dispatch
+// when all are busy, and then overlap with later instructions until the reorder
+// buffer (ROB) fills: an instruction cannot dispatch until the load rob_size
+// instructions before it has completed.  Stores are assumed to be absorbed by a
+// store buffer.  Each stall is charged to the PC and thread of the instruction
+// whose miss caused it.
+class core_timing_t {
+public:
+    core_timing_t();
+    bool
+    init(int num_mshrs, int rob_size);
+    // The latencies are those of the full access and of an L1 hit.
+    void
+    instr_fetch(const memref_t &memref, int latency, int l1_latency);
+    void
+    data_load(const memref_t &memref, int latency, int l1_latency);
+    // Waits for outstanding misses, so that the cycle count covers all
+    // instructions seen so far.
+    void
+    drain();
+    void
+    reset();
+    void
+    print_stats(std::string prefix);
+
+    const std::unordered_map<addr_t, int_least64_t> &
+    get_stalls_by_pc() const
+    {
+        return stalls_by_pc_;
+    }
+    const std::unordered_map<memref_tid_t, int_least64_t> &
+    get_stalls_by_thread() const
+    {
+        return stalls_by_thread_;
+    }
+
+protected:
+    struct pending_load_t {
+        int_least64_t instr_idx;
+        int_least64_t complete_cycle;
+        addr_t pc;
+        memref_tid_t tid;
+    };
+
+    void
+    stall_until(int_least64_t cycle, addr_t pc, memref_tid_t tid,
+                int_least64_t &category);
+    void
+    retire_completed();
+
+    int num_mshrs_;
+    int rob_size_;
+
+    int_least64_t cycle_;
+    int_least64_t num_instrs_;
+    // Outstanding long-latency loads in program order.
+    std::deque<pending_load_t> pending_;
+    // Completion cycles of loads occupying MSHRs.
+    std::vector<int_least64_t> mshrs_;
+
+    int_least64_t num_long_loads_;
+    int_least64_t total_miss_latency_;
+    // Cycles with at least one miss outstanding, for estimating memory-level
+    // parallelism.
+    int_least64_t miss_busy_cycles_;
+    int_least64_t miss_busy_until_;
+
+    int_least64_t stall_ifetch_;
+    int_least64_t stall_rob_;
+    int_least64_t stall_mshr_;
+    std::unordered_map<addr_t, int_least64_t> stalls_by_pc_;
+    std::unordered_map<memref_tid_t, int_least64_t> stalls_by_thread_;
+};
+
+#endif /* _CORE_TIMING_H_ */
@@ -0,0 +1,173 @@
+/* **********************************************************
+ * Copyright (c) 2020 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+#include "page_walker.h"
+#include <iomanip>
+#include <iostream>
+
+page_walker_t::page_walker_t()
+    : walk_cache_entries_(0)
+    , mem_access_latency_(0)
+    , timestamp_(0)
+{
+    reset();
+}
+
+bool
+page_walker_t::init(int walk_cache_entries, int mem_access_latency)
+{
+    if (walk_cache_entries < 0 || mem_access_latency < 0)
+        return false;
+    walk_cache_entries_ = walk_cache_entries;
+    mem_access_latency_ = mem_access_latency;
+    for (int level = 0; level <= PAGE_TABLE_LEVELS; ++level)
+        walk_cache_[level].clear();
+    reset();
+    return true;
+}
+
+int
+page_walker_t::leaf_level(int page_bits)
+{
+    int level = 1;
+    while (level < PAGE_TABLE_LEVELS - 1 && level_shift(level + 1) <= page_bits)
+        ++level;
+    return level;
+}
+
+bool
+page_walker_t::walk_cache_lookup(int level, memref_pid_t pid, addr_t addr)
+{
+    addr_t tag = addr >> level_shift(level);
+    for (auto &entry : walk_cache_[level]) {
+        if (entry.tag == tag && entry.pid == pid) {
+            entry.last_use = timestamp_;
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+page_walker_t::walk_cache_insert(int level, memref_pid_t pid, addr_t addr)
+{
+    std::vector<walk_cache_entry_t> &cache = walk_cache_[level];
+    walk_cache_entry_t *victim;
+    if ((int)cache.size() < walk_cache_entries_) {
+        cache.emplace_back();
+        victim = &cache.back();
+    } else {
+        victim = &cache[0];
+        for (auto &entry : cache) {
+            if (entry.last_use < victim->last_use)
+                victim = &entry;
+        }
+    }
+    victim->tag = addr >> level_shift(level);
+    victim->pid = pid;
+    victim->last_use = timestamp_;
+}
+
+int_least64_t
+page_walker_t::walk(memref_pid_t pid, addr_t addr, int page_bits)
+{
+    ++timestamp_;
+    int leaf = leaf_level(page_bits);
+    // Find the lowest cached non-leaf level: the walk resumes just below it.
+    int first_uncached = PAGE_TABLE_LEVELS;
+    if (walk_cache_entries_ > 0) {
+        for (int level = leaf + 1; level <= PAGE_TABLE_LEVELS; ++level) {
+            if (walk_cache_lookup(level, pid, addr)) {
+                num_walk_cache_hits_[level]++;
+                first_uncached = level - 1;
+                break;
+            }
+        }
+        // Fill the caches for each non-leaf level we had to read.
+        for (int level = leaf + 1; level <= first_uncached; ++level)
+            walk_cache_insert(level, pid, addr);
+    }
+    int accesses = first_uncached - leaf + 1;
+    int_least64_t cycles = (int_least64_t)accesses * mem_access_latency_;
+    num_walks_++;
+    num_walks_by_leaf_[leaf]++;
+    num_walk_mem_accesses_ += accesses;
+    num_walk_cycles_ += cycles;
+    return cycles;
+}
+
+void
+page_walker_t::print_stats(std::string prefix)
+{
+    static const char *const leaf_names[] = { "", "4K", "2M", "1G", "512G" };
+    std::cerr.imbue(std::locale("")); // Add commas, at least for my locale.
+    std::cerr << prefix << std::setw(18) << std::left << "Page walks:" << std::setw(20)
+              << std::right << num_walks_ << std::endl;
+    for (int level = 1; level < PAGE_TABLE_LEVELS; ++level) {
+        if (num_walks_by_leaf_[level] == 0)
+            continue;
+        std::string label = std::string("  for ") + leaf_names[level] + " pages:";
+        std::cerr << prefix << std::setw(18) << std::left << label << std::setw(20)
+                  << std::right << num_walks_by_leaf_[level] << std::endl;
+    }
+    std::cerr << prefix << std::setw(18) << std::left << "Walk mem accesses:"
+              << std::setw(20) << std::right << num_walk_mem_accesses_ << std::endl;
+    std::cerr << prefix << std::setw(18) << std::left << "Walk cycles:" << std::setw(20)
+              << std::right << num_walk_cycles_ << std::endl;
+    if (num_walks_ > 0) {
+        std::cerr << prefix << std::setw(18) << std::left
+                  << "Cycles per walk:" << std::setw(20) << std::fixed
+                  << std::setprecision(2) << std::right
+                  << ((double)num_walk_cycles_ / num_walks_) << std::endl;
+    }
+    if (walk_cache_entries_ > 0) {
+        for (int level = 2; level <= PAGE_TABLE_LEVELS; ++level) {
+            std::string label = "L" + std::to_string(level) + " cache hits:";
+            std::cerr << prefix << std::setw(18) << std::left << label << std::setw(20)
+                      << std::right << num_walk_cache_hits_[level] << std::endl;
+        }
+    }
+    std::cerr.imbue(std::locale("C")); // Reset to avoid affecting later prints.
+}
+
+void
+page_walker_t::reset()
+{
+    num_walks_ = 0;
+    num_walk_mem_accesses_ = 0;
+    num_walk_cycles_ = 0;
+    for (int level = 0; level <= PAGE_TABLE_LEVELS; ++level) {
+        num_walk_cache_hits_[level] = 0;
+        num_walks_by_leaf_[level] = 0;
+    }
+}
@@ -0,0 +1,109 @@
+/* **********************************************************
+ * Copyright (c) 2020 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+/* page_walker: models the hardware page table walk performed on a last-level
+ * TLB miss, including the paging-structure caches that let a walk skip upper
+ * levels of the page table.
+ */
+
+#ifndef _PAGE_WALKER_H_
+#define _PAGE_WALKER_H_ 1
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "memref.h"
+
+// We model an x86-64 style radix page table with 4 levels of 512-entry tables
+// mapping 4K pages.  A leaf at level 1 maps a 4K page, at level 2 a 2M page,
+// and at level 3 a 1G page.  Each non-leaf level has its own small fully
+// associative LRU paging-structure cache (e.g., the "PDE cache" for level 2)
+// holding entries that point at the next-lower table.  A hit in the cache for
+// level L means only the levels below L need to be read from memory.
+// XXX: Page table reads are charged a fixed latency rather than being sent
+// through a simulated data cache hierarchy.
+class page_walker_t {
+public:
+    page_walker_t();
+    virtual ~page_walker_t()
+    {
+    }
+    // A walk_cache_entries of 0 disables the paging-structure caches.
+    virtual bool
+    init(int walk_cache_entries, int mem_access_latency);
+    // Walks the page table for the page of size 1<<page_bits containing addr.
+    // Returns the latency of the walk in cycles.
+    virtual int_least64_t
+    walk(memref_pid_t pid, addr_t addr, int page_bits);
+    virtual void
+    print_stats(std::string prefix);
+    virtual void
+    reset();
+
+    static const int PAGE_TABLE_LEVELS = 4;
+
+protected:
+    struct walk_cache_entry_t {
+        addr_t tag;
+        memref_pid_t pid;
+        int_least64_t last_use;
+    };
+
+    static inline int
+    level_shift(int level)
+    {
+        // Each level indexes 9 address bits above the 12 bits of a 4K page offset.
+        return 12 + 9 * (level - 1);
+    }
+    int
+    leaf_level(int page_bits);
+    bool
+    walk_cache_lookup(int level, memref_pid_t pid, addr_t addr);
+    void
+    walk_cache_insert(int level, memref_pid_t pid, addr_t addr);
+
+    int walk_cache_entries_;
+    int mem_access_latency_;
+    int_least64_t timestamp_;
+    // Indexed by level; levels 0 and 1 have no walk cache as level 1 holds leaves.
+    std::vector<walk_cache_entry_t> walk_cache_[PAGE_TABLE_LEVELS + 1];
+
+    int_least64_t num_walks_;
+    int_least64_t num_walk_mem_accesses_;
+    int_least64_t num_walk_cycles_;
+    int_least64_t num_walk_cache_hits_[PAGE_TABLE_LEVELS + 1];
+    // Indexed by leaf level, i.e., by page size.
+    int_least64_t num_walks_by_leaf_[PAGE_TABLE_LEVELS + 1];
+};
+
+#endif /* _PAGE_WALKER_H_ */
@@ -0,0 +1,89 @@
+/* **********************************************************
+ * Copyright (c) 2020 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <algorithm>
+#include "pc_miss_table.h"
+
+static const int INITIAL_TABLE_BITS = 10;
+
+pc_miss_table_t::pc_miss_table_t()
+{
+    clear();
+}
+
+void
+pc_miss_table_t::clear()
+{
+    table_bits_ = INITIAL_TABLE_BITS;
+    entries_.assign((size_t)1 << table_bits_, entry_t{ 0, 0 });
+    mask_ = entries_.size() - 1;
+    num_pcs_ = 0;
+}
+
+void
+pc_miss_table_t::grow()
+{
+    std::vector<entry_t> old_entries;
+    old_entries.swap(entries_);
+    ++table_bits_;
+    entries_.assign((size_t)1 << table_bits_, entry_t{ 0, 0 });
+    mask_ = entries_.size() - 1;
+    for (const entry_t &entry : old_entries) {
+        if (entry.count == 0)
+            continue;
+        size_t idx = hash(entry.pc);
+        while (entries_[idx].count != 0)
+            idx = (idx + 1) & mask_;
+        entries_[idx] = entry;
+    }
+}
+
+std::vector<std::pair<addr_t, int_least64_t>>
+pc_miss_table_t::top(size_t n) const
+{
+    std::vector<std::pair<addr_t, int_least64_t>> pcs;
+    pcs.reserve(num_pcs_);
+    for (const entry_t &entry : entries_) {
+        if (entry.count != 0)
+            pcs.emplace_back(entry.pc, entry.count);
+    }
+    n = std::min(n, pcs.size());
+    // Break ties by PC so the output is deterministic.
+    std::partial_sort(pcs.begin(), pcs.begin() + n, pcs.end(),
+                      [](const std::pair<addr_t, int_least64_t> &l,
+                         const std::pair<addr_t, int_least64_t> &r) {
+                          return l.second > r.second ||
+                              (l.second == r.second && l.first < r.first);
+                      });
+    pcs.resize(n);
+    return pcs;
+}
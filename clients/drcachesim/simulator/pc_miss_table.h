@@ -0,0 +1,106 @@
+/* **********************************************************
+ * Copyright (c) 2020 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* pc_miss_table: a compact table of miss counts keyed by program counter.
+ */
+
+#ifndef _PC_MISS_TABLE_H_
+#define _PC_MISS_TABLE_H_ 1
+
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+#include "memref.h"
+
+// This is an open-addressing hashtable with linear probing, as it is updated on
+// every miss and a node-based map's allocation and pointer chasing per PC would
+// dominate the cost of simulating the miss itself.  Entries are never removed.
+class pc_miss_table_t {
+public:
+    pc_miss_table_t();
+
+    inline void
+    add_miss(addr_t pc)
+    {
+        size_t idx = hash(pc);
+        while (entries_[idx].count != 0) {
+            if (entries_[idx].pc == pc) {
+                ++entries_[idx].count;
+                return;
+            }
+            idx = (idx + 1) & mask_;
+        }
+        entries_[idx].pc = pc;
+        entries_[idx].count = 1;
+        // Keep the load factor at or below 1/2 so probe sequences stay short.
+        if (++num_pcs_ * 2 > entries_.size())
+            grow();
+    }
+
+    // Returns the n PCs with the most misses, in decreasing order of misses.
+    std::vector<std::pair<addr_t, int_least64_t>>
+    top(size_t n) const;
+
+    size_t
+    size() const
+    {
+        return num_pcs_;
+    }
+
+    void
+    clear();
+
+protected:
+    struct entry_t {
+        addr_t pc;
+        // A count of 0 marks an empty slot, which frees every PC value for use.
+        int_least64_t count;
+    };
+
+    inline size_t
+    hash(addr_t pc) const
+    {
+        // Fibonacci hashing spreads the low-entropy upper bits of code addresses.
+        return (size_t)((pc * 0x9e3779b97f4a7c15ULL) >> (64 - table_bits_));
+    }
+
+    void
+    grow();
+
+    std::vector<entry_t> entries_;
+    size_t mask_;
+    int table_bits_;
+    size_t num_pcs_;
+};
+
+#endif /* _PC_MISS_TABLE_H_ */
@@ -0,0 +1,138 @@
+/* **********************************************************
+ * Copyright (c) 2020 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <iomanip>
+#include <iostream>
+#include <locale>
+#include <sstream>
+#include "../common/options.h"
+#include "policy_compare.h"
+
+analysis_tool_t *
+policy_compare_create(const cache_simulator_knobs_t &knobs)
+{
+    return new policy_compare_t(knobs);
+}
+
+policy_compare_t::policy_compare_t(const cache_simulator_knobs_t &knobs)
+    : knobs_(knobs)
+    , policies_({ REPLACE_POLICY_LRU, REPLACE_POLICY_LFU, REPLACE_POLICY_FIFO,
+                  REPLACE_POLICY_SRRIP, REPLACE_POLICY_BRRIP, REPLACE_POLICY_DRRIP,
+                  REPLACE_POLICY_RANDOM, REPLACE_POLICY_PLRU })
+{
+    // Each simulator sees the same stream and so schedules threads onto cores
+    // identically, making the only difference between them the policy.
+    // Each would write the same miss file and we only report miss rates, so
+    // we disable miss files and timing.
+    cache_simulator_knobs_t policy_knobs = knobs;
+    policy_knobs.LL_miss_file = "";
+    policy_knobs.memory_latency = 0;
+    for (const auto &policy : policies_) {
+        policy_knobs.replace_policy = policy;
+        cache_simulator_t *sim = new cache_simulator_t(policy_knobs);
+        sims_.push_back(sim);
+        if (!*sim) {
+            error_string_ = policy + ": " + sim->get_error_string();
+            success_ = false;
+            return;
+        }
+    }
+}
+
+policy_compare_t::~policy_compare_t()
+{
+    for (auto sim : sims_)
+        delete sim;
+}
+
+bool
+policy_compare_t::process_memref(const memref_t &memref)
+{
+    for (size_t i = 0; i < sims_.size(); ++i) {
+        if (!sims_[i]->process_memref(memref)) {
+            error_string_ = policies_[i] + ": " + sims_[i]->get_error_string();
+            return false;
+        }
+    }
+    return true;
+}
+
+void
+policy_compare_t::sum_stats(const cache_simulator_t *sim, const std::string &prefix,
+                            int_least64_t *hits, int_least64_t *misses)
+{
+    *hits = 0;
+    *misses = 0;
+    for (unsigned int core = 0; core < knobs_.num_cores; ++core) {
+        const cache_t *cache = sim->get_cache(prefix + std::to_string(core));
+        if (cache == nullptr)
+            continue;
+        *hits += cache->get_stats()->get_hits();
+        *misses += cache->get_stats()->get_misses();
+    }
+}
+
+static std::string
+format_rate(int_least64_t hits, int_least64_t misses)
+{
+    std::ostringstream rate;
+    rate << std::fixed << std::setprecision(2);
+    if (hits + misses == 0)
+        rate << 0.0;
+    else
+        rate << 100.0 * misses / (hits + misses);
+    rate << "%";
+    return rate.str();
+}
+
+bool
+policy_compare_t::print_results()
+{
+    std::cerr << "Replacement policy comparison (miss rates; LL is local):\n";
+    std::cerr << std::setw(8) << std::left << "Policy" << std::setw(16) << std::right
+              << "L1I" << std::setw(16) << "L1D" << std::setw(16) << "LL"
+              << std::setw(20) << "LL misses" << std::endl;
+    std::cerr.imbue(std::locale("")); // Add commas, at least for my locale.
+    for (size_t i = 0; i < sims_.size(); ++i) {
+        int_least64_t l1i_hits, l1i_misses, l1d_hits, l1d_misses;
+        sum_stats(sims_[i], "L1_I_Cache_", &l1i_hits, &l1i_misses);
+        sum_stats(sims_[i], "L1_D_Cache_", &l1d_hits, &l1d_misses);
+        const caching_device_stats_t *ll_stats = sims_[i]->get_cache("LL")->get_stats();
+        std::cerr << std::setw(8) << std::left << policies_[i] << std::setw(16)
+                  << std::right << format_rate(l1i_hits, l1i_misses) << std::setw(16)
+                  << format_rate(l1d_hits, l1d_misses) << std::setw(16)
+                  << format_rate(ll_stats->get_hits(), ll_stats->get_misses())
+                  << std::setw(20) << ll_stats->get_misses() << std::endl;
+    }
+    std::cerr.imbue(std::locale("C")); // Reset to avoid affecting later prints.
+    return true;
+}
@@ -0,0 +1,67 @@
+/* **********************************************************
+ * Copyright (c) 2020 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* policy_compare: simulates one cache hierarchy under each replacement policy
+ * in a single pass and compares the results.
+ */
+
+#ifndef _POLICY_COMPARE_H_
+#define _POLICY_COMPARE_H_ 1
+
+#include <string>
+#include <vector>
+#include "analysis_tool.h"
+#include "cache_simulator.h"
+#include "cache_simulator_create.h"
+
+class policy_compare_t : public analysis_tool_t {
+public:
+    policy_compare_t(const cache_simulator_knobs_t &knobs);
+    virtual ~policy_compare_t();
+    bool
+    process_memref(const memref_t &memref) override;
+    bool
+    print_results() override;
+
+protected:
+    // Sums the hits and misses of the named caches of one simulator.
+    void
+    sum_stats(const cache_simulator_t *sim, const std::string &prefix,
+              int_least64_t *hits, int_least64_t *misses);
+
+    cache_simulator_knobs_t knobs_;
+    std::vector<std::string> policies_;
+    // One simulator per entry in policies_.
+    std::vector<cache_simulator_t *> sims_;
+};
+
+#endif /* _POLICY_COMPARE_H_ */
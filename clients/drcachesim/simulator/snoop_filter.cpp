@@ -34,91 +34,219 @@
 #include <iostream>
 #include <iomanip>
 #include <assert.h>
-#include <algorithm>
+#include "../common/utils.h"
 
 snoop_filter_t::snoop_filter_t(void)
 {
 }
 
 bool
-snoop_filter_t::init(cache_t **caches, int num_snooped_caches)
+snoop_filter_t::init(cache_t **caches, int num_snooped_caches, int num_entries,
+                     int associativity)
 {
     caches_ = caches;
     num_snooped_caches_ = num_snooped_caches;
+    words_per_entry_ = (num_snooped_caches + BITS_PER_WORD - 1) / BITS_PER_WORD;
     num_writes_ = 0;
     num_writebacks_ = 0;
     num_invalidates_ = 0;
+    num_directory_evictions_ = 0;
+    num_eviction_invalidates_ = 0;
+    timestamp_ = 0;
 
+    bounded_ = num_entries > 0;
+    if (bounded_) {
+        if (!IS_POWER_OF_2(num_entries) || !IS_POWER_OF_2(associativity) ||
+            associativity > num_entries)
+            return false;
+        associativity_ = associativity;
+        sets_mask_ = num_entries / associativity - 1;
+        tags_.assign(num_entries, TAG_INVALID);
+        dirty_.assign(num_entries, false);
+        sharers_.assign((size_t)num_entries * words_per_entry_, 0);
+        last_use_.assign(num_entries, 0);
+    }
     return true;
 }
 
-/*  This function should be called for all misses in snooped caches_ as well as
- *  all writes to coherent caches_.
+int
+snoop_filter_t::count_sharers(int idx)
+{
+    int count = 0;
+    uint64_t *words = get_sharers(idx);
+    for (int i = 0; i < words_per_entry_; i++) {
+        for (uint64_t bits = words[i]; bits != 0; bits &= bits - 1)
+            count++;
+    }
+    return count;
+}
+
+int
+snoop_filter_t::find_entry(addr_t tag)
+{
+    if (bounded_) {
+        int base = (int)(tag & sets_mask_) * associativity_;
+        for (int way = 0; way < associativity_; way++) {
+            if (tags_[base + way] == tag)
+                return base + way;
+        }
+        return ENTRY_INVALID;
+    }
+    auto it = tag2entry_.find(tag);
+    if (it == tag2entry_.end())
+        return ENTRY_INVALID;
+    return it->second;
+}
+
+int
+snoop_filter_t::allocate_entry(addr_t tag)
+{
+    int idx;
+    if (bounded_) {
+        int base = (int)(tag & sets_mask_) * associativity_;
+        idx = base;
+        for (int way = 0; way < associativity_; way++) {
+            if (tags_[base + way] == TAG_INVALID) {
+                idx = base + way;
+                break;
+            }
+            if (last_use_[base + way] < last_use_[idx])
+                idx = base + way;
+        }
+        if (tags_[idx] != TAG_INVALID)
+            evict_entry(idx);
+    } else if (!free_entries_.empty()) {
+        idx = free_entries_.back();
+        free_entries_.pop_back();
+    } else {
+        idx = (int)tags_.size();
+        tags_.push_back(TAG_INVALID);
+        dirty_.push_back(false);
+        sharers_.resize(sharers_.size() + words_per_entry_, 0);
+    }
+    if (!bounded_)
+        tag2entry_[tag] = idx;
+    tags_[idx] = tag;
+    return idx;
+}
+
+/* Evicting a directory entry forces each cache sharing its line to drop it,
+ * since the line would otherwise be untracked.
  */
 void
-snoop_filter_t::snoop(addr_t tag, int id, bool is_write)
+snoop_filter_t::evict_entry(int idx)
 {
-    coherence_table_entry_t *coherence_entry = &coherence_table_[tag];
-    // Initialize new snoop filter entry.
-    if (coherence_entry->sharers.empty()) {
-        coherence_entry->sharers.resize(num_snooped_caches_, false);
-        coherence_entry->dirty = false;
+    num_directory_evictions_++;
+    if (dirty_[idx])
+        num_writebacks_++;
+    uint64_t *words = get_sharers(idx);
+    for (int i = 0; i < num_snooped_caches_; i++) {
+        if (words[i / BITS_PER_WORD] == 0) {
+            // Skip to the next word.
+            i |= BITS_PER_WORD - 1;
+            continue;
+        }
+        if (is_sharer(idx, i)) {
+            caches_[i]->invalidate(tags_[idx], INVALIDATION_COHERENCE);
+            num_eviction_invalidates_++;
+        }
     }
+    free_entry(idx);
+}
 
-    auto num_sharers = std::count(coherence_entry->sharers.begin(),
-                                  coherence_entry->sharers.end(), true);
+void
+snoop_filter_t::free_entry(int idx)
+{
+    if (!bounded_) {
+        tag2entry_.erase(tags_[idx]);
+        free_entries_.push_back(idx);
+    }
+    tags_[idx] = TAG_INVALID;
+    dirty_[idx] = false;
+    uint64_t *words = get_sharers(idx);
+    for (int i = 0; i < words_per_entry_; i++)
+        words[i] = 0;
+}
 
+/*  This function should be called for all misses in snooped caches_ as well as
+ *  all writes to coherent caches_.
+ */
+void
+snoop_filter_t::snoop(addr_t tag, int id, bool is_write)
+{
     // Check that cache id is valid.
     assert(id >= 0 && id < num_snooped_caches_);
     // Check that tag is valid.
     assert(tag != TAG_INVALID);
+
+    int idx = find_entry(tag);
+    // Initialize new snoop filter entry.
+    if (idx == ENTRY_INVALID)
+        idx = allocate_entry(tag);
+    if (bounded_)
+        last_use_[idx] = ++timestamp_;
+
     // Check that any dirty line is only held in one snooped cache.
-    assert(!coherence_entry->dirty || num_sharers == 1);
+    assert(!dirty_[idx] || count_sharers(idx) == 1);
 
     // Check if this request causes a writeback.
-    if (!coherence_entry->sharers[id] && coherence_entry->dirty) {
+    if (!is_sharer(idx, id) && dirty_[idx]) {
         num_writebacks_++;
-        coherence_entry->dirty = false;
+        dirty_[idx] = false;
     }
 
     if (is_write) {
         num_writes_++;
-        coherence_entry->dirty = true;
-        if (num_sharers > 0) {
-            // Writes will invalidate other caches_.
-            for (int i = 0; i < num_snooped_caches_; i++) {
-                if (coherence_entry->sharers[i] && id != i) {
-                    caches_[i]->invalidate(tag, INVALIDATION_COHERENCE);
-                    num_invalidates_++;
-                    coherence_entry->sharers[i] = false;
-                }
+        dirty_[idx] = true;
+        // Writes will invalidate other caches_.
+        uint64_t *words = get_sharers(idx);
+        for (int i = 0; i < num_snooped_caches_; i++) {
+            if (words[i / BITS_PER_WORD] == 0) {
+                // Skip to the next word.
+                i |= BITS_PER_WORD - 1;
+                continue;
+            }
+            if (is_sharer(idx, i) && id != i) {
+                caches_[i]->invalidate(tag, INVALIDATION_COHERENCE);
+                num_invalidates_++;
+                clear_sharer(idx, i);
             }
         }
     }
-    coherence_entry->sharers[id] = true;
+    set_sharer(idx, id);
 }
 
 /* This function is called whenever a coherent cache evicts a line. */
 void
 snoop_filter_t::snoop_eviction(addr_t tag, int id)
 {
-    coherence_table_entry_t *coherence_entry = &coherence_table_[tag];
+    int idx = find_entry(tag);
 
-    // Check if sharer list is initialized.
-    assert(coherence_entry->sharers.size() == (uint64_t)num_snooped_caches_);
+    // Check that the line is tracked: lines whose directory entry is evicted
+    // are invalidated in all caches.
+    assert(idx != ENTRY_INVALID);
     // Check that cache id is valid.
     assert(id >= 0 && id < num_snooped_caches_);
     // Check that tag is valid.
     assert(tag != TAG_INVALID);
+    if (idx == ENTRY_INVALID)
+        return;
     // Check that we currently have this cache marked as a sharer.
-    assert(coherence_entry->sharers[id]);
+    assert(is_sharer(idx, id));
 
-    if (coherence_entry->dirty) {
+    if (dirty_[idx]) {
         num_writebacks_++;
-        coherence_entry->dirty = false;
+        dirty_[idx] = false;
     }
 
-    coherence_entry->sharers[id] = false;
+    clear_sharer(idx, id);
+    uint64_t *words = get_sharers(idx);
+    for (int i = 0; i < words_per_entry_; i++) {
+        if (words[i] != 0)
+            return;
+    }
+    // No cache holds the line anymore.
+    free_entry(idx);
 }
 
 void
@@ -133,5 +261,13 @@ snoop_filter_t::print_stats(void)
               << std::right << num_invalidates_ << std::endl;
     std::cerr << prefix << std::setw(18) << std::left << "Writebacks:" << std::setw(20)
               << std::right << num_writebacks_ << std::endl;
+    if (bounded_) {
+        std::cerr << prefix << std::setw(21) << std::left
+                  << "Directory evictions:" << std::setw(17) << std::right
+                  << num_directory_evictions_ << std::endl;
+        std::cerr << prefix << std::setw(24) << std::left
+                  << "Eviction invalidations:" << std::setw(14) << std::right
+                  << num_eviction_invalidates_ << std::endl;
+    }
     std::cerr.imbue(std::locale("C")); // Reset to avoid affecting later prints.
 }
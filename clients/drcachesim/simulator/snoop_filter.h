@@ -37,19 +37,27 @@
 #include <unordered_map>
 #include <vector>
 
-struct coherence_table_entry_t {
-    std::vector<bool> sharers;
-    bool dirty;
-};
-
+// The snoop filter is a directory tracking which snooped caches hold each line.
+// Each entry's sharers are an inline bitmask stored in one flat array, so an
+// entry costs one bit per snooped cache rather than a separately allocated
+// container.  Entries are freed once no cache holds their line.
+//
+// By default the directory is perfect: it has an entry for every line held in any
+// snooped cache.  If a capacity is supplied, it is instead a set-associative sparse
+// directory as found in hardware: allocating an entry in a full set evicts the
+// least recently used entry in that set, which invalidates its line in every
+// cache sharing it.
 class snoop_filter_t {
 public:
     snoop_filter_t(void);
     virtual ~snoop_filter_t()
     {
     }
+    // A num_entries of 0 requests a perfect, unbounded directory.
+    // Otherwise num_entries and associativity must be powers of 2.
     virtual bool
-    init(cache_t **caches, int num_snooped_caches);
+    init(cache_t **caches, int num_snooped_caches, int num_entries = 0,
+         int associativity = 0);
     virtual void
     snoop(addr_t tag, int id, bool is_write);
     virtual void
@@ -58,13 +66,72 @@ public:
     print_stats(void);
 
 protected:
-    // XXX: This initial coherence implementation uses a perfect snoop filter.
-    std::unordered_map<addr_t, coherence_table_entry_t> coherence_table_;
+    static const int ENTRY_INVALID = -1;
+    static const int BITS_PER_WORD = 64;
+
+    // Returns the index of the entry for tag, or ENTRY_INVALID.
+    int
+    find_entry(addr_t tag);
+    // Returns the index of a newly allocated and cleared entry for tag.
+    int
+    allocate_entry(addr_t tag);
+    // Invalidates the line of a bounded directory's entry in all of its sharers.
+    void
+    evict_entry(int idx);
+    void
+    free_entry(int idx);
+
+    inline uint64_t *
+    get_sharers(int idx)
+    {
+        return &sharers_[(size_t)idx * words_per_entry_];
+    }
+    inline bool
+    is_sharer(int idx, int id)
+    {
+        return (get_sharers(idx)[id / BITS_PER_WORD] &
+                (1ULL << (id % BITS_PER_WORD))) != 0;
+    }
+    inline void
+    set_sharer(int idx, int id)
+    {
+        get_sharers(idx)[id / BITS_PER_WORD] |= 1ULL << (id % BITS_PER_WORD);
+    }
+    inline void
+    clear_sharer(int idx, int id)
+    {
+        get_sharers(idx)[id / BITS_PER_WORD] &= ~(1ULL << (id % BITS_PER_WORD));
+    }
+    int
+    count_sharers(int idx);
+
     cache_t **caches_;
     int num_snooped_caches_;
+    int words_per_entry_;
+
+    // Per-entry state, indexed by entry.  The sharer bitmasks of all entries live
+    // in one array with words_per_entry_ words each.
+    std::vector<addr_t> tags_;
+    std::vector<bool> dirty_;
+    std::vector<uint64_t> sharers_;
+
+    // Bounded directory state.
+    bool bounded_;
+    int associativity_;
+    int sets_mask_;
+    std::vector<int_least64_t> last_use_;
+    int_least64_t timestamp_;
+
+    // Perfect directory state: maps tags to entries, which are recycled
+    // through a free list.
+    std::unordered_map<addr_t, int> tag2entry_;
+    std::vector<int> free_entries_;
+
     int_least64_t num_writes_;
     int_least64_t num_writebacks_;
     int_least64_t num_invalidates_;
+    int_least64_t num_directory_evictions_;
+    int_least64_t num_eviction_invalidates_;
 };
 
 #endif /* _SNOOP_FILTER_H_ */
@@ -34,6 +34,14 @@
 #include "../common/utils.h"
 #include <assert.h>
 
+tlb_t::tlb_t()
+    : page_map_(nullptr)
+    , walker_(nullptr)
+    , last_pid_(0)
+    , last_page_bits_(0)
+{
+}
+
 void
 tlb_t::init_blocks()
 {
@@ -54,20 +62,23 @@ tlb_t::request(const memref_t &memref_in)
     // the right data struct to the parent and stats collectors.
     memref_t memref;
     // We support larger sizes to improve the IPC perf.
-    // This means that one memref could touch multiple blocks.
-    // We treat each block separately for statistics purposes.
+    // This means that one memref could touch multiple pages, which may even be
+    // of different sizes.
+    // We treat each page separately for statistics purposes.
     addr_t final_addr = memref_in.data.addr + memref_in.data.size - 1 /*avoid overflow*/;
-    addr_t final_tag = compute_tag(final_addr);
-    addr_t tag = compute_tag(memref_in.data.addr);
+    int page_bits = compute_page_bits(memref_in.data.addr);
+    addr_t tag = memref_in.data.addr >> page_bits;
     memref_pid_t pid = memref_in.data.pid;
 
-    // Optimization: check last tag and pid if single-block
-    if (tag == final_tag && tag == last_tag_ && pid == last_pid_) {
+    // Optimization: check last tag and pid if single-page
+    if (tag == last_tag_ && page_bits == last_page_bits_ && pid == last_pid_ &&
+        (final_addr >> page_bits) == tag) {
         // Make sure last_tag_ and pid are properly in sync.
         caching_device_block_t *tlb_entry =
             &get_caching_device_block(last_block_idx_, last_way_);
         assert(tag != TAG_INVALID && tag == tlb_entry->tag_ &&
-               pid == ((tlb_entry_t *)tlb_entry)->pid_);
+               pid == ((tlb_entry_t *)tlb_entry)->pid_ &&
+               page_bits == ((tlb_entry_t *)tlb_entry)->page_bits_);
         stats_->access(memref_in, true /*hit*/, tlb_entry);
         if (parent_ != NULL)
             parent_->get_stats()->child_access(memref_in, true, tlb_entry);
@@ -76,16 +87,18 @@ tlb_t::request(const memref_t &memref_in)
     }
 
     memref = memref_in;
-    for (; tag <= final_tag; ++tag) {
+    while (true) {
         int way;
         int block_idx = compute_block_idx(tag);
+        addr_t final_tag = final_addr >> page_bits;
 
         if (tag + 1 <= final_tag)
-            memref.data.size = ((tag + 1) << block_size_bits_) - memref.data.addr;
+            memref.data.size = ((tag + 1) << page_bits) - memref.data.addr;
 
         for (way = 0; way < associativity_; ++way) {
             caching_device_block_t *tlb_entry = &get_caching_device_block(block_idx, way);
-            if (tlb_entry->tag_ == tag && ((tlb_entry_t *)tlb_entry)->pid_ == pid) {
+            if (tlb_entry->tag_ == tag && ((tlb_entry_t *)tlb_entry)->pid_ == pid &&
+                ((tlb_entry_t *)tlb_entry)->page_bits_ == page_bits) {
                 stats_->access(memref, true /*hit*/, tlb_entry);
                 if (parent_ != NULL)
                     parent_->get_stats()->child_access(memref, true, tlb_entry);
@@ -97,12 +110,16 @@ tlb_t::request(const memref_t &memref_in)
             way = replace_which_way(block_idx);
             caching_device_block_t *tlb_entry = &get_caching_device_block(block_idx, way);
 
+            // We set the page size up front so the stats can attribute the miss
+            // to the size of the page being filled.
+            ((tlb_entry_t *)tlb_entry)->page_bits_ = page_bits;
             stats_->access(memref, false /*miss*/, tlb_entry);
-            // If no parent we assume we get the data from main memory
+            // If no parent we walk the page table, if modeled.
             if (parent_ != NULL) {
                 parent_->get_stats()->child_access(memref, false, tlb_entry);
                 parent_->request(memref);
-            }
+            } else if (walker_ != nullptr)
+                walker_->walk(pid, memref.data.addr, page_bits);
 
             // XXX: do we need to handle TLB coherency?
 
@@ -112,15 +129,19 @@ tlb_t::request(const memref_t &memref_in)
 
         access_update(block_idx, way);
 
-        if (tag + 1 <= final_tag) {
-            addr_t next_addr = (tag + 1) << block_size_bits_;
-            memref.data.addr = next_addr;
-            memref.data.size = final_addr - next_addr + 1 /*undo the -1*/;
-        }
         // Optimization: remember last tag and pid
         last_tag_ = tag;
         last_way_ = way;
         last_block_idx_ = block_idx;
         last_pid_ = pid;
+        last_page_bits_ = page_bits;
+
+        if (tag + 1 > final_tag)
+            break;
+        addr_t next_addr = (tag + 1) << page_bits;
+        memref.data.addr = next_addr;
+        memref.data.size = final_addr - next_addr + 1 /*undo the -1*/;
+        page_bits = compute_page_bits(next_addr);
+        tag = next_addr >> page_bits;
     }
 }
@@ -37,20 +37,52 @@
 #define _TLB_H_ 1
 
 #include "caching_device.h"
+#include "page_walker.h"
 #include "tlb_entry.h"
+#include "tlb_page_map.h"
 #include "tlb_stats.h"
 
+// Each entry may map a page of a different size: the size of the page containing
+// each address is found through an optional tlb_page_map_t, with the block size
+// passed to init() serving as the page size when there is no map.  Since the
+// page size of an address is known before the lookup, we index each access
+// using its own page size, which is equivalent to probing once per size.
 class tlb_t : public caching_device_t {
 public:
+    tlb_t();
     void
     request(const memref_t &memref) override;
 
+    // The map is not owned by the TLB and may be shared among TLBs.
+    void
+    set_page_map(tlb_page_map_t *page_map)
+    {
+        page_map_ = page_map;
+    }
+    // The walker is invoked on misses in a TLB without a parent.
+    void
+    set_page_walker(page_walker_t *walker)
+    {
+        walker_ = walker;
+    }
+
 protected:
     void
     init_blocks() override;
 
-    // Optimization: remember last pid in addition to last tag
+    inline int
+    compute_page_bits(addr_t addr)
+    {
+        return page_map_ == nullptr ? block_size_bits_
+                                    : page_map_->compute_page_bits(addr);
+    }
+
+    tlb_page_map_t *page_map_;
+    page_walker_t *walker_;
+
+    // Optimization: remember last pid and page size in addition to last tag
     memref_pid_t last_pid_;
+    int last_page_bits_;
 };
 
 #endif /* _TLB_H_ */
@@ -44,6 +44,10 @@ public:
     // that have the same VPN but belong to different processes.
     memref_pid_t pid_;
 
+    // log2 of the size of the page this entry translates, which may differ
+    // from the TLB's default page size when huge pages are in use.
+    int page_bits_;
+
     // XXX: support page privilege and MMU-related exceptions
 };
 
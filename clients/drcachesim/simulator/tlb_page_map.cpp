@@ -0,0 +1,144 @@
+/* **********************************************************
+ * Copyright (c) 2020 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+#include "tlb_page_map.h"
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdlib.h>
+
+static int
+compute_log2_64(uint64_t value)
+{
+    for (int i = 0; i < 64; i++) {
+        if (value == (uint64_t)1 << i)
+            return i;
+    }
+    return -1;
+}
+
+tlb_page_map_t::tlb_page_map_t()
+    : default_page_bits_(0)
+    , last_start_(0)
+    , last_end_(0)
+    , last_page_bits_(0)
+{
+}
+
+bool
+tlb_page_map_t::init(int default_page_bits)
+{
+    if (default_page_bits < 2)
+        return false;
+    default_page_bits_ = default_page_bits;
+    ranges_.clear();
+    last_start_ = 0;
+    last_end_ = 0;
+    return true;
+}
+
+bool
+tlb_page_map_t::add_range(addr_t start, addr_t end, uint64_t page_size)
+{
+    int page_bits = compute_log2_64(page_size);
+    // We keep pages at least as large as the minimum caching device block size.
+    if (page_bits < 2 || end <= start || (start & (page_size - 1)) != 0 ||
+        (end & (page_size - 1)) != 0)
+        return false;
+    auto next = ranges_.lower_bound(start);
+    if (next != ranges_.end() && next->first < end)
+        return false; // Overlaps a later range.
+    if (next != ranges_.begin() && std::prev(next)->second.end > start)
+        return false; // Overlaps an earlier range.
+    range_t range;
+    range.end = end;
+    range.page_bits = page_bits;
+    ranges_[start] = range;
+    // Invalidate the lookup cache, which may cover a gap we just filled.
+    last_start_ = 0;
+    last_end_ = 0;
+    return true;
+}
+
+int
+tlb_page_map_t::lookup(addr_t addr)
+{
+    auto it = ranges_.upper_bound(addr);
+    if (it != ranges_.begin()) {
+        --it;
+        if (addr < it->second.end) {
+            last_start_ = it->first;
+            last_end_ = it->second.end;
+            last_page_bits_ = it->second.page_bits;
+            return last_page_bits_;
+        }
+    }
+    // We do not cache gaps: we expect most references to hit a mapped range
+    // when a map is supplied at all.
+    return default_page_bits_;
+}
+
+std::string
+tlb_page_map_t::read_file(const std::string &path)
+{
+    std::ifstream stream(path);
+    if (!stream.good())
+        return "Failed to open page map file " + path;
+    std::string line;
+    int line_num = 0;
+    while (std::getline(stream, line)) {
+        ++line_num;
+        std::istringstream line_stream(line);
+        std::string range, size;
+        if (!(line_stream >> range) || range[0] == '#')
+            continue;
+        std::size_t dash = range.find('-');
+        if (dash == std::string::npos || !(line_stream >> size))
+            return "Malformed page map line " + std::to_string(line_num);
+        addr_t start = (addr_t)strtoull(range.substr(0, dash).c_str(), nullptr, 16);
+        addr_t end = (addr_t)strtoull(range.substr(dash + 1).c_str(), nullptr, 16);
+        char *suffix;
+        uint64_t page_size = strtoull(size.c_str(), &suffix, 10);
+        if (*suffix == 'K' || *suffix == 'k')
+            page_size <<= 10;
+        else if (*suffix == 'M' || *suffix == 'm')
+            page_size <<= 20;
+        else if (*suffix == 'G' || *suffix == 'g')
+            page_size <<= 30;
+        if (!add_range(start, end, page_size)) {
+            return "Invalid page map line " + std::to_string(line_num) +
+                ": page sizes must be powers of 2 with aligned, non-overlapping ranges";
+        }
+    }
+    return "";
+}
@@ -0,0 +1,98 @@
+/* **********************************************************
+ * Copyright (c) 2020 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+/* tlb_page_map: maps virtual address ranges to the size of the pages backing them.
+ */
+
+#ifndef _TLB_PAGE_MAP_H_
+#define _TLB_PAGE_MAP_H_ 1
+
+#include <map>
+#include <string>
+#include "memref.h"
+
+// Ranges not covered by an explicit mapping use the default page size.
+// A mapping file has one range per line of the form "<start>-<end> <page_size>",
+// with hexadecimal addresses (as in /proc/self/maps) and a page size that takes
+// an optional K, M, or G suffix.  Lines starting with '#' are ignored.
+// For example, to back a heap with 2M pages:
+//   7f0000000000-7f0040000000 2M
+// XXX: We assume all processes in the trace share one mapping; we could key the
+// ranges by pid if traces of multiple processes with differing layouts matter.
+class tlb_page_map_t {
+public:
+    tlb_page_map_t();
+    bool
+    init(int default_page_bits);
+    // Returns false if the page size is not a power of 2 or the range is not
+    // aligned to the page size.
+    bool
+    add_range(addr_t start, addr_t end, uint64_t page_size);
+    // Returns an error string on failure and "" on success.
+    std::string
+    read_file(const std::string &path);
+
+    inline int
+    compute_page_bits(addr_t addr)
+    {
+        // Optimization: most consecutive references fall in the same range.
+        if (addr >= last_start_ && addr < last_end_)
+            return last_page_bits_;
+        return lookup(addr);
+    }
+    int
+    get_default_page_bits() const
+    {
+        return default_page_bits_;
+    }
+
+protected:
+    struct range_t {
+        addr_t end;
+        int page_bits;
+    };
+
+    int
+    lookup(addr_t addr);
+
+    int default_page_bits_;
+    // Keyed by range start.
+    std::map<addr_t, range_t> ranges_;
+
+    // Optimization: remember the last range found.
+    addr_t last_start_;
+    addr_t last_end_;
+    int last_page_bits_;
+};
+
+#endif /* _TLB_PAGE_MAP_H_ */
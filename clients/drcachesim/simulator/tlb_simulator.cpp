@@ -59,10 +59,24 @@ tlb_simulator_t::tlb_simulator_t(const tlb_simulator_knobs_t &knobs)
     itlbs_ = new tlb_t *[knobs_.num_cores];
     dtlbs_ = new tlb_t *[knobs_.num_cores];
     lltlbs_ = new tlb_t *[knobs_.num_cores];
+    walkers_ = new page_walker_t *[knobs_.num_cores];
     for (unsigned int i = 0; i < knobs_.num_cores; i++) {
         itlbs_[i] = NULL;
         dtlbs_[i] = NULL;
         lltlbs_[i] = NULL;
+        walkers_[i] = NULL;
+    }
+    if (!page_map_.init(compute_log2((int)knobs_.page_size))) {
+        error_string_ = "Usage error: page size must be a power of 2.";
+        success_ = false;
+        return;
+    }
+    if (!knobs_.TLB_page_map.empty()) {
+        error_string_ = page_map_.read_file(knobs_.TLB_page_map);
+        if (!error_string_.empty()) {
+            success_ = false;
+            return;
+        }
     }
     for (unsigned int i = 0; i < knobs_.num_cores; i++) {
         itlbs_[i] = create_tlb(knobs_.TLB_replace_policy);
@@ -96,12 +110,29 @@ tlb_simulator_t::tlb_simulator_t(const tlb_simulator_knobs_t &knobs)
             success_ = false;
             return;
         }
+        if (!knobs_.TLB_page_map.empty()) {
+            itlbs_[i]->set_page_map(&page_map_);
+            dtlbs_[i]->set_page_map(&page_map_);
+            lltlbs_[i]->set_page_map(&page_map_);
+        }
+
+        if (knobs_.TLB_walk_latency > 0) {
+            walkers_[i] = new page_walker_t;
+            if (!walkers_[i]->init(knobs_.TLB_walk_cache_entries,
+                                   knobs_.TLB_walk_latency)) {
+                error_string_ = "Usage error: failed to initialize page walkers.";
+                success_ = false;
+                return;
+            }
+            lltlbs_[i]->set_page_walker(walkers_[i]);
+        }
     }
 }
 
 tlb_simulator_t::~tlb_simulator_t()
 {
     for (unsigned int i = 0; i < knobs_.num_cores; i++) {
+        delete walkers_[i];
         // Try to handle failure during construction.
         if (itlbs_[i] == NULL)
             return;
@@ -119,6 +150,7 @@ tlb_simulator_t::~tlb_simulator_t()
     delete[] itlbs_;
     delete[] dtlbs_;
     delete[] lltlbs_;
+    delete[] walkers_;
 }
 
 bool
@@ -190,6 +222,8 @@ tlb_simulator_t::process_memref(const memref_t &memref)
                 itlbs_[i]->get_stats()->reset();
                 dtlbs_[i]->get_stats()->reset();
                 lltlbs_[i]->get_stats()->reset();
+                if (walkers_[i] != NULL)
+                    walkers_[i]->reset();
             }
         }
     } else {
@@ -211,6 +245,10 @@ tlb_simulator_t::print_results()
             dtlbs_[i]->get_stats()->print_stats("    ");
             std::cerr << "  LL stats:" << std::endl;
             lltlbs_[i]->get_stats()->print_stats("    ");
+            if (walkers_[i] != NULL) {
+                std::cerr << "  Page walk stats:" << std::endl;
+                walkers_[i]->print_stats("    ");
+            }
         }
     }
     return true;
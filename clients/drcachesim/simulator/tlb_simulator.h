@@ -38,7 +38,9 @@
 
 #include <unordered_map>
 #include "simulator.h"
+#include "page_walker.h"
 #include "tlb_simulator_create.h"
+#include "tlb_page_map.h"
 #include "tlb_stats.h"
 #include "tlb.h"
 
@@ -63,6 +65,12 @@ protected:
     tlb_t **itlbs_;
     tlb_t **dtlbs_;
     tlb_t **lltlbs_;
+
+    // Each core walks the page table on an L2 TLB miss, if enabled.
+    page_walker_t **walkers_;
+
+    // The page sizes backing each address, shared by all TLBs.
+    tlb_page_map_t page_map_;
 };
 
 #endif /* _TLB_SIMULATOR_H_ */
@@ -59,6 +59,9 @@ struct tlb_simulator_knobs_t {
         , TLB_L2_entries(1024)
         , TLB_L2_assoc(4)
         , TLB_replace_policy("LFU")
+        , TLB_page_map("")
+        , TLB_walk_latency(0)
+        , TLB_walk_cache_entries(32)
         , skip_refs(0)
         , warmup_refs(0)
         , warmup_fraction(0.0)
@@ -76,6 +79,9 @@ struct tlb_simulator_knobs_t {
     unsigned int TLB_L2_entries;
     unsigned int TLB_L2_assoc;
     std::string TLB_replace_policy;
+    std::string TLB_page_map;
+    unsigned int TLB_walk_latency;
+    unsigned int TLB_walk_cache_entries;
     uint64_t skip_refs;
     uint64_t warmup_refs;
     double warmup_fraction;
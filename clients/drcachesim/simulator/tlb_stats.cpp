@@ -0,0 +1,95 @@
+/* **********************************************************
+ * Copyright (c) 2020 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+#include "tlb_stats.h"
+#include <iomanip>
+#include <iostream>
+#include "tlb_entry.h"
+
+void
+tlb_stats_t::access(const memref_t &memref, bool hit,
+                    caching_device_block_t *cache_block)
+{
+    caching_device_stats_t::access(memref, hit, cache_block);
+    int page_bits = ((tlb_entry_t *)cache_block)->page_bits_;
+    if (hit)
+        page_size_hits_[page_bits]++;
+    else
+        page_size_misses_[page_bits]++;
+}
+
+void
+tlb_stats_t::print_counts(std::string prefix)
+{
+    caching_device_stats_t::print_counts(prefix);
+    int num_sizes = 0;
+    for (int bits = 0; bits < MAX_PAGE_BITS; ++bits) {
+        if (page_size_hits_[bits] + page_size_misses_[bits] > 0)
+            ++num_sizes;
+    }
+    if (num_sizes <= 1)
+        return;
+    for (int bits = 0; bits < MAX_PAGE_BITS; ++bits) {
+        if (page_size_hits_[bits] + page_size_misses_[bits] == 0)
+            continue;
+        std::string size;
+        if (bits >= 30)
+            size = std::to_string(1ULL << (bits - 30)) + "G";
+        else if (bits >= 20)
+            size = std::to_string(1ULL << (bits - 20)) + "M";
+        else if (bits >= 10)
+            size = std::to_string(1ULL << (bits - 10)) + "K";
+        else
+            size = std::to_string(1ULL << bits) + "B";
+        std::cerr << prefix << std::setw(18) << std::left << ("  " + size + " hits:")
+                  << std::setw(20) << std::right << page_size_hits_[bits] << std::endl;
+        std::cerr << prefix << std::setw(18) << std::left << ("  " + size + " misses:")
+                  << std::setw(20) << std::right << page_size_misses_[bits] << std::endl;
+    }
+}
+
+void
+tlb_stats_t::reset()
+{
+    caching_device_stats_t::reset();
+    reset_page_size_counts();
+}
+
+void
+tlb_stats_t::reset_page_size_counts()
+{
+    for (int bits = 0; bits < MAX_PAGE_BITS; ++bits) {
+        page_size_hits_[bits] = 0;
+        page_size_misses_[bits] = 0;
+    }
+}
@@ -1,5 +1,5 @@
 /* **********************************************************
- * Copyright (c) 2015-2017 Google, Inc.  All rights reserved.
+ * Copyright (c) 2015-2020 Google, Inc.  All rights reserved.
  * **********************************************************/
 
 /*
@@ -43,11 +43,33 @@ public:
     tlb_stats_t()
         : caching_device_stats_t("")
     {
+        reset_page_size_counts();
     }
+
+    void
+    access(const memref_t &memref, bool hit,
+           caching_device_block_t *cache_block) override;
+
+    void
+    reset() override;
+
     // XXX: support page privilege and MMU-related exceptions
 
     // It might be necessary to report stats of exceptions
     // triggered by address translation, e.g., address unaligned exception.
+
+protected:
+    void
+    print_counts(std::string prefix) override;
+
+    void
+    reset_page_size_counts();
+
+    // Indexed by log2 of the page size.  A breakdown is only printed once
+    // more than one page size has been accessed.
+    static const int MAX_PAGE_BITS = 64;
+    int_least64_t page_size_hits_[MAX_PAGE_BITS];
+    int_least64_t page_size_misses_[MAX_PAGE_BITS];
 };
 
 #endif /* _TLB_STATS_H_ */
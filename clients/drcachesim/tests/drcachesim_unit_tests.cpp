@@ -34,6 +34,15 @@
 #include <iostream>
 #include <cstdlib>
 #include "simulator/cache_simulator.h"
+#include "simulator/cache.h"
+#include "simulator/cache_plru.h"
+#include "simulator/cache_rrip.h"
+#include "simulator/core_timing.h"
+#include "simulator/page_walker.h"
+#include "simulator/pc_miss_table.h"
+#include "simulator/snoop_filter.h"
+#include "simulator/tlb.h"
+#include "simulator/tlb_page_map.h"
 #include "../common/memref.h"
 
 static cache_simulator_knobs_t
@@ -135,11 +144,287 @@ unit_test_sim_refs()
     }
 }
 
+// Counts the page walks triggered by misses in a parentless TLB.
+class walk_counter_t : public page_walker_t {
+public:
+    int_least64_t
+    walk(memref_pid_t pid, addr_t addr, int page_bits) override
+    {
+        ++count;
+        return 0;
+    }
+    int_least64_t count = 0;
+};
+
+static int_least64_t
+count_tlb_misses(tlb_page_map_t *page_map)
+{
+    tlb_t tlb;
+    tlb_stats_t stats;
+    walk_counter_t walker;
+    if (!tlb.init(4, 4096, 64, nullptr, &stats)) {
+        std::cerr << "drcachesim count_tlb_misses failed to init\n";
+        exit(1);
+    }
+    tlb.set_page_map(page_map);
+    tlb.set_page_walker(&walker);
+    // Touch each 4K page of a 2M-aligned 2M region.
+    for (addr_t addr = 0x200000; addr < 0x400000; addr += 4096) {
+        memref_t ref;
+        ref.data.type = TRACE_TYPE_READ;
+        ref.data.pid = 1;
+        ref.data.size = 8;
+        ref.data.addr = addr;
+        tlb.request(ref);
+    }
+    return walker.count;
+}
+
+void
+unit_test_tlb_page_sizes()
+{
+    // Without a page map every 4K page misses.
+    if (count_tlb_misses(nullptr) != 512) {
+        std::cerr << "drcachesim unit_test_tlb_page_sizes failed for 4K pages\n";
+        exit(1);
+    }
+    // With the region backed by one 2M page there is just one miss.
+    tlb_page_map_t page_map;
+    if (!page_map.init(12) || !page_map.add_range(0x200000, 0x400000, 2 * 1024 * 1024) ||
+        // Misaligned and overlapping ranges are rejected.
+        page_map.add_range(0x401000, 0x601000, 2 * 1024 * 1024) ||
+        page_map.add_range(0x300000, 0x301000, 4096)) {
+        std::cerr << "drcachesim unit_test_tlb_page_sizes failed to add ranges\n";
+        exit(1);
+    }
+    if (page_map.compute_page_bits(0x3ff000) != 21 ||
+        page_map.compute_page_bits(0x400000) != 12) {
+        std::cerr << "drcachesim unit_test_tlb_page_sizes failed page size lookup\n";
+        exit(1);
+    }
+    if (count_tlb_misses(&page_map) != 1) {
+        std::cerr << "drcachesim unit_test_tlb_page_sizes failed for 2M pages\n";
+        exit(1);
+    }
+}
+
+void
+unit_test_page_walker()
+{
+    page_walker_t walker;
+    if (!walker.init(4, 10)) {
+        std::cerr << "drcachesim unit_test_page_walker failed to init\n";
+        exit(1);
+    }
+    // A cold walk for a 4K page reads all 4 levels.
+    if (walker.walk(1, 0x7f0000001000, 12) != 40) {
+        std::cerr << "drcachesim unit_test_page_walker failed cold 4K walk\n";
+        exit(1);
+    }
+    // A neighboring 4K page hits in the level 2 cache and reads just the leaf.
+    if (walker.walk(1, 0x7f0000002000, 12) != 10) {
+        std::cerr << "drcachesim unit_test_page_walker failed warm 4K walk\n";
+        exit(1);
+    }
+    // A 2M page in the same 1G region hits in the level 3 cache.
+    if (walker.walk(1, 0x7f0000200000, 21) != 10) {
+        std::cerr << "drcachesim unit_test_page_walker failed 2M walk\n";
+        exit(1);
+    }
+    // A different process shares no cached entries.
+    if (walker.walk(2, 0x7f0000001000, 12) != 40) {
+        std::cerr << "drcachesim unit_test_page_walker failed pid walk\n";
+        exit(1);
+    }
+}
+
+static void
+coherent_read(cache_t *cache, addr_t addr)
+{
+    memref_t ref;
+    ref.data.type = TRACE_TYPE_READ;
+    ref.data.size = 8;
+    ref.data.addr = addr;
+    cache->request(ref);
+}
+
+void
+unit_test_snoop_filter_capacity()
+{
+    const int line_size = 64;
+    for (int num_entries = 0; num_entries <= 4; num_entries += 4) {
+        cache_t l1_0, l1_1;
+        cache_t *caches[2] = { &l1_0, &l1_1 };
+        snoop_filter_t snoop_filter;
+        if (!l1_0.init(16, line_size, 16 * line_size, nullptr,
+                       new cache_stats_t("", false, true), nullptr, false, true, 0,
+                       &snoop_filter) ||
+            !l1_1.init(16, line_size, 16 * line_size, nullptr,
+                       new cache_stats_t("", false, true), nullptr, false, true, 1,
+                       &snoop_filter) ||
+            !snoop_filter.init(caches, 2, num_entries, 4)) {
+            std::cerr << "drcachesim unit_test_snoop_filter_capacity failed to init\n";
+            exit(1);
+        }
+        for (int line = 0; line < 4; line++)
+            coherent_read(&l1_0, line * line_size);
+        // This refreshes line 0, leaving line 1 least recently used.
+        coherent_read(&l1_1, 0);
+        coherent_read(&l1_0, 4 * line_size);
+        // A 4-entry directory must drop line 1 from cache 0 to track line 4, while a
+        // perfect directory leaves all lines in place.
+        if (l1_0.contains_tag(1) != (num_entries == 0) || !l1_0.contains_tag(0) ||
+            !l1_1.contains_tag(0) || !l1_0.contains_tag(4)) {
+            std::cerr << "drcachesim unit_test_snoop_filter_capacity failed for "
+                      << num_entries << " entries\n";
+            exit(1);
+        }
+        delete l1_0.get_stats();
+        delete l1_1.get_stats();
+    }
+}
+
+void
+unit_test_core_timing()
+{
+    memref_t instr, load;
+    instr.instr.type = TRACE_TYPE_INSTR;
+    instr.instr.tid = 1;
+    instr.instr.addr = 0x1000;
+    load.data.type = TRACE_TYPE_READ;
+    load.data.tid = 1;
+    load.data.pc = 0x1000;
+
+    // With one MSHR, a second miss waits for the first to complete.
+    core_timing_t timing;
+    if (!timing.init(1, 64)) {
+        std::cerr << "drcachesim unit_test_core_timing failed to init\n";
+        exit(1);
+    }
+    timing.instr_fetch(instr, 4, 4);
+    timing.data_load(load, 104, 4); // Completes at cycle 1 + 104.
+    instr.instr.addr = load.data.pc = 0x1004;
+    timing.instr_fetch(instr, 4, 4);
+    timing.data_load(load, 104, 4);
+    if (timing.get_stalls_by_pc().at(0x1004) != 105 - 2) {
+        std::cerr << "drcachesim unit_test_core_timing failed MSHR stall\n";
+        exit(1);
+    }
+
+    // With a 4-entry ROB, the 4th instruction after a miss waits for it.
+    if (!timing.init(10, 4)) {
+        std::cerr << "drcachesim unit_test_core_timing failed to init\n";
+        exit(1);
+    }
+    instr.instr.addr = load.data.pc = 0x2000;
+    timing.instr_fetch(instr, 4, 4);
+    timing.data_load(load, 104, 4); // Completes at cycle 1 + 104.
+    instr.instr.addr = 0x2004;
+    for (int i = 0; i < 3; i++)
+        timing.instr_fetch(instr, 4, 4);
+    if (!timing.get_stalls_by_pc().empty()) {
+        std::cerr << "drcachesim unit_test_core_timing failed early ROB stall\n";
+        exit(1);
+    }
+    // The 5th instruction dispatches at cycle 5 and stalls until the load completes.
+    timing.instr_fetch(instr, 4, 4);
+    if (timing.get_stalls_by_pc().at(0x2000) != 105 - 5 ||
+        timing.get_stalls_by_thread().at(1) != 105 - 5) {
+        std::cerr << "drcachesim unit_test_core_timing failed ROB stall\n";
+        exit(1);
+    }
+}
+
+// Returns the misses of a 4-way cache with num_sets sets over several passes
+// through a working set of 5 lines per set.
+static int_least64_t
+count_thrashing_misses(cache_t *cache, int num_sets)
+{
+    const int line_size = 64;
+    if (!cache->init(4, line_size, 4 * num_sets * line_size, nullptr,
+                     new cache_stats_t, nullptr)) {
+        std::cerr << "drcachesim count_thrashing_misses failed to init\n";
+        exit(1);
+    }
+    for (int pass = 0; pass < 100; pass++) {
+        for (int line = 0; line < 5 * num_sets; line++)
+            coherent_read(cache, line * line_size);
+    }
+    int_least64_t misses = cache->get_stats()->get_misses();
+    delete cache->get_stats();
+    return misses;
+}
+
+void
+unit_test_replace_policies()
+{
+    // Tree pseudo-LRU only approximates LRU: after touching ways 0-3 and then way
+    // 0 again, LRU evicts way 1 but the tree points at way 2.
+    const int line_size = 64;
+    cache_plru_t plru;
+    if (!plru.init(4, line_size, 4 * line_size, nullptr, new cache_stats_t, nullptr)) {
+        std::cerr << "drcachesim unit_test_replace_policies failed to init\n";
+        exit(1);
+    }
+    for (int line : { 0, 1, 2, 3, 0, 4 })
+        coherent_read(&plru, line * line_size);
+    if (!plru.contains_tag(0) || !plru.contains_tag(1) || plru.contains_tag(2) ||
+        !plru.contains_tag(3) || !plru.contains_tag(4)) {
+        std::cerr << "drcachesim unit_test_replace_policies failed PLRU victim\n";
+        exit(1);
+    }
+    delete plru.get_stats();
+
+    // A cyclic working set just over the capacity makes SRRIP miss on every
+    // access, while BRRIP keeps most of it resident.  DRRIP's follower sets should
+    // learn from its leader sets to do the same, leaving mostly the misses of the
+    // quarter of its sets that lead for SRRIP.
+    const int num_sets = 128;
+    const int_least64_t accesses = 100 * 5 * num_sets;
+    cache_rrip_t srrip(RRIP_STATIC), brrip(RRIP_BIMODAL), drrip(RRIP_DYNAMIC);
+    if (count_thrashing_misses(&srrip, num_sets) != accesses ||
+        count_thrashing_misses(&brrip, num_sets) > accesses / 2 ||
+        count_thrashing_misses(&drrip, num_sets) > accesses * 3 / 5) {
+        std::cerr << "drcachesim unit_test_replace_policies failed thrashing\n";
+        exit(1);
+    }
+}
+
+void
+unit_test_pc_miss_table()
+{
+    // Enough PCs to force several rehashes, with PC i missing i % 7 + 1 times.
+    pc_miss_table_t table;
+    const int num_pcs = 5000;
+    for (int i = 0; i < num_pcs; i++) {
+        for (int j = 0; j <= i % 7; j++)
+            table.add_miss(0x400000 + i * 4);
+    }
+    std::vector<std::pair<addr_t, int_least64_t>> top = table.top(3);
+    if (table.size() != num_pcs || top.size() != 3 || top[0].first != 0x400000 + 6 * 4 ||
+        top[0].second != 7 || top[1].first != 0x400000 + 13 * 4 || top[2].second != 7) {
+        std::cerr << "drcachesim unit_test_pc_miss_table failed\n";
+        exit(1);
+    }
+    table.clear();
+    table.add_miss(0);
+    if (table.size() != 1 || table.top(10).size() != 1 || table.top(10)[0].second != 1) {
+        std::cerr << "drcachesim unit_test_pc_miss_table failed after clear\n";
+        exit(1);
+    }
+}
+
 int
 main(int argc, const char *argv[])
 {
     unit_test_warmup_fraction();
     unit_test_warmup_refs();
     unit_test_sim_refs();
+    unit_test_tlb_page_sizes();
+    unit_test_page_walker();
+    unit_test_snoop_filter_capacity();
+    unit_test_core_timing();
+    unit_test_replace_policies();
+    unit_test_pc_miss_table();
     return 0;
 }
@@ -1087,11 +1087,13 @@ raw2trace_t::raw2trace_t(const char *module_map,
         hashtable_init_ex(&decode_cache_[i], 16, HASH_INTPTR, false, false, nullptr,
                           nullptr, nullptr);
         // We pay a little memory to get a lower load factor, unless we have
-        // many duplicated tables.
-        hashtable_config_t config = { sizeof(config), true,
-                                      worker_count_ <= 8
-                                          ? 40U
-                                          : (worker_count_ <= 16 ? 50U : 60U) };
+        // many duplicated tables.  Open addressing avoids an allocation per
+        // entry and a pointer chase per lookup.
+        hashtable_config_t config = {
+            sizeof(config), true,
+            worker_count_ <= 8 ? 40U : (worker_count_ <= 16 ? 50U : 60U), nullptr,
+            true /*open_address*/
+        };
         hashtable_configure(&decode_cache_[i], &config);
     }
 }
@@ -1102,11 +1104,9 @@ raw2trace_t::~raw2trace_t()
     for (size_t i = 0; i < decode_cache_.size(); ++i) {
         // XXX: We can't use a free-payload function b/c we can't get the dcontext there,
         // so we have to explicitly free the payloads.
-        for (uint j = 0; j < HASHTABLE_SIZE(decode_cache_[i].table_bits); j++) {
-            for (hash_entry_t *e = decode_cache_[i].table[j]; e != NULL; e = e->next) {
-                delete (static_cast<block_summary_t *>(e->payload));
-            }
-        }
+        hashtable_apply_to_all_payloads(&decode_cache_[i], [](void *payload) {
+            delete (static_cast<block_summary_t *>(payload));
+        });
         hashtable_delete(&decode_cache_[i]);
     }
 }
@@ -46,6 +46,11 @@
 #include "hashtable.h"
 #include "dr_frontend.h"
 #include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "../../common/utils.h"
 #undef ASSERT /* we're standalone, so no client assert */
@@ -180,6 +185,14 @@ static droption_t<bool> op_include_tool(
     "coverage output.  Normally such execution is excluded and the output focuses on "
     "the application only.");
 
+static droption_t<int> op_jobs(
+    DROPTION_SCOPE_FRONTEND, "jobs", -1, "Number of parallel jobs",
+    "By default, the input log files are read in parallel.  This option controls the "
+    "number of concurrent jobs.  0 disables concurrency and reads all files on a "
+    "single thread.  A negative value sets the job count to the number of hardware "
+    "threads.  Files are always read on a single thread when -test_pattern or "
+    "-reduce_set is specified, as those depend on the order in which files are read.");
+
 static droption_t<bool> op_help(DROPTION_SCOPE_FRONTEND, "help", false,
                                 "Print this message", "Prints the usage message.");
 
@@ -564,10 +577,9 @@ bb_bitmap_lookup(module_table_t *table, uint addr)
 
 /* add an entry into a bitmap bb_table */
 static inline bool
-bb_bitmap_add(module_table_t *table, bb_entry_t *entry)
+bb_bitmap_add(byte *bm, bb_entry_t *entry)
 {
     uint idx, offs, addr_end, idx_end, offs_end, i;
-    byte *bm = table->bb_table.bitmap;
     idx = BITMAP_INDEX(entry->start);
     /* we assume that the whole bb is seen if its start addr is seen */
     if (bm[idx] == BB_TABLE_RANGE_SET)
@@ -576,8 +588,8 @@ bb_bitmap_add(module_table_t *table, bb_entry_t *entry)
     if (TEST(BITMAP_MASK(offs), bm[idx]))
         return false;
     /* now we add a new bb */
-    PRINT(6, "Add 0x%x-0x%x in table " PFX "\n", entry->start, entry->start + entry->size,
-          table);
+    PRINT(6, "Add 0x%x-0x%x in bitmap " PFX "\n", entry->start,
+          entry->start + entry->size, bm);
     addr_end = entry->start + entry->size - 1;
     idx_end = BITMAP_INDEX(addr_end);
     offs_end = (idx_end > idx) ? BITS_PER_BYTE - 1 : BITMAP_OFFSET(addr_end);
@@ -649,19 +661,73 @@ module_table_bb_lookup(module_table_t *table, uint addr, const char **info)
 }
 
 static inline bool
-module_table_bb_add(module_table_t *table, bb_entry_t *entry)
+module_table_bb_in_range(module_table_t *table, bb_entry_t *entry)
 {
-    if (table == MODULE_TABLE_IGNORE)
-        return false;
     if (table->size <= entry->start + entry->size) {
         WARN(3, "Wrong range 0x%x-0x%x or table size 0x%zx for table " PFX "\n",
              entry->start, entry->start + entry->size, table->size, table);
         return false;
     }
+    return true;
+}
+
+static inline bool
+module_table_bb_add(module_table_t *table, bb_entry_t *entry)
+{
+    if (table == MODULE_TABLE_IGNORE)
+        return false;
+    if (!module_table_bb_in_range(table, entry))
+        return false;
     if (op_test_pattern.specified())
         return bb_array_add(table, entry);
     else
-        return bb_bitmap_add(table, entry);
+        return bb_bitmap_add(table->bb_table.bitmap, entry);
+}
+
+/* Per-thread state for reading log files in parallel.  Each reader records the bbs
+ * it sees into its own bitmap per module, so the bb list walk needs no locking.
+ * The bitmaps are OR-ed into the shared module tables once all readers are done.
+ */
+typedef struct _log_reader_t {
+    std::unordered_map<module_table_t *, byte *> bitmaps;
+    uint num_read;
+} log_reader_t;
+
+/* Protects module_htable and the DR file and module list routines while logs
+ * are read in parallel.
+ */
+static std::mutex reader_lock;
+
+static inline bool
+log_reader_bb_add(log_reader_t *reader, module_table_t *table, bb_entry_t *entry)
+{
+    byte *bm;
+    if (table == MODULE_TABLE_IGNORE)
+        return false;
+    if (!module_table_bb_in_range(table, entry))
+        return false;
+    auto it = reader->bitmaps.find(table);
+    if (it == reader->bitmaps.end()) {
+        bm = (byte *)calloc(1, table->size / BITS_PER_BYTE);
+        ASSERT(bm != NULL, "Failed to create reader bitmap");
+        reader->bitmaps[table] = bm;
+    } else
+        bm = it->second;
+    return bb_bitmap_add(bm, entry);
+}
+
+static void
+log_reader_merge(log_reader_t *reader)
+{
+    size_t i;
+    for (auto &it : reader->bitmaps) {
+        module_table_t *table = it.first;
+        byte *bm = it.second;
+        for (i = 0; i < table->size / BITS_PER_BYTE; i++)
+            table->bb_table.bitmap[i] |= bm[i];
+        free(bm);
+    }
+    reader->bitmaps.clear();
 }
 
 static bool
@@ -814,7 +880,8 @@ read_module_list(const char *buf, module_table_t ***tables, uint *num_mods)
 }
 
 static bool
-read_bb_list(const char *buf, module_table_t **tables, uint num_mods, uint num_bbs)
+read_bb_list(const char *buf, module_table_t **tables, uint num_mods, uint num_bbs,
+             log_reader_t *reader)
 {
     uint i;
     bb_entry_t *entry;
@@ -830,7 +897,12 @@ read_bb_list(const char *buf, module_table_t **tables, uint num_mods, uint num_b
     for (i = 0, entry = (bb_entry_t *)buf; i < num_bbs; i++, entry++) {
         PRINT(6, "BB: 0x%x, %u, %u\n", entry->start, entry->size, entry->mod_id);
         /* we could have mod id USHRT_MAX for unknown module e.g., [vdso] */
-        if (entry->mod_id < num_mods)
+        if (entry->mod_id >= num_mods)
+            continue;
+        if (reader != NULL) {
+            add_new_bb =
+                log_reader_bb_add(reader, tables[entry->mod_id], entry) || add_new_bb;
+        } else
             add_new_bb = module_table_bb_add(tables[entry->mod_id], entry) || add_new_bb;
     }
     free(tables);
@@ -921,8 +993,11 @@ close_input_file(file_t f, const char *map, size_t map_size)
     dr_close_file(f);
 }
 
+/* Reads one log file.  If reader is non-NULL, we are one of several threads reading
+ * logs in parallel and the bbs are recorded in the reader's own bitmaps.
+ */
 static bool
-read_drcov_file(const char *input)
+read_drcov_file(const char *input, log_reader_t *reader)
 {
     file_t log;
     const char *map, *ptr;
@@ -932,7 +1007,10 @@ read_drcov_file(const char *input)
     bool res;
 
     PRINT(2, "Reading drcov log file: %s\n", input);
-    log = open_input_file(input, &map, &map_size, NULL);
+    {
+        std::lock_guard<std::mutex> guard(reader_lock);
+        log = open_input_file(input, &map, &map_size, NULL);
+    }
     if (log == INVALID_FILE) {
         WARN(1, "Failed to read drcov log file %s\n", input);
         return false;
@@ -943,7 +1021,10 @@ read_drcov_file(const char *input)
         return false;
     }
 
-    ptr = read_module_list(ptr, &tables, &num_mods);
+    {
+        std::lock_guard<std::mutex> guard(reader_lock);
+        ptr = read_module_list(ptr, &tables, &num_mods);
+    }
     if (ptr == NULL)
         return false;
 
@@ -954,16 +1035,82 @@ read_drcov_file(const char *input)
     ptr = move_to_next_line(ptr);
     if (num_bbs * sizeof(bb_entry_t) > map_size) {
         WARN(1, "Wrong number of bbs, corrupt log file %s\n", input);
+        std::lock_guard<std::mutex> guard(reader_lock);
         close_input_file(log, map, map_size);
         return false;
     }
-    res = read_bb_list(ptr, tables, num_mods, num_bbs);
+    res = read_bb_list(ptr, tables, num_mods, num_bbs, reader);
     if (res && set_log != INVALID_FILE)
         dr_fprintf(set_log, "%s\n", input);
+    std::lock_guard<std::mutex> guard(reader_lock);
     close_input_file(log, map, map_size);
     return true;
 }
 
+/* Log files queued up to be read in parallel by read_queued_files(). */
+static std::vector<std::string> queued_files;
+
+static inline bool
+read_in_parallel(void)
+{
+    /* Test names and the reduced set both depend on the order files are read in. */
+    return op_jobs.get_value() != 0 && !op_test_pattern.specified() &&
+        !op_reduce_set.specified();
+}
+
+static bool
+add_drcov_file(const char *input)
+{
+    if (read_in_parallel()) {
+        queued_files.push_back(input);
+        return true;
+    }
+    return read_drcov_file(input, NULL);
+}
+
+static void
+log_reader_run(log_reader_t *reader, size_t first, size_t stride)
+{
+    size_t i;
+    for (i = first; i < queued_files.size(); i += stride) {
+        if (read_drcov_file(queued_files[i].c_str(), reader))
+            reader->num_read++;
+    }
+}
+
+static bool
+read_queued_files(void)
+{
+    size_t num_readers, i;
+    uint num_read = 0;
+    if (queued_files.empty())
+        return true;
+    if (op_jobs.get_value() < 0)
+        num_readers = std::thread::hardware_concurrency();
+    else
+        num_readers = op_jobs.get_value();
+    if (num_readers == 0)
+        num_readers = 1;
+    if (num_readers > queued_files.size())
+        num_readers = queued_files.size();
+    PRINT(2, "Reading %zu log files with %zu threads\n", queued_files.size(),
+          num_readers);
+    /* We use a simple static round-robin assignment of files to threads. */
+    std::vector<log_reader_t> readers(num_readers);
+    std::vector<std::thread> threads;
+    for (i = 0; i < num_readers; i++) {
+        readers[i].num_read = 0;
+        threads.push_back(std::thread(log_reader_run, &readers[i], i, num_readers));
+    }
+    for (i = 0; i < num_readers; i++) {
+        threads[i].join();
+        log_reader_merge(&readers[i]);
+        num_read += readers[i].num_read;
+    }
+    queued_files.clear();
+    return num_read > 0;
+}
+
 static inline bool
 is_drcov_log_file(const char *fname)
 {
@@ -996,7 +1143,7 @@ read_drcov_dir(void)
                     WARN(1, "Fail to get full path of log file %s\n", ent->d_name);
                 } else {
                     NULL_TERMINATE_BUFFER(path);
-                    read_drcov_file(path);
+                    add_drcov_file(path);
                     found_logs = true;
                 }
             }
@@ -1043,7 +1190,7 @@ read_drcov_dir(void)
             if (!has_sep)
                 strcat(path, "\\");
             strcat(path, ffd.cFileName);
-            found_logs = read_drcov_file(path) || found_logs;
+            found_logs = add_drcov_file(path) || found_logs;
         }
     } while (FindNextFile(hFind, &ffd) != 0);
     FindClose(hFind);
@@ -1076,7 +1223,7 @@ read_drcov_list(void)
         NULL_TERMINATE_BUFFER(path);
         ptr = move_to_next_line(ptr);
         null_terminate_path(path);
-        found_logs = read_drcov_file(path) || found_logs;
+        found_logs = add_drcov_file(path) || found_logs;
     }
     close_input_file(list, map, map_size);
     if (!found_logs)
@@ -1089,11 +1236,12 @@ read_drcov_input(void)
 {
     bool res = true;
     if (op_input.specified())
-        res = read_drcov_file(input_file_buf) && res;
+        res = add_drcov_file(input_file_buf) && res;
     if (op_list.specified())
         res = read_drcov_list() && res;
     if (op_dir.specified())
         res = read_drcov_dir() && res;
+    res = read_queued_files() && res;
     return res;
 }
 
@@ -407,6 +407,7 @@ emit_detach_callback_final_jmp(dcontext_t *dcontext,
 #        define ATOMIC_COMPARE_EXCHANGE_PTR ATOMIC_COMPARE_EXCHANGE_int
 #    endif
 #    define MEMORY_STORE_BARRIER()       /* not needed on x86 */
+#    define MEMORY_LOAD_BARRIER()        /* not needed on x86 */
 #    define SPINLOCK_PAUSE() _mm_pause() /* PAUSE = 0xf3 0x90 = repz nop */
 #    define RDTSC_LL(var) (var = __rdtsc())
 #    define SERIALIZE_INSTRUCTIONS()     \
@@ -600,6 +601,7 @@ atomic_add_exchange_int64(volatile int64 *var, int64 value)
                              : "0"(newval), "m"(var))
 
 #        define MEMORY_STORE_BARRIER() /* not needed on x86 */
+#        define MEMORY_LOAD_BARRIER()  /* not needed on x86 */
 #        define SPINLOCK_PAUSE() __asm__ __volatile__("pause")
 #        ifdef X64
 #            define RDTSC_LL(llval)                                        \
@@ -784,6 +786,7 @@ DEF_ATOMIC_incdec(ATOMIC_INC_int, int, "w", "add") DEF_ATOMIC_incdec(ATOMIC_INC_
 }
 
 #        define MEMORY_STORE_BARRIER() __asm__ __volatile__("dmb st")
+#        define MEMORY_LOAD_BARRIER() __asm__ __volatile__("dmb ishld" : : : "memory")
 #        define SPINLOCK_PAUSE()             \
             do {                             \
                 __asm__ __volatile__("wfi"); \
@@ -944,6 +947,7 @@ atomic_dec_becomes_zero(volatile int *var)
                                  : "cc", "memory", "r2", "r3");
 
 #        define MEMORY_STORE_BARRIER() __asm__ __volatile__("dmb st")
+#        define MEMORY_LOAD_BARRIER() __asm__ __volatile__("dmb ish" : : : "memory")
 #        define SPINLOCK_PAUSE() __asm__ __volatile__("wfi") /* wait for interrupt */
 uint64
 proc_get_timestamp(void);
@@ -2195,6 +2199,10 @@ is_jmp_rel8(byte *code_buf, app_pc app_loc, app_pc *jmp_target /* OUT */);
  *    usually 3 bytes smaller since don't need to restore eflags.
  */
 #define TRACE_CTI_MANGLE_SIZE_UPPER_BOUND 72
+/* Upper bound on the trace bytes, exit stub included, that each
+ * -ibl_inline_cache target adds; one more covers the shared flags save.
+ */
+#define IBL_INLINE_CACHE_SIZE_UPPER_BOUND 128
 
 fragment_t *
 build_basic_block_fragment(dcontext_t *dcontext, app_pc start_pc, uint initial_flags,
@@ -2202,6 +2210,11 @@ build_basic_block_fragment(dcontext_t *dcontext, app_pc start_pc, uint initial_f
                            bool visible _IF_CLIENT(bool for_trace)
                                _IF_CLIENT(instrlist_t **unmangled_ilist));
 
+#if defined(CLIENT_SIDELINE) && defined(LINUX)
+void
+bb_prebuild_enqueue(dcontext_t *dcontext, fragment_t *f);
+#endif
+
 void
 interp(dcontext_t *dcontext);
 uint
@@ -2209,6 +2222,12 @@ extend_trace(dcontext_t *dcontext, fragment_t *f, linkstub_t *prev_l);
 int
 append_trace_speculate_last_ibl(dcontext_t *dcontext, instrlist_t *trace,
                                 app_pc speculate_next_tag, bool record_translation);
+#if defined(X86) && defined(X64)
+int
+append_trace_ibl_inline_cache(dcontext_t *dcontext, instrlist_t *trace,
+                              app_pc *targets, uint num_targets, uint trace_flags,
+                              bool record_translation);
+#endif
 
 uint
 forward_eflags_analysis(dcontext_t *dcontext, instrlist_t *ilist, instr_t *instr);
@@ -129,6 +129,20 @@ static file_t bbdump_file = INVALID_FILE;
 DECLARE_NEVERPROT_VAR(uint debug_bb_count, 0);
 #endif
 
+#if defined(CLIENT_SIDELINE) && defined(LINUX)
+/* Must be a power of 2. */
+#    define BB_PREBUILD_SLOTS 64
+/* Bounds how long the prebuild thread can hold up freeing of flushed fragments. */
+#    define BB_PREBUILD_WAIT_MS 100
+/* A lossy mailbox of tags for the prebuild thread: a tag whose slot is taken is
+ * simply dropped, as the app thread will build it on demand.
+ */
+DECLARE_NEVERPROT_VAR(static app_pc bb_prebuild_slots[BB_PREBUILD_SLOTS], { 0 });
+DECLARE_NEVERPROT_VAR(static int bb_prebuild_pending, 0);
+DECLARE_NEVERPROT_VAR(static int bb_prebuild_started, 0);
+static event_t bb_prebuild_event;
+#endif
+
 /* initialization */
 void
 interp_init()
@@ -139,6 +153,10 @@ interp_init()
         ASSERT(bbdump_file != INVALID_FILE);
     }
 #endif
+#if defined(CLIENT_SIDELINE) && defined(LINUX)
+    if (DYNAMO_OPTION(bb_prebuild))
+        bb_prebuild_event = create_event();
+#endif
 }
 
 #ifdef CUSTOM_TRACES_RET_REMOVAL
@@ -158,6 +176,11 @@ interp_exit()
     }
 #endif
     DELETE_LOCK(bb_building_lock);
+#if defined(CLIENT_SIDELINE) && defined(LINUX)
+    /* The prebuild thread was terminated along with the other client threads. */
+    if (DYNAMO_OPTION(bb_prebuild))
+        destroy_event(bb_prebuild_event);
+#endif
 
     LOG(GLOBAL, LOG_INTERP | LOG_STATS, 1, "Total application code seen: %d KB\n",
         GLOBAL_STAT(app_code_seen) / 1024);
@@ -5211,6 +5234,143 @@ build_basic_block_fragment_done:
     return f;
 }
 
+#if defined(CLIENT_SIDELINE) && defined(LINUX)
+/* -bb_prebuild: after an app thread builds a shared bb in d_r_dispatch we post
+ * its direct successors to bb_prebuild_slots, and a DR-owned client thread
+ * builds whichever of them are still missing so that the app thread finds
+ * them in the shared cache.  The blocks are built exactly as d_r_dispatch would
+ * build them, so client instrumentation sees the same inputs.  We only post
+ * successors in the same module as their source: that skips DGC and ensures
+ * the module load event was already delivered on an app thread.  We also only
+ * post from blocks in DEFAULT_ISA_MODE and build in that mode, as the slots do
+ * not record the mode of the thread that posted them.
+ */
+static void
+bb_prebuild_one(dcontext_t *dcontext, app_pc tag)
+{
+    fragment_t coarse_f;
+    fragment_t *f;
+    dr_where_am_i_t wherewasi = dcontext->whereami;
+    /* A client may have registered a bb event since the tag was posted. */
+    if (dr_bb_hook_exists())
+        return;
+    /* A previous build may have left a different mode behind. */
+    dr_set_isa_mode(dcontext, DEFAULT_ISA_MODE, NULL);
+    SHARED_BB_LOCK();
+    if (fragment_lookup_fine_and_coarse(dcontext, tag, &coarse_f, NULL) != NULL) {
+        SHARED_BB_UNLOCK();
+        return;
+    }
+    SELF_PROTECT_LOCAL(dcontext, WRITABLE);
+    TRY_EXCEPT(dcontext,
+               {
+                   f = build_basic_block_fragment(dcontext, tag, 0, true /*link*/,
+                                                  true /*visible*/
+                                                  _IF_CLIENT(false /*!for_trace*/)
+                                                      _IF_CLIENT(NULL));
+                   SHARED_BB_UNLOCK();
+               },
+               {
+                   /* The code was unmapped or made unreadable underneath us.  We
+                    * leave it to the app thread, which raises any fault where the
+                    * app expects it.
+                    */
+                   if (dcontext->bb_build_info != NULL)
+                       bb_build_abort(dcontext, true /*clean vm area*/, true /*unlock*/);
+                   else
+                       SHARED_BB_UNLOCK();
+                   dcontext->whereami = wherewasi;
+                   f = NULL;
+                   STATS_INC(num_bb_prebuild_faults);
+               });
+    SELF_PROTECT_LOCAL(dcontext, READONLY);
+    if (f != NULL) {
+        LOG(THREAD, LOG_INTERP, 2, "prebuilt bb for " PFX "\n", tag);
+        RSTATS_INC(num_bbs_prebuilt);
+    }
+}
+
+static void
+bb_prebuild_thread(void *arg)
+{
+    dcontext_t *dcontext = get_thread_private_dcontext();
+    uint i;
+    LOG(THREAD, LOG_INTERP, 1, "bb prebuild thread started\n");
+    while (true) {
+        /* Like dr_event_wait(): synch_with_all_threads() may suspend or terminate
+         * us only while we are idle, never in the middle of a build.
+         */
+        dcontext->client_data->client_thread_safe_for_synch = true;
+        wait_for_event(bb_prebuild_event, BB_PREBUILD_WAIT_MS);
+        dcontext->client_data->client_thread_safe_for_synch = false;
+        /* Linking is done under the same protocol as an app thread in
+         * d_r_dispatch, and going back to nolinking processes our flush queue.
+         */
+        enter_couldbelinking(dcontext, NULL, false /*not a cache transition*/);
+        atomic_exchange_int(&bb_prebuild_pending, 0);
+        for (i = 0; i < BB_PREBUILD_SLOTS; i++) {
+            app_pc tag = bb_prebuild_slots[i];
+            if (tag != NULL &&
+                atomic_compare_exchange_ptr(&bb_prebuild_slots[i], tag, NULL))
+                bb_prebuild_one(dcontext, tag);
+        }
+        enter_nolinking(dcontext, NULL, false /*not a cache transition*/);
+    }
+}
+
+/* Called by an app thread in d_r_dispatch right after building f. */
+void
+bb_prebuild_enqueue(dcontext_t *dcontext, fragment_t *f)
+{
+    linkstub_t *l;
+    app_pc base;
+    ASSERT(DYNAMO_OPTION(bb_prebuild));
+    /* The builder thread gets no client thread init event, so a client bb event
+     * that uses per-thread state (such as drmgr's) would fail there.  Clients
+     * are loaded after options are checked, so we test for them here.
+     */
+    if (dr_bb_hook_exists()) {
+        DO_ONCE({
+            SYSLOG_INTERNAL_INFO("-bb_prebuild is not supported with a client bb "
+                                 "event, disabling");
+        });
+        return;
+    }
+    if (!TEST(FRAG_SHARED, f->flags) ||
+        TESTANY(FRAG_COARSE_GRAIN | FRAG_SELFMOD_SANDBOXED, f->flags) ||
+        FRAG_ISA_MODE(f->flags) != DEFAULT_ISA_MODE)
+        return;
+    base = get_module_base(f->tag);
+    if (base == NULL)
+        return;
+    if (bb_prebuild_started == 0 &&
+        atomic_compare_exchange_int(&bb_prebuild_started, 0, 1)) {
+        /* We wait for the first posting so that the app is known to be running. */
+        if (!dr_create_client_thread(bb_prebuild_thread, NULL))
+            SYSLOG_INTERNAL_WARNING("failed to create the bb prebuild thread");
+    }
+    for (l = FRAGMENT_EXIT_STUBS(f); l != NULL; l = LINKSTUB_NEXT_EXIT(l)) {
+        app_pc target;
+        uint slot;
+        if (!LINKSTUB_DIRECT(l->flags))
+            continue;
+        target = EXIT_TARGET_TAG(dcontext, f, l);
+        if (fragment_lookup(dcontext, target) != NULL || get_module_base(target) != base)
+            continue;
+        slot = (uint)(((ptr_uint_t)target ^ ((ptr_uint_t)target >> 6)) &
+                      (BB_PREBUILD_SLOTS - 1));
+        if (!atomic_compare_exchange_ptr(&bb_prebuild_slots[slot], NULL, target)) {
+            STATS_INC(num_bb_prebuild_dropped);
+            continue;
+        }
+        STATS_INC(num_bb_prebuild_requests);
+        /* Only the first posting since the thread last drained needs to wake it. */
+        if (atomic_add_exchange_int(&bb_prebuild_pending, 1) == 1)
+            signal_event(bb_prebuild_event);
+    }
+}
+#endif /* CLIENT_SIDELINE && LINUX */
+
 /* Builds an instrlist_t as though building a bb from pretend_pc, but decodes
  * from pc.
  * Use recreate_fragment_ilist() for building an instrlist_t for a fragment.
@@ -5289,6 +5449,45 @@ recreate_bb_ilist(dcontext_t *dcontext, byte *pc, byte *pretend_pc, app_pc stop_
     return bb.ilist;
 }
 
+#if defined(X86) && defined(X64) && defined(CLIENT_INTERFACE)
+/* Re-applies the -ibl_inline_cache chain that end_and_emit_trace() appended to
+ * trace f, if any, to its recreated and mangled ilist.  The cached targets are
+ * not recorded anywhere else that is stable across rebuilds, but each one has a
+ * direct exit of its own just ahead of the final exit, so we recover them from
+ * the exits f has beyond those of the recreated ilist.
+ */
+static void
+recreate_trace_ibl_inline_cache(dcontext_t *dcontext, fragment_t *f, instrlist_t *ilist)
+{
+    app_pc targets[IBL_INLINE_CACHE_MAX];
+    linkstub_t *l;
+    instr_t *inst;
+    uint num_exits = 0, ilist_exits = 0, i = 0;
+    DEBUG_DECLARE(int added;)
+    for (l = FRAGMENT_EXIT_STUBS(f); l != NULL; l = LINKSTUB_NEXT_EXIT(l))
+        num_exits++;
+    for (inst = instrlist_first(ilist); inst != NULL; inst = instr_get_next(inst)) {
+        if (instr_is_exit_cti(inst))
+            ilist_exits++;
+    }
+    if (ilist_exits == 0 || num_exits <= ilist_exits)
+        return;
+    ASSERT(num_exits - ilist_exits <= IBL_INLINE_CACHE_MAX);
+    if (num_exits - ilist_exits > IBL_INLINE_CACHE_MAX)
+        return;
+    for (l = FRAGMENT_EXIT_STUBS(f); l != NULL; l = LINKSTUB_NEXT_EXIT(l), i++) {
+        if (i >= ilist_exits - 1 && i < num_exits - 1) {
+            ASSERT(LINKSTUB_DIRECT(l->flags));
+            targets[i - (ilist_exits - 1)] = EXIT_TARGET_TAG(dcontext, f, l);
+        }
+    }
+    DEBUG_DECLARE(added =)
+    append_trace_ibl_inline_cache(dcontext, ilist, targets, num_exits - ilist_exits,
+                                  f->flags, true /*record translation*/);
+    ASSERT(added > 0);
+}
+#endif
+
 /* Re-creates an ilist of the fragment that currently contains the
  * passed-in code cache pc, also returns the fragment.
  *
@@ -5515,6 +5714,10 @@ recreate_fragment_ilist(dcontext_t *dcontext, byte *pc,
             /* FIXME: case 4718 append_trace_speculate_last_ibl(true)
              * should be called as well
              */
+#if defined(X86) && defined(X64) && defined(CLIENT_INTERFACE)
+            if (DYNAMO_OPTION(ibl_inline_cache) > 0)
+                recreate_trace_ibl_inline_cache(dcontext, f, ilist);
+#endif
             if (PAD_FRAGMENT_JMPS(f->flags))
                 nop_pad_ilist(dcontext, f, ilist, false /* set translation */);
         }
@@ -6414,6 +6617,122 @@ append_trace_speculate_last_ibl(dcontext_t *dcontext, instrlist_t *trace,
     return added_size;
 }
 
+#if defined(X86) && defined(X64)
+/* Inserts an -ibl_inline_cache compare chain ahead of the trace's last exit, an
+ * indirect branch to the lookup routine.  A target matching one of targets has
+ * xax, xcx and the flags restored and leaves through a new direct exit to it;
+ * any other target enters the lookup past its flags save, as a failed in-trace
+ * comparison does in mangle_x64_ib_in_trace().
+ * Returns the size added to the trace, including the new exit stubs.
+ */
+int
+append_trace_ibl_inline_cache(dcontext_t *dcontext, instrlist_t *trace,
+                              app_pc *targets, uint num_targets, uint trace_flags,
+                              bool record_translation)
+{
+    instr_t *targeter = instrlist_last(trace);
+    bool save_flags = !INTERNAL_OPTION(unsafe_ignore_eflags_trace);
+    bool save_of = save_flags && !INTERNAL_OPTION(unsafe_ignore_overflow);
+    opnd_t flags_slot = opnd_create_tls_slot(os_tls_offset(INDIRECT_STUB_SPILL_SLOT));
+    opnd_t xax_slot = opnd_create_tls_slot(os_tls_offset(PREFIX_XAX_SPILL_SLOT));
+    ibl_type_t ibl_type;
+    instr_t *miss, *jnz;
+    int added_size = 0;
+    uint i;
+
+    if (num_targets == 0 || !X64_MODE_DC(dcontext) || targeter == NULL ||
+        !instr_is_exit_cti(targeter) || !instr_is_ubr(targeter) ||
+        !opnd_is_pc(instr_get_target(targeter)) ||
+        !get_ibl_routine_type(dcontext, opnd_get_pc(instr_get_target(targeter)),
+                              &ibl_type) ||
+        ibl_type.link_state != IBL_LINKED)
+        return 0;
+    ASSERT(num_targets <= IBL_INLINE_CACHE_MAX);
+
+    if (record_translation)
+        instrlist_set_translation_target(trace, instr_get_translation(targeter));
+    instrlist_set_our_mangling(trace, true); /* PR 267260 */
+    /* xcx already holds the target and its app value is spilled */
+    added_size += tracelist_add(dcontext, trace, targeter,
+                                INSTR_CREATE_mov_st(dcontext, xax_slot,
+                                                    opnd_create_reg(REG_XAX)));
+    if (save_flags) {
+        added_size +=
+            tracelist_add(dcontext, trace, targeter, INSTR_CREATE_lahf(dcontext));
+        if (save_of) {
+            added_size += tracelist_add(
+                dcontext, trace, targeter,
+                INSTR_CREATE_setcc(dcontext, OP_seto, opnd_create_reg(REG_AL)));
+        }
+        added_size += tracelist_add(
+            dcontext, trace, targeter,
+            INSTR_CREATE_mov_st(dcontext, flags_slot, opnd_create_reg(REG_XAX)));
+    }
+    for (i = 0; i < num_targets; i++) {
+        miss = INSTR_CREATE_label(dcontext);
+        added_size += tracelist_add(
+            dcontext, trace, targeter,
+            INSTR_CREATE_mov_imm(dcontext, opnd_create_reg(REG_XAX),
+                                 OPND_CREATE_INTPTR((ptr_int_t)targets[i])));
+        added_size += tracelist_add(dcontext, trace, targeter,
+                                    INSTR_CREATE_cmp(dcontext, opnd_create_reg(REG_XCX),
+                                                     opnd_create_reg(REG_XAX)));
+        jnz = INSTR_CREATE_jcc(dcontext, OP_jnz, opnd_create_instr(miss));
+        /* do not treat jnz as exit cti! */
+        instr_set_meta(jnz);
+        added_size += tracelist_add(dcontext, trace, targeter, jnz);
+        if (save_flags) {
+            added_size += tracelist_add(
+                dcontext, trace, targeter,
+                INSTR_CREATE_mov_ld(dcontext, opnd_create_reg(REG_XAX), flags_slot));
+            if (save_of) {
+                /* restore OF using add that overflows if OF was on when we did seto */
+                added_size +=
+                    tracelist_add(dcontext, trace, targeter,
+                                  INSTR_CREATE_add(dcontext, opnd_create_reg(REG_AL),
+                                                   OPND_CREATE_INT8(0x7f)));
+            }
+            added_size +=
+                tracelist_add(dcontext, trace, targeter, INSTR_CREATE_sahf(dcontext));
+        }
+        added_size += tracelist_add(
+            dcontext, trace, targeter,
+            INSTR_CREATE_mov_ld(dcontext, opnd_create_reg(REG_XAX), xax_slot));
+        added_size += insert_restore_spilled_xcx(dcontext, trace, targeter);
+        /* a direct exit, so the hit can be linked straight to the target */
+        added_size +=
+            tracelist_add(dcontext, trace, targeter,
+                          XINST_CREATE_jump(dcontext, opnd_create_pc(targets[i])));
+        added_size += local_exit_stub_size(dcontext, targets[i], trace_flags);
+        added_size += tracelist_add(dcontext, trace, targeter, miss);
+    }
+    /* the trace cmp entry expects the saved flags in xax */
+    if (save_flags) {
+        added_size += tracelist_add(
+            dcontext, trace, targeter,
+            INSTR_CREATE_mov_ld(dcontext, opnd_create_reg(REG_XAX), flags_slot));
+    }
+    instr_set_target(targeter,
+                     opnd_create_pc(get_trace_cmp_entry(
+                         dcontext, opnd_get_pc(instr_get_target(targeter)))));
+    /* since the target gets lost we need to OR in this flag */
+    instr_exit_branch_set_type(targeter,
+                               instr_exit_branch_type(targeter) | INSTR_TRACE_CMP_EXIT);
+    /* PR 214962: our spill restoration needs this whole sequence marked mangle */
+    instr_set_our_mangling(targeter, true);
+    instrlist_set_our_mangling(trace, false); /* PR 267260 */
+    if (record_translation)
+        instrlist_set_translation_target(trace, NULL);
+
+    STATS_INC(ibl_inline_cache_sites);
+    STATS_ADD(ibl_inline_cache_targets, num_targets);
+    LOG(THREAD, LOG_INTERP, 3,
+        "append_trace_ibl_inline_cache: added %d cmps, first vs. " PFX "\n",
+        num_targets, targets[0]);
+    return added_size;
+}
+#endif
+
 #ifdef HASHTABLE_STATISTICS
 /* Add a counter on last IBL exit
  * if speculate_next_tag is not NULL then check case 4817's possible success
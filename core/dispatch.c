@@ -136,6 +136,9 @@ d_r_dispatch(dcontext_t *dcontext)
 {
     fragment_t *targetf;
     fragment_t coarse_f;
+#if defined(CLIENT_SIDELINE) && defined(LINUX)
+    bool built_bb;
+#endif
 
 #ifdef HAVE_TLS
 #    if defined(UNIX) && defined(X86)
@@ -189,6 +192,9 @@ d_r_dispatch(dcontext_t *dcontext)
             continue;
 #endif
         do {
+#if defined(CLIENT_SIDELINE) && defined(LINUX)
+            built_bb = false;
+#endif
             if (targetf != NULL) {
                 KSTART(monitor_enter);
                 /* invoke monitor to continue or start a trace
@@ -216,6 +222,9 @@ d_r_dispatch(dcontext_t *dcontext)
                     true /*visible*/
                     _IF_CLIENT(false /*!for_trace*/) _IF_CLIENT(NULL));
                 SELF_PROTECT_LOCAL(dcontext, READONLY);
+#if defined(CLIENT_SIDELINE) && defined(LINUX)
+                built_bb = true;
+#endif
             }
             if (targetf != NULL && TEST(FRAG_COARSE_GRAIN, targetf->flags)) {
                 /* targetf is a static temp fragment protected by bb_building_lock,
@@ -232,6 +241,11 @@ d_r_dispatch(dcontext_t *dcontext)
             SHARED_BB_UNLOCK();
             if (targetf == NULL)
                 break;
+#if defined(CLIENT_SIDELINE) && defined(LINUX)
+            /* We are still couldbelinking, so targetf cannot have been freed. */
+            if (built_bb && DYNAMO_OPTION(bb_prebuild))
+                bb_prebuild_enqueue(dcontext, targetf);
+#endif
             /* loop around and re-do monitor check */
         } while (true);
 
@@ -586,6 +586,12 @@ DECLARE_CXTSWPROT_VAR(static mutex_t unit_flush_lock, INIT_LOCK_FREE(unit_flush_
 
 static fcache_t *shared_cache_bb;
 static fcache_t *shared_cache_trace;
+#ifdef CLIENT_INTERFACE
+/* -hot_trace_cache: traces from tags sampled as hot are rebuilt here, packed
+ * together instead of interleaved with lukewarm traces in creation order.
+ */
+static fcache_t *shared_cache_hot_trace;
+#endif
 
 /* To locate the fcache_unit_t corresponding to a fragment or empty slot
  * we use an interval data structure rather than waste space with a
@@ -851,6 +857,14 @@ fcache_reset_init(void)
         ASSERT(shared_cache_trace != NULL);
         LOG(GLOBAL, LOG_CACHE, 1, "Initial shared trace cache is %d KB\n",
             shared_cache_trace->init_unit_size / 1024);
+#ifdef CLIENT_INTERFACE
+        if (DYNAMO_OPTION(hot_trace_cache)) {
+            shared_cache_hot_trace =
+                fcache_cache_init(GLOBAL_DCONTEXT, FRAG_SHARED | FRAG_IS_TRACE, true);
+            ASSERT(shared_cache_hot_trace != NULL);
+            DODEBUG({ shared_cache_hot_trace->name = "Hot trace (shared)"; });
+        }
+#endif
     }
 }
 
@@ -1002,6 +1016,15 @@ fcache_stats_exit()
             fcache_cache_stats(GLOBAL_DCONTEXT, cache);
             PROTECT_CACHE(cache, unlock);
         }
+#    ifdef CLIENT_INTERFACE
+        cache = shared_cache_hot_trace;
+        if (cache != NULL) {
+            ASSERT_DO_NOT_OWN_MUTEX(cache->is_shared, &cache->lock);
+            PROTECT_CACHE(cache, lock);
+            fcache_cache_stats(GLOBAL_DCONTEXT, cache);
+            PROTECT_CACHE(cache, unlock);
+        }
+#    endif
     }
 }
 #endif
@@ -1035,6 +1058,12 @@ fcache_reset_free(void)
     if (DYNAMO_OPTION(shared_traces)) {
         fcache_cache_free(GLOBAL_DCONTEXT, shared_cache_trace, true);
         shared_cache_trace = NULL;
+#ifdef CLIENT_INTERFACE
+        if (shared_cache_hot_trace != NULL) {
+            fcache_cache_free(GLOBAL_DCONTEXT, shared_cache_hot_trace, true);
+            shared_cache_hot_trace = NULL;
+        }
+#endif
     }
 
     /* there may be units stranded on the to-flush list.
@@ -2787,6 +2816,8 @@ force_fragment_from_cache(dcontext_t *dcontext, fcache_t *cache, fragment_t *vic
             cache->num_replaced++;
         DOSTATS({ removed_fragment_stats(dcontext, cache, victim); });
         STATS_INC(num_fragments_replaced);
+        if (TEST(FRAG_IS_TRACE, victim->flags))
+            monitor_trace_evicted();
         fragment_delete(dcontext, victim, FRAGDEL_NO_FCACHE);
     }
 }
@@ -3607,9 +3638,16 @@ get_cache_for_new_fragment(dcontext_t *dcontext, fragment_t *f)
             ASSERT(((fcache_t *)info->cache)->coarse_info == info);
             return (fcache_t *)info->cache;
         } else {
-            if (IN_TRACE_CACHE(f->flags))
+            if (IN_TRACE_CACHE(f->flags)) {
+#ifdef CLIENT_INTERFACE
+                if (shared_cache_hot_trace != NULL && TEST(FRAG_IS_TRACE, f->flags) &&
+                    monitor_trace_is_hot(f->tag)) {
+                    STATS_INC(num_hot_cache_traces);
+                    return shared_cache_hot_trace;
+                }
+#endif
                 return shared_cache_trace;
-            else
+            } else
                 return shared_cache_bb;
         }
     } else {
@@ -4107,6 +4145,10 @@ fcache_flush_all_caches()
     }
     if (DYNAMO_OPTION(shared_traces)) {
         fcache_mark_units_for_free(dcontext, shared_cache_trace);
+#ifdef CLIENT_INTERFACE
+        if (shared_cache_hot_trace != NULL)
+            fcache_mark_units_for_free(dcontext, shared_cache_hot_trace);
+#endif
     }
     /* FIXME: for thread-private units, should use a trigger in
      * vm_area_flush_fragments() to call a routine here that frees all but
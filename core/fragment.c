@@ -69,6 +69,12 @@
 #define INIT_HTABLE_SIZE_FUTURE \
     ((DYNAMO_OPTION(shared_bbs) && DYNAMO_OPTION(shared_traces)) ? 5 : 9)
 
+/* Future fragments are freed as soon as they are removed, so unlike shared bbs
+ * and traces they cannot be read without the table lock.
+ */
+#define SHARED_LOOKUP_FLAGS \
+    (INTERNAL_OPTION(shared_lookup_lockless) ? HASHTABLE_LOCKLESS_LOOKUPS : 0)
+
 /* per-module htables */
 #define INIT_HTABLE_SIZE_COARSE 5
 #define INIT_HTABLE_SIZE_COARSE_TH 4
@@ -1322,14 +1328,16 @@ fragment_reset_init(void)
                 GLOBAL_DCONTEXT, shared_bb, INIT_HTABLE_SIZE_SHARED_BB,
                 INTERNAL_OPTION(shared_bb_load),
                 (hash_function_t)INTERNAL_OPTION(alt_hash_func), 0 /* hash_mask_offset */,
-                FRAG_TABLE_SHARED | FRAG_TABLE_TARGET_SHARED _IF_DEBUG("shared_bb"));
+                FRAG_TABLE_SHARED | FRAG_TABLE_TARGET_SHARED |
+                    SHARED_LOOKUP_FLAGS _IF_DEBUG("shared_bb"));
         }
         if (DYNAMO_OPTION(shared_traces)) {
             hashtable_fragment_init(
                 GLOBAL_DCONTEXT, shared_trace, INIT_HTABLE_SIZE_SHARED_TRACE,
                 INTERNAL_OPTION(shared_trace_load),
                 (hash_function_t)INTERNAL_OPTION(alt_hash_func), 0 /* hash_mask_offset */,
-                FRAG_TABLE_SHARED | FRAG_TABLE_TARGET_SHARED _IF_DEBUG("shared_trace"));
+                FRAG_TABLE_SHARED | FRAG_TABLE_TARGET_SHARED |
+                    SHARED_LOOKUP_FLAGS _IF_DEBUG("shared_trace"));
         }
         /* init routine will work for future_fragment_t* same as for fragment_t* */
         hashtable_fragment_init(
@@ -2725,9 +2733,8 @@ fragment_lookup_type(dcontext_t *dcontext, app_pc tag, uint lookup_flags)
             /* MUST look at shared trace table before shared bb table,
              * since a shared trace can shadow a shared trace head
              */
-            d_r_read_lock(&shared_trace->rwlock);
-            f = hashtable_fragment_lookup(dcontext, (ptr_uint_t)tag, shared_trace);
-            d_r_read_unlock(&shared_trace->rwlock);
+            f = hashtable_fragment_lookup_lockless(dcontext, (ptr_uint_t)tag,
+                                                   shared_trace);
             if (f->tag != NULL) {
                 ASSERT(f->tag == tag);
                 ASSERT(!TESTANY(FRAG_FAKE | FRAG_COARSE_GRAIN, f->flags));
@@ -2739,9 +2746,7 @@ fragment_lookup_type(dcontext_t *dcontext, app_pc tag, uint lookup_flags)
             /* MUST look at private trace table before shared bb table,
              * since a private trace can shadow a shared trace head
              */
-            d_r_read_lock(&shared_bb->rwlock);
-            f = hashtable_fragment_lookup(dcontext, (ptr_uint_t)tag, shared_bb);
-            d_r_read_unlock(&shared_bb->rwlock);
+            f = hashtable_fragment_lookup_lockless(dcontext, (ptr_uint_t)tag, shared_bb);
             if (f->tag != NULL) {
                 ASSERT(f->tag == tag);
                 ASSERT(!TESTANY(FRAG_FAKE | FRAG_COARSE_GRAIN, f->flags));
@@ -5971,6 +5976,12 @@ flush_fragments_free_futures(app_pc base, size_t size)
             fragment_delete_futures_in_region(GLOBAL_DCONTEXT, base, base + size);
         release_recursive_lock(&change_linking_lock);
     } /* else we leak them */
+#ifdef CLIENT_INTERFACE
+    monitor_reopt_range_remove(base, base + size);
+#endif
+#if defined(X86) && defined(X64) && defined(CLIENT_INTERFACE)
+    monitor_ibl_cache_range_remove(base, base + size);
+#endif
 }
 
 /* This routine begins a flush that requires full thread synch: currently,
@@ -316,6 +316,15 @@ typedef struct _dr_stats_t {
     uint64 peak_vmm_blocks_special_heap;
     /** Peak number of memory blocks used for mappings not in other categories. */
     uint64 peak_vmm_blocks_special_mmap;
+    /**
+     * Current global hot threshold for trace creation.  This only changes at
+     * runtime under the -adaptive_trace_threshold option.
+     */
+    uint64 trace_threshold;
+    /** Times -adaptive_trace_threshold raised the trace threshold. */
+    uint64 trace_threshold_raises;
+    /** Times -adaptive_trace_threshold lowered the trace threshold. */
+    uint64 trace_threshold_lowers;
 } dr_stats_t;
 
 /**
@@ -69,6 +69,12 @@
 #define HASHTABLE_READ_ONLY 0x00000040
 /* Align the main table to the cache line */
 #define HASHTABLE_ALIGN_TABLE 0x00000080
+/* Allow DR lookups without the read lock via hashtable_*_lookup_lockless().
+ * Unlike HASHTABLE_LOCKLESS_ACCESS, writers still only synchronize with the rwlock:
+ * resized tables are published in a new view and the old ones kept until the
+ * table is freed.
+ */
+#define HASHTABLE_LOCKLESS_LOOKUPS 0x00000100
 
 /* Specific tables can add their own flags starting with this value
  * FIXME: any better way? how know when hit limit with <<?
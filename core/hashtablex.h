@@ -171,6 +171,22 @@
 /****************************************************************************/
 #ifdef HASHTABLEX_HEADER
 
+/* A consistent snapshot of the fields needed for a lookup, published for
+ * HASHTABLE_LOCKLESS_LOOKUPS tables so that readers not holding the rwlock never
+ * combine a table with the mask of a differently-sized one.  Views replaced by a
+ * resize are kept, along with their tables, until the whole table is freed.
+ */
+typedef struct HTNAME(_, NAME_KEY, _view_t) {
+    ptr_uint_t hash_mask;
+    ENTRY_TYPE *table;
+    uint hash_bits;
+    hash_function_t hash_func;
+    uint hash_mask_offset;
+    uint capacity;
+    ENTRY_TYPE *table_unaligned;
+    struct HTNAME(_, NAME_KEY, _view_t) * older;
+} HTNAME(, NAME_KEY, _view_t);
+
 /* N.B.: if you change any fields here you must increase
  * PERSISTENT_CACHE_VERSION!
  */
@@ -226,6 +242,8 @@ typedef struct HTNAME(_, NAME_KEY, _table_t) {
 #    ifdef HASHTABLE_USE_LOOKUPTABLE
     byte *lookup_table_unaligned; /* real allocation unit for lookuptable */
 #    endif
+    /* for HASHTABLE_LOCKLESS_LOOKUPS: newest view, linking to retired ones */
+    HTNAME(, NAME_KEY, _view_t) * read_view;
 #    ifdef DEBUG
     const char *name;
     bool is_local; /* no lock needed since only known to this thread */
@@ -512,6 +530,33 @@ static void HTNAME(hashtable_, NAME_KEY,
     (dcontext, table _IFLOOKUP(use_lookup));
 }
 
+/* Makes the current table visible to lockless lookups.  The prior view and its
+ * table are retired rather than freed as readers may still be walking them.
+ * Caller must hold the write lock, if this is a shared table.
+ */
+static void HTNAME(hashtable_, NAME_KEY,
+                   _publish_view)(dcontext_t *dcontext,
+                                  HTNAME(, NAME_KEY, _table_t) * table)
+{
+    HTNAME(, NAME_KEY, _view_t) *view = (HTNAME(, NAME_KEY, _view_t) *)TABLE_MEMOP(
+        table->table_flags, alloc)(dcontext, sizeof(*view)
+                                       HEAPACCT(HASHTABLE_WHICH_HEAP(table->table_flags)));
+    ASSERT(TEST(HASHTABLE_LOCKLESS_LOOKUPS, table->table_flags));
+    view->hash_mask = table->hash_mask;
+    view->table = table->table;
+    view->hash_bits = table->hash_bits;
+    view->hash_func = table->hash_func;
+    view->hash_mask_offset = table->hash_mask_offset;
+    view->capacity = table->capacity;
+    view->table_unaligned = table->table_unaligned;
+    view->older = table->read_view;
+    /* A store-release, so the view and the table contents are seen before it. */
+    ATOMIC_PTRSZ_ALIGNED_WRITE(&table->read_view, (ptr_int_t)view, false);
+    LOG(THREAD, LOG_HTABLE, 2,
+        "hashtable_" KEY_STRING "_publish_view: %s table=" PFX " capacity=%d\n",
+        table->name, view->table, view->capacity);
+}
+
 static void HTNAME(hashtable_, NAME_KEY,
                    _init)(dcontext_t *dcontext, HTNAME(, NAME_KEY, _table_t) * table,
                           uint bits, uint load_factor_percent, hash_function_t func,
@@ -525,6 +570,7 @@ static void HTNAME(hashtable_, NAME_KEY,
     table->is_local = false;
 #    endif
     table->table_flags = table_flags;
+    table->read_view = NULL;
 #    ifdef HASHTABLE_STATISTICS
     /* indicate this is first time, not a resize */
 #        ifdef HASHTABLE_ENTRY_STATS
@@ -535,6 +581,11 @@ static void HTNAME(hashtable_, NAME_KEY,
     ASSERT(dcontext != GLOBAL_DCONTEXT || TEST(HASHTABLE_SHARED, table_flags));
     HTNAME(hashtable_, NAME_KEY, _init_internal)
     (dcontext, table, bits, load_factor_percent, func, hash_offset _IFLOOKUP(use_lookup));
+    if (TEST(HASHTABLE_LOCKLESS_LOOKUPS, table_flags)) {
+        /* the lockless lookup does not know about lookuptables */
+        ASSERT(IFLOOKUP_ELSE(!use_lookup, true));
+        HTNAME(hashtable_, NAME_KEY, _publish_view)(dcontext, table);
+    }
     ASSIGN_INIT_READWRITE_LOCK_FREE(table->rwlock, HTLOCK_RANK);
 #    ifdef HASHTABLE_STATISTICS
     INIT_HASHTABLE_STATS(table->drlookup_stats);
@@ -597,6 +648,21 @@ static void HTNAME(hashtable_, NAME_KEY, _free)(dcontext_t *dcontext,
 #        endif
 #    endif /* HASHTABLE_STATISTICS */
 
+    /* No lookups can be in progress at this point (we are at reset or exit, or
+     * the table is private), so retired views and tables can finally go.
+     */
+    while (table->read_view != NULL) {
+        HTNAME(, NAME_KEY, _view_t) *view = table->read_view;
+        table->read_view = view->older;
+        if (view->table_unaligned != table->table_unaligned) {
+            HTNAME(hashtable_, NAME_KEY, _free_table)
+            (dcontext, view->table_unaligned _IFLOOKUP(NULL), table->table_flags,
+             view->capacity);
+        }
+        TABLE_MEMOP(table->table_flags, free)
+        (dcontext, view,
+         sizeof(*view) HEAPACCT(HASHTABLE_WHICH_HEAP(table->table_flags)));
+    }
     HTNAME(hashtable_, NAME_KEY, _free_table)
     (dcontext, table->table_unaligned _IFLOOKUP(table->lookup_table_unaligned),
      table->table_flags, table->capacity);
@@ -749,6 +815,35 @@ static inline ENTRY_TYPE HTNAME(hashtable_, NAME_KEY,
     return e;
 }
 
+#    ifndef HASHTABLE_USE_LOOKUPTABLE
+/* Like _rlookup, but for HASHTABLE_LOCKLESS_LOOKUPS tables first searches the
+ * published view without acquiring the read lock.  Entries are only ever replaced
+ * by whole-pointer writes, and the tag check means a hit is always correct, but a
+ * concurrent removal can shift an entry out of our path: so a miss is retried
+ * under the lock.  Callers must already guarantee that the entries themselves stay
+ * live (shared fragments are only freed after all threads pass a flush point).
+ */
+static inline ENTRY_TYPE HTNAME(hashtable_, NAME_KEY,
+                                _lookup_lockless)(dcontext_t *dcontext, ptr_uint_t tag,
+                                                  HTNAME(, NAME_KEY, _table_t) * htable)
+{
+    if (TEST(HASHTABLE_LOCKLESS_LOOKUPS, htable->table_flags)) {
+        HTNAME(, NAME_KEY, _view_t) *view = htable->read_view;
+        uint hindex = HASH_FUNC(tag, view);
+        uint probes = 0;
+        ENTRY_TYPE e = view->table[hindex];
+        /* bound the walk in case removals keep moving entries under us */
+        while (!ENTRY_IS_EMPTY(e) && probes++ < view->capacity) {
+            if (ENTRY_IS_REAL(e) && TAGS_ARE_EQUAL(htable, ENTRY_TAG(e), tag))
+                return e;
+            hindex = HASH_INDEX_WRAPAROUND(hindex + 1, view);
+            e = view->table[hindex];
+        }
+    }
+    return HTNAME(hashtable_, NAME_KEY, _rlookup)(dcontext, tag, htable);
+}
+#    endif
+
 /* add f to a fragment table
  * returns whether resized the table or not
  * N.B.: this routine will recursively call itself via check_table_size if the
@@ -890,6 +985,9 @@ static inline bool HTNAME(hashtable_, NAME_KEY,
 #    endif
     if (ENTRY_IS_INVALID(table->table[hindex]))
         table->unlinked_entries--;
+    /* lockless readers must see the entry initialized before they can find it */
+    if (TEST(HASHTABLE_LOCKLESS_LOOKUPS, table->table_flags))
+        MEMORY_STORE_BARRIER();
 #    ifdef ENTRY_SET_TO_ENTRY
     ENTRY_SET_TO_ENTRY(table->table[hindex], e);
 #    else
@@ -1143,7 +1241,10 @@ static bool HTNAME(hashtable_, NAME_KEY,
          * they are accessed while in-cache, unlike other shared tables
          * such as the shared BB or shared trace table.
          */
-        if (!shared_lockless) {
+        if (TEST(HASHTABLE_LOCKLESS_LOOKUPS, table->table_flags)) {
+            /* the old table is retired and freed along with the whole table */
+            HTNAME(hashtable_, NAME_KEY, _publish_view)(alloc_dc, table);
+        } else if (!shared_lockless) {
             HTNAME(hashtable_, NAME_KEY, _free_table)
             (alloc_dc, old_table_unaligned _IFLOOKUP(old_lookup_table_unaligned),
              table->table_flags, old_capacity);
@@ -2189,6 +2290,7 @@ HTNAME(, NAME_KEY, _table_t) *
     htable->table_flags |= HASHTABLE_READ_ONLY;
     htable->table = (ENTRY_TYPE *)(mapped_table + sizeof(*htable));
     htable->table_unaligned = NULL;
+    htable->read_view = NULL;
     ASSIGN_INIT_READWRITE_LOCK_FREE(htable->rwlock, HTLOCK_RANK);
     DODEBUG({ htable->name = table_name; });
 #        ifdef HASHTABLE_STATISTICS
@@ -273,6 +273,27 @@ typedef struct _thread_units_t {
 #endif
 } thread_units_t;
 
+/* Per-CPU caches of freed fixed-size global heap blocks.  A thread frees to and
+ * allocates from the cache for the processor it last ran on while holding only
+ * that cache's try-lock, falling back to global_alloc_lock when the cache is busy,
+ * empty, or full.  Cached blocks stay carved out of the global units; only the
+ * accounting moves, and it is folded back into global_units at exit.
+ * Blocks are reused on the node whose threads freed them, which keeps hot blocks
+ * node-local under the kernel's first-touch placement.
+ */
+#define MAX_GLOBAL_FREE_CACHES 64
+#define NUMA_NODE_UNKNOWN UINT_MAX
+
+typedef struct _global_free_cache_t {
+    volatile int busy; /* try-lock: 0 when free */
+    uint node;         /* node of the first thread to use this cache */
+    heap_pc free_list[BLOCK_TYPES - 1];
+    uint num_free[BLOCK_TYPES - 1];
+#ifdef HEAP_ACCOUNTING
+    heap_acct_t acct;
+#endif
+} global_free_cache_t;
+
 /* We separate out heap memory used for fragments, linking, and vmarea multi-entries
  * both to enable resetting memory and for safety for unlink flushing in the presence
  * of clean calls out of the cache that might allocate IR memory (which does not
@@ -290,6 +311,9 @@ typedef struct _thread_heap_t {
     thread_units_t *local_heap;
     thread_units_t *nonpersistent_heap;
     thread_units_t *reachable_heap; /* Only used if !REACHABLE_HEAP() */
+    /* Index into heapmgt->global_free_caches and the node we last ran on. */
+    uint free_cache;
+    uint node;
 #ifdef UNIX
     /* Used for -satisfy_w_xor_x. */
     heap_pc fork_copy_start;
@@ -592,6 +616,14 @@ common_heap_free(thread_units_t *tu, void *p, size_t size HEAPACCT(which_heap_t
 static void
 release_real_memory(void *p, size_t size, bool remove_vm, which_vmm_t which);
 static void
+global_free_caches_init(void);
+static void
+global_free_caches_exit(void);
+#ifdef HEAP_ACCOUNTING
+static void
+add_heapacct_to_global_stats(heap_acct_t *acct);
+#endif
+static void
 release_guarded_real_memory(vm_addr_t p, size_t size, bool remove_vm, bool guarded,
                             which_vmm_t which);
 
@@ -703,6 +735,9 @@ typedef struct _heap_management_t {
     bool global_heap_writable;
     thread_units_t global_unprotected_units;
     thread_units_t global_reachable_units; /* Used if !REACHABLE_HEAP() */
+    /* Per-CPU caches in front of global_units; NULL if disabled. */
+    global_free_cache_t *global_free_caches;
+    uint num_global_free_caches;
 } heap_management_t;
 
 /* For bootstrapping until we can allocate our real heapmgt (case 8074).
@@ -809,10 +844,23 @@ report_w_xor_x_fatal_error_and_exit(void)
     ASSERT_NOT_REACHED();
 }
 
+/* Returns the alignment for the start of the vmcode and vmheap reservations. */
+static size_t
+vmm_reservation_align(void)
+{
+    /* With huge pages we align the whole reservation so that each huge-page-sized
+     * run of blocks from its start can be backed by a single huge page.
+     */
+    if (DYNAMO_OPTION(vm_huge_pages))
+        return MAX(DYNAMO_OPTION(vmm_block_size), VMM_HUGE_PAGE_SIZE);
+    return DYNAMO_OPTION(vmm_block_size);
+}
+
 static void
 vmm_place_vmcode(vm_heap_t *vmh, size_t size, heap_error_code_t *error_code)
 {
     ptr_uint_t preferred = 0;
+    size_t align = vmm_reservation_align();
 #ifdef X64
     /* -heap_in_lower_4GB takes top priority and has already set heap_allowable_region_*.
      * Next comes -vm_base_near_app.  It will fail for -vm_size=2G, which we document.
@@ -839,8 +887,8 @@ vmm_place_vmcode(vm_heap_t *vmh, size_t size, heap_error_code_t *error_code)
             byte *reach_end =
                 MIN(REACHABLE_32BIT_END(app_base, app_end), heap_allowable_region_end);
             if (reach_base < reach_end) {
-                size_t add_for_align = DYNAMO_OPTION(vmm_block_size);
-                if (DYNAMO_OPTION(vmm_block_size) == PAGE_SIZE) {
+                size_t add_for_align = align;
+                if (align == PAGE_SIZE) {
                     /* No need for extra space for alignment. */
                     add_for_align = 0;
                 }
@@ -849,10 +897,9 @@ vmm_place_vmcode(vm_heap_t *vmh, size_t size, heap_error_code_t *error_code)
                     (void *)ALIGN_BACKWARD(reach_end, PAGE_SIZE), size + add_for_align,
                     error_code, true /*+x*/);
                 if (vmh->alloc_start != NULL) {
-                    vmh->start_addr = (heap_pc)ALIGN_FORWARD(
-                        vmh->alloc_start, DYNAMO_OPTION(vmm_block_size));
+                    vmh->start_addr = (heap_pc)ALIGN_FORWARD(vmh->alloc_start, align);
                     if (add_for_align == 0) {
-                        ASSERT(ALIGNED(vmh->alloc_start, DYNAMO_OPTION(vmm_block_size)));
+                        ASSERT(ALIGNED(vmh->alloc_start, align));
                         ASSERT(vmh->start_addr == vmh->alloc_start);
                     }
                     request_region_be_heap_reachable(app_base, app_end - app_base);
@@ -877,7 +924,7 @@ vmm_place_vmcode(vm_heap_t *vmh, size_t size, heap_error_code_t *error_code)
                      get_random_offset(DYNAMO_OPTION(vm_max_offset) /
                                        DYNAMO_OPTION(vmm_block_size)) *
                          DYNAMO_OPTION(vmm_block_size));
-        preferred = ALIGN_FORWARD(preferred, DYNAMO_OPTION(vmm_block_size));
+        preferred = ALIGN_FORWARD(preferred, align);
         /* overflow check: w/ vm_base shouldn't happen so debug-only check */
         ASSERT(!POINTER_OVERFLOW_ON_ADD(preferred, size));
         /* let's assume a single chunk is sufficient to reserve */
@@ -905,19 +952,18 @@ vmm_place_vmcode(vm_heap_t *vmh, size_t size, heap_error_code_t *error_code)
          * syslog or assert here
          */
         /* need extra size to ensure alignment */
-        vmh->alloc_size = size + DYNAMO_OPTION(vmm_block_size);
+        vmh->alloc_size = size + align;
 #ifdef X64
         /* PR 215395, make sure allocation satisfies heap reachability contraints */
         vmh->alloc_start = os_heap_reserve_in_region(
             (void *)ALIGN_FORWARD(heap_allowable_region_start, PAGE_SIZE),
-            (void *)ALIGN_BACKWARD(heap_allowable_region_end, PAGE_SIZE),
-            size + DYNAMO_OPTION(vmm_block_size), error_code, true /*+x*/);
+            (void *)ALIGN_BACKWARD(heap_allowable_region_end, PAGE_SIZE), size + align,
+            error_code, true /*+x*/);
 #else
-        vmh->alloc_start = (heap_pc)os_heap_reserve(
-            NULL, size + DYNAMO_OPTION(vmm_block_size), error_code, true /*+x*/);
+        vmh->alloc_start =
+            (heap_pc)os_heap_reserve(NULL, size + align, error_code, true /*+x*/);
 #endif
-        vmh->start_addr =
-            (heap_pc)ALIGN_FORWARD(vmh->alloc_start, DYNAMO_OPTION(vmm_block_size));
+        vmh->start_addr = (heap_pc)ALIGN_FORWARD(vmh->alloc_start, align);
         LOG(GLOBAL, LOG_HEAP, 1,
             "vmm_heap_unit_init unable to allocate at preferred=" PFX
             " letting OS place sz=%dM addr=" PFX "\n",
@@ -959,7 +1005,7 @@ vmm_place_vmcode(vm_heap_t *vmh, size_t size, heap_error_code_t *error_code)
         request_region_be_heap_reachable(vmh->start_addr, size);
     }
 #endif
-    ASSERT(ALIGNED(vmh->start_addr, DYNAMO_OPTION(vmm_block_size)));
+    ASSERT(ALIGNED(vmh->start_addr, align));
 }
 
 static void
@@ -1018,11 +1064,11 @@ vmm_heap_unit_init(vm_heap_t *vmh, size_t size, bool is_vmcode, const char *name
         /* These days every OS provides ASLR, so we do not bother to do our own
          * for this second reservation and rely on the OS.
          */
-        vmh->alloc_size = size + DYNAMO_OPTION(vmm_block_size);
-        vmh->alloc_start = (heap_pc)os_heap_reserve(
-            NULL, size + DYNAMO_OPTION(vmm_block_size), &error_code, false /*-x*/);
-        vmh->start_addr =
-            (heap_pc)ALIGN_FORWARD(vmh->alloc_start, DYNAMO_OPTION(vmm_block_size));
+        size_t align = vmm_reservation_align();
+        vmh->alloc_size = size + align;
+        vmh->alloc_start =
+            (heap_pc)os_heap_reserve(NULL, size + align, &error_code, false /*-x*/);
+        vmh->start_addr = (heap_pc)ALIGN_FORWARD(vmh->alloc_start, align);
     }
 
     if (vmh->start_addr == 0) {
@@ -1038,6 +1084,15 @@ vmm_heap_unit_init(vm_heap_t *vmh, size_t size, bool is_vmcode, const char *name
         ASSERT_NOT_REACHED();
     }
     vmh->end_addr = vmh->start_addr + size;
+    if (DYNAMO_OPTION(vm_huge_pages)) {
+        /* The advice is only a hint, so failure is not fatal. */
+        if (os_heap_advise_huge_pages(vmh->start_addr, size)) {
+            RSTATS_ADD(vmm_huge_page_advised, size);
+        } else {
+            LOG(GLOBAL, LOG_HEAP, 1, "vmm_heap_unit_init %s: huge page advice failed\n",
+                name);
+        }
+    }
     ASSERT_TRUNCATE(vmh->num_blocks, uint, size / DYNAMO_OPTION(vmm_block_size));
     vmh->num_blocks = (uint)(size / DYNAMO_OPTION(vmm_block_size));
     vmh->num_free_blocks = vmh->num_blocks;
@@ -2234,6 +2289,7 @@ d_r_heap_init()
                          GLOBAL_UNIT_MIN_SIZE, true);
     }
     heap_reset_init();
+    global_free_caches_init();
 
 #ifdef WINDOWS
     /* PR 250294: As part of 64-bit hook work, hook reachability was addressed
@@ -2310,6 +2366,7 @@ d_r_heap_exit()
     heap_unit_t *u, *next_u;
     heap_management_t *temp;
 
+    global_free_caches_exit();
     heap_exiting = true;
     /* FIXME: we shouldn't need either lock if executed last */
     dynamo_vm_areas_lock();
@@ -3420,6 +3477,214 @@ heap_vmareas_synch_units()
     release_recursive_lock(&global_alloc_lock);
 }
 
+/* Returns the per-CPU free cache for the processor we are running on. */
+static uint
+global_free_cache_home(OUT uint *node)
+{
+    uint cpu;
+    if (!get_current_processor(&cpu, node)) {
+        /* Spread threads out even when we cannot tell where they run. */
+        cpu = (uint)d_r_get_thread_id();
+        *node = 0;
+    }
+    return cpu % heapmgt->num_global_free_caches;
+}
+
+/* Returns the fixed-size bucket for size, or -1 if size needs a variable-sized
+ * block, which the per-CPU caches do not hold.
+ */
+static int
+global_free_cache_bucket(size_t size)
+{
+    int bucket = 0;
+    size_t aligned_size = ALIGN_FORWARD(size, HEAP_ALIGNMENT);
+    while (aligned_size > BLOCK_SIZES[bucket])
+        bucket++;
+    return (bucket == BLOCK_TYPES - 1) ? -1 : bucket;
+}
+
+/* Try-locks the calling thread's per-CPU free cache.  Never blocks: returns NULL
+ * if the thread has no cache yet (or anymore) or if the cache is busy, in which
+ * case the caller should use the global units.
+ */
+static global_free_cache_t *
+global_free_cache_acquire(OUT thread_heap_t **th_out)
+{
+    dcontext_t *dcontext = get_thread_private_dcontext();
+    thread_heap_t *th;
+    global_free_cache_t *cache;
+    if (dcontext == NULL || dcontext == GLOBAL_DCONTEXT || dcontext->heap_field == NULL)
+        return NULL;
+    th = (thread_heap_t *)dcontext->heap_field;
+    cache = &heapmgt->global_free_caches[th->free_cache];
+    if (!atomic_compare_exchange_int(&cache->busy, 0, 1)) {
+        /* Another thread shares our cache, most likely because one of us has
+         * migrated: re-pick ours for next time and skip the cache this time.
+         */
+        STATS_INC(global_free_cache_busy);
+        th->free_cache = global_free_cache_home(&th->node);
+        return NULL;
+    }
+    if (cache->node == NUMA_NODE_UNKNOWN)
+        cache->node = th->node;
+    *th_out = th;
+    return cache;
+}
+
+static inline void
+global_free_cache_release(global_free_cache_t *cache)
+{
+    ATOMIC_DEC(int, cache->busy);
+}
+
+/* Pops a block from the per-CPU free cache, doing the bookkeeping that
+ * common_heap_alloc() does for a reused fixed-size block.  Returns NULL if the
+ * cache cannot satisfy the request.
+ */
+static void *
+global_free_cache_alloc(size_t size HEAPACCT(which_heap_t which))
+{
+    global_free_cache_t *cache;
+    thread_heap_t *th = NULL;
+    heap_pc p;
+    size_t aligned_size, alloc_size;
+    int bucket = global_free_cache_bucket(size);
+#if defined(DEBUG_MEMORY) && defined(DEBUG)
+    uint chklvl = CHKLVL_MEMFILL + (IF_HEAPACCT_ELSE(which == ACCT_LIBDUP ? 1 : 0, 0));
+#endif
+    if (bucket < 0)
+        return NULL;
+    cache = global_free_cache_acquire(&th);
+    if (cache == NULL)
+        return NULL;
+    p = cache->free_list[bucket];
+    if (p == NULL) {
+        global_free_cache_release(cache);
+        return NULL;
+    }
+    cache->free_list[bucket] = *((heap_pc *)p);
+    cache->num_free[bucket]--;
+    aligned_size = ALIGN_FORWARD(size, HEAP_ALIGNMENT);
+    alloc_size = BLOCK_SIZES[bucket];
+    ACCOUNT_FOR_ALLOC(alloc_reuse, cache, which, alloc_size, aligned_size);
+    if (cache->node != th->node)
+        RSTATS_INC(global_free_cache_cross_node);
+    global_free_cache_release(cache);
+
+    RSTATS_INC(global_free_cache_allocs);
+    DOSTATS({
+        ATOMIC_ADD(int, block_count[bucket], 1);
+        ATOMIC_ADD(int, block_total_count[bucket], 1);
+        ATOMIC_MAX(int, block_peak_count[bucket], block_count[bucket]);
+        ATOMIC_ADD(int, block_wasted[bucket], (int)(alloc_size - aligned_size));
+        ATOMIC_MAX(int, block_peak_wasted[bucket], block_wasted[bucket]);
+        if (aligned_size > size) {
+            ATOMIC_ADD(int, block_align_pad[bucket], (int)(aligned_size - size));
+            ATOMIC_MAX(int, block_peak_align_pad[bucket], block_align_pad[bucket]);
+            STATS_ADD_PEAK(heap_align, aligned_size - size);
+        }
+        STATS_INC(heap_allocs_buckets);
+        if (alloc_size > aligned_size)
+            STATS_ADD_PEAK(heap_bucket_pad, alloc_size - aligned_size);
+    });
+#if defined(DEBUG_MEMORY) && defined(DEBUG)
+    /* The block was freed under the free's check level, which may not match
+     * ours, so we do not verify its contents here.
+     */
+    DOCHECK(chklvl, memset(p + size, HEAP_PAD_BYTE, alloc_size - size););
+    DOCHECK(chklvl, memset(p, HEAP_ALLOCATED_BYTE, size););
+#endif
+    return (void *)p;
+}
+
+/* Pushes a block onto the per-CPU free cache, doing the bookkeeping that
+ * common_heap_free() does for a fixed-size block.  Returns false if the cache
+ * cannot take it.
+ */
+static bool
+global_free_cache_free(void *p_void, size_t size HEAPACCT(which_heap_t which))
+{
+    global_free_cache_t *cache;
+    thread_heap_t *th = NULL;
+    heap_pc p = (heap_pc)p_void;
+    size_t aligned_size, alloc_size;
+    int bucket = global_free_cache_bucket(size);
+#if defined(DEBUG_MEMORY) && defined(DEBUG)
+    uint chklvl = CHKLVL_MEMFILL + (IF_HEAPACCT_ELSE(which == ACCT_LIBDUP ? 1 : 0, 0));
+#endif
+    if (bucket < 0)
+        return false;
+    cache = global_free_cache_acquire(&th);
+    if (cache == NULL)
+        return false;
+    if (cache->num_free[bucket] >= DYNAMO_OPTION(global_free_cache_max)) {
+        global_free_cache_release(cache);
+        return false;
+    }
+    aligned_size = ALIGN_FORWARD(size, HEAP_ALIGNMENT);
+    alloc_size = BLOCK_SIZES[bucket];
+#if defined(DEBUG_MEMORY) && defined(DEBUG)
+    ASSERT_MESSAGE(chklvl, "heap overflow",
+                   is_region_memset_to_char(p + size, alloc_size - size, HEAP_PAD_BYTE));
+    DOCHECK(chklvl, memset(p, HEAP_UNALLOCATED_BYTE, alloc_size););
+#endif
+    ACCOUNT_FOR_FREE(cache, which, alloc_size);
+    *((heap_pc *)p) = cache->free_list[bucket];
+    cache->free_list[bucket] = p;
+    cache->num_free[bucket]++;
+    global_free_cache_release(cache);
+
+    RSTATS_INC(global_free_cache_frees);
+    STATS_SUB(heap_bucket_pad, (alloc_size - aligned_size));
+    STATS_SUB(heap_align, (aligned_size - size));
+    DOSTATS({
+        ATOMIC_ADD(int, block_count[bucket], -1);
+        ATOMIC_ADD(int, block_wasted[bucket], -(int)(alloc_size - aligned_size));
+        ATOMIC_ADD(int, block_align_pad[bucket], -(int)(aligned_size - size));
+    });
+    return true;
+}
+
+static void
+global_free_caches_init(void)
+{
+    uint i, num = get_num_processors();
+    global_free_cache_t *caches;
+    if (DYNAMO_OPTION(global_free_cache_max) == 0 IF_CLIENT_INTERFACE(|| standalone_library))
+        return;
+    if (num > MAX_GLOBAL_FREE_CACHES)
+        num = MAX_GLOBAL_FREE_CACHES;
+    caches = (global_free_cache_t *)global_heap_alloc(
+        num * sizeof(global_free_cache_t) HEAPACCT(ACCT_MEM_MGT));
+    memset(caches, 0, num * sizeof(global_free_cache_t));
+    for (i = 0; i < num; i++)
+        caches[i].node = NUMA_NODE_UNKNOWN;
+    heapmgt->num_global_free_caches = num;
+    heapmgt->global_free_caches = caches;
+}
+
+/* The cached blocks stay in the global units, which are freed wholesale; we only
+ * need to fold the caches' accounting back in.
+ */
+static void
+global_free_caches_exit(void)
+{
+    global_free_cache_t *caches = heapmgt->global_free_caches;
+    uint num = heapmgt->num_global_free_caches;
+    if (caches == NULL)
+        return;
+    heapmgt->global_free_caches = NULL;
+    heapmgt->num_global_free_caches = 0;
+#ifdef HEAP_ACCOUNTING
+    {
+        uint i;
+        for (i = 0; i < num; i++)
+            add_heapacct_to_global_stats(&caches[i].acct);
+    }
+#endif
+    global_heap_free(caches, num * sizeof(global_free_cache_t) HEAPACCT(ACCT_MEM_MGT));
+}
+
 /* shared between global and global_unprotected */
 static void *
 common_global_heap_alloc(thread_units_t *tu, size_t size HEAPACCT(which_heap_t which))
@@ -3435,6 +3700,11 @@ common_global_heap_alloc(thread_units_t *tu, size_t size HEAPACCT(which_heap_t w
     }
 #endif
     void *p;
+    if (tu == &heapmgt->global_units && heapmgt->global_free_caches != NULL) {
+        p = global_free_cache_alloc(size HEAPACCT(which));
+        if (p != NULL)
+            return p;
+    }
     acquire_recursive_lock(&global_alloc_lock);
     p = common_heap_alloc(tu, size HEAPACCT(which));
     release_recursive_lock(&global_alloc_lock);
@@ -3473,6 +3743,9 @@ common_global_heap_free(thread_units_t *tu, void *p,
         ASSERT(false && "attempt to free NULL");
         return;
     }
+    if (tu == &heapmgt->global_units && heapmgt->global_free_caches != NULL &&
+        global_free_cache_free(p, size HEAPACCT(which)))
+        return;
 
     acquire_recursive_lock(&global_alloc_lock);
     ok = common_heap_free(tu, p, size HEAPACCT(which));
@@ -3986,6 +4259,13 @@ heap_thread_init(dcontext_t *dcontext)
 {
     thread_heap_t *th =
         (thread_heap_t *)global_heap_alloc(sizeof(thread_heap_t) HEAPACCT(ACCT_MEM_MGT));
+    /* Pick our per-CPU cache before heap_field makes th visible to global allocs. */
+    if (heapmgt->global_free_caches != NULL)
+        th->free_cache = global_free_cache_home(&th->node);
+    else {
+        th->free_cache = 0;
+        th->node = 0;
+    }
     dcontext->heap_field = (void *)th;
     th->local_heap = (thread_units_t *)global_heap_alloc(sizeof(thread_units_t)
                                                              HEAPACCT(ACCT_MEM_MGT));
@@ -4041,6 +4321,8 @@ heap_thread_exit(dcontext_t *dcontext)
         global_heap_free(th->reachable_heap,
                          sizeof(thread_units_t) HEAPACCT(ACCT_MEM_MGT));
     }
+    /* Stop global allocs from finding our per-CPU cache through th. */
+    dcontext->heap_field = NULL;
     global_heap_free(th, sizeof(thread_heap_t) HEAPACCT(ACCT_MEM_MGT));
 }
 
@@ -352,6 +352,8 @@ global_unprotected_heap_free(void *p, size_t size HEAPACCT(which_heap_t which));
     NONPERSISTENT_HEAP_ARRAY_FREE(dc, p, type, 1, which)
 
 #define MIN_VMM_BLOCK_SIZE IF_WINDOWS_ELSE(16U * 1024, 4U * 1024)
+/* Alignment and commit granularity used for -vm_huge_pages. */
+#define VMM_HUGE_PAGE_SIZE (2U * 1024 * 1024)
 
 /* special heap of same-sized blocks that avoids global locks */
 void *
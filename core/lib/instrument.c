@@ -219,6 +219,9 @@ static callback_list_t bb_callbacks = {
 static callback_list_t trace_callbacks = {
     0,
 };
+static callback_list_t trace_reopt_callbacks = {
+    0,
+};
 #    ifdef CUSTOM_TRACES
 static callback_list_t end_trace_callbacks = {
     0,
@@ -828,6 +831,7 @@ free_all_callback_lists()
     free_callback_list(&low_on_memory_callbacks);
     free_callback_list(&bb_callbacks);
     free_callback_list(&trace_callbacks);
+    free_callback_list(&trace_reopt_callbacks);
 #    ifdef CUSTOM_TRACES
     free_callback_list(&end_trace_callbacks);
 #    endif
@@ -1008,6 +1012,23 @@ bool dr_unregister_trace_event(dr_emit_flags_t (*func)(void *drcontext, void *ta
     return remove_callback(&trace_callbacks, (void (*)(void))func, true);
 }
 
+void dr_register_trace_reopt_event(dr_emit_flags_t (*func)(void *drcontext, void *tag,
+                                                           instrlist_t *trace))
+{
+    if (!INTERNAL_OPTION(code_api)) {
+        CLIENT_ASSERT(false, "asking for trace reopt event when code_api is disabled");
+        return;
+    }
+
+    add_callback(&trace_reopt_callbacks, (void (*)(void))func, true);
+}
+
+bool dr_unregister_trace_reopt_event(dr_emit_flags_t (*func)(void *drcontext, void *tag,
+                                                             instrlist_t *trace))
+{
+    return remove_callback(&trace_reopt_callbacks, (void (*)(void))func, true);
+}
+
 #    ifdef CUSTOM_TRACES
 void dr_register_end_trace_event(dr_custom_trace_action_t (*func)(void *drcontext,
                                                                   void *tag,
@@ -1509,6 +1530,12 @@ dr_trace_hook_exists(void)
     return (trace_callbacks.num > 0);
 }
 
+bool
+dr_trace_reopt_hook_exists(void)
+{
+    return (trace_reopt_callbacks.num > 0);
+}
+
 bool
 dr_fragment_deleted_hook_exists(void)
 {
@@ -1762,6 +1789,41 @@ instrument_trace(dcontext_t *dcontext, app_pc tag, instrlist_t *trace, bool tran
     return ret;
 }
 
+/* Give the user a hot trace, selected by sampling or dr_reopt_trace(), for
+ * re-optimization.  Called after instrument_trace() on the same unmangled list.
+ * Never called when translating: re-optimized traces always store translations.
+ */
+dr_emit_flags_t
+instrument_trace_reopt(dcontext_t *dcontext, app_pc tag, instrlist_t *trace)
+{
+    dr_emit_flags_t ret = DR_EMIT_DEFAULT;
+    if (trace_reopt_callbacks.num == 0)
+        return DR_EMIT_DEFAULT;
+
+    LOG(THREAD, LOG_INTERP | LOG_MONITOR, 2, "instrument_trace_reopt " PFX "\n", tag);
+    dcontext->client_data->mcontext_in_dcontext = true;
+
+    call_all_ret(ret, |=, , trace_reopt_callbacks, int (*)(void *, void *, instrlist_t *),
+                 (void *)dcontext, (void *)tag, trace);
+
+    DOCHECK(1, { check_ilist_translations(trace); });
+
+    CLIENT_ASSERT(instrlist_get_return_target(trace) == NULL &&
+                      instrlist_get_fall_through_target(trace) == NULL,
+                  "instrlist_set_return/fall_through_target"
+                  " cannot be used on traces");
+
+    dcontext->client_data->mcontext_in_dcontext = false;
+
+#    ifdef DEBUG
+    LOG(THREAD, LOG_INTERP, 3, "\nafter re-optimization:\n");
+    if (d_r_stats->loglevel >= 3 && (d_r_stats->logmask & LOG_INTERP) != 0)
+        instrlist_disassemble(dcontext, tag, trace, THREAD);
+#    endif
+
+    return ret;
+}
+
 /* Notify user when a fragment is deleted from the cache
  * FIXME PR 242544: how does user know whether this is a shadowed copy or the
  * real thing?  The user might free memory that shouldn't be freed!
@@ -7313,6 +7375,19 @@ dr_delay_flush_region(app_pc start, size_t size, uint flush_id,
     return true;
 }
 
+DR_API
+bool
+dr_reopt_trace(void *drcontext, void *tag)
+{
+    dcontext_t *dcontext = (dcontext_t *)drcontext;
+    CLIENT_ASSERT(drcontext != NULL, "dr_reopt_trace: drcontext cannot be NULL");
+    CLIENT_ASSERT(drcontext != GLOBAL_DCONTEXT,
+                  "dr_reopt_trace: drcontext is invalid");
+    if (DYNAMO_OPTION(disable_traces) || !dr_trace_reopt_hook_exists())
+        return false;
+    return monitor_reopt_request(dcontext, (app_pc)tag);
+}
+
 DR_API
 /* returns whether or not there is a fragment in the drcontext fcache at tag
  */
@@ -7884,6 +7959,24 @@ dr_get_stats(dr_stats_t *drstats)
  * PERSISTENCE
  */
 
+/* Identifies the instrumentation a client will produce beyond its path: its
+ * options, and on Linux the build id of the library itself so that a rebuilt
+ * client does not pick up stale instrumentation.
+ */
+static uint
+client_instrumentation_hash(size_t i)
+{
+    uint hash = d_r_crc32(client_libs[i].options, (uint)strlen(client_libs[i].options));
+#    ifdef LINUX
+    byte build_id[MAX_BUILD_ID_LENGTH];
+    size_t len;
+    len = module_get_build_id(client_libs[i].start, build_id, sizeof(build_id));
+    if (len > 0)
+        hash ^= d_r_crc32((const char *)build_id, (uint)len);
+#    endif
+    return hash;
+}
+
 /* Up to caller to synchronize. */
 uint
 instrument_persist_ro_size(dcontext_t *dcontext, void *perscxt, size_t file_offs)
@@ -7898,8 +7991,9 @@ instrument_persist_ro_size(dcontext_t *dcontext, void *perscxt, size_t file_offs
      * We ignore ids.  We do care about priority order: clients must
      * be in the same order in addition to having the same path.
      *
-     * XXX: we could go further and store client library checksum, etc. hashes,
-     * but that precludes clients from doing their own proper versioning.
+     * After each path we store a hash of the client's options and (on Linux)
+     * of its library build id, as either can change the instrumentation.
+     * Clients with other inputs should still do their own proper versioning.
      *
      * XXX: we could also put the set of clients into the pcache namespace to allow
      * simultaneous use of pcaches with different sets of clients (empty set
@@ -7908,6 +8002,7 @@ instrument_persist_ro_size(dcontext_t *dcontext, void *perscxt, size_t file_offs
      */
     for (i = 0; i < num_client_libs; i++) {
         sz += strlen(client_libs[i].path) + 1 /*NULL*/;
+        sz += sizeof(uint) /*instrumentation hash*/;
     }
     sz++; /* double NULL ends it */
 
@@ -7939,8 +8034,11 @@ instrument_persist_ro(dcontext_t *dcontext, void *perscxt, file_t fd)
 
     for (i = 0; i < num_client_libs; i++) {
         size_t sz = strlen(client_libs[i].path) + 1 /*NULL*/;
+        uint hash = client_instrumentation_hash(i);
         if (os_write(fd, client_libs[i].path, sz) != (ssize_t)sz)
             return false;
+        if (os_write(fd, &hash, sizeof(hash)) != (ssize_t)sizeof(hash))
+            return false;
     }
     /* double NULL ends it */
     if (os_write(fd, &nul, sizeof(nul)) != (ssize_t)sizeof(nul))
@@ -7962,6 +8060,7 @@ instrument_resurrect_ro(dcontext_t *dcontext, void *perscxt, byte *map)
     bool res = true;
     size_t i;
     const char *c;
+    uint hash;
     ASSERT(map != NULL);
 
     /* Ensure we have the same set of tools (see comments above) */
@@ -7973,6 +8072,10 @@ instrument_resurrect_ro(dcontext_t *dcontext, void *perscxt, byte *map)
         if (strcmp(client_libs[i].path, c) != 0)
             return false; /* client path mismatch */
         c += strlen(c) + 1;
+        memcpy(&hash, c, sizeof(hash)); /* may be unaligned */
+        if (hash != client_instrumentation_hash(i))
+            return false; /* client options or library mismatch */
+        c += sizeof(hash);
         i++;
     }
     if (i < num_client_libs)
@@ -96,6 +96,8 @@ instrument_basic_block(dcontext_t *dcontext, app_pc tag, instrlist_t *bb, bool f
                        bool translating, dr_emit_flags_t *emitflags);
 dr_emit_flags_t
 instrument_trace(dcontext_t *dcontext, app_pc tag, instrlist_t *trace, bool translating);
+dr_emit_flags_t
+instrument_trace_reopt(dcontext_t *dcontext, app_pc tag, instrlist_t *trace);
 #    ifdef CUSTOM_TRACES
 dr_custom_trace_action_t
 instrument_end_trace(dcontext_t *dcontext, app_pc trace_tag, app_pc next_tag);
@@ -185,6 +187,8 @@ dr_bb_hook_exists(void);
 bool
 dr_trace_hook_exists(void);
 bool
+dr_trace_reopt_hook_exists(void);
+bool
 dr_fragment_deleted_hook_exists(void);
 bool
 dr_end_trace_hook_exists(void);
@@ -485,6 +485,34 @@ bool dr_unregister_trace_event(dr_emit_flags_t (*func)(void *drcontext, void *ta
                                                        instrlist_t *trace,
                                                        bool translating));
 
+DR_API
+/**
+ * Registers a callback function for the trace re-optimization event.  DR
+ * calls \p func for a trace that has been found to be hot, either by
+ * sampling the code cache (see the -reopt_sample_ms, -reopt_threshold, and
+ * -reopt_max_traces runtime options; sampling is only supported on UNIX) or
+ * by an explicit dr_reopt_trace() request.  The old trace is flushed and
+ * \p func is called on the rebuilt trace immediately after the trace event
+ * (#dr_register_trace_event()), on the same instruction list, and may apply
+ * more expensive optimizations than are worthwhile for every trace.
+ *
+ * Once a tag is selected, every trace later built from it is passed to this
+ * event until its code is unmapped.  Translation information is always stored
+ * for a re-optimized trace, so this event is never called for state
+ * recreation and its return value is currently ignored.
+ */
+void dr_register_trace_reopt_event(dr_emit_flags_t (*func)(void *drcontext, void *tag,
+                                                           instrlist_t *trace));
+
+DR_API
+/**
+ * Unregister a callback function for the trace re-optimization event.
+ * \return true if unregistration is successful and false if it is not
+ * (e.g., \p func was not registered).
+ */
+bool dr_unregister_trace_reopt_event(dr_emit_flags_t (*func)(void *drcontext, void *tag,
+                                                             instrlist_t *trace));
+
 #    ifdef CUSTOM_TRACES
 /* DR_API EXPORT BEGIN */
 
@@ -6295,6 +6323,19 @@ bool
 dr_delay_flush_region(app_pc start, size_t size, uint flush_id,
                       void (*flush_completion_callback)(int flush_id));
 
+DR_API
+/**
+ * Requests that the trace headed by \p tag be re-optimized: the current trace
+ * is flushed via dr_delay_flush_region() and the next trace built from \p tag
+ * is passed to the trace re-optimization event
+ * (#dr_register_trace_reopt_event()).  This is the manual counterpart to the
+ * sampling enabled by the -reopt_sample_ms runtime option, and is not limited
+ * by -reopt_max_traces.  Returns false if traces are disabled, no
+ * re-optimization event is registered, or \p tag was already selected.
+ */
+bool
+dr_reopt_trace(void *drcontext, void *tag);
+
 DR_API
 /** Returns whether or not there is a fragment in code cache with tag \p tag. */
 bool
@@ -390,12 +390,25 @@ STATS_DEF("App writes emulated un-successfully", num_emulated_write_failures)
 
 STATS_DEF("Fragments generated, bb and trace", num_fragments)
 RSTATS_DEF("Basic block fragments generated", num_bbs)
+RSTATS_DEF("Basic block fragments prebuilt in the background", num_bbs_prebuilt)
+STATS_DEF("Basic block prebuild requests posted", num_bb_prebuild_requests)
+STATS_DEF("Basic block prebuild requests dropped on collision", num_bb_prebuild_dropped)
+STATS_DEF("Basic block prebuilds aborted on a fault", num_bb_prebuild_faults)
 RSTATS_DEF("Trace fragments generated", num_traces)
 #ifdef X64
 STATS_DEF("32-bit basic block fragments generated", num_32bit_bbs)
 STATS_DEF("32-bit trace fragments generated", num_32bit_traces)
 STATS_DEF("32-bit instructions translated to 64-bit", num_32bit_instrs_translated)
 #endif
+RSTATS_DEF("Adaptive trace threshold raises", trace_threshold_raises)
+RSTATS_DEF("Adaptive trace threshold lowers", trace_threshold_lowers)
+STATS_DEF("Trace head hits in tight loops", num_tight_loop_trace_heads)
+#ifdef CLIENT_INTERFACE
+STATS_DEF("Trace re-optimization pc samples", num_reopt_samples)
+RSTATS_DEF("Trace fragments queued for re-optimization", num_reopt_requested)
+RSTATS_DEF("Trace fragments re-optimized", num_traces_reoptimized)
+STATS_DEF("Trace fragments placed in hot trace cache", num_hot_cache_traces)
+#endif
 STATS_DEF("Trace fragments aborted for any reason", num_aborted_traces)
 STATS_DEF("Trace fragments aborted: shared race", num_aborted_traces_race)
 STATS_DEF("Trace fragments aborted: client bad mod", num_aborted_traces_client)
@@ -901,6 +914,11 @@ STATS_DEF("Heap bucket pad space (bytes)", heap_bucket_pad)
 STATS_DEF("Peak heap bucket pad space (bytes)", peak_heap_bucket_pad)
 STATS_DEF("Heap allocs in buckets", heap_allocs_buckets)
 STATS_DEF("Heap allocs variable-sized", heap_allocs_variable)
+RSTATS_DEF("Global heap allocs from per-CPU caches", global_free_cache_allocs)
+RSTATS_DEF("Global heap frees to per-CPU caches", global_free_cache_frees)
+RSTATS_DEF("Global heap per-CPU cache allocs across NUMA nodes",
+           global_free_cache_cross_node)
+STATS_DEF("Global heap per-CPU cache contention fallbacks", global_free_cache_busy)
 STATS_DEF("Total reserved memory", reserved_memory_capacity)
 STATS_DEF("Peak total reserved memory", peak_reserved_memory_capacity)
 STATS_DEF("Guard pages, reserved virtual pages", guard_pages)
@@ -992,6 +1010,8 @@ STATS_DEF("Allocations using multiple vmm blocks", vmm_multi_block_allocs)
 STATS_DEF("Blocks used for multi-block allocs", vmm_multi_blocks)
 RSTATS_DEF("Current vmm virtual memory in use (bytes)", vmm_vsize_used)
 RSTATS_DEF("Peak vmm virtual memory in use (bytes)", peak_vmm_vsize_used)
+RSTATS_DEF("Vmm reservations advised to use huge pages (bytes)",
+           vmm_huge_page_advised)
 STATS_DEF("Number of landing pad areas allocated", num_landing_pad_areas)
 STATS_DEF("Total times mutexes acquired", total_acquired)
 STATS_DEF("Total times mutexes contended", total_contended)
@@ -1153,6 +1173,9 @@ STATS_DEF("Trace fragment ending with an IBL, syscall", num_traces_end_at_ibl_sy
 STATS_DEF("Trace fragment ending at MUST_END_TRACE", num_traces_at_must_end_trace)
 STATS_DEF("Trace fragment ending with an IBL, speculative",
           num_traces_end_at_ibl_speculative_link)
+STATS_DEF("Trace IB exits with an inline target cache", ibl_inline_cache_sites)
+STATS_DEF("Trace IB inline cache targets", ibl_inline_cache_targets)
+STATS_DEF("Traces flushed to add IB inline cache targets", ibl_inline_cache_rebuilds)
 STATS_DEF("Yields in intercept_apc wait dynamo_initialized",
           apc_yields_while_initializing)
 STATS_DEF("IBL Tables groomed", num_ibt_groomed)
@@ -327,6 +327,11 @@ free_module_names(module_names_t *mod_names HEAPACCT(which_heap_t which));
 bool
 module_has_text_relocs(app_pc base, bool at_map);
 #endif
+#ifdef LINUX
+/* returns the length of the GNU build id copied into build_id, or 0 if none */
+size_t
+module_get_build_id(app_pc base, OUT byte *build_id, size_t build_id_size);
+#endif
 
 void
 module_copy_os_data(os_module_data_t *dst, os_module_data_t *src);
@@ -102,10 +102,36 @@ reset_trace_state(dcontext_t *dcontext, bool grab_link_lock);
 /* synchronization of shared traces */
 DECLARE_CXTSWPROT_VAR(mutex_t trace_building_lock, INIT_LOCK_FREE(trace_building_lock));
 
+/* -adaptive_trace_threshold moves the threshold by factors of two within
+ * [trace_threshold/N, trace_threshold*N] for this N.
+ */
+#define TRACE_THRESHOLD_ADAPT_RANGE 8
+/* A trace head hit again within this many cache exits is a tight loop going
+ * through dispatch on every iteration, which gets a quarter of the threshold.
+ */
+#define TIGHT_LOOP_EXITS 4
+#define TIGHT_LOOP_DIVISOR 4
+
+typedef struct _trace_threshold_state_t {
+    volatile uint threshold; /* current global threshold, read racily */
+    uint min;
+    uint max;
+    /* Trace creations and trace cache capacity evictions, counted atomically. */
+    volatile int traces_built;
+    volatile int traces_evicted;
+    /* The thread that sets busy owns the fields below. */
+    volatile int busy;
+    int last_traces_built;
+    int last_traces_evicted;
+} trace_threshold_state_t;
+
+DECLARE_NEVERPROT_VAR(static trace_threshold_state_t adapt, { 0 });
+
 /* For clearing counters on trace deletion we follow a lazy strategy
- * using a sentinel value to determine whether we've built a trace or not
+ * using a sentinel value to determine whether we've built a trace or not.
+ * It must exceed any threshold a head can be given.
  */
-#define TH_COUNTER_CREATED_TRACE_VALUE() (INTERNAL_OPTION(trace_threshold) + 1U)
+#define TH_COUNTER_CREATED_TRACE_VALUE() (adapt.max + 1U)
 
 static void
 delete_private_copy(dcontext_t *dcontext)
@@ -266,12 +292,303 @@ mangle_trace_at_end(void)
      * or a recreate-state trace.
      */
 #ifdef CLIENT_INTERFACE
-    return (dr_bb_hook_exists() || dr_trace_hook_exists());
+    return (dr_bb_hook_exists() || dr_trace_hook_exists() ||
+            dr_trace_reopt_hook_exists());
 #else
     return false;
 #endif
 }
 
+#ifdef CLIENT_INTERFACE
+/* Hot-trace re-optimization (-reopt_sample_ms and dr_reopt_trace()).  Code
+ * cache pcs sampled on ITIMER_VIRTUAL are attributed to trace tags in a global
+ * table.  A tag that collects -reopt_threshold samples is marked hot and its
+ * trace is flushed; every trace built from a hot tag from then on is passed to
+ * the trace re-optimization event.  Entries go away only when the code is
+ * unmapped.
+ */
+typedef struct _reopt_entry_t {
+    uint samples;
+    bool hot;
+    bool sampled; /* marked hot by sampling rather than by dr_reopt_trace() */
+} reopt_entry_t;
+
+#    define REOPT_TABLE_BITS 8
+#    define REOPT_TABLE_LOAD 75
+
+static generic_table_t *reopt_table;
+/* Number of hot tags, read racily as a fast path, and the number of those
+ * marked hot by sampling, which is capped at -reopt_max_traces.  Both are
+ * written under the reopt_table write lock and drop as entries are removed.
+ */
+DECLARE_NEVERPROT_VAR(static uint reopt_num_hot, 0);
+DECLARE_NEVERPROT_VAR(static uint reopt_num_sampled, 0);
+
+static void
+reopt_entry_free(dcontext_t *dcontext, void *p)
+{
+    HEAP_TYPE_FREE(GLOBAL_DCONTEXT, p, reopt_entry_t, ACCT_TRACE, UNPROTECTED);
+}
+
+/* Adds samples to tag's entry.  Returns true iff this call marked tag hot:
+ * always when forced and not yet hot, else once the threshold is crossed.
+ * Forced marks do not count against -reopt_max_traces.
+ */
+static bool
+reopt_add_samples(app_pc tag, uint samples, bool force)
+{
+    reopt_entry_t *e;
+    bool marked = false;
+    TABLE_RWLOCK(reopt_table, write, lock);
+    e = (reopt_entry_t *)generic_hash_lookup(GLOBAL_DCONTEXT, reopt_table,
+                                             (ptr_uint_t)tag);
+    if (e == NULL) {
+        e = HEAP_TYPE_ALLOC(GLOBAL_DCONTEXT, reopt_entry_t, ACCT_TRACE, UNPROTECTED);
+        e->samples = 0;
+        e->hot = false;
+        e->sampled = false;
+        generic_hash_add(GLOBAL_DCONTEXT, reopt_table, (ptr_uint_t)tag, e);
+    }
+    if (!e->hot) {
+        e->samples += samples;
+        if (force) {
+            e->hot = true;
+        } else if (e->samples >= DYNAMO_OPTION(reopt_threshold) &&
+                   reopt_num_sampled < DYNAMO_OPTION(reopt_max_traces)) {
+            e->hot = true;
+            e->sampled = true;
+            reopt_num_sampled++;
+        }
+        if (e->hot) {
+            reopt_num_hot++;
+            marked = true;
+        }
+    }
+    TABLE_RWLOCK(reopt_table, write, unlock);
+    return marked;
+}
+
+static bool
+reopt_tag_is_hot(app_pc tag)
+{
+    reopt_entry_t *e;
+    bool hot;
+    if (reopt_table == NULL || reopt_num_hot == 0)
+        return false;
+    TABLE_RWLOCK(reopt_table, read, lock);
+    e = (reopt_entry_t *)generic_hash_lookup(GLOBAL_DCONTEXT, reopt_table,
+                                             (ptr_uint_t)tag);
+    hot = (e != NULL && e->hot);
+    TABLE_RWLOCK(reopt_table, read, unlock);
+    return hot;
+}
+
+/* Marks tag hot and queues a flush of its current trace so that the next one
+ * built goes through the re-optimization event.
+ */
+static bool
+reopt_queue(dcontext_t *dcontext, app_pc tag, uint samples, bool force)
+{
+    if (!reopt_add_samples(tag, samples, force))
+        return false;
+    LOG(THREAD, LOG_MONITOR, 2, "queueing trace " PFX " for re-optimization\n", tag);
+    STATS_INC(num_reopt_requested);
+    dr_delay_flush_region(tag, 1, 0, NULL);
+    return true;
+}
+
+bool
+monitor_reopt_request(dcontext_t *dcontext, app_pc tag)
+{
+    if (reopt_table == NULL)
+        return false;
+    return reopt_queue(dcontext, tag, 0, true /*force*/);
+}
+
+/* Called from the ITIMER_VIRTUAL handler: only records the pc, as we may have
+ * interrupted DR or lock-holding code.  The samples are attributed to traces
+ * at the next cache exit.
+ */
+void
+monitor_reopt_alarm(dcontext_t *dcontext, priv_mcontext_t *mcontext)
+{
+    monitor_data_t *md = (monitor_data_t *)dcontext->monitor_field;
+    if (md == NULL || dcontext->whereami != DR_WHERE_FCACHE ||
+        md->reopt_num_samples >= REOPT_SAMPLE_BATCH)
+        return;
+    md->reopt_samples[md->reopt_num_samples++] = (app_pc)mcontext->pc;
+}
+
+static void
+reopt_process_samples(dcontext_t *dcontext)
+{
+    monitor_data_t *md = (monitor_data_t *)dcontext->monitor_field;
+    fragment_t wrapper, *f;
+    uint i;
+    ASSERT(dcontext->whereami == DR_WHERE_MONITOR); /* no new samples */
+    /* Flushing hot traces is pointless unless they will be rebuilt differently:
+     * through a client pass, or into the hot trace cache.
+     */
+    if (reopt_table != NULL &&
+        (dr_trace_reopt_hook_exists() || DYNAMO_OPTION(hot_trace_cache))) {
+        for (i = 0; i < md->reopt_num_samples; i++) {
+            f = fragment_pclookup(dcontext, md->reopt_samples[i], &wrapper);
+            if (f != NULL && TEST(FRAG_IS_TRACE, f->flags))
+                reopt_queue(dcontext, f->tag, 1, false /*!force*/);
+        }
+    }
+    STATS_ADD(num_reopt_samples, md->reopt_num_samples);
+    md->reopt_num_samples = 0;
+}
+
+bool
+monitor_trace_is_hot(app_pc tag)
+{
+    return reopt_tag_is_hot(tag);
+}
+
+/* Forgets sample counts and hot marks for code in [start,end) being unmapped,
+ * returning the budget of its hot entries.
+ */
+void
+monitor_reopt_range_remove(app_pc start, app_pc end)
+{
+    ptr_uint_t key;
+    reopt_entry_t *e;
+    int iter;
+    if (reopt_table == NULL)
+        return;
+    TABLE_RWLOCK(reopt_table, write, lock);
+    iter = 0;
+    do {
+        iter = generic_hash_iterate_next(GLOBAL_DCONTEXT, reopt_table, iter, &key,
+                                         (void **)&e);
+        if (iter < 0)
+            break;
+        if (key < (ptr_uint_t)start || key >= (ptr_uint_t)end)
+            continue;
+        if (e->hot) {
+            ASSERT(reopt_num_hot > 0);
+            reopt_num_hot--;
+            if (e->sampled) {
+                ASSERT(reopt_num_sampled > 0);
+                reopt_num_sampled--;
+            }
+        }
+        iter = generic_hash_iterate_remove(GLOBAL_DCONTEXT, reopt_table, iter, key);
+    } while (true);
+    TABLE_RWLOCK(reopt_table, write, unlock);
+}
+#endif /* CLIENT_INTERFACE */
+
+#if defined(X86) && defined(X64) && defined(CLIENT_INTERFACE)
+/* Per-trace profile for -ibl_inline_cache: the targets the final indirect branch
+ * of a trace has missed on, in the order first seen.  They are compared inline
+ * ahead of the lookup each time the trace is built.  As with the reopt table,
+ * entries go away only when the code is unmapped.
+ */
+typedef struct _ibl_cache_entry_t {
+    app_pc targets[IBL_INLINE_CACHE_MAX];
+    uint num;
+    uint built; /* number of targets the current trace was emitted with */
+    uint rebuilds;
+} ibl_cache_entry_t;
+
+#    define IBL_CACHE_TABLE_BITS 8
+#    define IBL_CACHE_TABLE_LOAD 75
+/* Bounds how many times a polymorphic site can flush its trace. */
+#    define IBL_CACHE_MAX_REBUILDS 2
+
+static generic_table_t *ibl_cache_table;
+
+static void
+ibl_cache_entry_free(dcontext_t *dcontext, void *p)
+{
+    HEAP_TYPE_FREE(GLOBAL_DCONTEXT, p, ibl_cache_entry_t, ACCT_TRACE, UNPROTECTED);
+}
+
+/* Caller must hold the ibl_cache_table write lock */
+static bool
+ibl_cache_add_target(app_pc tag, app_pc target, ibl_cache_entry_t **entry /*OUT*/)
+{
+    ibl_cache_entry_t *e;
+    uint i;
+    ASSERT_TABLE_SYNCHRONIZED(ibl_cache_table, WRITE);
+    e = (ibl_cache_entry_t *)generic_hash_lookup(GLOBAL_DCONTEXT, ibl_cache_table,
+                                                 (ptr_uint_t)tag);
+    if (e == NULL) {
+        e = HEAP_TYPE_ALLOC(GLOBAL_DCONTEXT, ibl_cache_entry_t, ACCT_TRACE, UNPROTECTED);
+        memset(e, 0, sizeof(*e));
+        generic_hash_add(GLOBAL_DCONTEXT, ibl_cache_table, (ptr_uint_t)tag, e);
+    }
+    *entry = e;
+    for (i = 0; i < e->num; i++) {
+        if (e->targets[i] == target)
+            return false;
+    }
+    if (e->num >= DYNAMO_OPTION(ibl_inline_cache))
+        return false;
+    e->targets[e->num++] = target;
+    return true;
+}
+
+/* Called on a cache exit through the last indirect branch of trace tag, which
+ * means target missed both the inline cache and the lookup table.  Queues a
+ * rebuild of the trace if target is one it has not yet cached.
+ */
+static void
+ibl_cache_record_miss(dcontext_t *dcontext, app_pc tag, app_pc target)
+{
+    ibl_cache_entry_t *e;
+    bool rebuild = false;
+    TABLE_RWLOCK(ibl_cache_table, write, lock);
+    if (ibl_cache_add_target(tag, target, &e) && e->built > 0 &&
+        e->rebuilds < IBL_CACHE_MAX_REBUILDS) {
+        e->rebuilds++;
+        rebuild = true;
+    }
+    TABLE_RWLOCK(ibl_cache_table, write, unlock);
+    if (rebuild) {
+        LOG(THREAD, LOG_MONITOR, 2,
+            "rebuilding trace " PFX " to cache IB target " PFX " inline\n", tag,
+            target);
+        STATS_INC(ibl_inline_cache_rebuilds);
+        dr_delay_flush_region(tag, 1, 0, NULL);
+    }
+}
+
+/* Fills targets with those to cache inline for the trace being emitted, after
+ * adding next_tag, the target its last indirect branch is about to take.
+ * Returns the number of targets.
+ */
+static uint
+ibl_cache_get_targets(app_pc tag, app_pc next_tag,
+                      app_pc targets[IBL_INLINE_CACHE_MAX] /*OUT*/)
+{
+    ibl_cache_entry_t *e;
+    uint num;
+    TABLE_RWLOCK(ibl_cache_table, write, lock);
+    ibl_cache_add_target(tag, next_tag, &e);
+    num = e->num;
+    memcpy(targets, e->targets, num * sizeof(targets[0]));
+    e->built = num;
+    TABLE_RWLOCK(ibl_cache_table, write, unlock);
+    return num;
+}
+
+/* Forgets the cached targets of traces in [start,end) being unmapped */
+void
+monitor_ibl_cache_range_remove(app_pc start, app_pc end)
+{
+    if (ibl_cache_table == NULL)
+        return;
+    TABLE_RWLOCK(ibl_cache_table, write, lock);
+    generic_hash_range_remove(GLOBAL_DCONTEXT, ibl_cache_table, (ptr_uint_t)start,
+                              (ptr_uint_t)end);
+    TABLE_RWLOCK(ibl_cache_table, write, unlock);
+}
+#endif
+
 /* Initialization */
 /* thread-shared init does nothing, thread-private init does it all */
 void
@@ -282,6 +599,29 @@ d_r_monitor_init()
      * this does not include exit stubs
      */
     ASSERT(MAX_TRACE_BUFFER_SIZE <= MAX_FRAGMENT_SIZE);
+    adapt.threshold = INTERNAL_OPTION(trace_threshold);
+    adapt.min = adapt.threshold;
+    adapt.max = adapt.threshold;
+    if (DYNAMO_OPTION(adaptive_trace_threshold)) {
+        adapt.min = MAX(1U, adapt.threshold / TRACE_THRESHOLD_ADAPT_RANGE);
+        adapt.max = MIN(adapt.threshold * TRACE_THRESHOLD_ADAPT_RANGE, USHRT_MAX);
+    }
+#ifdef CLIENT_INTERFACE
+    if (!RUNNING_WITHOUT_CODE_CACHE() && !DYNAMO_OPTION(disable_traces)) {
+        reopt_table = generic_hash_create(
+            GLOBAL_DCONTEXT, REOPT_TABLE_BITS, REOPT_TABLE_LOAD,
+            HASHTABLE_SHARED | HASHTABLE_PERSISTENT,
+            reopt_entry_free _IF_DEBUG("trace reopt table"));
+    }
+#endif
+#if defined(X86) && defined(X64) && defined(CLIENT_INTERFACE)
+    if (DYNAMO_OPTION(ibl_inline_cache) > 0) {
+        ibl_cache_table = generic_hash_create(
+            GLOBAL_DCONTEXT, IBL_CACHE_TABLE_BITS, IBL_CACHE_TABLE_LOAD,
+            HASHTABLE_SHARED | HASHTABLE_PERSISTENT,
+            ibl_cache_entry_free _IF_DEBUG("trace ibl inline cache table"));
+    }
+#endif
 }
 
 /* re-initializes non-persistent memory */
@@ -313,6 +653,18 @@ d_r_monitor_exit()
 {
     LOG(GLOBAL, LOG_MONITOR | LOG_STATS, 1, "Trace fragments generated: %d\n",
         GLOBAL_STAT(num_traces));
+#ifdef CLIENT_INTERFACE
+    if (reopt_table != NULL) {
+        generic_hash_destroy(GLOBAL_DCONTEXT, reopt_table);
+        reopt_table = NULL;
+    }
+#endif
+#if defined(X86) && defined(X64) && defined(CLIENT_INTERFACE)
+    if (ibl_cache_table != NULL) {
+        generic_hash_destroy(GLOBAL_DCONTEXT, ibl_cache_table);
+        ibl_cache_table = NULL;
+    }
+#endif
     DELETE_LOCK(trace_building_lock);
 }
 
@@ -396,6 +748,7 @@ thcounter_add(dcontext_t *dcontext, app_pc tag)
                           sizeof(trace_head_counter_t) HEAPACCT(ACCT_THCOUNTER));
         e->tag = tag;
         e->counter = 0;
+        e->last_hit = 0;
         generic_hash_add(dcontext, md->thead_table, (ptr_uint_t)tag, e);
     }
     return e;
@@ -412,6 +765,85 @@ thcounter_range_remove(dcontext_t *dcontext, app_pc start, app_pc end)
     }
 }
 
+uint
+monitor_trace_threshold(void)
+{
+    return adapt.threshold;
+}
+
+/* Called with the cache lock held when a trace is evicted for capacity */
+void
+monitor_trace_evicted(void)
+{
+    if (DYNAMO_OPTION(adaptive_trace_threshold))
+        ATOMIC_INC(int, adapt.traces_evicted);
+}
+
+/* Returns the threshold for the just-hit trace head ctr, which has not yet
+ * been incremented.
+ */
+static uint
+trace_head_threshold(dcontext_t *dcontext, trace_head_counter_t *ctr)
+{
+    monitor_data_t *md = (monitor_data_t *)dcontext->monitor_field;
+    uint threshold;
+    if (!DYNAMO_OPTION(adaptive_trace_threshold))
+        return INTERNAL_OPTION(trace_threshold);
+    threshold = adapt.threshold;
+    md->epoch_head_hits++;
+    if (ctr->counter > 0 && md->exits - ctr->last_hit <= TIGHT_LOOP_EXITS) {
+        STATS_INC(num_tight_loop_trace_heads);
+        threshold = MAX(threshold / TIGHT_LOOP_DIVISOR, adapt.min);
+    }
+    ctr->last_hit = md->exits;
+    return threshold;
+}
+
+/* Folds this thread's epoch into the adaptive trace threshold.  Traces
+ * evicting each other raise the threshold so only hotter heads are promoted;
+ * dispatches dominated by trace heads still counting up lower it so traces
+ * form sooner.
+ */
+static void
+trace_threshold_update(dcontext_t *dcontext)
+{
+    monitor_data_t *md = (monitor_data_t *)dcontext->monitor_field;
+    uint exits, non_trace_exits, old, threshold;
+    int built, evicted;
+    /* Some other thread is updating: we'll retry on our next exit. */
+    if (!atomic_compare_exchange_int(&adapt.busy, 0, 1))
+        return;
+    exits = md->exits - md->epoch_start;
+    non_trace_exits = exits - md->epoch_trace_exits;
+    built = adapt.traces_built - adapt.last_traces_built;
+    evicted = adapt.traces_evicted - adapt.last_traces_evicted;
+    adapt.last_traces_built += built;
+    adapt.last_traces_evicted += evicted;
+    old = adapt.threshold;
+    threshold = old;
+    if (built > 0 && evicted * 2 >= built)
+        threshold = MIN(old * 2, adapt.max);
+    else if (evicted == 0 && (uint64)non_trace_exits * 4 >= (uint64)exits * 3 &&
+             md->epoch_head_hits * 2 >= non_trace_exits)
+        threshold = MAX(old / 2, adapt.min);
+    if (threshold != old) {
+        LOG(GLOBAL, LOG_MONITOR, 1,
+            "trace threshold %d => %d: %d exits, %d from traces, %d head hits, "
+            "%d traces built, %d evicted\n",
+            old, threshold, exits, md->epoch_trace_exits, md->epoch_head_hits, built,
+            evicted);
+        adapt.threshold = threshold;
+        if (threshold > old)
+            RSTATS_INC(trace_threshold_raises);
+        else
+            RSTATS_INC(trace_threshold_lowers);
+    }
+    md->epoch_start = md->exits;
+    md->epoch_trace_exits = 0;
+    md->epoch_head_hits = 0;
+    ATOMIC_DEC(int, adapt.busy);
+}
+
 bool
 is_building_trace(dcontext_t *dcontext)
 {
@@ -1197,6 +1629,14 @@ end_and_emit_trace(dcontext_t *dcontext, fragment_t *cur_f)
         dr_emit_flags_t emitflags =
             instrument_trace(dcontext, tag, &md->unmangled_ilist, false /*!recreating*/);
         externally_mangled = true;
+        if (dr_trace_reopt_hook_exists() && reopt_tag_is_hot(tag)) {
+            /* State recreation does not replay the re-optimization passes, so
+             * we must store translations for this trace.
+             */
+            instrument_trace_reopt(dcontext, tag, &md->unmangled_ilist);
+            md->trace_flags |= FRAG_HAS_TRANSLATION_INFO;
+            STATS_INC(num_traces_reoptimized);
+        }
         if (TEST(DR_EMIT_STORE_TRANSLATIONS, emitflags)) {
             /* PR 214962: let client request storage instead of recreation */
             md->trace_flags |= FRAG_HAS_TRANSLATION_INFO;
@@ -1282,6 +1722,21 @@ end_and_emit_trace(dcontext_t *dcontext, fragment_t *cur_f)
             }
         }
     }
+#if defined(X86) && defined(X64) && defined(CLIENT_INTERFACE)
+    if (ibl_cache_table != NULL && !TEST(FRAG_MUST_END_TRACE, cur_f->flags) &&
+        LINKSTUB_INDIRECT(dcontext->last_exit->flags) && dcontext->next_tag != NULL) {
+        app_pc targets[IBL_INLINE_CACHE_MAX];
+        uint num = ibl_cache_get_targets(tag, dcontext->next_tag, targets);
+        /* stay within the ushort fragment size */
+        while (num > 0 &&
+               md->emitted_size + (num + 1) * IBL_INLINE_CACHE_SIZE_UPPER_BOUND >
+                   MAX_FRAGMENT_SIZE)
+            num--;
+        md->emitted_size += append_trace_ibl_inline_cache(
+            dcontext, trace, targets, num, md->trace_flags,
+            TEST(FRAG_HAS_TRANSLATION_INFO, md->trace_flags));
+    }
+#endif
 
     DOLOG(2, LOG_MONITOR, {
         LOG(THREAD, LOG_MONITOR, 2, "Ending and emitting hot trace (tag " PFX ")\n", tag);
@@ -1501,6 +1956,8 @@ end_and_emit_trace(dcontext_t *dcontext, fragment_t *cur_f)
         d_r_mutex_unlock(&trace_building_lock);
 
     RSTATS_INC(num_traces);
+    if (DYNAMO_OPTION(adaptive_trace_threshold))
+        ATOMIC_INC(int, adapt.traces_built);
     DOSTATS(
         { IF_X86_64(if (FRAG_IS_32(trace_f->flags)) { STATS_INC(num_32bit_traces); }) });
     STATS_ADD(num_bbs_in_all_traces, md->num_blks);
@@ -1825,6 +2282,26 @@ monitor_cache_exit(dcontext_t *dcontext)
             (TEST(FRAG_IS_TRACE, dcontext->last_fragment->flags) &&
              TEST(LINK_NI_SYSCALL, dcontext->last_exit->flags));
     }
+    if (DYNAMO_OPTION(adaptive_trace_threshold)) {
+        md->exits++;
+        if (TEST(FRAG_IS_TRACE, dcontext->last_fragment->flags))
+            md->epoch_trace_exits++;
+        if (md->exits - md->epoch_start >= INTERNAL_OPTION(adaptive_trace_epoch))
+            trace_threshold_update(dcontext);
+    }
+#ifdef CLIENT_INTERFACE
+    if (md->reopt_num_samples >= REOPT_SAMPLE_BATCH)
+        reopt_process_samples(dcontext);
+#endif
+#if defined(X86) && defined(X64) && defined(CLIENT_INTERFACE)
+    if (ibl_cache_table != NULL && !LINKSTUB_FAKE(dcontext->last_exit) &&
+        TEST(FRAG_IS_TRACE, dcontext->last_fragment->flags) &&
+        LINKSTUB_INDIRECT(dcontext->last_exit->flags) &&
+        LINKSTUB_FINAL(dcontext->last_exit) &&
+        !TEST(LINK_FAR, dcontext->last_exit->flags) &&
+        !IS_SHARED_SYSCALLS_LINKSTUB(dcontext->last_exit))
+        ibl_cache_record_miss(dcontext, dcontext->last_fragment->tag, dcontext->next_tag);
+#endif
     dcontext->whereami = DR_WHERE_DISPATCH;
 }
 
@@ -1872,6 +2349,7 @@ monitor_cache_enter(dcontext_t *dcontext, fragment_t *f)
     dr_custom_trace_action_t client = CUSTOM_TRACE_DR_DECIDES;
 #endif
     trace_head_counter_t *ctr;
+    uint threshold;
     uint add_size = 0, prev_mangle_size = 0; /* NOTE these aren't set if end_trace */
 
     if (DYNAMO_OPTION(disable_traces) || f == NULL) {
@@ -2159,9 +2637,10 @@ monitor_cache_enter(dcontext_t *dcontext, fragment_t *f)
         STATS_INC(th_counter_reset);
     }
 
+    threshold = trace_head_threshold(dcontext, ctr);
     ctr->counter++;
-    /* Should never be > here (assert is down below) but we check just in case */
-    if (ctr->counter >= INTERNAL_OPTION(trace_threshold)) {
+    /* Can be > here if the adaptive threshold dropped since the last hit */
+    if (ctr->counter >= threshold) {
         /* if cannot delete fragment, do not start trace -- wait until
          * can delete it (w/ exceptions, deletion status changes). */
         if (!TEST(FRAG_CANNOT_DELETE, f->flags)) {
@@ -2225,21 +2704,20 @@ monitor_cache_enter(dcontext_t *dcontext, fragment_t *f)
         /* operate on new f from here on */
         f = md->last_fragment;
     }
-    if (!start_trace && ctr->counter >= INTERNAL_OPTION(trace_threshold)) {
-        /* Back up the counter by one. This ensures that the
-         * counter will be == trace_threshold if this thread is later
+    if (!start_trace && ctr->counter >= threshold) {
+        /* Back up the counter to one below the threshold. This ensures that
+         * the counter will reach the threshold if this thread is later
          * able to start building a trace w/this tag and ensures
          * that our one-up sentinel works for lazy clearing.
          */
         LOG(THREAD, LOG_MONITOR, 3, "Backing up F%d counter from %d\n", f->id,
             ctr->counter);
-        ctr->counter--;
-        ASSERT(ctr->counter < INTERNAL_OPTION(trace_threshold));
+        ctr->counter = threshold - 1;
     }
     if (start_trace) {
         KSTART(trace_building);
         /* ensure our sentinel counter value for counter clearing will work */
-        ASSERT(ctr->counter == INTERNAL_OPTION(trace_threshold));
+        ASSERT(ctr->counter >= threshold && ctr->counter < TH_COUNTER_CREATED_TRACE_VALUE());
         ctr->counter = TH_COUNTER_CREATED_TRACE_VALUE();
         /* Found a hot trace head.  Switch this thread into trace
            selection mode, and initialize the instrlist_t for the new
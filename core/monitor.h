@@ -121,9 +121,42 @@ trace_abort_and_delete(dcontext_t *dcontext);
 void
 thcounter_range_remove(dcontext_t *dcontext, app_pc start, app_pc end);
 
+uint
+monitor_trace_threshold(void);
+
+void
+monitor_trace_evicted(void);
+
 bool
 mangle_trace_at_end(void);
 
+/* Maximum number of targets -ibl_inline_cache compares inline */
+#define IBL_INLINE_CACHE_MAX 4
+
+#if defined(X86) && defined(X64) && defined(CLIENT_INTERFACE)
+void
+monitor_ibl_cache_range_remove(app_pc start, app_pc end);
+#endif
+
+#ifdef CLIENT_INTERFACE
+/* Number of code cache pcs a thread samples before attributing them to traces
+ * for hot-trace re-optimization.
+ */
+#    define REOPT_SAMPLE_BATCH 16
+
+bool
+monitor_reopt_request(dcontext_t *dcontext, app_pc tag);
+
+void
+monitor_reopt_alarm(dcontext_t *dcontext, priv_mcontext_t *mcontext);
+
+void
+monitor_reopt_range_remove(app_pc start, app_pc end);
+
+bool
+monitor_trace_is_hot(app_pc tag);
+#endif
+
 /* trace head counters are thread-private and must be kept in a
  * separate table and not in the fragment_t structure.
  * FIXME: may want to do this for non-shared-cache, since persistent counters
@@ -135,6 +168,7 @@ mangle_trace_at_end(void);
 typedef struct _trace_head_counter_t {
     app_pc tag;
     uint counter;
+    uint last_hit; /* monitor_data_t.exits at the previous hit */
 } trace_head_counter_t;
 
 typedef struct _trace_bb_build_t {
@@ -186,12 +220,24 @@ typedef struct _monitor_data_t {
     instrlist_t *unmangled_bb_ilist; /* next bb */
     /* cache at start of trace building whether we're going to pass to client */
     bool pass_to_client;
+    /* code cache pcs sampled by monitor_reopt_alarm() */
+    app_pc reopt_samples[REOPT_SAMPLE_BATCH];
+    uint reopt_num_samples;
 #endif
     /* Record whether final block ends in syscall or int.
      * FIXME: remove once we have PR 307284.
      */
     uint final_exit_flags;
 
+    /* -adaptive_trace_threshold inputs: exits is a running count of cache
+     * exits, the rest are counted since epoch_start and folded into the
+     * global window by trace_threshold_update().
+     */
+    uint exits;
+    uint epoch_start;
+    uint epoch_trace_exits;
+    uint epoch_head_hits;
+
 #ifdef CUSTOM_TRACES
     fragment_t wrapper; /* for creating new shadowed trace heads */
 #endif
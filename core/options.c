@@ -1301,6 +1301,61 @@ check_option_compatibility_helper(int recurse_count)
     }
 #    endif
 
+    if (DYNAMO_OPTION(adaptive_trace_threshold) && DYNAMO_OPTION(disable_traces)) {
+        USAGE_ERROR("-adaptive_trace_threshold requires traces, disabling");
+        dynamo_options.adaptive_trace_threshold = false;
+        changed_options = true;
+    }
+
+    if (DYNAMO_OPTION(ibl_inline_cache) > 0) {
+        /* New targets are picked up by rebuilding the trace through
+         * dr_delay_flush_region(), which needs the client interface.
+         */
+#    if defined(X86) && defined(X64) && defined(CLIENT_INTERFACE)
+        if (DYNAMO_OPTION(disable_traces) || DYNAMO_OPTION(speculate_last_exit)) {
+            USAGE_ERROR("-ibl_inline_cache requires traces and is incompatible with "
+                        "-speculate_last_exit, disabling");
+            SET_DEFAULT_VALUE(ibl_inline_cache);
+            changed_options = true;
+        } else if (DYNAMO_OPTION(ibl_inline_cache) > IBL_INLINE_CACHE_MAX) {
+            dynamo_options.ibl_inline_cache = IBL_INLINE_CACHE_MAX;
+            changed_options = true;
+        }
+#    else
+        USAGE_ERROR("-ibl_inline_cache is only supported on x86-64 with the client "
+                    "interface");
+        SET_DEFAULT_VALUE(ibl_inline_cache);
+        changed_options = true;
+#    endif
+    }
+
+#    ifdef CLIENT_INTERFACE
+    if (DYNAMO_OPTION(reopt_sample_ms) > 0) {
+#        ifdef UNIX
+        if (DYNAMO_OPTION(disable_traces)) {
+            USAGE_ERROR("-reopt_sample_ms requires traces, disabling");
+            SET_DEFAULT_VALUE(reopt_sample_ms);
+            changed_options = true;
+        } else if (INTERNAL_OPTION(profile_pcs)) {
+            /* Both samplers are driven by ITIMER_VIRTUAL. */
+            USAGE_ERROR("-reopt_sample_ms incompatible with -prof_pcs, disabling");
+            SET_DEFAULT_VALUE(reopt_sample_ms);
+            changed_options = true;
+        }
+#        else
+        USAGE_ERROR("-reopt_sample_ms not supported on this OS");
+        SET_DEFAULT_VALUE(reopt_sample_ms);
+        changed_options = true;
+#        endif
+    }
+    if (DYNAMO_OPTION(hot_trace_cache) &&
+        (DYNAMO_OPTION(reopt_sample_ms) == 0 || !DYNAMO_OPTION(shared_traces))) {
+        USAGE_ERROR("-hot_trace_cache requires -reopt_sample_ms and -shared_traces");
+        dynamo_options.hot_trace_cache = false;
+        changed_options = true;
+    }
+#    endif
+
 #    ifdef UNIX
 #        ifndef HAVE_TLS
     if (SHARED_FRAGMENTS_ENABLED()) {
@@ -1667,6 +1722,26 @@ check_option_compatibility_helper(int recurse_count)
         changed_options = true;
     }
 #        endif
+#    endif
+    if (DYNAMO_OPTION(bb_prebuild) &&
+        (!DYNAMO_OPTION(shared_bbs) || INTERNAL_OPTION(single_thread_in_DR))) {
+        SYSLOG_INTERNAL_INFO("-bb_prebuild requires -shared_bbs, disabling");
+        dynamo_options.bb_prebuild = false;
+        changed_options = true;
+    }
+    /* -bb_prebuild is also unsupported with a client bb event, as the builder
+     * thread gets no client thread init event.  Clients are not loaded yet, so
+     * bb_prebuild_enqueue() checks for that and syslogs.
+     */
+#    if !defined(LINUX) || !defined(CLIENT_SIDELINE) || !defined(X86)
+    /* The builder thread only builds in DEFAULT_ISA_MODE, which would produce
+     * wrong blocks for ARM/Thumb interworking code.
+     */
+    if (DYNAMO_OPTION(bb_prebuild)) {
+        USAGE_ERROR("-bb_prebuild is only supported on x86 Linux");
+        dynamo_options.bb_prebuild = false;
+        changed_options = true;
+    }
 #    endif
     if (DYNAMO_OPTION(shared_bb_ibt_tables) && !DYNAMO_OPTION(shared_bbs)) {
         SYSLOG_INTERNAL_INFO("-shared_bb_ibt_tables requires -shared_bbs, disabling");
@@ -1782,6 +1857,30 @@ check_option_compatibility_helper(int recurse_count)
         changed_options = true;
     }
 #    endif
+#    ifdef LINUX
+    if (DYNAMO_OPTION(vm_huge_pages) && DYNAMO_OPTION(satisfy_w_xor_x)) {
+        /* The dual mapping is file-backed, which transparent huge pages do not
+         * cover, and its writable view assumes -vmm_block_size alignment.
+         */
+        USAGE_ERROR("-vm_huge_pages is not supported with -satisfy_w_xor_x");
+        dynamo_options.vm_huge_pages = false;
+        changed_options = true;
+    }
+    if (DYNAMO_OPTION(vm_huge_pages) &&
+        DYNAMO_OPTION(cache_commit_increment) < VMM_HUGE_PAGE_SIZE) {
+        /* Committing in smaller pieces leaves the cache split into mappings of
+         * differing protections, which the kernel will not back with huge pages.
+         */
+        dynamo_options.cache_commit_increment = VMM_HUGE_PAGE_SIZE;
+        changed_options = true;
+    }
+#    else
+    if (DYNAMO_OPTION(vm_huge_pages)) {
+        USAGE_ERROR("-vm_huge_pages is only supported on Linux");
+        dynamo_options.vm_huge_pages = false;
+        changed_options = true;
+    }
+#    endif
 #    ifdef WINDOWS
     /* In theory ignore syscalls should work for int system calls, and also for
      * sysenter system calls when Sygate SPA is not installed [though haven't
@@ -857,6 +857,14 @@ OPTION_COMMAND(bool, disable_traces, IF_X86_ELSE(false, true), "disable_traces",
                    }
                },
                "disable trace creation (block fragments only)", STATIC, OP_PCACHE_GLOBAL)
+/* Adapts the trace threshold at runtime, within [trace_threshold/8,
+ * trace_threshold*8], to trace cache evictions, the share of cache exits
+ * coming from traces, and how often trace heads are hit.
+ */
+OPTION_DEFAULT(bool, adaptive_trace_threshold, false,
+               "adapt the trace threshold to code cache pressure")
+OPTION_DEFAULT_INTERNAL(uint, adaptive_trace_epoch, 4096,
+                        "cache exits per thread between adaptive trace threshold updates")
 /* FIXME i#1551, i#1569: enable traces on ARM/AArch64 once we have them working */
 OPTION_COMMAND(bool, enable_traces, IF_X86_ELSE(true, false), "enable_traces",
                {
@@ -895,6 +903,12 @@ OPTION_DEFAULT_INTERNAL(
 /* PR 361894: if no TLS available, we fall back to thread-private */
 PC_OPTION_DEFAULT(bool, shared_bbs, IF_HAVE_TLS_ELSE(true, false),
                   "use thread-shared basic blocks")
+/* The builder thread receives no client thread init event, so nothing is
+ * prebuilt while a client bb event is registered.  x86 Linux only.
+ */
+OPTION_DEFAULT(bool, bb_prebuild, false,
+               "build the direct successors of new shared basic blocks on a "
+               "background thread")
 /* Note that if we want traces off by default we would have to turn
  * off -shared_traces to avoid tripping over un-initialized ibl tables
  * PR 361894: if no TLS available, we fall back to thread-private
@@ -1117,8 +1131,29 @@ OPTION_DEFAULT(bool, shared_trace_ibl_routine,
                "share ibl routine for traces")
 OPTION_DEFAULT(bool, speculate_last_exit, false,
                "enable speculative linking of trace last IB exit")
+/* Inline cache of up to IBL_INLINE_CACHE_MAX targets compared ahead of the
+ * lookup at a trace's final indirect branch.  The targets are those the branch
+ * missed on; a trace that gains new ones is flushed and rebuilt.  x64 only, and
+ * only with CLIENT_INTERFACE, as the rebuild uses dr_delay_flush_region().
+ */
+OPTION_DEFAULT(uint, ibl_inline_cache, 0,
+               "number of targets to cache inline at a trace's last IB exit (0 disables)")
 
 OPTION_DEFAULT(uint, max_trace_bbs, 128, "maximum number of basic blocks in a trace")
+#ifdef CLIENT_INTERFACE
+/* Hot-trace re-optimization: code cache pcs are sampled every reopt_sample_ms of
+ * thread cpu time and a trace collecting reopt_threshold samples is flushed and
+ * rebuilt through the trace re-optimization event.  Sampling is UNIX-only.
+ */
+OPTION_DEFAULT(uint, reopt_sample_ms, 0,
+               "ms between hot-trace re-optimization samples (0 disables)")
+OPTION_DEFAULT(uint, reopt_threshold, 32, "samples before a trace is re-optimized")
+OPTION_DEFAULT(uint, reopt_max_traces, 256, "maximum number of sampled traces re-optimized")
+/* Rebuilds sampled hot traces into their own shared cache so they sit together
+ * for i-cache and iTLB locality.  Requires -reopt_sample_ms and -shared_traces.
+ */
+OPTION_DEFAULT(bool, hot_trace_cache, false, "pack sampled hot traces in their own cache")
+#endif
 
 /* FIXME i#3522: re-enable SELFPROT_DATA_RARE on linux */
 OPTION_DEFAULT(
@@ -1163,6 +1198,8 @@ OPTION_DEFAULT_INTERNAL(uint, shared_trace_load,
 OPTION_DEFAULT_INTERNAL(uint, shared_future_load,
                         /* performance not critical, save some memory */
                         60, "load factor percent for shared future hashtable")
+OPTION_DEFAULT_INTERNAL(bool, shared_lookup_lockless, true,
+                        "look up shared bbs and traces without the table read lock")
 
 OPTION_DEFAULT(uint, shared_after_call_load,
                /* performance not critical */
@@ -1296,6 +1333,12 @@ OPTION_DEFAULT(uint_size, initial_global_heap_unit_size, 32 * 1024,
  */
 OPTION_DEFAULT_INTERNAL(uint_size, max_heap_unit_size, 256 * 1024,
                         "maximum heap unit size")
+/* Freed fixed-size global heap blocks are kept in per-CPU caches to avoid
+ * contention on the global heap lock.
+ */
+OPTION_DEFAULT_INTERNAL(uint, global_free_cache_max, 32,
+                        "max freed blocks of each size per per-CPU global heap cache "
+                        "(0 disables the caches)")
 /* heap_commit_increment may be adjusted by adjust_defaults_for_page_size(). */
 OPTION_DEFAULT(uint_size, heap_commit_increment, 4 * 1024, "heap commit increment")
 /* cache_commit_increment may be adjusted by adjust_defaults_for_page_size(). */
@@ -1632,6 +1675,12 @@ OPTION_DEFAULT(bool, reachable_client, IF_STATIC_LIBRARY_ELSE(false, true),
  */
 OPTION_DEFAULT(bool, satisfy_w_xor_x, false,
                "avoids ever allocating memory that is both writable and executable.")
+/* Only supported on Linux, where it uses transparent huge pages.  Raises
+ * -cache_commit_increment to the huge page size.
+ */
+OPTION_DEFAULT(bool, vm_huge_pages, false,
+               "align the vmcode and vmheap reservations to the huge page size and "
+               "ask the kernel to back them with huge pages, reducing iTLB misses.")
 /* FIXME: the lower 16 bits are ignored - so this here gives us
  * 12bits of randomness.  Could make it larger if we verify as
  * collision free the whole range [vm_base, * vm_base+vm_size+vm_max_offset)
@@ -3136,6 +3185,8 @@ OPTION_DEFAULT_INTERNAL(uint, vmarea_initial_size, 100, "initial vmarea vector s
 /* FIXME: case 4471 should start smaller and double instead */
 OPTION_DEFAULT_INTERNAL(uint, vmarea_increment_size, 100,
                         "incremental vmarea vector size")
+OPTION_DEFAULT_INTERNAL(bool, vmarea_lockless_reads, true,
+                        "read the executable areas optimistically without the lock")
 OPTION_INTERNAL(uint_addr, stress_fake_userva,
                 "pretend system address space starts at this address (case 9022)")
 
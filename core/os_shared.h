@@ -166,6 +166,11 @@ os_heap_decommit(void *p, size_t size, heap_error_code_t *error_code);
  * containing p is freed and size is ignored) */
 void
 os_heap_free(void *p, size_t size, heap_error_code_t *error_code);
+/* Asks the OS to back the reserved region [p, p+size) with huge pages where it
+ * can.  Returns false if the OS does not support the request.
+ */
+bool
+os_heap_advise_huge_pages(void *p, size_t size);
 
 /* prognosticate whether systemwide memory pressure based on
  * last_error_code and systemwide omens
@@ -367,6 +372,12 @@ get_application_end(void);
 int
 get_num_processors(void);
 
+/* Returns the processor and NUMA node the calling thread is currently running on.
+ * The answer may be stale as soon as it is returned.  Returns false if unknown.
+ */
+bool
+get_current_processor(OUT uint *cpu, OUT uint *node);
+
 /* Terminate types - the best choice here is TERMINATE_PROCESS, no cleanup*/
 typedef enum {
     TERMINATE_PROCESS = 0x1,
@@ -190,12 +190,20 @@ os_module_area_init(module_area_t *ma, app_pc base, size_t view_size, bool at_ma
 
     /* Fields for pcaches (PR 295534).  These entries are not present in
      * all libs: I see DT_CHECKSUM and the prelink field on FC12 but not
-     * on Ubuntu 9.04.
+     * on Ubuntu 9.04.  The GNU build id, which modern linkers emit by default,
+     * identifies the file contents far better than either, so we prefer it.
      */
-    if (ma->os_data.checksum == 0 &&
-        (DYNAMO_OPTION(coarse_enable_freeze) || DYNAMO_OPTION(use_persisted))) {
-        /* Use something so we have usable pcache names */
-        ma->os_data.checksum = d_r_crc32((const char *)ma->start, PAGE_SIZE);
+    if (DYNAMO_OPTION(coarse_enable_freeze) || DYNAMO_OPTION(use_persisted)) {
+#    ifdef LINUX
+        if (ma->os_data.build_id_len > 0) {
+            ma->os_data.checksum = d_r_crc32((const char *)ma->os_data.build_id,
+                                             (uint)ma->os_data.build_id_len);
+        }
+#    endif
+        if (ma->os_data.checksum == 0) {
+            /* Use something so we have usable pcache names */
+            ma->os_data.checksum = d_r_crc32((const char *)ma->start, PAGE_SIZE);
+        }
     }
     /* Timestamp we just leave as 0 */
 
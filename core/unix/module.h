@@ -51,6 +51,11 @@ typedef struct _module_segment_t {
     uint64 offset;
 } module_segment_t;
 
+#ifdef LINUX
+/* Long enough for the SHA1 (20 bytes) build ids which ld produces by default. */
+#    define MAX_BUILD_ID_LENGTH 32
+#endif
+
 typedef struct _os_module_data_t {
     /* To compute the base address, one determines the memory address associated with
      * the lowest p_vaddr value for a PT_LOAD segment. One then obtains the base
@@ -67,6 +72,11 @@ typedef struct _os_module_data_t {
     size_t timestamp;
 
 #ifdef LINUX
+    /* The contents of the NT_GNU_BUILD_ID note, if any, which we prefer to the
+     * above for identifying pcaches.  Longer ids are truncated.
+     */
+    byte build_id[MAX_BUILD_ID_LENGTH];
+    size_t build_id_len;
     /* i#112: Dynamic section info for exported symbol lookup.  Not
      * using elf types here to avoid having to export those.
      */
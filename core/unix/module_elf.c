@@ -331,11 +331,86 @@ module_fill_os_data(ELF_PROGRAM_HEADER_TYPE *prog_hdr, /* PT_DYNAMIC entry */
     return res;
 }
 
+#ifdef LINUX
+/* Copies the GNU build id from the PT_NOTE segment prog_hdr, if it has one, into
+ * build_id and returns its length (truncated to build_id_size), or returns 0.
+ */
+static size_t
+module_read_build_id(ELF_PROGRAM_HEADER_TYPE *prog_hdr, app_pc base, size_t view_size,
+                     bool at_map, ptr_int_t load_delta, OUT byte *build_id,
+                     size_t build_id_size)
+{
+    byte *note, *note_end;
+    size_t len = 0;
+    dcontext_t *dcontext = get_thread_private_dcontext();
+    ASSERT(prog_hdr->p_type == PT_NOTE);
+    if (at_map) {
+        /* Only the first segment is mapped in; notes are normally within it. */
+        if (prog_hdr->p_offset + prog_hdr->p_filesz > view_size)
+            return 0;
+        note = base + prog_hdr->p_offset;
+    } else
+        note = (app_pc)prog_hdr->p_vaddr + load_delta;
+    note_end = note + prog_hdr->p_filesz;
+    TRY_EXCEPT_ALLOW_NO_DCONTEXT(
+        dcontext,
+        {
+            while (note + sizeof(ELF_NOTE_HEADER_TYPE) <= note_end) {
+                ELF_NOTE_HEADER_TYPE *nhdr = (ELF_NOTE_HEADER_TYPE *)note;
+                byte *name = note + sizeof(*nhdr);
+                byte *desc = name + ALIGN_FORWARD(nhdr->n_namesz, 4);
+                byte *next = desc + ALIGN_FORWARD(nhdr->n_descsz, 4);
+                if (next > note_end || next <= note)
+                    break; /* malformed */
+                if (nhdr->n_type == NT_GNU_BUILD_ID && nhdr->n_namesz == 4 &&
+                    memcmp(name, "GNU", 4) == 0) {
+                    len = MIN(nhdr->n_descsz, build_id_size);
+                    memcpy(build_id, desc, len);
+                    break;
+                }
+                note = next;
+            }
+        },
+        { /* EXCEPT */
+          ASSERT_CURIOSITY(false && "crashed while walking notes");
+          len = 0;
+        });
+    return len;
+}
+
+/* Copies the GNU build id of the fully-loaded module at base into build_id and
+ * returns its length (truncated to build_id_size), or returns 0 if it has none.
+ */
+size_t
+module_get_build_id(app_pc base, OUT byte *build_id, size_t build_id_size)
+{
+    ELF_HEADER_TYPE *elf_hdr = (ELF_HEADER_TYPE *)base;
+    app_pc mod_base;
+    uint i;
+    if (!is_elf_so_header(base, 0))
+        return 0;
+    mod_base = module_vaddr_from_prog_header(base + elf_hdr->e_phoff, elf_hdr->e_phnum,
+                                             NULL, NULL);
+    for (i = 0; i < elf_hdr->e_phnum; i++) {
+        ELF_PROGRAM_HEADER_TYPE *prog_hdr =
+            (ELF_PROGRAM_HEADER_TYPE *)(base + elf_hdr->e_phoff +
+                                        i * elf_hdr->e_phentsize);
+        if (prog_hdr->p_type == PT_NOTE) {
+            size_t len = module_read_build_id(prog_hdr, base, 0, false /*!at_map*/,
+                                              base - mod_base, build_id, build_id_size);
+            if (len > 0)
+                return len;
+        }
+    }
+    return 0;
+}
+#endif
+
 /* Identifies the bounds of each segment in the ELF at base.
  * Returned addresses out_base and out_end are relative to the actual
  * loaded module base, so the "base" param should be added to produce
  * absolute addresses.
- * If out_data != NULL, fills in the dynamic section fields and adds
+ * If out_data != NULL, fills in the dynamic section fields and build id and adds
  * entries to the module list vector: so the caller must be
  * os_module_area_init() if out_data != NULL!
  * Optionally returns the first segment bounds, the max segment end, and the soname.
@@ -392,6 +467,14 @@ module_walk_program_headers(app_pc base, size_t view_size, bool at_map, bool dyn
                 }
                 found_load = true;
             }
+#ifdef LINUX
+            if (out_data != NULL && prog_hdr->p_type == PT_NOTE &&
+                out_data->build_id_len == 0) {
+                out_data->build_id_len = module_read_build_id(
+                    prog_hdr, base, view_size, at_map, load_delta, out_data->build_id,
+                    BUFFER_SIZE_BYTES(out_data->build_id));
+            }
+#endif
             if ((out_soname != NULL || out_data != NULL) &&
                 prog_hdr->p_type == PT_DYNAMIC) {
                 module_fill_os_data(prog_hdr, mod_base, max_end, base, view_size, at_map,
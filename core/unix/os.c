@@ -58,6 +58,9 @@
 #ifndef MAP_ANONYMOUS
 #    define MAP_ANONYMOUS MAP_ANON /* MAP_ANON on Mac */
 #endif
+#if defined(LINUX) && !defined(MADV_HUGEPAGE) /* in linux 2.6.38+ */
+#    define MADV_HUGEPAGE 14
+#endif
 /* for open */
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -3446,6 +3449,25 @@ os_heap_decommit(void *p, size_t size, heap_error_code_t *error_code)
     ASSERT(rc == 0);
 }
 
+bool
+os_heap_advise_huge_pages(void *p, size_t size)
+{
+#ifdef LINUX
+    long res;
+    ASSERT(ALIGNED(p, PAGE_SIZE) && ALIGNED(size, PAGE_SIZE));
+    /* This only marks the region: the kernel backs it with huge pages at fault
+     * time or via khugepaged once an aligned huge page's worth of it shares a
+     * single mapping, and silently falls back to base pages otherwise.
+     */
+    res = dynamorio_syscall(SYS_madvise, 3, p, size, MADV_HUGEPAGE);
+    LOG(GLOBAL, LOG_HEAP, 2, "os_heap_advise_huge_pages: %d bytes @ " PFX " => %d\n",
+        size, p, res);
+    return res == 0;
+#else
+    return false;
+#endif
+}
+
 bool
 os_heap_systemwide_overcommit(heap_error_code_t last_error_code)
 {
@@ -3928,6 +3950,24 @@ get_num_processors(void)
     return num_cpu;
 }
 
+bool
+get_current_processor(OUT uint *cpu, OUT uint *node)
+{
+#ifdef LINUX
+    uint cpu_local, node_local;
+    if (dynamorio_syscall(SYS_getcpu, 3, &cpu_local, &node_local, NULL) != 0)
+        return false;
+    if (cpu != NULL)
+        *cpu = cpu_local;
+    if (node != NULL)
+        *node = node_local;
+    return true;
+#else
+    /* XXX: there is no getcpu on Mac; callers fall back to thread ids. */
+    return false;
+#endif
+}
+
 /* i#46: To support -no_private_loader, we have to call the dlfcn family of
  * routines in libdl.so.  When we do early injection, there is no loader to
  * resolve these imports, so they will crash.  Early injection is incompatible
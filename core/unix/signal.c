@@ -1061,10 +1061,11 @@ signal_thread_inherit(dcontext_t *dcontext, void *clone_record)
             /* use SIGPROF for updating gui so it can be distinguished from SIGVTALRM */
             info->we_intercept[SIGPROF] = true;
 #endif
-            /* vtalarm only used with pc profiling.  it interferes w/ PAPI
-             * so arm this signal only if necessary
+            /* vtalarm only used with pc profiling and hot-trace sampling.  it
+             * interferes w/ PAPI so arm this signal only if necessary
              */
-            if (INTERNAL_OPTION(profile_pcs)) {
+            if (INTERNAL_OPTION(profile_pcs) IF_CLIENT_INTERFACE(
+                    || DYNAMO_OPTION(reopt_sample_ms) > 0)) {
                 info->we_intercept[SIGVTALRM] = true;
             }
 #ifdef CLIENT_INTERFACE
@@ -1091,6 +1092,12 @@ signal_thread_inherit(dcontext_t *dcontext, void *clone_record)
         pcprofile_thread_init(dcontext, info->shared_itimer,
                               (record == NULL) ? NULL : record->pcprofile_info);
     }
+#ifdef CLIENT_INTERFACE
+    if (DYNAMO_OPTION(reopt_sample_ms) > 0) {
+        set_itimer_callback(dcontext, ITIMER_VIRTUAL, DYNAMO_OPTION(reopt_sample_ms),
+                            monitor_reopt_alarm, NULL);
+    }
+#endif
 
     info->pre_syscall_app_sigprocmask_valid = false;
 
@@ -1194,6 +1201,13 @@ signal_fork_init(dcontext_t *dcontext)
     if (INTERNAL_OPTION(profile_pcs)) {
         pcprofile_fork_init(dcontext);
     }
+#ifdef CLIENT_INTERFACE
+    /* itimers are not inherited across fork */
+    if (DYNAMO_OPTION(reopt_sample_ms) > 0) {
+        set_itimer_callback(dcontext, ITIMER_VIRTUAL, DYNAMO_OPTION(reopt_sample_ms),
+                            monitor_reopt_alarm, NULL);
+    }
+#endif
 
     info->pre_syscall_app_sigprocmask_valid = false;
 
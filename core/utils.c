@@ -44,6 +44,7 @@
 #include "configure_defines.h"
 #include "utils.h"
 #include "module_shared.h"
+#include "monitor.h" /* for monitor_trace_threshold */
 #include <math.h>
 
 #ifdef PROCESS_CONTROL
@@ -1226,6 +1227,22 @@ d_r_read_lock(read_write_lock_t *rw)
     DEADLOCK_AVOIDANCE_LOCK(&rw->lock, true, LOCK_NOT_OWNABLE);
 }
 
+/* Starts and ends a write_epoch: see d_r_read_optimistic_begin(). */
+static inline void
+rwlock_write_epoch_begin(read_write_lock_t *rw)
+{
+    rw->write_epoch++;
+    /* the now-odd epoch must be visible before any of the writer's stores */
+    MEMORY_STORE_BARRIER();
+}
+
+static inline void
+rwlock_write_epoch_end(read_write_lock_t *rw)
+{
+    MEMORY_STORE_BARRIER();
+    rw->write_epoch++;
+}
+
 void
 d_r_write_lock(read_write_lock_t *rw)
 {
@@ -1242,6 +1259,7 @@ d_r_write_lock(read_write_lock_t *rw)
             os_thread_yield();
         }
         rw->writer = d_r_get_thread_id();
+        rwlock_write_epoch_begin(rw);
         return;
     }
 
@@ -1255,6 +1273,7 @@ d_r_write_lock(read_write_lock_t *rw)
         rwlock_wait_contended_writer(rw);
     }
     rw->writer = d_r_get_thread_id();
+    rwlock_write_epoch_begin(rw);
 }
 
 bool
@@ -1264,6 +1283,7 @@ d_r_write_trylock(read_write_lock_t *rw)
         ASSERT_NOT_TESTED();
         if (rw->num_readers == 0) {
             rw->writer = d_r_get_thread_id();
+            rwlock_write_epoch_begin(rw);
             return true;
         } else {
             /* We need to duplicate the bottom of d_r_write_unlock() */
@@ -1328,6 +1348,7 @@ d_r_write_unlock(read_write_lock_t *rw)
 #ifdef DEADLOCK_AVOIDANCE
     ASSERT(rw->writer == rw->lock.owner);
 #endif
+    rwlock_write_epoch_end(rw);
     rw->writer = INVALID_THREAD_ID;
     if (INTERNAL_OPTION(spin_yield_rwlock)) {
         d_r_mutex_unlock(&rw->lock);
@@ -1349,6 +1370,31 @@ d_r_write_unlock(read_write_lock_t *rw)
     }
 }
 
+/* Optimistic lockless reads, for data that is only modified under the write lock
+ * and whose memory stays mapped while it is read: the caller passes the returned
+ * epoch to d_r_read_optimistic_validate() once it has copied out what it needs,
+ * and must discard the copy and read again under the lock on failure.  Nothing
+ * read beforehand may be trusted, in particular to index into other data,
+ * without validating.
+ */
+uint
+d_r_read_optimistic_begin(read_write_lock_t *rw)
+{
+    uint epoch;
+    ATOMIC_4BYTE_ALIGNED_READ(&rw->write_epoch, &epoch);
+    return epoch;
+}
+
+bool
+d_r_read_optimistic_validate(read_write_lock_t *rw, uint epoch)
+{
+    uint now;
+    /* the caller's loads of the protected data must complete first */
+    MEMORY_LOAD_BARRIER();
+    ATOMIC_4BYTE_ALIGNED_READ(&rw->write_epoch, &now);
+    return (epoch & 1) == 0 && now == epoch;
+}
+
 bool
 self_owns_write_lock(read_write_lock_t *rw)
 {
@@ -4618,5 +4664,11 @@ stats_get_snapshot(dr_stats_t *drstats)
         drstats->peak_vmm_blocks_special_heap = GLOBAL_STAT(peak_vmm_blocks_special_heap);
         drstats->peak_vmm_blocks_special_mmap = GLOBAL_STAT(peak_vmm_blocks_special_mmap);
     }
+    if (drstats->size > offsetof(dr_stats_t, trace_threshold)) {
+        /* These fields were added all at once. */
+        drstats->trace_threshold = monitor_trace_threshold();
+        drstats->trace_threshold_raises = GLOBAL_STAT(trace_threshold_raises);
+        drstats->trace_threshold_lowers = GLOBAL_STAT(trace_threshold_lowers);
+    }
     return true;
 }
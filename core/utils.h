@@ -343,6 +343,10 @@ typedef struct _read_write_lock_t {
     volatile int num_pending_readers; /* readers that have contended with a writer */
     contention_event_t writer_waiting_readers; /* event object for writer to wait on */
     contention_event_t readers_waiting_writer; /* event object for readers to wait on */
+    /* Incremented on each write lock and unlock, so odd while a writer holds the
+     * lock: allows optimistic readers via d_r_read_optimistic_{begin,validate}.
+     */
+    volatile uint write_epoch;
     /* make sure to update the two INIT_READWRITE_LOCK cases if you add new fields  */
 } read_write_lock_t;
 
@@ -714,13 +718,14 @@ thread_owns_first_or_both_locks_only(dcontext_t *dcontext, mutex_t *lock1,
             INVALID_THREAD_ID, 0                                      \
     }
 
-#define INIT_READWRITE_LOCK(lock)                                                     \
-    STRUCTURE_TYPE(read_write_lock_t)                                                 \
-    {                                                                                 \
-        INIT_LOCK_NO_TYPE(#lock "(readwrite)"                                         \
-                                "@" __FILE__ ":" STRINGIFY(__LINE__),                 \
-                          LOCK_RANK(lock)),                                           \
-            0, INVALID_THREAD_ID, 0, KSYNCH_TYPE_STATIC_INIT, KSYNCH_TYPE_STATIC_INIT \
+#define INIT_READWRITE_LOCK(lock)                                                      \
+    STRUCTURE_TYPE(read_write_lock_t)                                                  \
+    {                                                                                  \
+        INIT_LOCK_NO_TYPE(#lock "(readwrite)"                                          \
+                                "@" __FILE__ ":" STRINGIFY(__LINE__),                  \
+                          LOCK_RANK(lock)),                                            \
+            0, INVALID_THREAD_ID, 0, KSYNCH_TYPE_STATIC_INIT, KSYNCH_TYPE_STATIC_INIT, \
+            0                                                                          \
     }
 
 #define ASSIGN_INIT_READWRITE_LOCK_FREE(var, lock)                                \
@@ -733,7 +738,8 @@ thread_owns_first_or_both_locks_only(dcontext_t *dcontext, mutex_t *lock1,
             INVALID_THREAD_ID,                                                    \
             0,                                                                    \
             KSYNCH_TYPE_STATIC_INIT,                                              \
-            KSYNCH_TYPE_STATIC_INIT                                               \
+            KSYNCH_TYPE_STATIC_INIT,                                              \
+            0                                                                     \
         };                                                                        \
         var = initializer_##lock;                                                 \
     } while (0)
@@ -853,6 +859,10 @@ void
 d_r_write_unlock(read_write_lock_t *rw);
 bool
 self_owns_write_lock(read_write_lock_t *rw);
+uint
+d_r_read_optimistic_begin(read_write_lock_t *rw);
+bool
+d_r_read_optimistic_validate(read_write_lock_t *rw, uint epoch);
 
 /* test whether locks are held at all */
 #define WRITE_LOCK_HELD(rw) (mutex_testlock(&(rw)->lock) && ((rw)->num_readers == 0))
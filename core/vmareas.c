@@ -839,6 +839,13 @@ writelock_if_not_already(vm_area_vector_t *v)
     return false;
 }
 
+/* An old buffer of a VECTOR_LOCKLESS_READS vector */
+typedef struct vmvector_retired_t {
+    vm_area_t *buf;
+    int size;
+    struct vmvector_retired_t *next;
+} vmvector_retired_t;
+
 static void
 vm_area_vector_check_size(vm_area_vector_t *v)
 {
@@ -850,6 +857,24 @@ vm_area_vector_check_size(vm_area_vector_t *v)
             v->size = INTERNAL_OPTION(vmarea_initial_size);
             v->buf = (vm_area_t *)global_heap_alloc(
                 v->size * sizeof(struct vm_area_t) HEAPACCT(ACCT_VMAREAS));
+        } else if (TEST(VECTOR_LOCKLESS_READS, v->flags)) {
+            /* Lockless readers may be in the old buffer, so we cannot realloc
+             * (which can unmap it).  We double so that the retired buffers never
+             * add up to more than the live one.
+             */
+            int new_size = 2 * v->size;
+            vm_area_t *new_buf = (vm_area_t *)global_heap_alloc(
+                new_size * sizeof(struct vm_area_t) HEAPACCT(ACCT_VMAREAS));
+            vmvector_retired_t *old = (vmvector_retired_t *)global_heap_alloc(
+                sizeof(*old) HEAPACCT(ACCT_VMAREAS));
+            STATS_INC(num_vmareas_resized);
+            memcpy(new_buf, v->buf, v->length * sizeof(struct vm_area_t));
+            old->buf = v->buf;
+            old->size = v->size;
+            old->next = v->retired;
+            v->retired = old;
+            v->buf = new_buf;
+            v->size = new_size;
         } else {
             /* FIXME: case 4471 we should be doubling size here */
             int new_size = (INTERNAL_OPTION(vmarea_increment_size) + v->length);
@@ -1550,6 +1575,46 @@ binary_search(vm_area_vector_t *v, app_pc start, app_pc end, vm_area_t **area /*
     return false;
 }
 
+/* Lockless counterpart of binary_search() for VECTOR_LOCKLESS_READS vectors.
+ * Returns false if the vector changed under us (or may not be read this way),
+ * in which case the caller must search again under the lock.  Otherwise sets
+ * *found and, if found and area_copy != NULL, copies the area into it.
+ */
+static bool
+binary_search_lockless(vm_area_vector_t *v, app_pc start, app_pc end,
+                       bool *found /*OUT*/, vm_area_t *area_copy /*OUT*/)
+{
+    vm_area_t *buf;
+    int min = 0;
+    int max;
+    uint epoch;
+    if (!TEST(VECTOR_LOCKLESS_READS, v->flags) || self_owns_write_lock(&v->lock))
+        return false;
+    epoch = d_r_read_optimistic_begin(&v->lock);
+    buf = v->buf;
+    max = v->length - 1;
+    /* buf and length must match before we index with them */
+    if (!d_r_read_optimistic_validate(&v->lock, epoch))
+        return false;
+    while (max >= min) {
+        int i = (min + max) / 2;
+        app_pc area_start = buf[i].start;
+        app_pc area_end = buf[i].end;
+        if (end != NULL && end <= area_start)
+            max = i - 1;
+        else if (start >= area_end || start == end)
+            min = i + 1;
+        else {
+            if (area_copy != NULL)
+                *area_copy = buf[i];
+            *found = true;
+            return d_r_read_optimistic_validate(&v->lock, epoch);
+        }
+    }
+    *found = false;
+    return d_r_read_optimistic_validate(&v->lock, epoch);
+}
+
 /* lookup an addr in the current area
  * RETURN true if address area is found, false otherwise
  * if area is non NULL it is set to the area found
@@ -1616,7 +1681,11 @@ vm_areas_init()
      * We're already paying the indirection cost by passing their addresses
      * to generic routines, after all.
      */
-    VMVECTOR_ALLOC_VECTOR(executable_areas, GLOBAL_DCONTEXT, VECTOR_SHARED,
+    VMVECTOR_ALLOC_VECTOR(executable_areas, GLOBAL_DCONTEXT,
+                          VECTOR_SHARED |
+                              (INTERNAL_OPTION(vmarea_lockless_reads)
+                                   ? VECTOR_LOCKLESS_READS
+                                   : 0),
                           executable_areas);
     VMVECTOR_ALLOC_VECTOR(pretend_writable_areas, GLOBAL_DCONTEXT, VECTOR_SHARED,
                           pretend_writable_areas);
@@ -1992,6 +2061,8 @@ vmvector_overlap(vm_area_vector_t *v, app_pc start, app_pc end)
     bool release_lock; /* 'true' means this routine needs to unlock */
     if (vmvector_empty(v))
         return false;
+    if (binary_search_lockless(v, start, end, &overlap, NULL))
+        return overlap;
     LOCK_VECTOR(v, release_lock, read);
     ASSERT_OWN_READWRITE_LOCK(SHOULD_LOCK_VECTOR(v), &v->lock);
     overlap = vm_area_overlap(v, start, end);
@@ -2021,8 +2092,20 @@ vmvector_lookup_data(vm_area_vector_t *v, app_pc pc, app_pc *start /* OUT */,
 {
     bool overlap;
     vm_area_t *area = NULL;
+    vm_area_t area_copy;
     bool release_lock; /* 'true' means this routine needs to unlock */
 
+    if (binary_search_lockless(v, pc, pc + 1, &overlap, &area_copy)) {
+        if (overlap) {
+            if (start != NULL)
+                *start = area_copy.start;
+            if (end != NULL)
+                *end = area_copy.end;
+            if (data != NULL)
+                *data = area_copy.custom.client;
+        }
+        return overlap;
+    }
     LOCK_VECTOR(v, release_lock, read);
     ASSERT_OWN_READWRITE_LOCK(SHOULD_LOCK_VECTOR(v), &v->lock);
     overlap = lookup_addr(v, pc, &area);
@@ -2169,6 +2252,14 @@ vmvector_reset_vector(dcontext_t *dcontext, vm_area_vector_t *v)
         v->buf = NULL;
     } else
         ASSERT(v->size == 0 && v->length == 0);
+    /* all threads are synched (or gone) by now so no one is reading these */
+    while (v->retired != NULL) {
+        vmvector_retired_t *old = v->retired;
+        v->retired = old->next;
+        global_heap_free(old->buf,
+                         old->size * sizeof(struct vm_area_t) HEAPACCT(ACCT_VMAREAS));
+        global_heap_free(old, sizeof(*old) HEAPACCT(ACCT_VMAREAS));
+    }
 }
 
 static void
@@ -2989,6 +3080,8 @@ bool
 is_executable_address(app_pc addr)
 {
     bool found;
+    if (binary_search_lockless(executable_areas, addr, addr + 1, &found, NULL))
+        return found;
     d_r_read_lock(&executable_areas->lock);
     found = lookup_addr(executable_areas, addr, NULL);
     d_r_read_unlock(&executable_areas->lock);
@@ -3004,6 +3097,12 @@ get_executable_area_vm_flags(app_pc addr, uint *vm_flags)
 {
     bool found = false;
     vm_area_t *area;
+    vm_area_t area_copy;
+    if (binary_search_lockless(executable_areas, addr, addr + 1, &found, &area_copy)) {
+        if (found)
+            *vm_flags = area_copy.vm_flags;
+        return found;
+    }
     d_r_read_lock(&executable_areas->lock);
     if (lookup_addr(executable_areas, addr, &area)) {
         *vm_flags = area->vm_flags;
@@ -3024,6 +3123,12 @@ get_executable_area_flags(app_pc addr, uint *frag_flags)
 {
     bool found = false;
     vm_area_t *area;
+    vm_area_t area_copy;
+    if (binary_search_lockless(executable_areas, addr, addr + 1, &found, &area_copy)) {
+        if (found)
+            *frag_flags = area_copy.frag_flags;
+        return found;
+    }
     d_r_read_lock(&executable_areas->lock);
     if (lookup_addr(executable_areas, addr, &area)) {
         *frag_flags = area->frag_flags;
@@ -3492,7 +3597,7 @@ was_executable_area_writable(app_pc addr)
 bool
 is_executable_area_selfmod(app_pc addr)
 {
-    uint flags;
+    uint flags = 0;
     if (get_executable_area_flags(addr, &flags))
         return TEST(FRAG_SELFMOD_SANDBOXED, flags);
     else
@@ -3935,7 +4040,7 @@ is_address_on_stack(dcontext_t *dcontext, app_pc address)
 bool
 is_driver_address(app_pc addr)
 {
-    uint vm_flags;
+    uint vm_flags = 0;
     if (get_executable_area_vm_flags(addr, &vm_flags)) {
         return TEST(VM_DRIVER_ADDRESS, vm_flags);
     }
@@ -6348,7 +6453,7 @@ tamper_resistant_region_overlap(app_pc start, app_pc end)
 bool
 is_jit_managed_area(app_pc addr)
 {
-    uint vm_flags;
+    uint vm_flags = 0;
     if (get_executable_area_vm_flags(addr, &vm_flags))
         return TEST(VM_JIT_MANAGED, vm_flags);
     else
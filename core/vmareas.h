@@ -67,6 +67,11 @@ enum {
      * flag to avoid the redundant vector-level lock
      */
     VECTOR_NO_LOCK = 0x0010,
+    /* Lookups may read the vector without its lock, validating against the lock's
+     * write_epoch instead.  Growth then doubles the buffer and retires, rather than
+     * frees, the old one, since readers may still be in it.
+     */
+    VECTOR_LOCKLESS_READS = 0x0020,
 };
 
 #define VECTOR_NEVER_MERGE (VECTOR_NEVER_MERGE_ADJACENT | VECTOR_NEVER_OVERLAP)
@@ -111,6 +116,8 @@ struct vm_area_vector_t {
      * If non-NULL, the free_payload_func will NOT be called.
      */
     void *(*merge_payload_func)(void *dst, void *src);
+    /* Buffers replaced on growth of a VECTOR_LOCKLESS_READS vector, freed on reset */
+    struct vmvector_retired_t *retired;
 }; /* typedef-ed in globals.h */
 
 /* vm_area_vectors should NOT be declared statically if their locks need to be
@@ -4972,6 +4972,15 @@ os_heap_decommit(void *p, size_t size, heap_error_code_t *error_code)
     ASSERT(NT_SUCCESS(*error_code));
 }
 
+bool
+os_heap_advise_huge_pages(void *p, size_t size)
+{
+    /* Large pages on Windows require SeLockMemoryPrivilege and must be committed
+     * up front, which does not fit our reserve-then-commit model.
+     */
+    return false;
+}
+
 bool
 os_heap_systemwide_overcommit(heap_error_code_t last_error_code)
 {
@@ -5268,6 +5277,15 @@ get_num_processors()
     return num_cpu;
 }
 
+bool
+get_current_processor(OUT uint *cpu, OUT uint *node)
+{
+    /* XXX: we could use NtGetCurrentProcessorNumber here; for now callers
+     * fall back to thread ids.
+     */
+    return false;
+}
+
 /* Static to save stack space, is initialized at first call to debugbox or
  * at os_init (whichever is earlier), we are guaranteed to be single threaded
  * at os_init so no race conditions even though there shouldn't be any anyways
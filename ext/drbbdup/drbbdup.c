@@ -89,10 +89,17 @@ typedef enum {
 
 /* Contains information of a case that maps to a copy of a bb. */
 typedef struct {
-    uintptr_t encoding; /* The encoding specific to the case. */
-    bool is_defined;    /* Denotes whether the case is defined. */
+    uintptr_t encoding;   /* The encoding specific to the case. */
+    bool is_defined;      /* Denotes whether the case is defined. */
+    uintptr_t *exec_count; /* Points into count_table if profiling is enabled. */
 } drbbdup_case_t;
 
+/* The approximate execution count of the case occupying a slot of a bb. */
+typedef struct {
+    uintptr_t encoding; /* The encoding of the case last bound to the slot. */
+    uintptr_t count;
+} drbbdup_case_count_t;
+
 /* Contains per bb information required for managing bb copies. */
 typedef struct {
     bool enable_dup;              /* Denotes whether to duplicate blocks. */
@@ -102,6 +109,10 @@ typedef struct {
     bool is_gen; /* Denotes whether a new bb copy is dynamically being generated. */
     drbbdup_case_t default_case;
     drbbdup_case_t *cases; /* Is NULL if enable_dup is not set. */
+    /* Slot 0 is for the default case and slot i + 1 for cases[i]. Is NULL if
+     * profiling is disabled.
+     */
+    drbbdup_case_count_t *counts;
 } drbbdup_manager_t;
 
 /* Label types. */
@@ -115,6 +126,8 @@ typedef struct {
     void *orig_analysis_data;        /* Analysis data accessible for all cases. */
     void *default_analysis_data;     /* Analysis data specific to default case. */
     void **case_analysis_data;       /* Analysis data specific to cases. */
+    int *case_order;    /* Order in which cases are dispatched for the current bb. */
+    int case_order_pos; /* Position in case_order of the next bb copy to consider. */
     uint16_t hit_counts[TABLE_SIZE]; /* Keeps track of hit-counts of unhandled cases. */
     instr_t *first_instr;          /* The first instr of the bb copy being considered. */
     instr_t *first_nonlabel_instr; /* The first non label instr of the bb copy. */
@@ -123,6 +136,11 @@ typedef struct {
 
 static uint ref_count = 0;        /* Instance count of drbbdup. */
 static hashtable_t manager_table; /* Maps bbs with book-keeping data. */
+/* Maps bbs with the execution counts of their cases. Unlike managers, which are
+ * freed whenever a bb is rebuilt, the counts are only freed by drbbdup_exit() as
+ * code built from an older manager may still be running and incrementing them.
+ */
+static hashtable_t count_table;
 static drbbdup_options_t opts;
 static void *rw_lock = NULL;
 
@@ -237,12 +255,62 @@ drbbdup_add_copy(void *drcontext, instrlist_t *bb, instrlist_t *orig_bb)
     }
 }
 
+/* Returns the execution counts of the cases of the bb at pc, creating them if
+ * necessary. Must be called with rw_lock held for writing.
+ */
+static drbbdup_case_count_t *
+drbbdup_get_case_counts(app_pc pc)
+{
+    drbbdup_case_count_t *counts =
+        (drbbdup_case_count_t *)hashtable_lookup(&count_table, pc);
+    if (counts == NULL) {
+        size_t size = sizeof(drbbdup_case_count_t) * (opts.non_default_case_limit + 1);
+        counts = dr_global_alloc(size);
+        memset(counts, 0, size);
+        hashtable_add(&count_table, pc, counts);
+    }
+    return counts;
+}
+
+static void
+drbbdup_destroy_case_counts(void *counts)
+{
+    dr_global_free(counts,
+                   sizeof(drbbdup_case_count_t) * (opts.non_default_case_limit + 1));
+}
+
+/* Points the case's execution count to the given slot. The count is kept if the
+ * slot was last bound to the same encoding, such that counts survive rebuilds of
+ * the bb.
+ */
+static void
+drbbdup_bind_case_count(drbbdup_manager_t *manager, drbbdup_case_t *drbbdup_case,
+                        int slot)
+{
+    if (manager->counts == NULL)
+        return;
+    drbbdup_case_count_t *case_count = &manager->counts[slot];
+    if (case_count->encoding != drbbdup_case->encoding) {
+        case_count->encoding = drbbdup_case->encoding;
+        case_count->count = 0;
+    }
+    drbbdup_case->exec_count = &case_count->count;
+}
+
+static uintptr_t
+drbbdup_get_case_exec_count(drbbdup_case_t *drbbdup_case)
+{
+    return drbbdup_case->exec_count == NULL ? 0 : *drbbdup_case->exec_count;
+}
+
 /* Creates a manager, which contains book-keeping data for a fragment. */
 static drbbdup_manager_t *
-drbbdup_create_manager(void *drcontext, void *tag, instrlist_t *bb)
+drbbdup_create_manager(void *drcontext, void *tag, app_pc pc, instrlist_t *bb)
 {
     drbbdup_manager_t *manager = dr_global_alloc(sizeof(drbbdup_manager_t));
     memset(manager, 0, sizeof(drbbdup_manager_t));
+    if (opts.is_case_profiling_enabled)
+        manager->counts = drbbdup_get_case_counts(pc);
 
     manager->cases = NULL;
     ASSERT(opts.non_default_case_limit > 0, "dup limit should be greater than zero");
@@ -262,10 +330,6 @@ drbbdup_create_manager(void *drcontext, void *tag, instrlist_t *bb)
         !drbbdup_encoding_already_included(manager, manager->default_case.encoding,
                                            false /* don't check default case */),
         "default case encoding cannot be already registered");
-    /* XXX i#3778: To remove once we support specific fragment deletion. */
-    DR_ASSERT_MSG(!manager->enable_dynamic_handling,
-                  "dynamic case generation is not yet supported");
-
     /* Check whether user wants copies for this particular bb. */
     if (!manager->enable_dup && manager->cases != NULL) {
         /* Multiple cases not wanted. Destroy cases. */
@@ -275,6 +339,7 @@ drbbdup_create_manager(void *drcontext, void *tag, instrlist_t *bb)
     }
 
     manager->default_case.is_defined = true;
+    drbbdup_bind_case_count(manager, &manager->default_case, 0);
     return manager;
 }
 
@@ -391,17 +456,24 @@ drbbdup_duplicate_phase(void *drcontext, void *tag, instrlist_t *bb, bool for_tr
     drbbdup_manager_t *manager =
         (drbbdup_manager_t *)hashtable_lookup(&manager_table, pc);
 
-    if (!for_trace && manager != NULL && !manager->is_gen) {
-        /* Remove existing invalid book-keeping data. */
-        hashtable_remove(&manager_table, pc);
-        manager = NULL;
+    if (!for_trace && manager != NULL) {
+        if (!manager->is_gen) {
+            /* Remove existing invalid book-keeping data. */
+            hashtable_remove(&manager_table, pc);
+            manager = NULL;
+        } else {
+            /* This rebuild is the one requested by drbbdup_handle_new_case(). Any
+             * later rebuild is for another reason and starts from scratch.
+             */
+            manager->is_gen = false;
+        }
     }
 
     /* A manager is created if there does not already exist one that "book-keeps"
      * this basic block.
      */
     if (manager == NULL) {
-        manager = drbbdup_create_manager(drcontext, tag, bb);
+        manager = drbbdup_create_manager(drcontext, tag, pc, bb);
         ASSERT(manager != NULL, "created manager cannot be NULL");
         hashtable_add(&manager_table, pc, manager);
         if (opts.is_stat_enabled) {
@@ -771,6 +843,23 @@ drbbdup_insert_compare_encoding(void *drcontext, instrlist_t *bb, instr_t *where
 }
 #endif
 
+/* Inserts code that increments the execution count of a case. The increment is not
+ * atomic as the count only guides the ordering of cases. Arithmetic flags are
+ * already saved by the dispatcher at this point.
+ */
+static void
+drbbdup_insert_case_count(void *drcontext, instrlist_t *bb, instr_t *where,
+                          drbbdup_case_t *current_case)
+{
+    if (!opts.is_case_profiling_enabled)
+        return;
+
+    ASSERT(current_case->exec_count != NULL, "count cannot be NULL");
+    opnd_t count_opnd = opnd_create_abs_addr(current_case->exec_count, OPSZ_PTR);
+    instr_t *instr = INSTR_CREATE_add(drcontext, count_opnd, OPND_CREATE_INT8(1));
+    instrlist_meta_preinsert(bb, where, instr);
+}
+
 /* At the start of a bb copy, dispatcher code is inserted. The runtime encoding
  * is compared with the encoding of the defined case, and if they match control
  * falls-through to execute the bb. Otherwise, control  branches to the next bb
@@ -791,6 +880,8 @@ drbbdup_insert_dispatch(void *drcontext, instrlist_t *bb, instr_t *where,
     instr_t *instr = INSTR_CREATE_jcc(drcontext, OP_jnz, opnd_create_instr(next_label));
     instrlist_meta_preinsert(bb, where, instr);
 
+    drbbdup_insert_case_count(drcontext, bb, where, current_case);
+
     /* If fall-through, restore regs back to their original values. */
     drbbdup_insert_landing_restoration(drcontext, bb, where, manager);
 }
@@ -883,7 +974,7 @@ drbbdup_insert_dynamic_handling(void *drcontext, app_pc translation_pc, void *ta
              * call.
              */
             instrlist_insert_mov_immed_ptrsz(drcontext, (intptr_t)tag, drbbdup_opnd, bb,
-                                             instr, NULL, NULL);
+                                             where, NULL, NULL);
 
             /* Jump to outlined clean call code for new case registration. */
             instr = XINST_CREATE_jump(drcontext, opnd_create_pc(new_case_cache_pc));
@@ -918,6 +1009,7 @@ drbbdup_insert_dispatch_end(void *drcontext, app_pc translation_pc, void *tag,
     }
 
     /* Last bb version is always the default case. */
+    drbbdup_insert_case_count(drcontext, bb, where, &manager->default_case);
     drbbdup_insert_landing_restoration(drcontext, bb, where, manager);
 }
 
@@ -952,6 +1044,32 @@ drbbdup_instrument_instr(void *drcontext, void *tag, instrlist_t *bb, instr_t *i
                           opts.user_data, pt->orig_analysis_data, analysis_data);
 }
 
+/* Determines the order in which the dispatcher compares the runtime encoding against
+ * defined cases. Cases are sorted in descending order of their execution counts,
+ * which are all zero unless profiling is enabled, thus keeping the order of
+ * registration by default. An insertion sort suffices as the case limit is small.
+ * The counts may be concurrently updated by other threads, but any resulting
+ * permutation is valid.
+ */
+static void
+drbbdup_set_case_order(drbbdup_per_thread *pt, drbbdup_manager_t *manager)
+{
+    int num_ordered = 0;
+    int i, j;
+    for (i = 0; i < opts.non_default_case_limit; i++) {
+        if (!manager->cases[i].is_defined)
+            continue;
+        uintptr_t count = drbbdup_get_case_exec_count(&manager->cases[i]);
+        for (j = num_ordered; j > 0 &&
+             drbbdup_get_case_exec_count(&manager->cases[pt->case_order[j - 1]]) < count;
+             j--)
+            pt->case_order[j] = pt->case_order[j - 1];
+        pt->case_order[j] = i;
+        num_ordered++;
+    }
+    pt->case_order_pos = 0;
+}
+
 /* Support different instrumentation for different bb copies. Tracks which case is
  * currently being considered via an index (namely pt->case_index) in thread-local
  * storage, and update this index upon encountering the start/end of bb copies.
@@ -971,6 +1089,7 @@ drbbdup_instrument_dups(void *drcontext, app_pc pc, void *tag, instrlist_t *bb,
     /* Insert runtime case encoding at start. */
     if (drmgr_is_first_instr(drcontext, instr)) {
         ASSERT(pt->case_index == -1, "case index should start at -1");
+        drbbdup_set_case_order(pt, manager);
         drbbdup_encode_runtime_case(drcontext, pt, tag, bb, instr, manager);
     }
 
@@ -1008,28 +1127,16 @@ drbbdup_instrument_dups(void *drcontext, app_pc pc, void *tag, instrlist_t *bb,
             drbbdup_insert_dispatch_end(drcontext, pc, tag, bb, next_instr, manager);
         } else {
             /* We have reached the start of a new bb version (not the last one). */
-            bool found = false;
-            int i;
-            for (i = pt->case_index + 1; i < opts.non_default_case_limit; i++) {
-                drbbdup_case = &manager->cases[i];
-                if (drbbdup_case->is_defined) {
-                    found = true;
-                    break;
-                }
-            }
-            ASSERT(found, "mismatch between bb copy count and case count detected");
+            ASSERT(pt->case_order_pos < (int)drbbdup_count(manager),
+                   "mismatch between bb copy count and case count detected");
+            /* Move on to the next case in dispatch order. */
+            pt->case_index = pt->case_order[pt->case_order_pos++];
+            drbbdup_case = &manager->cases[pt->case_index];
             ASSERT(drbbdup_case->is_defined, "the found case cannot be undefined");
-            ASSERT(pt->case_index + 1 == i,
-                   "the next case considered should be the next increment");
-            pt->case_index = i; /* Move on to the next case. */
             drbbdup_insert_dispatch(drcontext, bb,
                                     next_instr /* insert after START label. */, manager,
                                     next_bb_label, drbbdup_case);
         }
-
-        /* XXX i#4134: statistics -- insert code that tracks the number of times the
-         * current case (pt->case_index) is executed.
-         */
     } else if (drbbdup_is_at_end(instr)) {
         /* Handle last special instruction (if present). */
         if (is_last_special) {
@@ -1173,6 +1280,7 @@ drbbdup_include_encoding(drbbdup_manager_t *manager, uintptr_t new_encoding)
             if (!dup_case->is_defined) {
                 dup_case->is_defined = true;
                 dup_case->encoding = new_encoding;
+                drbbdup_bind_case_count(manager, dup_case, i + 1);
                 return true;
             }
         }
@@ -1181,6 +1289,21 @@ drbbdup_include_encoding(drbbdup_manager_t *manager, uintptr_t new_encoding)
     return false;
 }
 
+/* Returns whether a free case slot remains for drbbdup_include_encoding(). */
+static bool
+drbbdup_include_encoding_possible(drbbdup_manager_t *manager)
+{
+    if (manager->enable_dup) {
+        int i;
+        for (i = 0; i < opts.non_default_case_limit; i++) {
+            if (!manager->cases[i].is_defined)
+                return true;
+        }
+    }
+
+    return false;
+}
+
 /****************************************************************************
  * Dynamic case handling via flushing.
  */
@@ -1248,8 +1371,12 @@ drbbdup_handle_new_case()
                     opts.allow_gen(drcontext, tag, ilist, new_encoding,
                                    &manager->enable_dynamic_handling, opts.user_data);
             }
-            if (do_gen)
-                drbbdup_include_encoding(manager, new_encoding);
+            /* Stop dynamic handling once all case slots are taken, as no further
+             * case can be generated for this bb.
+             */
+            do_gen = do_gen && drbbdup_include_encoding(manager, new_encoding);
+            if (!drbbdup_include_encoding_possible(manager))
+                manager->enable_dynamic_handling = false;
 
             /* Flush only if a new case needs to be generated or
              * dynamic handling has been disabled.
@@ -1292,11 +1419,11 @@ drbbdup_handle_new_case()
             "pc %p to generate a copy to handle the new case.\n",
             __FUNCTION__, pc);
 
-        /* No locks held upon fragment deletion. */
-        /* XXX i#3778: To include once we support specific fragment deletion. */
-#if 0
-        dr_delete_shared_fragment(tag);
-#endif
+        /* No locks held upon flushing. The flush removes the fragment (and any trace
+         * containing it) such that the bb is rebuilt with a copy for the new case.
+         * The manager is retained upon rebuilding as is_gen is set.
+         */
+        dr_flush_region(pc, 1);
     }
 
     dr_redirect_execution(&mcontext);
@@ -1421,6 +1548,38 @@ drbbdup_get_stats(OUT drbbdup_stats_t *stats_in)
     return DRBBDUP_SUCCESS;
 }
 
+drbbdup_status_t
+drbbdup_get_case_execution_count(app_pc bb_pc, uintptr_t encoding, OUT uint64 *count)
+{
+    if (!opts.is_case_profiling_enabled)
+        return DRBBDUP_ERROR_UNSET_FEATURE;
+    if (count == NULL)
+        return DRBBDUP_ERROR_INVALID_PARAMETER;
+
+    drbbdup_status_t res = DRBBDUP_ERROR_INVALID_PARAMETER;
+    dr_rwlock_read_lock(rw_lock);
+    drbbdup_manager_t *manager =
+        (drbbdup_manager_t *)hashtable_lookup(&manager_table, bb_pc);
+    if (manager != NULL) {
+        if (manager->default_case.encoding == encoding) {
+            *count = *manager->default_case.exec_count;
+            res = DRBBDUP_SUCCESS;
+        } else if (manager->enable_dup) {
+            int i;
+            for (i = 0; i < opts.non_default_case_limit; i++) {
+                drbbdup_case_t *drbbdup_case = &manager->cases[i];
+                if (drbbdup_case->is_defined && drbbdup_case->encoding == encoding) {
+                    *count = *drbbdup_case->exec_count;
+                    res = DRBBDUP_SUCCESS;
+                    break;
+                }
+            }
+        }
+    }
+    dr_rwlock_read_unlock(rw_lock);
+    return res;
+}
+
 /****************************************************************************
  * THREAD INIT AND EXIT
  */
@@ -1451,6 +1610,9 @@ drbbdup_thread_init(void *drcontext)
     pt->case_analysis_data =
         dr_thread_alloc(drcontext, sizeof(void *) * opts.non_default_case_limit);
     memset(pt->case_analysis_data, 0, sizeof(void *) * opts.non_default_case_limit);
+    pt->case_order =
+        dr_thread_alloc(drcontext, sizeof(int) * opts.non_default_case_limit);
+    pt->case_order_pos = 0;
 
     /* Init hit table. */
     for (int i = 0; i < TABLE_SIZE; i++)
@@ -1470,6 +1632,7 @@ drbbdup_thread_exit(void *drcontext)
 
     dr_thread_free(drcontext, pt->case_analysis_data,
                    sizeof(void *) * opts.non_default_case_limit);
+    dr_thread_free(drcontext, pt->case_order, sizeof(int) * opts.non_default_case_limit);
     dr_thread_free(drcontext, pt, sizeof(drbbdup_per_thread));
 }
 
@@ -1480,7 +1643,9 @@ drbbdup_thread_exit(void *drcontext)
 static bool
 drbbdup_check_options(drbbdup_options_t *ops_in)
 {
-    if (ops_in != NULL && ops_in->set_up_bb_dups != NULL && ops_in->instrument_instr &&
+    if (ops_in != NULL && ops_in->struct_size > 0 &&
+        ops_in->struct_size <= sizeof(drbbdup_options_t) &&
+        ops_in->set_up_bb_dups != NULL && ops_in->instrument_instr &&
         ops_in->non_default_case_limit > 0)
         return true;
 
@@ -1511,7 +1676,9 @@ drbbdup_init(drbbdup_options_t *ops_in)
     if (!drbbdup_check_case_opnd(ops_in->runtime_case_opnd))
         return DRBBDUP_ERROR_INVALID_OPND;
 
-    memcpy(&opts, ops_in, sizeof(drbbdup_options_t));
+    /* Fields appended after the caller's struct_size are left unset. */
+    memset(&opts, 0, sizeof(drbbdup_options_t));
+    memcpy(&opts, ops_in, ops_in->struct_size);
 
     drreg_options_t drreg_ops = { sizeof(drreg_ops), 0 /* no regs needed */, false, NULL,
                                   true };
@@ -1544,6 +1711,10 @@ drbbdup_init(drbbdup_options_t *ops_in)
      */
     hashtable_init_ex(&manager_table, HASH_BIT_TABLE, HASH_INTPTR, false, false,
                       drbbdup_destroy_manager, NULL, NULL);
+    if (opts.is_case_profiling_enabled) {
+        hashtable_init_ex(&count_table, HASH_BIT_TABLE, HASH_INTPTR, false, false,
+                          drbbdup_destroy_case_counts, NULL, NULL);
+    }
 
     rw_lock = dr_rwlock_create();
     if (rw_lock == NULL)
@@ -1581,6 +1752,8 @@ drbbdup_exit(void)
             return DRBBDUP_ERROR;
 
         hashtable_delete(&manager_table);
+        if (opts.is_case_profiling_enabled)
+            hashtable_delete(&count_table);
         dr_rwlock_destroy(rw_lock);
 
         if (opts.is_stat_enabled)
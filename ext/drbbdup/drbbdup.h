@@ -284,7 +284,8 @@ typedef struct {
     /**
      * The maximum number of alternative cases, excluding the default case, that can be
      * associated with a basic block. Once the limit is reached and an unhandled case is
-     * encountered, control is directed to the default case.
+     * encountered, control is directed to the default case. Dynamic handling is turned
+     * off for a basic block once all of its case slots are taken.
      */
     ushort non_default_case_limit;
     /**
@@ -301,6 +302,19 @@ typedef struct {
      * set to true.
      */
     bool is_stat_enabled;
+    /**
+     * Determines whether drbbdup profiles how often each case of a basic block is
+     * executed. When set, the dispatcher increments a per-case counter whenever it
+     * directs control to a basic block copy. Moreover, whenever a fragment is rebuilt
+     * (e.g., upon trace creation or dynamic case generation), the dispatcher compares
+     * the runtime encoding against cases in descending order of their observed
+     * execution counts so that hot cases are reached with fewer comparisons.
+     *
+     * The counters are not updated atomically and are therefore approximate when
+     * multiple threads execute the same fragment. Counts may be queried via
+     * drbbdup_get_case_execution_count().
+     */
+    bool is_case_profiling_enabled;
 } drbbdup_options_t;
 
 /**
@@ -432,6 +446,20 @@ DR_EXPORT
 drbbdup_status_t
 drbbdup_get_stats(OUT drbbdup_stats_t *stats);
 
+DR_EXPORT
+/**
+ * Returns via \p count the number of times the copy handling the case \p encoding
+ * was executed for the basic block starting at \p bb_pc. The encoding of the
+ * default case may also be passed.
+ * Note that the invocation of this routine is only successful if case profiling
+ * is set via #drbbdup_options_t when initializing drbbdup. Counts persist when
+ * the basic block is rebuilt, as long as the case is registered in the same order,
+ * and are only discarded by drbbdup_exit().
+ * @return whether successful or an error code on failure.
+ */
+drbbdup_status_t
+drbbdup_get_case_execution_count(app_pc bb_pc, uintptr_t encoding, OUT uint64 *count);
+
 /*@}*/ /* end doxygen group */
 
 #ifdef __cplusplus
@@ -152,9 +152,9 @@ hash_free(void *ptr, size_t size)
 #define HASH_FUNC_BITS(val, num_bits) ((val) & (HASH_MASK(num_bits)))
 #define HASH_FUNC(val, mask) ((val) & (mask))
 
-/* caller must hold lock */
+/* caller must hold lock.  Returns the hash before truncation to num_bits. */
 static uint
-hash_key(hashtable_t *table, void *key)
+hash_key_unmasked(hashtable_t *table, void *key, uint num_bits)
 {
     uint hash = 0;
     if (table->hash_key_func != NULL) {
@@ -163,7 +163,7 @@ hash_key(hashtable_t *table, void *key)
         const char *s = (const char *)key;
         char c;
         uint i, shift;
-        uint max_shift = ALIGN_FORWARD(table->table_bits, 8);
+        uint max_shift = ALIGN_FORWARD(num_bits, 8);
         /* XXX: share w/ core's hash_value() function */
         for (i = 0; s[i] != '\0'; i++) {
             c = s[i];
@@ -180,7 +180,15 @@ hash_key(hashtable_t *table, void *key)
                "hashtable.c hash_key internal error: invalid hash type");
         hash = (uint)(ptr_uint_t)key;
     }
-    return HASH_FUNC_BITS(hash, table->table_bits);
+    return hash;
+}
+
+/* caller must hold lock */
+static uint
+hash_key(hashtable_t *table, void *key)
+{
+    return HASH_FUNC_BITS(hash_key_unmasked(table, key, table->table_bits),
+                          table->table_bits);
 }
 
 static bool
@@ -200,6 +208,284 @@ keys_equal(hashtable_t *table, void *key1, void *key2)
     }
 }
 
+/* Open addressing.  With config.open_address, keys and payloads are stored
+ * inline in table->slots and table->ctrl holds one control byte per slot:
+ * CTRL_EMPTY, CTRL_DELETED, or 7 bits of the key's mixed hash ("h2").  The rest
+ * of the hash selects the first group of CTRL_GROUP slots to probe, and probing
+ * then walks the groups in order.  As in SwissTable, all of a group's control bytes
+ * are compared against h2 at once using word-sized arithmetic, so keys are
+ * only compared on a likely match.  A probe ends at the first group with a
+ * CTRL_EMPTY byte, which is why removal leaves a CTRL_DELETED tombstone unless
+ * the slot's own group still has a CTRL_EMPTY byte.
+ *
+ * The group loads assume a little-endian byte order.
+ */
+
+#define CTRL_GROUP 8
+#define CTRL_EMPTY 0x80
+#define CTRL_DELETED 0xfe
+#define CTRL_IS_FULL(c) (((c)&0x80) == 0)
+#define CTRL_LSBS 0x0101010101010101ULL
+#define CTRL_MSBS 0x8080808080808080ULL
+/* The smallest table is one group */
+#define OA_MIN_BITS 3
+/* Maximum load in percent, counting tombstones, regardless of configuration */
+#define OA_MAX_LOAD 87
+
+/* The unmasked hash is multiplied out so that pointer keys with aligned low bits
+ * still spread across both the group index and h2.
+ */
+#define OA_MIX(hash) ((uint64)(hash)*0x9e3779b97f4a7c15ULL)
+#define OA_GROUP_INDEX(mix) ((uint)((mix) >> 32))
+#define OA_H2(mix) ((byte)(((mix) >> 25) & 0x7f))
+
+/* caller must hold lock */
+static uint64
+oa_hash(hashtable_t *table, void *key)
+{
+    return OA_MIX(hash_key_unmasked(table, key, 32));
+}
+
+static inline uint64
+oa_group_load(const byte *ctrl)
+{
+    uint64 group;
+    memcpy(&group, ctrl, sizeof(group));
+    return group;
+}
+
+/* Returns a mask with the top bit set for each byte in group equal to h2.  A full
+ * byte just above a match can also be flagged, but never an empty or deleted one,
+ * and callers compare keys anyway.
+ */
+static inline uint64
+oa_group_match(uint64 group, byte h2)
+{
+    uint64 x = group ^ (CTRL_LSBS * h2);
+    return (x - CTRL_LSBS) & ~x & CTRL_MSBS;
+}
+
+static inline uint64
+oa_group_match_empty(uint64 group)
+{
+    /* Of the control values only CTRL_EMPTY has bit 7 set and bit 1 clear */
+    return (group & (~group << 6)) & CTRL_MSBS;
+}
+
+static inline uint64
+oa_group_match_free(uint64 group)
+{
+    return group & CTRL_MSBS;
+}
+
+/* Returns the index within its group of the lowest byte flagged in mask */
+static inline uint
+oa_mask_first(uint64 mask)
+{
+    uint i = 0;
+    while ((mask & 0x80) == 0) {
+        mask >>= 8;
+        i++;
+    }
+    return i;
+}
+
+static uint
+oa_threshold(hashtable_t *table)
+{
+    if (table->config.resizable && table->config.resize_threshold < OA_MAX_LOAD)
+        return table->config.resize_threshold;
+    return OA_MAX_LOAD;
+}
+
+static void
+oa_alloc(hashtable_t *table, uint num_bits)
+{
+    size_t capacity = (size_t)HASHTABLE_SIZE(num_bits);
+    table->table_bits = num_bits;
+    table->ctrl = (byte *)hash_alloc(capacity);
+    memset(table->ctrl, CTRL_EMPTY, capacity);
+    table->slots = (hash_slot_t *)hash_alloc(capacity * sizeof(hash_slot_t));
+    table->deleted = 0;
+}
+
+static void
+oa_free(hashtable_t *table)
+{
+    size_t capacity = (size_t)HASHTABLE_SIZE(table->table_bits);
+    hash_free(table->ctrl, capacity);
+    hash_free(table->slots, capacity * sizeof(hash_slot_t));
+    table->ctrl = NULL;
+    table->slots = NULL;
+    table->deleted = 0;
+}
+
+/* caller must hold lock.  Returns the slot holding key, or -1 if there is none. */
+static int
+oa_find(hashtable_t *table, void *key)
+{
+    uint64 mix = oa_hash(table, key);
+    uint group_mask = HASHTABLE_SIZE(table->table_bits) / CTRL_GROUP - 1;
+    uint g = OA_GROUP_INDEX(mix) & group_mask;
+    byte h2 = OA_H2(mix);
+    uint probes;
+    for (probes = 0; probes <= group_mask; probes++) {
+        uint64 group = oa_group_load(&table->ctrl[g * CTRL_GROUP]);
+        uint64 match;
+        for (match = oa_group_match(group, h2); match != 0; match &= match - 1) {
+            uint i = g * CTRL_GROUP + oa_mask_first(match);
+            if (keys_equal(table, table->slots[i].key, key))
+                return (int)i;
+        }
+        if (oa_group_match_empty(group) != 0)
+            break;
+        g = (g + 1) & group_mask;
+    }
+    return -1;
+}
+
+/* caller must hold lock.  Claims the first free slot along the probe sequence
+ * for a key with hash mix that is not yet in the table.
+ */
+static uint
+oa_claim(hashtable_t *table, uint64 mix)
+{
+    uint group_mask = HASHTABLE_SIZE(table->table_bits) / CTRL_GROUP - 1;
+    uint g = OA_GROUP_INDEX(mix) & group_mask;
+    uint probes;
+    for (probes = 0; probes <= group_mask; probes++) {
+        uint64 free = oa_group_match_free(oa_group_load(&table->ctrl[g * CTRL_GROUP]));
+        if (free != 0) {
+            uint i = g * CTRL_GROUP + oa_mask_first(free);
+            if (table->ctrl[i] == CTRL_DELETED)
+                table->deleted--;
+            table->ctrl[i] = OA_H2(mix);
+            return i;
+        }
+        g = (g + 1) & group_mask;
+    }
+    ASSERT(false, "hashtable.c oa_claim internal error: table is full");
+    return 0;
+}
+
+/* caller must hold lock */
+static void
+oa_rehash(hashtable_t *table, uint new_bits)
+{
+    byte *old_ctrl = table->ctrl;
+    hash_slot_t *old_slots = table->slots;
+    size_t old_capacity = (size_t)HASHTABLE_SIZE(table->table_bits);
+    size_t i;
+    oa_alloc(table, new_bits);
+    for (i = 0; i < old_capacity; i++) {
+        if (CTRL_IS_FULL(old_ctrl[i])) {
+            uint j = oa_claim(table, oa_hash(table, old_slots[i].key));
+            table->slots[j] = old_slots[i];
+        }
+    }
+    hash_free(old_ctrl, old_capacity);
+    hash_free(old_slots, old_capacity * sizeof(hash_slot_t));
+}
+
+/* caller must hold lock.  Makes room for one more entry. */
+static void
+oa_check_for_resize(hashtable_t *table)
+{
+    size_t capacity = (size_t)HASHTABLE_SIZE(table->table_bits);
+    size_t threshold = oa_threshold(table);
+    if (((size_t)table->entries + table->deleted + 1) * 100 <= threshold * capacity)
+        return;
+    /* If tombstones make up much of the load, purge them without growing */
+    if (((size_t)table->entries + 1) * 100 * 2 <= threshold * capacity)
+        oa_rehash(table, table->table_bits);
+    else
+        oa_rehash(table, table->table_bits + 1);
+}
+
+/* caller must hold lock */
+static void
+oa_free_key(hashtable_t *table, void *key)
+{
+    if (table->str_dup)
+        hash_free(key, strlen((const char *)key) + 1);
+    else if (table->config.free_key_func != NULL)
+        (table->config.free_key_func)(key);
+}
+
+/* caller must hold lock.  Empties slot i without freeing its key or payload. */
+static void
+oa_release(hashtable_t *table, uint i)
+{
+    uint64 group = oa_group_load(&table->ctrl[ALIGN_BACKWARD(i, CTRL_GROUP)]);
+    /* No probe has passed through a group that still has an empty slot */
+    if (oa_group_match_empty(group) != 0)
+        table->ctrl[i] = CTRL_EMPTY;
+    else {
+        table->ctrl[i] = CTRL_DELETED;
+        table->deleted++;
+    }
+    table->entries--;
+}
+
+/* caller must hold lock */
+static void *
+oa_dup_key(hashtable_t *table, void *key)
+{
+    if (table->str_dup) {
+        const char *s = (const char *)key;
+        void *dup = hash_alloc(strlen(s) + 1);
+        strncpy((char *)dup, s, strlen(s) + 1);
+        return dup;
+    }
+    return key;
+}
+
+/* caller must hold lock.  Returns the old payload if replace and key was
+ * present, and sets *added to whether a new entry was added.
+ */
+static void *
+oa_add(hashtable_t *table, void *key, void *payload, bool replace, bool *added)
+{
+    void *old_payload = NULL;
+    int i = oa_find(table, key);
+    if (i >= 0) {
+        *added = false;
+        if (replace) {
+            void *new_key = oa_dup_key(table, key);
+            oa_free_key(table, table->slots[i].key);
+            /* up to caller to free payload */
+            old_payload = table->slots[i].payload;
+            table->slots[i].key = new_key;
+            table->slots[i].payload = payload;
+        }
+        return old_payload;
+    }
+    oa_check_for_resize(table);
+    i = (int)oa_claim(table, oa_hash(table, key));
+    table->slots[i].key = oa_dup_key(table, key);
+    table->slots[i].payload = payload;
+    table->entries++;
+    *added = true;
+    return NULL;
+}
+
+/* caller must hold lock.  Removes every entry, freeing keys and payloads. */
+static void
+oa_clear(hashtable_t *table)
+{
+    size_t i;
+    for (i = 0; i < (size_t)HASHTABLE_SIZE(table->table_bits); i++) {
+        if (CTRL_IS_FULL(table->ctrl[i])) {
+            oa_free_key(table, table->slots[i].key);
+            if (table->free_payload_func != NULL)
+                (table->free_payload_func)(table->slots[i].payload);
+        }
+    }
+    memset(table->ctrl, CTRL_EMPTY, (size_t)HASHTABLE_SIZE(table->table_bits));
+    table->entries = 0;
+    table->deleted = 0;
+}
+
 void
 hashtable_init_ex(hashtable_t *table, uint num_bits, hash_type_t hashtype, bool str_dup,
                   bool synch, void (*free_payload_func)(void *),
@@ -227,6 +513,10 @@ hashtable_init_ex(hashtable_t *table, uint num_bits, hash_type_t hashtype, bool
     table->config.resizable = true;
     table->config.resize_threshold = 75;
     table->config.free_key_func = NULL;
+    table->config.open_address = false;
+    table->ctrl = NULL;
+    table->slots = NULL;
+    table->deleted = 0;
 }
 
 void
@@ -246,6 +536,25 @@ hashtable_configure(hashtable_t *table, hashtable_config_t *config)
         table->config.resize_threshold = config->resize_threshold;
     if (config->size > offsetof(hashtable_config_t, free_key_func))
         table->config.free_key_func = config->free_key_func;
+    if (config->size > offsetof(hashtable_config_t, open_address) &&
+        config->open_address != table->config.open_address) {
+        ASSERT(table->entries == 0, "open_address can only be changed when empty");
+        if (table->entries == 0) {
+            if (config->open_address) {
+                hash_free(table->table, (size_t)HASHTABLE_SIZE(table->table_bits) *
+                              sizeof(hash_entry_t *));
+                table->table = NULL;
+                oa_alloc(table, MAX(table->table_bits, OA_MIN_BITS));
+            } else {
+                size_t sz =
+                    (size_t)HASHTABLE_SIZE(table->table_bits) * sizeof(hash_entry_t *);
+                oa_free(table);
+                table->table = (hash_entry_t **)hash_alloc(sz);
+                memset(table->table, 0, sz);
+            }
+            table->config.open_address = config->open_address;
+        }
+    }
 }
 
 void
@@ -276,11 +585,17 @@ hashtable_lookup(hashtable_t *table, void *key)
     if (table->synch) {
         dr_mutex_lock(table->lock);
     }
-    uint hindex = hash_key(table, key);
-    for (e = table->table[hindex]; e != NULL; e = e->next) {
-        if (keys_equal(table, e->key, key)) {
-            res = e->payload;
-            break;
+    if (table->ctrl != NULL) {
+        int i = oa_find(table, key);
+        if (i >= 0)
+            res = table->slots[i].payload;
+    } else {
+        uint hindex = hash_key(table, key);
+        for (e = table->table[hindex]; e != NULL; e = e->next) {
+            if (keys_equal(table, e->key, key)) {
+                res = e->payload;
+                break;
+            }
         }
     }
     if (table->synch)
@@ -288,6 +603,34 @@ hashtable_lookup(hashtable_t *table, void *key)
     return res;
 }
 
+/* caller must hold lock */
+static void
+hashtable_resize(hashtable_t *table, uint new_bits)
+{
+    size_t capacity = (size_t)HASHTABLE_SIZE(table->table_bits);
+    hash_entry_t **new_table;
+    size_t new_sz;
+    uint i, old_bits;
+    old_bits = table->table_bits;
+    table->table_bits = new_bits;
+    new_sz = (size_t)HASHTABLE_SIZE(table->table_bits) * sizeof(hash_entry_t *);
+    new_table = (hash_entry_t **)hash_alloc(new_sz);
+    memset(new_table, 0, new_sz);
+    /* rehash the old table into the new */
+    for (i = 0; i < HASHTABLE_SIZE(old_bits); i++) {
+        hash_entry_t *e = table->table[i];
+        while (e != NULL) {
+            hash_entry_t *nexte = e->next;
+            uint hindex = hash_key(table, e->key);
+            e->next = new_table[hindex];
+            new_table[hindex] = e;
+            e = nexte;
+        }
+    }
+    hash_free(table->table, capacity * sizeof(hash_entry_t *));
+    table->table = new_table;
+}
+
 /* caller must hold lock */
 static bool
 hashtable_check_for_resize(hashtable_t *table)
@@ -296,33 +639,35 @@ hashtable_check_for_resize(hashtable_t *table)
     if (table->config.resizable &&
         /* avoid fp ops.  should check for overflow. */
         table->entries * 100 > table->config.resize_threshold * capacity) {
-        hash_entry_t **new_table;
-        size_t new_sz;
-        uint i, old_bits;
         /* double the size */
-        old_bits = table->table_bits;
-        table->table_bits++;
-        new_sz = (size_t)HASHTABLE_SIZE(table->table_bits) * sizeof(hash_entry_t *);
-        new_table = (hash_entry_t **)hash_alloc(new_sz);
-        memset(new_table, 0, new_sz);
-        /* rehash the old table into the new */
-        for (i = 0; i < HASHTABLE_SIZE(old_bits); i++) {
-            hash_entry_t *e = table->table[i];
-            while (e != NULL) {
-                hash_entry_t *nexte = e->next;
-                uint hindex = hash_key(table, e->key);
-                e->next = new_table[hindex];
-                new_table[hindex] = e;
-                e = nexte;
-            }
-        }
-        hash_free(table->table, capacity * sizeof(hash_entry_t *));
-        table->table = new_table;
+        hashtable_resize(table, table->table_bits + 1);
         return true;
     }
     return false;
 }
 
+void
+hashtable_reserve(hashtable_t *table, uint num_entries)
+{
+    uint threshold, new_bits;
+    if (table->synch)
+        dr_mutex_lock(table->lock);
+    threshold =
+        table->ctrl != NULL ? oa_threshold(table) : table->config.resize_threshold;
+    new_bits = table->table_bits;
+    while (threshold > 0 && new_bits < 31 &&
+           (size_t)num_entries * 100 > threshold * (size_t)HASHTABLE_SIZE(new_bits))
+        new_bits++;
+    if (new_bits > table->table_bits) {
+        if (table->ctrl != NULL)
+            oa_rehash(table, new_bits);
+        else
+            hashtable_resize(table, new_bits);
+    }
+    if (table->synch)
+        dr_mutex_unlock(table->lock);
+}
+
 bool
 hashtable_add(hashtable_t *table, void *key, void *payload)
 {
@@ -331,6 +676,13 @@ hashtable_add(hashtable_t *table, void *key, void *payload)
     if (table->synch) {
         dr_mutex_lock(table->lock);
     }
+    if (table->ctrl != NULL) {
+        bool added;
+        oa_add(table, key, payload, false /*!replace*/, &added);
+        if (table->synch)
+            dr_mutex_unlock(table->lock);
+        return added;
+    }
     uint hindex = hash_key(table, key);
     hash_entry_t *e;
     for (e = table->table[hindex]; e != NULL; e = e->next) {
@@ -367,6 +719,13 @@ hashtable_add_replace(hashtable_t *table, void *key, void *payload)
         dr_mutex_lock(table->lock);
     }
     void *old_payload = NULL;
+    if (table->ctrl != NULL) {
+        bool added;
+        old_payload = oa_add(table, key, payload, true /*replace*/, &added);
+        if (table->synch)
+            dr_mutex_unlock(table->lock);
+        return old_payload;
+    }
     uint hindex = hash_key(table, key);
     hash_entry_t *e, *new_e, *prev_e;
     new_e = (hash_entry_t *)hash_alloc(sizeof(*new_e));
@@ -413,6 +772,19 @@ hashtable_remove(hashtable_t *table, void *key)
     if (table->synch) {
         dr_mutex_lock(table->lock);
     }
+    if (table->ctrl != NULL) {
+        int i = oa_find(table, key);
+        if (i >= 0) {
+            oa_free_key(table, table->slots[i].key);
+            if (table->free_payload_func != NULL)
+                (table->free_payload_func)(table->slots[i].payload);
+            oa_release(table, (uint)i);
+            res = true;
+        }
+        if (table->synch)
+            dr_mutex_unlock(table->lock);
+        return res;
+    }
     uint hindex = hash_key(table, key);
     for (e = table->table[hindex], prev_e = NULL; e != NULL; prev_e = e, e = e->next) {
         if (keys_equal(table, e->key, key)) {
@@ -446,6 +818,17 @@ hashtable_remove_range(hashtable_t *table, void *start, void *end)
     if (table->synch)
         hashtable_lock(table);
     for (i = 0; i < HASHTABLE_SIZE(table->table_bits); i++) {
+        if (table->ctrl != NULL) {
+            if (CTRL_IS_FULL(table->ctrl[i]) && table->slots[i].key >= start &&
+                table->slots[i].key < end) {
+                oa_free_key(table, table->slots[i].key);
+                if (table->free_payload_func != NULL)
+                    (table->free_payload_func)(table->slots[i].payload);
+                oa_release(table, i);
+                res = true;
+            }
+            continue;
+        }
         for (e = table->table[i], prev_e = NULL; e != NULL; e = next_e) {
             next_e = e->next;
             if (e->key >= start && e->key < end) {
@@ -477,7 +860,13 @@ hashtable_apply_to_all_payloads(hashtable_t *table, void (*apply_func)(void *pay
     DR_ASSERT_MSG(apply_func != NULL, "The apply_func ptr cannot be NULL.");
     uint i;
     for (i = 0; i < HASHTABLE_SIZE(table->table_bits); i++) {
-        hash_entry_t *e = table->table[i];
+        hash_entry_t *e;
+        if (table->ctrl != NULL) {
+            if (CTRL_IS_FULL(table->ctrl[i]))
+                apply_func(table->slots[i].payload);
+            continue;
+        }
+        e = table->table[i];
         while (e != NULL) {
             hash_entry_t *nexte = e->next;
             apply_func(e->payload);
@@ -495,7 +884,13 @@ hashtable_apply_to_all_payloads_user_data(hashtable_t *table,
     DR_ASSERT_MSG(apply_func != NULL, "The apply_func ptr cannot be NULL.");
     uint i;
     for (i = 0; i < HASHTABLE_SIZE(table->table_bits); i++) {
-        hash_entry_t *e = table->table[i];
+        hash_entry_t *e;
+        if (table->ctrl != NULL) {
+            if (CTRL_IS_FULL(table->ctrl[i]))
+                apply_func(table->slots[i].payload, user_data);
+            continue;
+        }
+        e = table->table[i];
         while (e != NULL) {
             hash_entry_t *nexte = e->next;
             apply_func(e->payload, user_data);
@@ -508,6 +903,10 @@ static void
 hashtable_clear_internal(hashtable_t *table)
 {
     uint i;
+    if (table->ctrl != NULL) {
+        oa_clear(table);
+        return;
+    }
     for (i = 0; i < HASHTABLE_SIZE(table->table_bits); i++) {
         hash_entry_t *e = table->table[i];
         while (e != NULL) {
@@ -542,8 +941,12 @@ hashtable_delete(hashtable_t *table)
     if (table->synch)
         dr_mutex_lock(table->lock);
     hashtable_clear_internal(table);
-    hash_free(table->table,
-              (size_t)HASHTABLE_SIZE(table->table_bits) * sizeof(hash_entry_t *));
+    if (table->ctrl != NULL)
+        oa_free(table);
+    else {
+        hash_free(table->table,
+                  (size_t)HASHTABLE_SIZE(table->table_bits) * sizeof(hash_entry_t *));
+    }
     table->table = NULL;
     table->entries = 0;
     if (table->synch)
@@ -575,20 +978,43 @@ hashtable_delete(hashtable_t *table)
  */
 
 static bool
-key_in_range(hashtable_t *table, hash_entry_t *he, ptr_uint_t start, size_t size)
+hash_write_file(file_t fd, void *ptr, size_t sz)
+{
+    return (dr_write_file(fd, ptr, sz) == (ssize_t)sz);
+}
+
+static bool
+key_in_range(hashtable_t *table, void *key, ptr_uint_t start, size_t size)
 {
     if (table->hashtype != HASH_INTPTR || size == 0)
         return true;
     /* avoiding overflow by subtracting one */
-    return ((ptr_uint_t)he->key >= start && (ptr_uint_t)he->key <= (start + (size - 1)));
+    return ((ptr_uint_t)key >= start && (ptr_uint_t)key <= (start + (size - 1)));
 }
 
 static bool
-hash_write_file(file_t fd, void *ptr, size_t sz)
+key_to_persist(void *drcontext, hashtable_t *table, void *key, void *perscxt,
+               ptr_uint_t start, size_t size, hasthable_persist_flags_t flags)
 {
-    return (dr_write_file(fd, ptr, sz) == (ssize_t)sz);
+    return (!TEST(DR_HASHPERS_ONLY_IN_RANGE, flags) ||
+            key_in_range(table, key, start, size)) &&
+        (!TEST(DR_HASHPERS_ONLY_PERSISTED, flags) ||
+         dr_fragment_persistable(drcontext, perscxt, key));
+}
+
+static bool
+hash_write_entry(file_t fd, void *key, void *payload, size_t entry_size,
+                 hasthable_persist_flags_t flags)
+{
+    if (!hash_write_file(fd, &key, sizeof(key)))
+        return false;
+    if (TEST(DR_HASHPERS_PAYLOAD_IS_POINTER, flags))
+        return hash_write_file(fd, payload, entry_size);
+    ASSERT(entry_size <= sizeof(void *), "inlined data too large");
+    return hash_write_file(fd, &payload, entry_size);
 }
 
+
 size_t
 hashtable_persist_size(void *drcontext, hashtable_t *table, size_t entry_size,
                        void *perscxt, hasthable_persist_flags_t flags)
@@ -607,11 +1033,16 @@ hashtable_persist_size(void *drcontext, hashtable_t *table, size_t entry_size,
         count = 0;
         for (i = 0; i < HASHTABLE_SIZE(table->table_bits); i++) {
             hash_entry_t *he;
+            if (table->ctrl != NULL) {
+                if (CTRL_IS_FULL(table->ctrl[i]) &&
+                    key_to_persist(drcontext, table, table->slots[i].key, perscxt,
+                                   start, size, flags))
+                    count++;
+                continue;
+            }
             for (he = table->table[i]; he != NULL; he = he->next) {
-                if ((!TEST(DR_HASHPERS_ONLY_IN_RANGE, flags) ||
-                     key_in_range(table, he, start, size)) &&
-                    (!TEST(DR_HASHPERS_ONLY_PERSISTED, flags) ||
-                     dr_fragment_persistable(drcontext, perscxt, he->key)))
+                if (key_to_persist(drcontext, table, he->key, perscxt, start, size,
+                                   flags))
                     count++;
             }
         }
@@ -651,22 +1082,22 @@ hashtable_persist(void *drcontext, hashtable_t *table, size_t entry_size, file_t
     /* synch is already provided */
     for (i = 0; i < HASHTABLE_SIZE(table->table_bits); i++) {
         hash_entry_t *he;
+        if (table->ctrl != NULL) {
+            hash_slot_t *slot = &table->slots[i];
+            if (CTRL_IS_FULL(table->ctrl[i]) &&
+                key_to_persist(drcontext, table, slot->key, perscxt, start, size,
+                               flags)) {
+                IF_DEBUG(count_check++;)
+                if (!hash_write_entry(fd, slot->key, slot->payload, entry_size, flags))
+                    return false;
+            }
+            continue;
+        }
         for (he = table->table[i]; he != NULL; he = he->next) {
-            if ((!TEST(DR_HASHPERS_ONLY_IN_RANGE, flags) ||
-                 key_in_range(table, he, start, size)) &&
-                (!TEST(DR_HASHPERS_ONLY_PERSISTED, flags) ||
-                 dr_fragment_persistable(drcontext, perscxt, he->key))) {
+            if (key_to_persist(drcontext, table, he->key, perscxt, start, size, flags)) {
                 IF_DEBUG(count_check++;)
-                if (!hash_write_file(fd, &he->key, sizeof(he->key)))
+                if (!hash_write_entry(fd, he->key, he->payload, entry_size, flags))
                     return false;
-                if (TEST(DR_HASHPERS_PAYLOAD_IS_POINTER, flags)) {
-                    if (!hash_write_file(fd, he->payload, entry_size))
-                        return false;
-                } else {
-                    ASSERT(entry_size <= sizeof(void *), "inlined data too large");
-                    if (!hash_write_file(fd, &he->payload, entry_size))
-                        return false;
-                }
             }
         }
     }
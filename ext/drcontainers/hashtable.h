@@ -85,8 +85,24 @@ typedef struct _hashtable_config_t {
      * to true in hashtable_init() or hashtable_init_ex(), this field is ignored.
      */
     void (*free_key_func)(void *);
+    /**
+     * Whether to use open addressing rather than chaining.  Keys and payloads
+     * are then stored inline in one array alongside a byte of hash metadata
+     * per entry, so adding an entry does not allocate and a lookup usually
+     * touches a single cache line.  This can only be changed while the table is
+     * empty.  The table's \p table field is NULL in this mode: iterate with
+     * hashtable_apply_to_all_payloads() instead.  The table always grows before
+     * it is 7/8 full, even when not \p resizable.
+     */
+    bool open_address;
 } hashtable_config_t;
 
+/* Inline entry storage for open addressing */
+typedef struct _hash_slot_t {
+    void *key;
+    void *payload;
+} hash_slot_t;
+
 typedef struct _hashtable_t {
     hash_entry_t **table;
     hash_type_t hashtype;
@@ -100,6 +116,10 @@ typedef struct _hashtable_t {
     uint entries;
     hashtable_config_t config;
     uint persist_count;
+    /* For config.open_address: one control byte per slot, and the slots */
+    byte *ctrl;
+    hash_slot_t *slots;
+    uint deleted; /* tombstone slots */
 } hashtable_t;
 
 /* should move back to utils.c once have iterator and alloc_exit
@@ -163,6 +183,13 @@ hashtable_init_ex(hashtable_t *table, uint num_bits, hash_type_t hashtype, bool
 void
 hashtable_configure(hashtable_t *table, hashtable_config_t *config);
 
+/**
+ * Grows the table, if necessary, so that it can hold \p num_entries entries
+ * without resizing, avoiding repeated rehashing when bulk-adding entries.
+ */
+void
+hashtable_reserve(hashtable_t *table, uint num_entries);
+
 /** Returns the payload for the given key, or NULL if the key is not found */
 void *
 hashtable_lookup(hashtable_t *table, void *key);
@@ -203,6 +203,13 @@ typedef struct _per_thread_t {
     instr_t *first_instr;
     instr_t *first_nonlabel_instr;
     instr_t *last_instr;
+    /* Cached copy of the bb cb lists, revalidated against bb_cb_generation so
+     * that steady-state bb events need not acquire bb_cb_lock.
+     */
+    struct _local_ctx_t *bb_cbs;
+    int bb_cbs_generation;
+    /* Nesting depth of drmgr_bb_event, as bb_cbs is in use while non-zero. */
+    int bb_event_depth;
 } per_thread_t;
 
 /* Emulation note types */
@@ -254,6 +261,12 @@ static void *bb_cb_lock;
 /* To know whether we need any DR events; protected by bb_cb_lock */
 static uint bb_event_count;
 
+/* Incremented while holding the bb_cb_lock write lock whenever any of the lists,
+ * counts, or bbdup callbacks below change.  Threads compare it against the
+ * generation of their cached copy to avoid taking bb_cb_lock on each bb event.
+ */
+static volatile int bb_cb_generation;
+
 /* Lists sorted by priority and protected by bb_cb_lock */
 static cb_list_t cblist_app2app;
 static cb_list_t cblist_instrumentation;
@@ -1047,10 +1060,13 @@ drmgr_bb_event_instrument_dups(void *drcontext, void *tag, instrlist_t *bb,
     return is_dups;
 }
 
-static void
+/* Returns the value of bb_cb_generation which the copy corresponds to. */
+static int
 drmgr_bb_event_set_local_cb_info(void *drcontext, OUT local_cb_info_t *local_info)
 {
+    int generation;
     dr_rwlock_read_lock(bb_cb_lock);
+    generation = bb_cb_generation;
     /* We use arrays to more easily support unregistering while in an event (i#1356).
      * With arrays we can make a temporary copy and avoid holding a lock while
      * delivering events.
@@ -1090,6 +1106,7 @@ drmgr_bb_event_set_local_cb_info(void *drcontext, OUT local_cb_info_t *local_inf
                             BUFFER_SIZE_ELEMENTS(local_info->pre_bbdup));
     }
     dr_rwlock_read_unlock(bb_cb_lock);
+    return generation;
 }
 
 static void
@@ -1108,38 +1125,76 @@ drmgr_bb_event_delete_local_cb_info(void *drcontext, IN local_cb_info_t *local_i
     }
 }
 
+/* Returns the callback lists to use for this bb event.  In the steady state this is
+ * the thread's cached copy, which is only rebuilt (under bb_cb_lock) once a
+ * registration or unregistration has bumped bb_cb_generation.  A callback
+ * unregistering itself mid-event still only affects the next event (i#1356) as the
+ * cached copy is never modified while in use.  If we are nested inside another bb
+ * event on this thread, a temporary copy is made which the caller must free with
+ * drmgr_bb_event_put_local_cb_info().
+ */
+static local_cb_info_t *
+drmgr_bb_event_get_local_cb_info(void *drcontext, per_thread_t *pt)
+{
+    local_cb_info_t *local_info;
+    if (pt->bb_event_depth > 0) {
+        local_info = dr_thread_alloc(drcontext, sizeof(*local_info));
+        drmgr_bb_event_set_local_cb_info(drcontext, local_info);
+        return local_info;
+    }
+    if (pt->bb_cbs == NULL)
+        pt->bb_cbs = dr_thread_alloc(drcontext, sizeof(*pt->bb_cbs));
+    else if (pt->bb_cbs_generation == dr_atomic_load32(&bb_cb_generation))
+        return pt->bb_cbs;
+    else
+        drmgr_bb_event_delete_local_cb_info(drcontext, pt->bb_cbs);
+    pt->bb_cbs_generation = drmgr_bb_event_set_local_cb_info(drcontext, pt->bb_cbs);
+    return pt->bb_cbs;
+}
+
+static void
+drmgr_bb_event_put_local_cb_info(void *drcontext, per_thread_t *pt,
+                                 local_cb_info_t *local_info)
+{
+    if (local_info != pt->bb_cbs) {
+        drmgr_bb_event_delete_local_cb_info(drcontext, local_info);
+        dr_thread_free(drcontext, local_info, sizeof(*local_info));
+    }
+}
+
 static dr_emit_flags_t
 drmgr_bb_event(void *drcontext, void *tag, instrlist_t *bb, bool for_trace,
                bool translating)
 {
     dr_emit_flags_t res = DR_EMIT_DEFAULT;
-    local_cb_info_t local_info;
+    local_cb_info_t *local_info;
     void **pair_data = NULL, **quartet_data = NULL;
     per_thread_t *pt = (per_thread_t *)drmgr_get_tls_field(drcontext, our_tls_idx);
 
-    drmgr_bb_event_set_local_cb_info(drcontext, &local_info);
+    local_info = drmgr_bb_event_get_local_cb_info(drcontext, pt);
+    pt->bb_event_depth++;
 
     /* We need per-thread user_data */
-    if (local_info.pair_count > 0) {
+    if (local_info->pair_count > 0) {
         pair_data =
-            (void **)dr_thread_alloc(drcontext, sizeof(void *) * local_info.pair_count);
+            (void **)dr_thread_alloc(drcontext, sizeof(void *) * local_info->pair_count);
     }
-    if (local_info.quartet_count > 0) {
+    if (local_info->quartet_count > 0) {
         quartet_data = (void **)dr_thread_alloc(
-            drcontext, sizeof(void *) * local_info.quartet_count);
+            drcontext, sizeof(void *) * local_info->quartet_count);
     }
 
     bool is_dups = false;
     /* Only true if drbbdup is in use. */
-    if (local_info.is_bbdup_enabled) {
+    if (local_info->is_bbdup_enabled) {
         is_dups = drmgr_bb_event_instrument_dups(drcontext, tag, bb, for_trace,
-                                                 translating, &res, pt, &local_info,
+                                                 translating, &res, pt, local_info,
                                                  pair_data, quartet_data);
     }
 
     if (!is_dups) {
         res = drmgr_bb_event_do_instrum_phases(drcontext, tag, bb, for_trace, translating,
-                                               pt, &local_info, pair_data, quartet_data);
+                                               pt, local_info, pair_data, quartet_data);
     }
 
     /* Do final fix passes: */
@@ -1159,14 +1214,15 @@ drmgr_bb_event(void *drcontext, void *tag, instrlist_t *bb, bool for_trace,
     }
 #endif
 
-    if (local_info.pair_count > 0)
-        dr_thread_free(drcontext, pair_data, sizeof(void *) * local_info.pair_count);
-    if (local_info.quartet_count > 0) {
+    if (local_info->pair_count > 0)
+        dr_thread_free(drcontext, pair_data, sizeof(void *) * local_info->pair_count);
+    if (local_info->quartet_count > 0) {
         dr_thread_free(drcontext, quartet_data,
-                       sizeof(void *) * local_info.quartet_count);
+                       sizeof(void *) * local_info->quartet_count);
     }
 
-    drmgr_bb_event_delete_local_cb_info(drcontext, &local_info);
+    pt->bb_event_depth--;
+    drmgr_bb_event_put_local_cb_info(drcontext, pt, local_info);
 
     return res;
 }
@@ -1347,6 +1403,7 @@ drmgr_bb_cb_add(cb_list_t *list, drmgr_xform_cb_t xform_func,
         else if (xform_func == NULL)
             pair_count++;
         res = true;
+        dr_atomic_add32_return_sum(&bb_cb_generation, 1);
     }
     dr_rwlock_write_unlock(bb_cb_lock);
     return res;
@@ -1476,6 +1533,7 @@ drmgr_bb_cb_remove(cb_list_t *list, drmgr_xform_cb_t xform_func,
             bb_event_count--;
             if (bb_event_count == 0)
                 dr_unregister_bb_event(drmgr_bb_event);
+            dr_atomic_add32_return_sum(&bb_cb_generation, 1);
             break;
         }
     }
@@ -1501,6 +1559,7 @@ drmgr_bb_exit(void)
     cblist_delete(&cblist_app2app);
     cblist_delete(&cblist_instrumentation);
     cblist_delete(&cblist_instru2instru);
+    dr_atomic_add32_return_sum(&bb_cb_generation, 1);
 }
 
 DR_EXPORT
@@ -1670,6 +1729,10 @@ static void
 our_thread_exit_event(void *drcontext)
 {
     per_thread_t *pt = (per_thread_t *)drmgr_get_tls_field(drcontext, our_tls_idx);
+    if (pt->bb_cbs != NULL) {
+        drmgr_bb_event_delete_local_cb_info(drcontext, pt->bb_cbs);
+        dr_thread_free(drcontext, pt->bb_cbs, sizeof(*pt->bb_cbs));
+    }
     dr_thread_free(drcontext, pt, sizeof(*pt));
 }
 
@@ -3270,6 +3333,7 @@ drmgr_register_bbdup_event(drmgr_bbdup_duplicate_bb_cb_t bb_dup_func,
         bbdup_extract_cb = extract_func;
         bbdup_stitch_cb = stitch_func;
         cblist_init(&cblist_pre_bbdup, sizeof(cb_entry_t));
+        dr_atomic_add32_return_sum(&bb_cb_generation, 1);
         succ = true;
     }
     dr_rwlock_write_unlock(bb_cb_lock);
@@ -3288,6 +3352,7 @@ drmgr_unregister_bbdup_event()
         bbdup_stitch_cb = NULL;
         cblist_delete(&cblist_pre_bbdup);
         ASSERT(!is_bbdup_enabled(), "should be disabled after unregistration");
+        dr_atomic_add32_return_sum(&bb_cb_generation, 1);
         succ = true;
     }
     dr_rwlock_write_unlock(bb_cb_lock);
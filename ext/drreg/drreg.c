@@ -43,6 +43,7 @@
 #include "dr_api.h"
 #include "drmgr.h"
 #include "drvector.h"
+#include "hashtable.h"
 #include "drreg.h"
 #include "../ext_utils.h"
 #include <string.h>
@@ -121,6 +122,25 @@ typedef struct _per_thread_t {
 
 static drreg_options_t ops;
 
+/* For ops.cross_block_liveness: the liveness at entry to a block, keyed by its
+ * app pc.  Shared by all threads and protected by its table lock.
+ */
+typedef struct _live_summary_t {
+    /* Bit GPR_IDX(reg) is set if reg may be read before it is written */
+    uint64 gpr_live;
+    /* The EFLAGS_READ_ARITH flags that may be read before they are written */
+    uint aflags_live;
+} live_summary_t;
+
+#define LIVE_CACHE_HASH_BITS 10
+/* We clear the cache rather than let it grow past this many entries */
+#define LIVE_CACHE_MAX_ENTRIES (64 * 1024)
+/* The lookahead bound when decoding a successor */
+#define LIVE_LOOKAHEAD_INSTRS 16
+#define LIVE_LOOKAHEAD_BYTES 128
+static hashtable_t live_cache;
+static bool live_cache_initialized;
+
 static int tls_idx = -1;
 static uint tls_slot_offs;
 static reg_id_t tls_seg;
@@ -286,6 +306,159 @@ count_app_uses(per_thread_t *pt, opnd_t opnd)
     }
 }
 
+/* Returns whether inst overwrites all of reg.  We do not consider writes to
+ * sub-regs, or conditional writes.
+ */
+static inline bool
+instr_kills_reg(instr_t *inst, reg_id_t reg)
+{
+    return instr_writes_to_exact_reg(inst, reg, DR_QUERY_INCLUDE_COND_SRCS)
+        /* a write to a 32-bit reg for amd64 zeroes the top 32 bits */
+        IF_X86_64(|| instr_writes_to_exact_reg(inst, reg_64_to_32(reg),
+                                               DR_QUERY_INCLUDE_COND_SRCS));
+}
+
+#ifndef ARM
+static void
+live_summary_free(void *v)
+{
+    dr_global_free(v, sizeof(live_summary_t));
+}
+
+/* Decodes up to a bounded number of instructions at pc to find which registers
+ * and flags may be read before being written.  Anything not decided within the
+ * lookahead, or by the first transfer, is considered live.
+ */
+static void
+compute_entry_liveness(void *drcontext, app_pc pc, OUT live_summary_t *summary)
+{
+    /* Padded so a truncated final instr cannot make us decode beyond the end */
+    byte buf[LIVE_LOOKAHEAD_BYTES + MAX_INSTR_LENGTH];
+    size_t len = LIVE_LOOKAHEAD_BYTES, read = 0, offs = 0;
+    uint64 gpr_decided = 0;
+    uint aflags_decided = 0;
+    int count;
+    reg_id_t reg;
+    instr_t inst;
+    summary->gpr_live = 0;
+    summary->aflags_live = 0;
+    /* Do not read across a page boundary we do not need */
+    if ((size_t)(ALIGN_FORWARD(pc + 1, dr_page_size()) - (ptr_uint_t)pc) < len)
+        len = ALIGN_FORWARD(pc + 1, dr_page_size()) - (ptr_uint_t)pc;
+    if (!dr_safe_read(pc, len, buf, &read))
+        read = 0;
+    memset(buf + read, 0, sizeof(buf) - read);
+    instr_init(drcontext, &inst);
+    for (count = 0; count < LIVE_LOOKAHEAD_INSTRS; count++) {
+        uint aflags, aflags_read, aflags_w2r;
+        bool xfer;
+        byte *next;
+        if (offs >= read)
+            break;
+        instr_reset(drcontext, &inst);
+        next = decode_from_copy(drcontext, buf + offs, pc + offs, &inst);
+        /* Give up on an instr that extends beyond what we read */
+        if (next == NULL || (size_t)(next - buf) > read)
+            break;
+        offs = next - buf;
+        for (reg = DR_REG_START_GPR; reg <= DR_REG_STOP_GPR; reg++) {
+            uint64 bit = 1ULL << GPR_IDX(reg);
+            if (TEST(bit, gpr_decided))
+                continue;
+            if (instr_reads_from_reg(&inst, reg, DR_QUERY_INCLUDE_COND_SRCS)) {
+                summary->gpr_live |= bit;
+                gpr_decided |= bit;
+            } else if (instr_kills_reg(&inst, reg))
+                gpr_decided |= bit;
+        }
+        aflags = instr_get_arith_flags(&inst, DR_QUERY_INCLUDE_COND_SRCS);
+        aflags_read = aflags & EFLAGS_READ_ARITH & ~aflags_decided;
+        summary->aflags_live |= aflags_read;
+        aflags_w2r = EFLAGS_WRITE_TO_READ(aflags & EFLAGS_WRITE_ARITH);
+        aflags_decided |= aflags_read | aflags_w2r;
+        xfer = (instr_is_cti(&inst) || instr_is_interrupt(&inst) ||
+                instr_is_syscall(&inst));
+        if (xfer)
+            break;
+    }
+    instr_free(drcontext, &inst);
+    for (reg = DR_REG_START_GPR; reg <= DR_REG_STOP_GPR; reg++) {
+        if (!TEST(1ULL << GPR_IDX(reg), gpr_decided))
+            summary->gpr_live |= 1ULL << GPR_IDX(reg);
+    }
+    /* We never hand these out, but be explicit. */
+    summary->gpr_live |= 1ULL << GPR_IDX(DR_REG_XSP);
+    if (dr_get_stolen_reg() != DR_REG_NULL)
+        summary->gpr_live |= 1ULL << GPR_IDX(dr_get_stolen_reg());
+    summary->aflags_live |= EFLAGS_READ_ARITH & ~aflags_decided;
+}
+
+static void
+lookup_entry_liveness(void *drcontext, app_pc pc, OUT live_summary_t *summary)
+{
+    live_summary_t *cached;
+    hashtable_lock(&live_cache);
+    cached = (live_summary_t *)hashtable_lookup(&live_cache, pc);
+    if (cached != NULL)
+        *summary = *cached;
+    hashtable_unlock(&live_cache);
+    if (cached != NULL)
+        return;
+    /* We decode outside of the lock. */
+    compute_entry_liveness(drcontext, pc, summary);
+    cached = dr_global_alloc(sizeof(*cached));
+    *cached = *summary;
+    hashtable_lock(&live_cache);
+    if (live_cache.entries >= LIVE_CACHE_MAX_ENTRIES)
+        hashtable_clear(&live_cache);
+    /* Another thread may have beaten us to it. */
+    if (!hashtable_add(&live_cache, pc, cached))
+        live_summary_free(cached);
+    hashtable_unlock(&live_cache);
+}
+
+/* Computes the liveness at entry to the successors of inst that lie outside of
+ * the block, returning false if any of them is unknown.  The fall-through of a
+ * conditional branch that is not the last instr is inside the block and is
+ * not included.
+ */
+static bool
+get_successor_liveness(void *drcontext, instr_t *inst, bool last,
+                       OUT live_summary_t *summary)
+{
+    live_summary_t fall;
+    if (!instr_is_app(inst))
+        return false;
+    if (instr_is_cti(inst)) {
+        if (!instr_is_cbr(inst) && !instr_is_ubr(inst) && !instr_is_call_direct(inst))
+            return false;
+        if (!opnd_is_pc(instr_get_target(inst)))
+            return false;
+        lookup_entry_liveness(drcontext, opnd_get_pc(instr_get_target(inst)), summary);
+        if (!instr_is_cbr(inst) || !last)
+            return true;
+    } else if (!last || instr_is_interrupt(inst) || instr_is_syscall(inst))
+        return false;
+    else {
+        summary->gpr_live = 0;
+        summary->aflags_live = 0;
+    }
+    lookup_entry_liveness(
+        drcontext, instr_get_app_pc(inst) + instr_length(drcontext, inst), &fall);
+    summary->gpr_live |= fall.gpr_live;
+    summary->aflags_live |= fall.aflags_live;
+    return true;
+}
+
+static void
+drreg_event_module_unload(void *drcontext, const module_data_t *info)
+{
+    hashtable_lock(&live_cache);
+    hashtable_remove_range(&live_cache, info->start, info->end);
+    hashtable_unlock(&live_cache);
+}
+#endif
+
 /* This event has to go last, to handle labels inserted by other components:
  * else our indices get off, and we can't simply skip labels in the
  * per-instr event b/c we need the liveness to advance at the label
@@ -315,6 +488,19 @@ drreg_event_bb_analysis(void *drcontext, void *tag, instrlist_t *bb, bool for_tr
 
         bool xfer =
             (instr_is_cti(inst) || instr_is_interrupt(inst) || instr_is_syscall(inst));
+        /* With ops.cross_block_liveness we use the successors' liveness at exits
+         * rather than assuming everything is live there.
+         */
+        live_summary_t succ;
+        bool have_succ = false;
+        /* A non-final cbr also falls through to the next instr */
+        bool merge_next = false;
+#ifndef ARM
+        if (live_cache_initialized && (xfer || index == 0)) {
+            have_succ = get_successor_liveness(drcontext, inst, index == 0, &succ);
+            merge_next = have_succ && index > 0 && instr_is_cbr(inst);
+        }
+#endif
 
         if (!pt->bb_has_internal_flow && (instr_is_ubr(inst) || instr_is_cbr(inst)) &&
             opnd_is_instr(instr_get_target(inst))) {
@@ -334,13 +520,16 @@ drreg_event_bb_analysis(void *drcontext, void *tag, instrlist_t *bb, bool for_tr
             if (instr_reads_from_reg(inst, reg, DR_QUERY_INCLUDE_COND_SRCS))
                 value = REG_LIVE;
             /* make sure we don't consider writes to sub-regs */
-            else if (instr_writes_to_exact_reg(inst, reg, DR_QUERY_INCLUDE_COND_SRCS)
-                     /* a write to a 32-bit reg for amd64 zeroes the top 32 bits */
-                     IF_X86_64(||
-                               instr_writes_to_exact_reg(inst, reg_64_to_32(reg),
-                                                         DR_QUERY_INCLUDE_COND_SRCS)))
+            else if (instr_kills_reg(inst, reg))
                 value = REG_DEAD;
-            else if (xfer)
+            else if (have_succ) {
+                if (TEST(1ULL << GPR_IDX(reg), succ.gpr_live))
+                    value = REG_LIVE;
+                else if (merge_next)
+                    value = drvector_get_entry(&pt->reg[GPR_IDX(reg)].live, index - 1);
+                else
+                    value = REG_DEAD;
+            } else if (xfer)
                 value = REG_LIVE;
             else if (index > 0)
                 value = drvector_get_entry(&pt->reg[GPR_IDX(reg)].live, index - 1);
@@ -351,11 +540,17 @@ drreg_event_bb_analysis(void *drcontext, void *tag, instrlist_t *bb, bool for_tr
 
         /* aflags liveness */
         aflags_new = instr_get_arith_flags(inst, DR_QUERY_INCLUDE_COND_SRCS);
-        if (xfer)
+        if (xfer && !have_succ)
             aflags_cur = EFLAGS_READ_ARITH; /* assume flags are read before written */
         else {
             uint aflags_read, aflags_w2r;
-            if (index == 0)
+            if (have_succ) {
+                aflags_cur = succ.aflags_live;
+                if (merge_next) {
+                    aflags_cur |=
+                        (uint)(ptr_uint_t)drvector_get_entry(&pt->aflags.live, index - 1);
+                }
+            } else if (index == 0)
                 aflags_cur = EFLAGS_READ_ARITH; /* assume flags are read before written */
             else {
                 aflags_cur =
@@ -1967,6 +2162,25 @@ drreg_init(drreg_options_t *ops_in)
     /* If anyone wants to be conservative, then be conservative. */
     ops.conservative = ops.conservative || ops_in->conservative;
 
+    if (ops_in->struct_size > offsetof(drreg_options_t, cross_block_liveness))
+        ops.cross_block_liveness =
+            ops.cross_block_liveness || ops_in->cross_block_liveness;
+#ifndef ARM
+    if (ops.cross_block_liveness && !ops.conservative && !live_cache_initialized) {
+        hashtable_init_ex(&live_cache, LIVE_CACHE_HASH_BITS, HASH_INTPTR,
+                          false /*!str_dup*/, false /*!synch*/, live_summary_free, NULL,
+                          NULL);
+        if (!drmgr_register_module_unload_event(drreg_event_module_unload))
+            return DRREG_ERROR;
+        live_cache_initialized = true;
+    } else if (ops.conservative && live_cache_initialized) {
+        /* A later conservative request turns this off. */
+        live_cache_initialized = false;
+        drmgr_unregister_module_unload_event(drreg_event_module_unload);
+        hashtable_delete(&live_cache);
+    }
+#endif
+
     /* The first callback wins. */
     if (ops_in->struct_size > offsetof(drreg_options_t, error_callback) &&
         ops.error_callback == NULL)
@@ -2002,6 +2216,14 @@ drreg_exit(void)
         !drmgr_unregister_restore_state_ex_event(drreg_event_restore_state))
         return DRREG_ERROR;
 
+#ifndef ARM
+    if (live_cache_initialized) {
+        live_cache_initialized = false;
+        drmgr_unregister_module_unload_event(drreg_event_module_unload);
+        hashtable_delete(&live_cache);
+    }
+#endif
+
     drmgr_exit();
 
     if (ops.num_spill_slots > 0) {
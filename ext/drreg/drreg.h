@@ -167,6 +167,23 @@ typedef struct _drreg_options_t {
      * needed.
      */
     bool do_not_sum_slots;
+    /**
+     * By default, drreg assumes that all registers and the arithmetic flags are
+     * live at the end of each block.  If this is set, drreg instead decodes the
+     * first few instructions reached by each direct branch, direct call, or
+     * fall-through out of a block, caching a summary per target address, and
+     * treats registers and flags that are written before being read on every such
+     * path as dead.  This avoids spills and restores at block boundaries, which
+     * matters most in tight loops.  Like the dead-register optimizations within a
+     * block, this is disabled by \p conservative.  It assumes that code reached by
+     * a direct transfer is not modified without the transferring block also being
+     * flushed, so it should not be used with applications that generate code.  It
+     * is not supported on 32-bit ARM, where it is ignored.
+     *
+     * If multiple drreg_init() calls are made, this field is combined by
+     * logical OR.
+     */
+    bool cross_block_liveness;
 } drreg_options_t;
 
 DR_EXPORT
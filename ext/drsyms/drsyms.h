@@ -722,6 +722,22 @@ DR_EXPORT
 drsym_error_t
 drsym_enumerate_lines(const char *modpath, drsym_enumerate_lines_cb callback, void *data);
 
+DR_EXPORT
+/**
+ * Enables an on-disk cache for the address-to-line index that drsyms builds
+ * for each module with DWARF line information upon the first line lookup.
+ * The index of a module is saved in \p dir under a file named after the
+ * module's build id, and later processes load it from there instead of
+ * parsing the DWARF line programs again. Modules without a build id are not
+ * cached. Passing NULL disables the cache. The directory must already exist.
+ *
+ * \note Currently only supported for ELF modules.
+ *
+ * @param[in] dir  The directory to hold the cache files, or NULL.
+ */
+drsym_error_t
+drsym_set_line_cache_dir(const char *dir);
+
 /*@}*/ /* end doxygen group */
 
 #ifdef __cplusplus
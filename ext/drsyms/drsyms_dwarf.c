@@ -37,6 +37,7 @@
 #include "dr_api.h"
 #include "drsyms.h"
 #include "drsyms_private.h"
+#include "hashtable.h"
 
 #include "dwarf.h"
 #include "libdwarf.h"
@@ -63,8 +64,42 @@ typedef struct _dwarf_module_t {
     Dwarf_Signed num_lines;
     /* Amount to adjust all offsets for __PAGEZERO + PIE (i#1365) */
     ssize_t offs_adjust;
+    /* Address-to-line index of all CUs, built or loaded upon the first lookup. */
+    byte *line_index;
+    size_t line_index_size;
+    bool line_index_failed;
+    /* Owned by the object file module; keys the on-disk copy of line_index. */
+    const char *build_id;
 } dwarf_module_t;
 
+/* The address-to-line index of a module is a single contiguous blob so that it can
+ * be written to and read from the on-disk cache as is.  It consists of this header
+ * followed by the rows sorted by address, the offsets of the file names, and the
+ * nul-terminated file names themselves.
+ */
+typedef struct _line_index_header_t {
+    uint64 magic;
+    uint64 version;
+    uint64 num_rows;
+    uint64 num_files;
+    uint64 strings_size;
+} line_index_header_t;
+
+typedef struct _line_index_row_t {
+    uint64 addr;
+    uint line;
+    uint file_idx;
+} line_index_row_t;
+
+#define LINE_INDEX_MAGIC 0x58444e4c4d595344ULL /* "DSYMLNDX" */
+#define LINE_INDEX_VERSION 1
+#define LINE_INDEX_FILE_HASH_BITS 10
+
+/* Directory of the on-disk line index cache; empty if disabled.
+ * Protected by the caller's symbol lock.
+ */
+static char line_cache_dir[MAXIMUM_PATH];
+
 typedef enum {
     SEARCH_FOUND = 0,
     SEARCH_MAYBE = 1,
@@ -75,6 +110,9 @@ static search_result_t
 search_addr2line_in_cu(dwarf_module_t *mod, Dwarf_Addr pc, Dwarf_Die cu_die,
                        drsym_info_t *sym_info INOUT);
 
+static Dwarf_Signed
+get_lines_from_cu(dwarf_module_t *mod, Dwarf_Die cu_die, Dwarf_Line **lines_out OUT);
+
 /******************************************************************************
  * DWARF parsing code.
  */
@@ -182,6 +220,356 @@ compare_lines(const void *a_in, const void *b_in)
     return 0;
 }
 
+static void
+fill_line_info(Dwarf_Addr pc, const char *file, Dwarf_Unsigned lineno,
+               Dwarf_Addr lineaddr, drsym_info_t *sym_info INOUT)
+{
+    /* Caller has provided space that we must copy the file into. */
+    sym_info->file_available_size = strlen(file);
+    if (sym_info->file != NULL) {
+        strncpy(sym_info->file, file, sym_info->file_size);
+        sym_info->file[sym_info->file_size - 1] = '\0';
+    }
+    sym_info->line = lineno;
+    sym_info->line_offs = (size_t)(pc - lineaddr);
+}
+
+/******************************************************************************
+ * Address-to-line index.
+ *
+ * Rather than re-walking the line program of a CU whenever a lookup targets a
+ * different CU than the previous one, we gather the rows of all CUs into a single
+ * array sorted by address that is binary searched.  As building the index still
+ * requires decoding every line program, it is optionally saved to an on-disk cache
+ * keyed by the build id of the module so that later processes can skip the parsing.
+ */
+
+static line_index_header_t *
+line_index_header(byte *index)
+{
+    return (line_index_header_t *)index;
+}
+
+static line_index_row_t *
+line_index_rows(byte *index)
+{
+    return (line_index_row_t *)(index + sizeof(line_index_header_t));
+}
+
+static uint64 *
+line_index_file_offs(byte *index)
+{
+    return (uint64 *)(line_index_rows(index) + line_index_header(index)->num_rows);
+}
+
+static const char *
+line_index_strings(byte *index)
+{
+    return (const char *)(line_index_file_offs(index) +
+                          line_index_header(index)->num_files);
+}
+
+/* Checks that an index read from the cache is consistent, as the file may be stale
+ * or truncated.
+ */
+static bool
+line_index_is_valid(byte *index, size_t size)
+{
+    line_index_header_t *hdr = line_index_header(index);
+    uint64 i, avail;
+    line_index_row_t *rows;
+    if (size < sizeof(*hdr) || hdr->magic != LINE_INDEX_MAGIC ||
+        hdr->version != LINE_INDEX_VERSION)
+        return false;
+    avail = size - sizeof(*hdr);
+    if (hdr->num_rows > avail / sizeof(line_index_row_t))
+        return false;
+    avail -= hdr->num_rows * sizeof(line_index_row_t);
+    if (hdr->num_files > avail / sizeof(uint64))
+        return false;
+    avail -= hdr->num_files * sizeof(uint64);
+    if (hdr->strings_size != avail || hdr->num_rows == 0 || hdr->strings_size == 0 ||
+        line_index_strings(index)[hdr->strings_size - 1] != '\0')
+        return false;
+    for (i = 0; i < hdr->num_files; i++) {
+        if (line_index_file_offs(index)[i] >= hdr->strings_size)
+            return false;
+    }
+    rows = line_index_rows(index);
+    for (i = 0; i < hdr->num_rows; i++) {
+        if (rows[i].file_idx >= hdr->num_files ||
+            (i > 0 && rows[i - 1].addr > rows[i].addr))
+            return false;
+    }
+    return true;
+}
+
+static bool
+line_index_cache_path(dwarf_module_t *mod, char path[MAXIMUM_PATH])
+{
+    if (line_cache_dir[0] == '\0' || mod->build_id == NULL || mod->build_id[0] == '\0')
+        return false;
+    dr_snprintf(path, MAXIMUM_PATH, "%s/%s.drsymline", line_cache_dir, mod->build_id);
+    path[MAXIMUM_PATH - 1] = '\0';
+    return true;
+}
+
+static bool
+line_index_load(dwarf_module_t *mod, const char *path)
+{
+    uint64 file_size;
+    bool ok = false;
+    file_t fd = dr_open_file(path, DR_FILE_READ);
+    if (fd == INVALID_FILE)
+        return false;
+    if (dr_file_size(fd, &file_size) && file_size >= sizeof(line_index_header_t) &&
+        file_size == (size_t)file_size) {
+        size_t size = (size_t)file_size;
+        byte *index = dr_global_alloc(size);
+        if (dr_read_file(fd, index, size) == (ssize_t)size &&
+            line_index_is_valid(index, size)) {
+            mod->line_index = index;
+            mod->line_index_size = size;
+            ok = true;
+        } else {
+            NOTIFY("%s: ignoring invalid line index cache %s\n", __FUNCTION__, path);
+            dr_global_free(index, size);
+        }
+    }
+    dr_close_file(fd);
+    return ok;
+}
+
+/* Writes to a temporary file first so that concurrent processes never read a
+ * partially written index.
+ */
+static void
+line_index_save(dwarf_module_t *mod, const char *path)
+{
+    char tmp_path[MAXIMUM_PATH];
+    bool ok;
+    file_t fd;
+    dr_snprintf(tmp_path, MAXIMUM_PATH, "%s.%d.tmp", path, (int)dr_get_process_id());
+    tmp_path[MAXIMUM_PATH - 1] = '\0';
+    fd = dr_open_file(tmp_path, DR_FILE_WRITE_OVERWRITE);
+    if (fd == INVALID_FILE) {
+        NOTIFY("%s: unable to create %s\n", __FUNCTION__, tmp_path);
+        return;
+    }
+    ok = dr_write_file(fd, mod->line_index, mod->line_index_size) ==
+        (ssize_t)mod->line_index_size;
+    dr_close_file(fd);
+    if (!ok || !dr_rename_file(tmp_path, path, true /*replace*/)) {
+        NOTIFY("%s: unable to write %s\n", __FUNCTION__, path);
+        dr_delete_file(tmp_path);
+    }
+}
+
+typedef struct _line_index_builder_t {
+    line_index_row_t *rows;
+    size_t num_rows;
+    size_t rows_capacity;
+    char **files;
+    size_t num_files;
+    size_t files_capacity;
+    size_t strings_size;
+    hashtable_t file_table; /* Maps a file name to its index plus one. */
+} line_index_builder_t;
+
+static void *
+grow_array(void *array, size_t elem_size, size_t count, size_t *capacity INOUT)
+{
+    size_t new_capacity = (*capacity == 0) ? 1024 : *capacity * 2;
+    void *new_array = dr_global_alloc(new_capacity * elem_size);
+    if (array != NULL) {
+        memcpy(new_array, array, count * elem_size);
+        dr_global_free(array, *capacity * elem_size);
+    }
+    *capacity = new_capacity;
+    return new_array;
+}
+
+static uint
+line_index_add_file(line_index_builder_t *builder, const char *file)
+{
+    size_t len;
+    char *copy;
+    void *found = hashtable_lookup(&builder->file_table, (void *)file);
+    if (found != NULL)
+        return (uint)((ptr_uint_t)found - 1);
+    if (builder->num_files == builder->files_capacity) {
+        builder->files = grow_array(builder->files, sizeof(*builder->files),
+                                    builder->num_files, &builder->files_capacity);
+    }
+    len = strlen(file) + 1;
+    copy = dr_global_alloc(len);
+    memcpy(copy, file, len);
+    builder->files[builder->num_files] = copy;
+    builder->strings_size += len;
+    hashtable_add(&builder->file_table, copy,
+                  (void *)(ptr_uint_t)(builder->num_files + 1));
+    return (uint)builder->num_files++;
+}
+
+static void
+line_index_add_cu(dwarf_module_t *mod, line_index_builder_t *builder, Dwarf_Die cu_die)
+{
+    Dwarf_Line *lines;
+    Dwarf_Signed num_lines, i;
+    Dwarf_Error de; /* expensive to init (DrM#1770) */
+
+    num_lines = get_lines_from_cu(mod, cu_die, &lines);
+    for (i = 0; i < num_lines; i++) {
+        char *file;
+        const char *name;
+        Dwarf_Unsigned lineno;
+        Dwarf_Addr lineaddr;
+        line_index_row_t *row;
+        /* Rows without an address cannot be searched, but we keep the rest. */
+        if (dwarf_lineaddr(lines[i], &lineaddr, &de) != DW_DLV_OK) {
+            NOTIFY_DWARF(de);
+            continue;
+        }
+        if (dwarf_linesrc(lines[i], &file, &de) == DW_DLV_OK)
+            name = file;
+        else {
+            NOTIFY_DWARF(de);
+            name = "";
+        }
+        if (dwarf_lineno(lines[i], &lineno, &de) != DW_DLV_OK) {
+            NOTIFY_DWARF(de);
+            lineno = 0;
+        }
+        if (builder->num_rows == builder->rows_capacity) {
+            builder->rows = grow_array(builder->rows, sizeof(*builder->rows),
+                                       builder->num_rows, &builder->rows_capacity);
+        }
+        row = &builder->rows[builder->num_rows++];
+        row->addr = lineaddr;
+        row->line = (uint)lineno;
+        row->file_idx = line_index_add_file(builder, name);
+    }
+}
+
+static int
+compare_index_rows(const void *a_in, const void *b_in)
+{
+    const line_index_row_t *a = (const line_index_row_t *)a_in;
+    const line_index_row_t *b = (const line_index_row_t *)b_in;
+    if (a->addr > b->addr)
+        return 1;
+    if (a->addr < b->addr)
+        return -1;
+    return 0;
+}
+
+static bool
+line_index_build(dwarf_module_t *mod)
+{
+    line_index_builder_t builder;
+    Dwarf_Error de; /* expensive to init (DrM#1770) */
+    Dwarf_Die cu_die;
+    Dwarf_Unsigned cu_offset = 0;
+    size_t i, offs;
+    line_index_header_t *hdr;
+    char *strings;
+
+    memset(&builder, 0, sizeof(builder));
+    hashtable_init_ex(&builder.file_table, LINE_INDEX_FILE_HASH_BITS, HASH_STRING,
+                      false /*!strdup*/, false /*!synch*/, NULL, NULL, NULL);
+
+    while (dwarf_next_cu_header(mod->dbg, NULL, NULL, NULL, NULL, &cu_offset, &de) ==
+           DW_DLV_OK) {
+        /* Scan forward in the tag soup for a CU DIE. */
+        cu_die = next_die_matching_tag(mod->dbg, DW_TAG_compile_unit);
+        if (cu_die != NULL)
+            line_index_add_cu(mod, &builder, cu_die);
+    }
+
+    if (builder.num_rows > 0) {
+        mod->line_index_size = sizeof(*hdr) + builder.num_rows * sizeof(*builder.rows) +
+            builder.num_files * sizeof(uint64) + builder.strings_size;
+        mod->line_index = dr_global_alloc(mod->line_index_size);
+        hdr = line_index_header(mod->line_index);
+        hdr->magic = LINE_INDEX_MAGIC;
+        hdr->version = LINE_INDEX_VERSION;
+        hdr->num_rows = builder.num_rows;
+        hdr->num_files = builder.num_files;
+        hdr->strings_size = builder.strings_size;
+        memcpy(line_index_rows(mod->line_index), builder.rows,
+               builder.num_rows * sizeof(*builder.rows));
+        qsort(line_index_rows(mod->line_index), builder.num_rows,
+              sizeof(*builder.rows), compare_index_rows);
+        strings = (char *)line_index_strings(mod->line_index);
+        for (i = 0, offs = 0; i < builder.num_files; i++) {
+            size_t len = strlen(builder.files[i]) + 1;
+            line_index_file_offs(mod->line_index)[i] = offs;
+            memcpy(strings + offs, builder.files[i], len);
+            offs += len;
+        }
+    }
+
+    hashtable_delete(&builder.file_table);
+    for (i = 0; i < builder.num_files; i++)
+        dr_global_free(builder.files[i], strlen(builder.files[i]) + 1);
+    if (builder.files != NULL)
+        dr_global_free(builder.files, builder.files_capacity * sizeof(*builder.files));
+    if (builder.rows != NULL)
+        dr_global_free(builder.rows, builder.rows_capacity * sizeof(*builder.rows));
+    return mod->line_index != NULL;
+}
+
+/* Returns whether the index is available, building or loading it if necessary. */
+static bool
+line_index_ensure(dwarf_module_t *mod)
+{
+    char cache_path[MAXIMUM_PATH];
+    bool use_cache;
+    if (mod->line_index != NULL)
+        return true;
+    if (mod->line_index_failed)
+        return false;
+    use_cache = line_index_cache_path(mod, cache_path);
+    if (use_cache && line_index_load(mod, cache_path)) {
+        NOTIFY("%s: loaded line index from %s\n", __FUNCTION__, cache_path);
+        return true;
+    }
+    if (!line_index_build(mod)) {
+        /* Fall back to searching CU by CU. */
+        mod->line_index_failed = true;
+        return false;
+    }
+    if (use_cache)
+        line_index_save(mod, cache_path);
+    return true;
+}
+
+static search_result_t
+search_addr2line_in_index(dwarf_module_t *mod, Dwarf_Addr pc,
+                          drsym_info_t *sym_info INOUT)
+{
+    line_index_row_t *rows = line_index_rows(mod->line_index);
+    size_t num_rows = (size_t)line_index_header(mod->line_index)->num_rows;
+    size_t lo = 0, hi = num_rows;
+    const char *file;
+
+    if (pc < rows[0].addr)
+        return SEARCH_NOT_FOUND;
+    /* Find the last row at or below pc. */
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (rows[mid].addr <= pc)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    file = line_index_strings(mod->line_index) +
+        line_index_file_offs(mod->line_index)[rows[lo].file_idx];
+    fill_line_info(pc, file, rows[lo].line, (Dwarf_Addr)rows[lo].addr, sym_info);
+    /* As with a CU search, the last row is only a possible fit. */
+    return (lo == num_rows - 1) ? SEARCH_MAYBE : SEARCH_FOUND;
+}
+
 /* Given a function DIE and a PC, fill out sym_info with line information.
  */
 bool
@@ -204,6 +592,9 @@ drsym_dwarf_search_addr2line(void *mod_in, Dwarf_Addr pc, drsym_info_t *sym_info
     sym_info->line = 0;
     sym_info->line_offs = 0;
 
+    if (line_index_ensure(mod))
+        return (search_addr2line_in_index(mod, pc, sym_info) != SEARCH_NOT_FOUND);
+
     /* First try cutting down the search space by finding the CU (i.e., the .c
      * file) that this function belongs to.
      */
@@ -331,16 +722,8 @@ search_addr2line_in_cu(dwarf_module_t *mod, Dwarf_Addr pc, Dwarf_Die cu_die,
             NOTIFY_DWARF(de);
             res = SEARCH_NOT_FOUND;
         } else {
-            /* File comes from .debug_str and therefore lives until
-             * drsym_exit, but caller has provided space that we must copy into.
-             */
-            sym_info->file_available_size = strlen(file);
-            if (sym_info->file != NULL) {
-                strncpy(sym_info->file, file, sym_info->file_size);
-                sym_info->file[sym_info->file_size - 1] = '\0';
-            }
-            sym_info->line = lineno;
-            sym_info->line_offs = (size_t)(pc - lineaddr);
+            /* File comes from .debug_str and therefore lives until drsym_exit. */
+            fill_line_info(pc, file, lineno, lineaddr, sym_info);
         }
     }
 
@@ -455,6 +838,8 @@ drsym_dwarf_exit(void *mod_in)
     dwarf_module_t *mod = (dwarf_module_t *)mod_in;
     if (mod->lines != NULL)
         dwarf_srclines_dealloc(mod->dbg, mod->lines, mod->num_lines);
+    if (mod->line_index != NULL)
+        dr_global_free(mod->line_index, mod->line_index_size);
     dwarf_finish(mod->dbg, NULL);
     dr_global_free(mod, sizeof(*mod));
 }
@@ -473,6 +858,24 @@ drsym_dwarf_set_load_base(void *mod_in, byte *load_base)
     mod->load_base = load_base;
 }
 
+void
+drsym_dwarf_set_build_id(void *mod_in, const char *build_id)
+{
+    dwarf_module_t *mod = (dwarf_module_t *)mod_in;
+    mod->build_id = build_id;
+}
+
+void
+drsym_dwarf_set_line_cache_dir(const char *dir)
+{
+    if (dir == NULL)
+        line_cache_dir[0] = '\0';
+    else {
+        dr_snprintf(line_cache_dir, MAXIMUM_PATH, "%s", dir);
+        line_cache_dir[MAXIMUM_PATH - 1] = '\0';
+    }
+}
+
 #if defined(WINDOWS) && defined(STATIC_LIB)
 /* if we build as a static library with "/MT /link /nodefaultlib libcmt.lib",
  * somehow we're missing strdup
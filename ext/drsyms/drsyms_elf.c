@@ -43,24 +43,16 @@
 #include "dwarf.h"
 #include "libdwarf.h"
 
+#include <stdlib.h> /* qsort */
 #include <string.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <errno.h>
-#include <limits.h>
 
 #ifndef MIN
 #    define MIN(x, y) ((x) <= (y) ? (x) : (y))
 #endif
 
-#ifndef SIZE_T_MAX
-#    ifdef X64
-#        define SIZE_T_MAX ULLONG_MAX
-#    else
-#        define SIZE_T_MAX UINT_MAX
-#    endif
-#endif
-
 static bool verbose = 0;
 
 #undef NOTIFY
@@ -118,11 +110,23 @@ static bool verbose = 0;
 #    define ELF_ST_TYPE ELF32_ST_TYPE
 #endif
 
+/* An entry of the address-sorted symbol index used by drsym_obj_addrsearch_symtab(). */
+typedef struct _sym_range_t {
+    size_t lo_offs;
+    size_t hi_offs;
+    /* The maximum hi_offs of this and all preceding entries, which bounds how far
+     * back a search must go to find all ranges containing an offset.
+     */
+    size_t max_hi_offs;
+    uint idx;
+} sym_range_t;
+
 typedef struct _elf_info_t {
     Elf *elf;
     Elf_Sym *syms;
     int strtab_idx;
     int num_syms;
+    sym_range_t *sym_ranges; /* Built upon the first address search. */
     byte *map_base;
     ptr_uint_t load_base;
     drsym_debug_kind_t debug_kind;
@@ -344,6 +348,8 @@ drsym_obj_mod_exit(void *mod_in)
         return;
     if (mod->elf != NULL)
         elf_end(mod->elf);
+    if (mod->sym_ranges != NULL)
+        dr_global_free(mod->sym_ranges, mod->num_syms * sizeof(*mod->sym_ranges));
     dr_global_free(mod, sizeof(*mod));
 }
 
@@ -432,46 +438,99 @@ drsym_obj_symbol_offs(void *mod_in, uint idx, size_t *offs_start OUT,
     return DRSYM_SUCCESS;
 }
 
+static int
+compare_sym_ranges(const void *a_in, const void *b_in)
+{
+    const sym_range_t *a = (const sym_range_t *)a_in;
+    const sym_range_t *b = (const sym_range_t *)b_in;
+    if (a->lo_offs != b->lo_offs)
+        return (a->lo_offs > b->lo_offs) ? 1 : -1;
+    /* Break ties by symbol table order to match a linear search. */
+    if (a->idx != b->idx)
+        return (a->idx > b->idx) ? 1 : -1;
+    return 0;
+}
+
+static void
+build_sym_ranges(elf_info_t *mod)
+{
+    int i;
+    mod->sym_ranges = dr_global_alloc(mod->num_syms * sizeof(*mod->sym_ranges));
+    for (i = 0; i < mod->num_syms; i++) {
+        mod->sym_ranges[i].lo_offs = mod->syms[i].st_value - mod->load_base;
+        mod->sym_ranges[i].hi_offs = mod->sym_ranges[i].lo_offs + mod->syms[i].st_size;
+        mod->sym_ranges[i].idx = i;
+    }
+    qsort(mod->sym_ranges, mod->num_syms, sizeof(*mod->sym_ranges), compare_sym_ranges);
+    for (i = 0; i < mod->num_syms; i++) {
+        mod->sym_ranges[i].max_hi_offs = mod->sym_ranges[i].hi_offs;
+        if (i > 0 && mod->sym_ranges[i - 1].max_hi_offs > mod->sym_ranges[i].max_hi_offs)
+            mod->sym_ranges[i].max_hi_offs = mod->sym_ranges[i - 1].max_hi_offs;
+    }
+}
+
+/* Returns the same symbol as walking the symbol table in order would, using a binary
+ * search over symbols sorted by address.
+ */
 drsym_error_t
 drsym_obj_addrsearch_symtab(void *mod_in, size_t modoffs, uint *idx OUT)
 {
     elf_info_t *mod = (elf_info_t *)mod_in;
-    int i;
-    int closest_idx = -1;
-    size_t closest_diff = SIZE_T_MAX;
+    int lo, hi, i;
+    int containing_idx = -1;
+    int closest_idx;
 
     if (mod == NULL || mod->syms == NULL || idx == NULL)
         return DRSYM_ERROR;
 
     NOTIFY(1, "%s: +" PIFX "\n", __FUNCTION__, modoffs);
+    if (mod->num_syms <= 0)
+        return DRSYM_ERROR_SYMBOL_NOT_FOUND;
+    if (mod->sym_ranges == NULL)
+        build_sym_ranges(mod);
+
+    /* Find the number of symbols starting at or below modoffs. */
+    lo = 0;
+    hi = mod->num_syms;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (mod->sym_ranges[mid].lo_offs <= modoffs)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == 0)
+        return DRSYM_ERROR_SYMBOL_NOT_FOUND;
+
     /* XXX: if a function is split into non-contiguous pieces, will it
      * have multiple entries?
      */
-    for (i = 0; i < mod->num_syms; i++) {
-        size_t lo_offs = mod->syms[i].st_value - mod->load_base;
-        size_t hi_offs = lo_offs + mod->syms[i].st_size;
-        NOTIFY(3, "\tcomparing +" PIFX " to " PIFX "-" PIFX "\n", modoffs, lo_offs,
-               hi_offs);
-        if (lo_offs <= modoffs && modoffs < hi_offs) {
-            NOTIFY(2, "\tfound +" PIFX " in " PIFX "-" PIFX "\n", modoffs, lo_offs,
-                   hi_offs);
-            *idx = i;
-            return DRSYM_SUCCESS;
-        }
-        /* i#1337: handle st_size==0 asm routines */
-        if (modoffs >= lo_offs) {
-            if (modoffs - lo_offs < closest_diff) {
-                closest_idx = i;
-                closest_diff = modoffs - lo_offs;
-                NOTIFY(3, "\tclosest diff is now " PIFX "\n", closest_diff);
-            }
-        }
+    for (i = lo - 1; i >= 0 && mod->sym_ranges[i].max_hi_offs > modoffs; i--) {
+        sym_range_t *range = &mod->sym_ranges[i];
+        NOTIFY(3, "\tcomparing +" PIFX " to " PIFX "-" PIFX "\n", modoffs,
+               range->lo_offs, range->hi_offs);
+        if (modoffs < range->hi_offs &&
+            (containing_idx < 0 || range->idx < (uint)containing_idx))
+            containing_idx = range->idx;
+    }
+    if (containing_idx >= 0) {
+        NOTIFY(2, "\tfound +" PIFX " in symbol %d\n", modoffs, containing_idx);
+        *idx = containing_idx;
+        return DRSYM_SUCCESS;
     }
 
-    if (closest_idx >= 0 && mod->syms[closest_idx].st_size == 0) {
+    /* i#1337: handle st_size==0 asm routines by using the closest preceding
+     * symbol, which is the first of the entries sharing the highest start.
+     */
+    for (i = lo - 1;
+         i > 0 && mod->sym_ranges[i - 1].lo_offs == mod->sym_ranges[lo - 1].lo_offs; i--)
+        ; /* empty */
+    closest_idx = mod->sym_ranges[i].idx;
+    if (mod->syms[closest_idx].st_size == 0) {
         /* i#1337: rule out anything without a name */
         const char *name = drsym_obj_symbol_name(mod_in, closest_idx);
-        NOTIFY(2, "\tusing closest +" PIFX " diff " PIFX "\n", modoffs, closest_diff);
+        NOTIFY(2, "\tusing closest +" PIFX " diff " PIFX "\n", modoffs,
+               modoffs - mod->sym_ranges[i].lo_offs);
         if (name != NULL && name[0] != '\0') {
             *idx = closest_idx;
             return DRSYM_SUCCESS;
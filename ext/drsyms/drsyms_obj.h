@@ -120,6 +120,12 @@ drsym_dwarf_set_obj_offs(void *mod_in, ssize_t adjust);
 void
 drsym_dwarf_set_load_base(void *mod_in, byte *load_base);
 
+void
+drsym_dwarf_set_build_id(void *mod_in, const char *build_id);
+
+void
+drsym_dwarf_set_line_cache_dir(const char *dir);
+
 bool
 drsym_dwarf_search_addr2line(void *mod_in, Dwarf_Addr pc, drsym_info_t *sym_info INOUT);
 
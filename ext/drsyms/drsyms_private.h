@@ -131,4 +131,7 @@ drsym_unix_get_module_debug_kind(void *moddata, drsym_debug_kind_t *kind OUT);
 drsym_error_t
 drsym_unix_enumerate_lines(void *mod_in, drsym_enumerate_lines_cb callback, void *data);
 
+void
+drsym_unix_set_line_cache_dir(const char *dir);
+
 #endif /* DRSYMS_PRIVATE_H */
@@ -151,6 +151,7 @@ load_module(const char *modpath)
     config.resizable = true;
     config.resize_threshold = 70;
     config.free_key_func = drsym_free_hash_key;
+    config.open_address = false;
     hashtable_configure(&mod->symtable, &config);
 
     /* We need to partially initialize in order to get the debug info */
@@ -221,6 +222,7 @@ load_module(const char *modpath)
             /* i#1433: obj_info->load_base is initialized in drsym_obj_mod_init_post */
             drsym_dwarf_set_load_base(mod->dwarf_info,
                                       drsym_obj_load_base(mod->obj_info));
+            drsym_dwarf_set_build_id(mod->dwarf_info, drsym_obj_build_id(mod->obj_info));
         }
     }
 
@@ -712,6 +714,12 @@ drsym_unix_enumerate_lines(void *mod_in, drsym_enumerate_lines_cb callback, void
         return DRSYM_ERROR_LINE_NOT_AVAILABLE;
 }
 
+void
+drsym_unix_set_line_cache_dir(const char *dir)
+{
+    drsym_dwarf_set_line_cache_dir(dir);
+}
+
 drsym_error_t
 drsym_unix_get_type(void *mod_in, size_t modoffs, uint levels_to_expand, char *buf,
                     size_t buf_sz, drsym_type_t **type OUT)
@@ -1866,3 +1866,18 @@ drsym_enumerate_lines(const char *modpath, drsym_enumerate_lines_cb callback, vo
         return drsym_enumerate_lines_local(modpath, callback, data);
     }
 }
+
+DR_EXPORT
+drsym_error_t
+drsym_set_line_cache_dir(const char *dir)
+{
+    if (IS_SIDELINE) {
+        return DRSYM_ERROR_NOT_IMPLEMENTED;
+    } else {
+        /* Only DWARF modules read via drsyms_unix_common.c use the index. */
+        dr_recurlock_lock(symbol_lock);
+        drsym_unix_set_line_cache_dir(dir);
+        dr_recurlock_unlock(symbol_lock);
+        return DRSYM_SUCCESS;
+    }
+}
@@ -27,6 +27,7 @@
 #include "dr_api.h"
 #include "drwrap.h"
 #include "drmgr.h"
+#include "drreg.h"
 #include "hashtable.h"
 #include "drvector.h"
 #include "../ext_utils.h"
@@ -196,6 +197,50 @@ wrap_entry_free(void *v)
     }
 }
 
+/* Lean wraps (drwrap_wrap_lean()): func => lean_entry_t */
+typedef struct _lean_entry_t {
+    app_pc func;
+    uint num_args;
+    bool record_retval;
+    drwrap_callconv_t callconv;
+} lean_entry_t;
+
+#define LEAN_TABLE_HASH_BITS 6
+/* Protected by wrap_lock */
+static hashtable_t lean_table;
+/* Lets the bb event skip the table lookups when there are no lean wraps.
+ * Written under wrap_lock.
+ */
+static uint lean_wrap_count;
+
+/* Post-call points of lean wraps: pc => lean_post_t */
+typedef struct _lean_post_t {
+    app_pc pc;
+    /* NULL once drwrap_unwrap_lean() is called for the callee */
+    app_pc func;
+} lean_post_t;
+
+#define LEAN_POST_TABLE_HASH_BITS 8
+/* Protected by wrap_lock */
+static hashtable_t lean_post_table;
+
+#define LEAN_DEFAULT_RECORDS_PER_THREAD 4096
+static void (*lean_batch_cb)(void *drcontext, drwrap_lean_record_t *records,
+                             uint num_records);
+static uint lean_records_per_thread;
+
+static void
+lean_entry_free(void *v)
+{
+    dr_global_free(v, sizeof(lean_entry_t));
+}
+
+static void
+lean_post_free(void *v)
+{
+    dr_global_free(v, sizeof(lean_post_t));
+}
+
 /* TLS.  OK to be callback-shared: just more nesting. */
 static int tls_idx;
 
@@ -238,6 +283,15 @@ typedef struct _per_thread_t {
     bool hit_exception;
 #endif
     app_pc retaddr[MAX_WRAP_NESTING];
+    /* Lean wrap records.  Inlined code writes the next record at lean_cur and
+     * calls drwrap_lean_buffer_full() once lean_left reaches 0.  Until that
+     * first happens, the buffer is just lean_initial and lean_buf is NULL.
+     */
+    drwrap_lean_record_t *lean_cur;
+    ptr_uint_t lean_left;
+    drwrap_lean_record_t *lean_buf;
+    uint lean_buf_records;
+    drwrap_lean_record_t lean_initial;
 } per_thread_t;
 
 /***************************************************************************
@@ -270,17 +324,28 @@ fast_safe_read(void *base, size_t size, void *out_buf)
  * WRAPPING INSTRUMENTATION TRACKING
  */
 
-/* Hashtable so we can remember post-call pcs (since
- * post-cti-instrumentation is not supported by DR).
- * Synchronized externally to safeguard the externally-allocated payload,
- * using an rwlock b/c read on every instruction.
+/* Table so we can remember post-call pcs (since post-cti-instrumentation is
+ * not supported by DR).  It is queried for every new block, by every thread
+ * building blocks, so lookups take no lock: see post_call_find().  Changes are
+ * made under the write lock of post_call_rwlock.
+ *
+ * The table is open-addressed with entries stored inline.  Removal only
+ * clears "live": the slot keeps its pc so that probe chains stay intact, and is
+ * reused by a later add of the same pc or of a pc whose probe passes it.  When
+ * the table fills up, a new one is built from the live entries and published
+ * with an atomic store.  The old one is retired, as a lookup may still be
+ * walking it, and is freed after the next dr_flush_region() synch, by which
+ * time every thread has left any lookup it was in.
  */
 #define POST_CALL_TABLE_HASH_BITS 10
-/* i#1689: we store the aligned (LSB=0) pc here */
-static hashtable_t post_call_table;
-static void *post_call_rwlock;
+/* Rebuild once this % of slots has been claimed */
+#define POST_CALL_TABLE_LOAD 50
 
 typedef struct _post_call_entry_t {
+    /* i#1689: we store the aligned (LSB=0) pc here.  NULL for an unclaimed slot. */
+    app_pc pc;
+    /* Set, via an atomic store, only once the fields below are filled in */
+    volatile int live;
     /* PR 454616: we need two flags in the post_call_table: one that
      * says "please add instru for this callee" and one saying "all
      * existing fragments have instru"
@@ -299,6 +364,34 @@ typedef struct _post_call_entry_t {
     byte prior[POST_CALL_PRIOR_BYTES_STORED];
 } post_call_entry_t;
 
+typedef struct _post_call_table_t {
+    uint bits;
+    uint entries; /* live entries */
+    uint claimed; /* slots with a pc, live or not */
+    uint retired_gen;
+    struct _post_call_table_t *retired_next;
+    post_call_entry_t *slots;
+} post_call_table_t;
+
+/* Read with atomic loads; written under the post_call_rwlock write lock */
+static post_call_table_t *post_call_table;
+/* Earlier tables, newest first, awaiting a synch to be freed.  Protected by
+ * post_call_rwlock, as is the count of tables ever retired.
+ */
+static post_call_table_t *post_call_retired;
+static uint post_call_retired_gen;
+static void *post_call_rwlock;
+
+#ifdef X64
+#    define atomic_load_ptr(src) ((void *)dr_atomic_load64((volatile int64 *)(src)))
+#    define atomic_store_ptr(dst, val) \
+        dr_atomic_store64((volatile int64 *)(dst), (int64)(ptr_int_t)(val))
+#else
+#    define atomic_load_ptr(src) ((void *)dr_atomic_load32((volatile int *)(src)))
+#    define atomic_store_ptr(dst, val) \
+        dr_atomic_store32((volatile int *)(dst), (int)(ptr_int_t)(val))
+#endif
+
 /* Support for external post-call caching */
 typedef struct _post_call_notify_t {
     void (*cb)(app_pc);
@@ -315,30 +408,152 @@ static uint postcall_cache_idx;
 #define POSTCALL_CACHE_SIZE 8
 static app_pc postcall_cache[POSTCALL_CACHE_SIZE];
 
+static inline uint
+post_call_hash(app_pc pc, uint bits)
+{
+    uint val = (uint)(ptr_uint_t)pc ^ (uint)((ptr_uint_t)pc >> 16);
+    return (val * 0x9e3779b1U) >> (32 - bits);
+}
+
+static post_call_table_t *
+post_call_table_create(uint bits)
+{
+    post_call_table_t *t = (post_call_table_t *)dr_global_alloc(sizeof(*t));
+    size_t sz = sizeof(post_call_entry_t) << bits;
+    t->bits = bits;
+    t->entries = 0;
+    t->claimed = 0;
+    t->retired_gen = 0;
+    t->retired_next = NULL;
+    t->slots = (post_call_entry_t *)dr_global_alloc(sz);
+    memset(t->slots, 0, sz);
+    return t;
+}
+
 static void
-post_call_entry_free(void *v)
+post_call_table_free(post_call_table_t *t)
 {
-    post_call_entry_t *e = (post_call_entry_t *)v;
-    ASSERT(e != NULL, "invalid hashtable deletion");
-    dr_global_free(e, sizeof(*e));
+    dr_global_free(t->slots, sizeof(post_call_entry_t) << t->bits);
+    dr_global_free(t, sizeof(*t));
+}
+
+/* Returns the live entry for pc, or NULL.  Takes no lock: a concurrent change
+ * is either seen or not, and callers that act on a missing or inconsistent
+ * entry re-check under the write lock.
+ */
+static post_call_entry_t *
+post_call_find(app_pc pc)
+{
+    post_call_table_t *t = (post_call_table_t *)atomic_load_ptr(&post_call_table);
+    uint mask = (1U << t->bits) - 1;
+    uint i = post_call_hash(pc, t->bits);
+    uint probes;
+    for (probes = 0; probes <= mask; probes++) {
+        post_call_entry_t *e = &t->slots[i];
+        app_pc slot_pc = (app_pc)atomic_load_ptr(&e->pc);
+        if (slot_pc == NULL)
+            break;
+        if (slot_pc == pc) {
+            /* A dead slot can be reused for another pc: re-check the pc once we
+             * have seen the entry live, as it is published before live is set.
+             */
+            if (dr_atomic_load32(&e->live) == 0 ||
+                (app_pc)atomic_load_ptr(&e->pc) != pc)
+                return NULL;
+            return e;
+        }
+        i = (i + 1) & mask;
+    }
+    return NULL;
+}
+
+/* caller must hold write lock.  Returns pc's slot in t, else the first dead
+ * slot on its probe, else claims a new one; t must not be full.
+ */
+static post_call_entry_t *
+post_call_table_claim(post_call_table_t *t, app_pc pc)
+{
+    uint mask = (1U << t->bits) - 1;
+    uint i = post_call_hash(pc, t->bits);
+    post_call_entry_t *dead = NULL;
+    for (;;) {
+        post_call_entry_t *e = &t->slots[i];
+        if (e->pc == pc)
+            return e;
+        if (e->pc == NULL) {
+            if (dead != NULL)
+                return dead;
+            t->claimed++;
+            return e;
+        }
+        if (dead == NULL && !e->live)
+            dead = e;
+        i = (i + 1) & mask;
+    }
+}
+
+/* caller must hold write lock.  Makes room to claim one more slot. */
+static void
+post_call_table_check_for_resize(void)
+{
+    post_call_table_t *old = post_call_table, *t;
+    uint i, bits = old->bits;
+    if ((old->claimed + 1) * 100 <= POST_CALL_TABLE_LOAD << old->bits)
+        return;
+    /* Size for the live entries alone: removed ones are dropped here. */
+    while ((old->entries + 1) * 100 * 2 > POST_CALL_TABLE_LOAD << bits)
+        bits++;
+    t = post_call_table_create(bits);
+    for (i = 0; i < (1U << old->bits); i++) {
+        if (old->slots[i].live) {
+            post_call_entry_t *e = post_call_table_claim(t, old->slots[i].pc);
+            *e = old->slots[i];
+            t->entries++;
+        }
+    }
+    atomic_store_ptr(&post_call_table, t);
+    old->retired_gen = ++post_call_retired_gen;
+    old->retired_next = post_call_retired;
+    post_call_retired = old;
+}
+
+/* caller must hold write lock.  Frees the tables retired up through generation
+ * gen.  Only safe once every thread has passed a synch point since gen was
+ * read, so that none can still be walking them.
+ */
+static void
+post_call_retired_free(uint gen)
+{
+    post_call_table_t **prev = &post_call_retired;
+    while (*prev != NULL && (*prev)->retired_gen > gen)
+        prev = &(*prev)->retired_next;
+    while (*prev != NULL) {
+        post_call_table_t *next = (*prev)->retired_next;
+        post_call_table_free(*prev);
+        *prev = next;
+    }
 }
 
 /* caller must hold write lock */
 static post_call_entry_t *
 post_call_entry_add(app_pc postcall, bool external)
 {
-    post_call_entry_t *e = (post_call_entry_t *)dr_global_alloc(sizeof(*e));
+    post_call_entry_t *e;
     ASSERT(dr_rwlock_self_owns_write_lock(post_call_rwlock), "must hold write lock");
+    post_call_table_check_for_resize();
+    e = post_call_table_claim(post_call_table, postcall);
+    if (e->live)
+        return NULL;
     e->existing_instrumented = false;
     if (!fast_safe_read(postcall - POST_CALL_PRIOR_BYTES_STORED,
                         POST_CALL_PRIOR_BYTES_STORED, e->prior)) {
         /* notify client somehow?  we'll carry on and invalidate on next bb */
         memset(e->prior, 0, sizeof(e->prior));
     }
-    if (!hashtable_add(&post_call_table, (void *)postcall, (void *)e)) {
-        post_call_entry_free(e);
-        return NULL;
-    }
+    /* Publish the pc and then the entry, in that order, for post_call_find() */
+    atomic_store_ptr(&e->pc, postcall);
+    dr_atomic_store32(&e->live, 1);
+    post_call_table->entries++;
     if (!external && post_call_notify_list != NULL) {
         post_call_notify_t *cb = post_call_notify_list;
         while (cb != NULL) {
@@ -349,7 +564,20 @@ post_call_entry_add(app_pc postcall, bool external)
     return e;
 }
 
-/* caller must hold post_call_rwlock read lock or write lock */
+/* caller must hold write lock */
+static void
+post_call_entry_remove(post_call_entry_t *e)
+{
+    ASSERT(dr_rwlock_self_owns_write_lock(post_call_rwlock), "must hold write lock");
+    ASSERT(e->live, "removing a removed entry");
+    dr_atomic_store32(&e->live, 0);
+    post_call_table->entries--;
+}
+
+/* May be called without a lock, in which case a torn read of e->prior from a
+ * racing re-add looks inconsistent: callers must re-check under the write lock
+ * before acting on that.
+ */
 static bool
 post_call_consistent(app_pc postcall, post_call_entry_t *e)
 {
@@ -373,11 +601,7 @@ post_call_consistent(app_pc postcall, post_call_entry_t *e)
 static bool
 post_call_lookup(app_pc pc)
 {
-    bool res = false;
-    dr_rwlock_read_lock(post_call_rwlock);
-    res = (hashtable_lookup(&post_call_table, (void *)pc) != NULL);
-    dr_rwlock_read_unlock(post_call_rwlock);
-    return res;
+    return post_call_find(pc) != NULL;
 }
 #endif
 
@@ -386,27 +610,36 @@ static bool
 post_call_lookup_for_instru(app_pc pc)
 {
     bool res = false;
-    post_call_entry_t *e;
-    dr_rwlock_read_lock(post_call_rwlock);
-    e = (post_call_entry_t *)hashtable_lookup(&post_call_table, (void *)pc);
+    post_call_entry_t *e = post_call_find(pc);
     if (e != NULL) {
         res = post_call_consistent(pc, e);
         if (!res) {
             int i;
-            /* need the write lock */
-            dr_rwlock_read_unlock(post_call_rwlock);
-            e = NULL; /* no longer safe */
+            /* need the write lock, and to re-check as we looked without a lock */
             dr_rwlock_write_lock(post_call_rwlock);
+            e = post_call_find(pc);
             /* might not be found now if racily removed: but that's fine */
-            hashtable_remove(&post_call_table, (void *)pc);
-            /* invalidate cache */
-            for (i = 0; i < POSTCALL_CACHE_SIZE; i++) {
-                if (pc == postcall_cache[i])
-                    postcall_cache[i] = NULL;
+            if (e != NULL) {
+                res = post_call_consistent(pc, e);
+                if (!res)
+                    post_call_entry_remove(e);
+                else
+                    e->existing_instrumented = true;
+            }
+            if (!res) {
+                /* invalidate cache */
+                for (i = 0; i < POSTCALL_CACHE_SIZE; i++) {
+                    if (pc == postcall_cache[i])
+                        postcall_cache[i] = NULL;
+                }
             }
             dr_rwlock_write_unlock(post_call_rwlock);
             return res;
         } else {
+            /* This store is racy w/o a lock: if the table is concurrently
+             * rebuilt it can be lost, costing a later re-check and at worst
+             * a redundant flush in drwrap_mark_retaddr_for_instru().
+             */
             e->existing_instrumented = true;
         }
     }
@@ -419,7 +652,6 @@ post_call_lookup_for_instru(app_pc pc)
      * we'll execute it along w/ the next post-hook b/c of our stored esp.
      * That seems sufficient.
      */
-    dr_rwlock_read_unlock(post_call_rwlock);
     return res;
 }
 
@@ -916,6 +1148,11 @@ drwrap_init(void)
                                      NULL, NULL, DRMGR_PRIORITY_APP2APP_DRWRAP };
     drmgr_priority_t pri_insert = { sizeof(pri_insert), DRMGR_PRIORITY_NAME_DRWRAP, NULL,
                                     NULL, DRMGR_PRIORITY_INSERT_DRWRAP };
+    /* The replace table is queried on every new block, so we store it inline
+     * for fewer cache misses.
+     */
+    hashtable_config_t open_address_config = { sizeof(open_address_config), true, 75,
+                                               NULL, true /*open_address*/ };
 #ifdef WINDOWS
     /* DrMem i#1098: We use a late priority so we don't unwind if the client
      * handles the fault.
@@ -946,14 +1183,17 @@ drwrap_init(void)
 
     hashtable_init(&replace_table, REPLACE_TABLE_HASH_BITS, HASH_INTPTR,
                    false /*!strdup*/);
+    hashtable_configure(&replace_table, &open_address_config);
     hashtable_init_ex(&replace_native_table, REPLACE_NATIVE_TABLE_HASH_BITS, HASH_INTPTR,
                       false /*!strdup*/, false /*!synch*/, replace_native_free, NULL,
                       NULL);
     hashtable_init_ex(&wrap_table, WRAP_TABLE_HASH_BITS, HASH_INTPTR, false /*!str_dup*/,
                       false /*!synch*/, wrap_entry_free, NULL, NULL);
-    hashtable_init_ex(&post_call_table, POST_CALL_TABLE_HASH_BITS, HASH_INTPTR,
-                      false /*!str_dup*/, false /*!synch*/, post_call_entry_free, NULL,
-                      NULL);
+    post_call_table = post_call_table_create(POST_CALL_TABLE_HASH_BITS);
+    hashtable_init_ex(&lean_table, LEAN_TABLE_HASH_BITS, HASH_INTPTR, false /*!str_dup*/,
+                      false /*!synch*/, lean_entry_free, NULL, NULL);
+    hashtable_init_ex(&lean_post_table, LEAN_POST_TABLE_HASH_BITS, HASH_INTPTR,
+                      false /*!str_dup*/, false /*!synch*/, lean_post_free, NULL, NULL);
     post_call_rwlock = dr_rwlock_create();
     wrap_lock = dr_recurlock_create();
     drmgr_register_module_unload_event(drwrap_event_module_unload);
@@ -1012,7 +1252,22 @@ drwrap_exit(void)
     hashtable_delete(&replace_table);
     hashtable_delete(&replace_native_table);
     hashtable_delete(&wrap_table);
-    hashtable_delete(&post_call_table);
+    post_call_table_free(post_call_table);
+    post_call_table = NULL;
+    while (post_call_retired != NULL) {
+        post_call_table_t *next = post_call_retired->retired_next;
+        post_call_table_free(post_call_retired);
+        post_call_retired = next;
+    }
+    post_call_retired_gen = 0;
+    hashtable_delete(&lean_table);
+    hashtable_delete(&lean_post_table);
+    lean_wrap_count = 0;
+#ifdef X86
+    if (lean_batch_cb != NULL && drreg_exit() != DRREG_SUCCESS)
+        ASSERT(false, "failed to exit drreg in drwrap_exit");
+#endif
+    lean_batch_cb = NULL;
     dr_rwlock_destroy(post_call_rwlock);
     dr_recurlock_destroy(wrap_lock);
     drmgr_exit();
@@ -1030,9 +1285,23 @@ drwrap_thread_init(void *drcontext)
     per_thread_t *pt = (per_thread_t *)dr_thread_alloc(drcontext, sizeof(*pt));
     memset(pt, 0, sizeof(*pt));
     pt->wrap_level = -1;
+    pt->lean_cur = &pt->lean_initial;
+    pt->lean_left = 1;
     drmgr_set_tls_field(drcontext, tls_idx, (void *)pt);
 }
 
+/* Passes the records in pt's lean buffer to the client */
+static void
+drwrap_lean_deliver(void *drcontext, per_thread_t *pt)
+{
+    drwrap_lean_record_t *base = pt->lean_buf == NULL ? &pt->lean_initial : pt->lean_buf;
+    uint count = (uint)(pt->lean_cur - base);
+    if (count > 0 && lean_batch_cb != NULL)
+        (*lean_batch_cb)(drcontext, base, count);
+    pt->lean_cur = base;
+    pt->lean_left = pt->lean_buf == NULL ? 1 : pt->lean_buf_records;
+}
+
 static void
 drwrap_free_user_data(void *drcontext, per_thread_t *pt, int i)
 {
@@ -1061,6 +1330,11 @@ drwrap_thread_exit(void *drcontext)
     for (i = 0; i < MAX_WRAP_NESTING; i++) {
         drwrap_free_user_data(drcontext, pt, i);
     }
+    drwrap_lean_deliver(drcontext, pt);
+    if (pt->lean_buf != NULL) {
+        dr_thread_free(drcontext, pt->lean_buf,
+                       pt->lean_buf_records * sizeof(drwrap_lean_record_t));
+    }
     dr_thread_free(drcontext, pt, sizeof(*pt));
 }
 
@@ -1718,7 +1992,7 @@ drwrap_mark_retaddr_for_instru(void *drcontext, app_pc decorated_pc,
      */
     /* Ensure we have the retaddr instrumented for post-call events */
     dr_rwlock_write_lock(post_call_rwlock);
-    e = (post_call_entry_t *)hashtable_lookup(&post_call_table, (void *)retaddr);
+    e = post_call_find(retaddr);
     /* PR 454616: we may have added an entry and started a flush
      * but not finished the flush, so we check not just the entry
      * but also the existing_instrumented flag.
@@ -1739,6 +2013,8 @@ drwrap_mark_retaddr_for_instru(void *drcontext, app_pc decorated_pc,
          */
         /* XXX: we're assuming void* tag == pc */
         if (dr_fragment_exists_at(drcontext, (void *)retaddr)) {
+            /* Tables retired before the flush can be freed once its synch is done */
+            uint retired_gen = post_call_retired_gen;
             /* XXX: I'd use dr_unlink_flush_region but it requires -enable_full_api.
              * should we dynamically check and use it if we can?
              */
@@ -1757,12 +2033,14 @@ drwrap_mark_retaddr_for_instru(void *drcontext, app_pc decorated_pc,
             dr_flush_region(retaddr, 1);
             /* now we are guaranteed no thread is inside the fragment */
             /* another thread may have done a racy competing flush: should be fine */
-            dr_rwlock_read_lock(post_call_rwlock);
-            e = (post_call_entry_t *)hashtable_lookup(&post_call_table, (void *)retaddr);
+            /* The write lock ensures the table is not being rebuilt under us */
+            dr_rwlock_write_lock(post_call_rwlock);
+            e = post_call_find(retaddr);
             if (e != NULL) /* selfmod could disappear once have PR 408529 */
                 e->existing_instrumented = true;
+            post_call_retired_free(retired_gen);
             /* XXX DrMem i#553: if e==NULL, recursion count could get off */
-            dr_rwlock_read_unlock(post_call_rwlock);
+            dr_rwlock_write_unlock(post_call_rwlock);
             /* Since the flush may remove the fragment we're already in,
              * we have to redirect execution to the callee again.
              */
@@ -1842,7 +2120,7 @@ drwrap_ensure_postcall(void *drcontext, per_thread_t *pt, wrap_entry_t *wrap,
         postcall_cache_idx = 0;
     postcall_cache[postcall_cache_idx] = retaddr;
 
-    if (hashtable_lookup(&post_call_table, (void *)retaddr) == NULL) {
+    if (post_call_find(retaddr) == NULL) {
         bool enabled = wrap->enabled;
         /* this function may not return: but in that case it will redirect
          * and we'll come back here to do the wrapping.
@@ -2267,6 +2545,421 @@ drwrap_insert_post_call(void *drcontext, instrlist_t *bb, instr_t *where,
                             opnd_create_reg(DR_REG_XSP));
 }
 
+/***************************************************************************
+ * LEAN WRAPPING
+ */
+
+DR_EXPORT
+bool
+drwrap_set_lean_callback(void (*batch_cb)(void *drcontext, drwrap_lean_record_t *records,
+                                          uint num_records),
+                         uint records_per_thread)
+{
+    if (batch_cb == NULL || lean_batch_cb != NULL)
+        return false;
+#ifdef X86
+    /* The library model: just ensure drreg is initialized, with the 2 registers
+     * the inlined code needs plus one slot for the flags.
+     */
+    drreg_options_t ops = { sizeof(ops), 3 /*max slots needed*/, false, NULL,
+                            true /*do_not_sum_slots*/ };
+    if (drreg_init(&ops) != DRREG_SUCCESS)
+        return false;
+#endif
+    lean_records_per_thread =
+        records_per_thread == 0 ? LEAN_DEFAULT_RECORDS_PER_THREAD : records_per_thread;
+    lean_batch_cb = batch_cb;
+    return true;
+}
+
+DR_EXPORT
+void
+drwrap_lean_flush(void *drcontext)
+{
+    per_thread_t *pt = (per_thread_t *)drmgr_get_tls_field(drcontext, tls_idx);
+    if (pt != NULL)
+        drwrap_lean_deliver(drcontext, pt);
+}
+
+#ifdef X86
+/* The offset of a record field from the end of the record, which the inlined
+ * code holds in a register.
+ */
+#    define LEAN_RECORD_DISP(field) \
+        ((int)offsetof(drwrap_lean_record_t, field) - (int)sizeof(drwrap_lean_record_t))
+
+static void
+drwrap_lean_buffer_full(void)
+{
+    void *drcontext = dr_get_current_drcontext();
+    per_thread_t *pt = (per_thread_t *)drmgr_get_tls_field(drcontext, tls_idx);
+    drwrap_lean_deliver(drcontext, pt);
+    if (pt->lean_buf == NULL) {
+        /* We allocate lazily so threads that never reach a lean wrap pay nothing. */
+        pt->lean_buf_records = lean_records_per_thread;
+        pt->lean_buf = (drwrap_lean_record_t *)dr_thread_alloc(
+            drcontext, pt->lean_buf_records * sizeof(drwrap_lean_record_t));
+        pt->lean_cur = pt->lean_buf;
+        pt->lean_left = pt->lean_buf_records;
+    }
+}
+
+static inline opnd_t
+drwrap_lean_stack_arg(uint arg, uint reg_arg_count, uint stack_arg_offset)
+{
+    return OPND_CREATE_MEMPTR(DR_REG_XSP,
+                              (arg - reg_arg_count + stack_arg_offset) * sizeof(reg_t));
+}
+
+/* Returns where arg is found at function entry: mirrors drwrap_arg_addr(). */
+static opnd_t
+drwrap_lean_arg(drwrap_callconv_t callconv, uint arg)
+{
+    switch (callconv) {
+#    ifdef X64
+    case DRWRAP_CALLCONV_AMD64:
+        switch (arg) {
+        case 0: return opnd_create_reg(DR_REG_RDI);
+        case 1: return opnd_create_reg(DR_REG_RSI);
+        case 2: return opnd_create_reg(DR_REG_RDX);
+        case 3: return opnd_create_reg(DR_REG_RCX);
+        case 4: return opnd_create_reg(DR_REG_R8);
+        case 5: return opnd_create_reg(DR_REG_R9);
+        default: return drwrap_lean_stack_arg(arg, 6, 1 /*retaddr*/);
+        }
+    case DRWRAP_CALLCONV_MICROSOFT_X64:
+        switch (arg) {
+        case 0: return opnd_create_reg(DR_REG_RCX);
+        case 1: return opnd_create_reg(DR_REG_RDX);
+        case 2: return opnd_create_reg(DR_REG_R8);
+        case 3: return opnd_create_reg(DR_REG_R9);
+        default: return drwrap_lean_stack_arg(arg, 4, 1 /*retaddr*/ + 4 /*reserved*/);
+        }
+#    endif
+    case DRWRAP_CALLCONV_CDECL: return drwrap_lean_stack_arg(arg, 0, 1 /*retaddr*/);
+    case DRWRAP_CALLCONV_FASTCALL:
+        switch (arg) {
+        case 0: return opnd_create_reg(DR_REG_XCX);
+        case 1: return opnd_create_reg(DR_REG_XDX);
+        default: return drwrap_lean_stack_arg(arg, 2, 1 /*retaddr*/);
+        }
+    case DRWRAP_CALLCONV_THISCALL:
+        if (arg == 0)
+            return opnd_create_reg(DR_REG_XCX);
+        else
+            return drwrap_lean_stack_arg(arg, 1, 1 /*retaddr*/);
+    default: return opnd_create_null();
+    }
+}
+
+/* Stores the application value src into the record field at disp from reg_rec.
+ * Clobbers scratch.
+ */
+static void
+drwrap_lean_insert_store(void *drcontext, instrlist_t *bb, instr_t *where, opnd_t src,
+                         int disp, reg_id_t reg_rec, reg_id_t scratch)
+{
+    if (opnd_is_reg(src)) {
+        /* drreg restores app values lazily, so the register may hold a tool value.
+         * A dead register has no app value and whatever it holds is recorded.
+         */
+        drreg_status_t res =
+            drreg_get_app_value(drcontext, bb, where, opnd_get_reg(src), scratch);
+        if (res != DRREG_SUCCESS && res != DRREG_ERROR_NO_APP_VALUE)
+            ASSERT(false, "failed to get app value for lean wrap");
+    } else {
+        instrlist_meta_preinsert(
+            bb, where, INSTR_CREATE_mov_ld(drcontext, opnd_create_reg(scratch), src));
+    }
+    instrlist_meta_preinsert(bb, where,
+                             INSTR_CREATE_mov_st(drcontext,
+                                                 OPND_CREATE_MEMPTR(reg_rec, disp),
+                                                 opnd_create_reg(scratch)));
+}
+
+/* Inserts code at where to write a lean record for func.  For a post-call point,
+ * post_pc is the point's address and the record holds the return value;
+ * otherwise it holds the first num_args args.
+ */
+static void
+drwrap_lean_insert(void *drcontext, instrlist_t *bb, instr_t *where, app_pc func,
+                   uint num_args, drwrap_callconv_t callconv, app_pc post_pc)
+{
+    instr_t *done = INSTR_CREATE_label(drcontext);
+    reg_id_t reg_a = DR_REG_NULL, reg_c = DR_REG_NULL;
+    bool have_aflags;
+    uint i;
+
+    have_aflags = drreg_reserve_aflags(drcontext, bb, where) == DRREG_SUCCESS;
+    if (have_aflags &&
+        drreg_reserve_register(drcontext, bb, where, NULL, &reg_a) != DRREG_SUCCESS)
+        reg_a = DR_REG_NULL;
+    if (reg_a != DR_REG_NULL &&
+        drreg_reserve_register(drcontext, bb, where, NULL, &reg_c) != DRREG_SUCCESS)
+        reg_c = DR_REG_NULL;
+    if (reg_c == DR_REG_NULL) {
+        ASSERT(false, "failed to reserve registers for lean wrap");
+        if (reg_a != DR_REG_NULL)
+            drreg_unreserve_register(drcontext, bb, where, reg_a);
+        if (have_aflags)
+            drreg_unreserve_aflags(drcontext, bb, where);
+        instr_destroy(drcontext, done);
+        return;
+    }
+
+    if (post_pc != NULL) {
+        /* Only record if we got here by returning, in which case the return
+         * address is still just beyond the stack pointer.  On a match we clear the
+         * now-dead slot, so that a later jump to post_pc (e.g., post_pc being a
+         * loop's join point) does not match the same stale return address.
+         */
+        instrlist_insert_mov_immed_ptrsz(drcontext, (ptr_int_t)post_pc,
+                                         opnd_create_reg(reg_a), bb, where, NULL, NULL);
+        instrlist_meta_preinsert(
+            bb, where,
+            INSTR_CREATE_cmp(drcontext,
+                             OPND_CREATE_MEMPTR(DR_REG_XSP, -(int)sizeof(reg_t)),
+                             opnd_create_reg(reg_a)));
+        instrlist_meta_preinsert(bb, where,
+                                 INSTR_CREATE_jcc(drcontext, OP_jne,
+                                                  opnd_create_instr(done)));
+        instrlist_meta_preinsert(
+            bb, where,
+            INSTR_CREATE_mov_st(drcontext,
+                                OPND_CREATE_MEMPTR(DR_REG_XSP, -(int)sizeof(reg_t)),
+                                OPND_CREATE_INT32(0)));
+    }
+
+    /* Claim the next record, leaving its end in reg_c. */
+    drmgr_insert_read_tls_field(drcontext, tls_idx, bb, where, reg_a);
+    instrlist_meta_preinsert(
+        bb, where,
+        INSTR_CREATE_mov_ld(drcontext, opnd_create_reg(reg_c),
+                            OPND_CREATE_MEMPTR(reg_a, offsetof(per_thread_t, lean_cur))));
+    instrlist_meta_preinsert(
+        bb, where,
+        INSTR_CREATE_add(drcontext, opnd_create_reg(reg_c),
+                         OPND_CREATE_INT32(sizeof(drwrap_lean_record_t))));
+    instrlist_meta_preinsert(
+        bb, where,
+        INSTR_CREATE_mov_st(drcontext,
+                            OPND_CREATE_MEMPTR(reg_a, offsetof(per_thread_t, lean_cur)),
+                            opnd_create_reg(reg_c)));
+
+    /* Fill it in. */
+    instrlist_meta_preinsert(
+        bb, where,
+        INSTR_CREATE_mov_st(drcontext, OPND_CREATE_MEM32(reg_c, LEAN_RECORD_DISP(func)),
+                            OPND_CREATE_INT32((int)(ptr_int_t)func)));
+#    ifdef X64
+    instrlist_meta_preinsert(
+        bb, where,
+        INSTR_CREATE_mov_st(drcontext,
+                            OPND_CREATE_MEM32(reg_c, LEAN_RECORD_DISP(func) + 4),
+                            OPND_CREATE_INT32((int)((ptr_int_t)func >> 32))));
+#    endif
+    instrlist_meta_preinsert(
+        bb, where,
+        INSTR_CREATE_mov_st(
+            drcontext, OPND_CREATE_MEMPTR(reg_c, LEAN_RECORD_DISP(where)),
+            OPND_CREATE_INT32(post_pc == NULL ? DRWRAP_LEAN_PRE : DRWRAP_LEAN_POST)));
+    if (post_pc != NULL) {
+        instrlist_meta_preinsert(
+            bb, where,
+            INSTR_CREATE_lea(drcontext, opnd_create_reg(reg_a),
+                             OPND_CREATE_MEM_lea(DR_REG_XSP, DR_REG_NULL, 0,
+                                                 -(int)sizeof(reg_t))));
+        instrlist_meta_preinsert(
+            bb, where,
+            INSTR_CREATE_mov_st(drcontext,
+                                OPND_CREATE_MEMPTR(reg_c, LEAN_RECORD_DISP(xsp)),
+                                opnd_create_reg(reg_a)));
+        drwrap_lean_insert_store(drcontext, bb, where, opnd_create_reg(DR_REG_XAX),
+                                 LEAN_RECORD_DISP(value), reg_c, reg_a);
+    } else {
+        instrlist_meta_preinsert(
+            bb, where,
+            INSTR_CREATE_mov_st(drcontext,
+                                OPND_CREATE_MEMPTR(reg_c, LEAN_RECORD_DISP(xsp)),
+                                opnd_create_reg(DR_REG_XSP)));
+        for (i = 0; i < num_args; i++) {
+            drwrap_lean_insert_store(drcontext, bb, where, drwrap_lean_arg(callconv, i),
+                                     LEAN_RECORD_DISP(value) + i * sizeof(reg_t), reg_c,
+                                     reg_a);
+        }
+    }
+
+    /* Count it, and hand the buffer to the client if that was the last slot. */
+    drmgr_insert_read_tls_field(drcontext, tls_idx, bb, where, reg_a);
+    instrlist_meta_preinsert(
+        bb, where,
+        INSTR_CREATE_sub(drcontext,
+                         OPND_CREATE_MEMPTR(reg_a, offsetof(per_thread_t, lean_left)),
+                         OPND_CREATE_INT8(1)));
+    instrlist_meta_preinsert(
+        bb, where, INSTR_CREATE_jcc(drcontext, OP_jnz, opnd_create_instr(done)));
+    dr_insert_clean_call(drcontext, bb, where, (void *)drwrap_lean_buffer_full,
+                         false /*!fpstate*/, 0);
+    instrlist_meta_preinsert(bb, where, done);
+
+    if (drreg_unreserve_register(drcontext, bb, where, reg_c) != DRREG_SUCCESS ||
+        drreg_unreserve_register(drcontext, bb, where, reg_a) != DRREG_SUCCESS ||
+        drreg_unreserve_aflags(drcontext, bb, where) != DRREG_SUCCESS)
+        ASSERT(false, "failed to unreserve registers for lean wrap");
+}
+
+/* Returns the function reached by a direct call to target: target itself, or,
+ * for a stub that jumps through a pointer in memory (such as a PLT entry), the
+ * pointer's current value.
+ */
+static app_pc
+drwrap_lean_call_target(void *drcontext, app_pc target)
+{
+    byte buf[MAX_INSTR_LENGTH];
+    app_pc res = target;
+    instr_t instr;
+    if (!fast_safe_read(target, sizeof(buf), buf))
+        return res;
+    instr_init(drcontext, &instr);
+    if (decode_from_copy(drcontext, buf, target, &instr) != NULL &&
+        instr_get_opcode(&instr) == OP_jmp_ind) {
+        opnd_t ptr = instr_get_target(&instr);
+        app_pc value;
+        if ((opnd_is_abs_addr(ptr) || opnd_is_rel_addr(ptr)) &&
+            fast_safe_read(opnd_get_addr(ptr), sizeof(value), &value))
+            res = value;
+    }
+    instr_free(drcontext, &instr);
+    return res;
+}
+
+/* Called for a direct call to target, whose post-call point is post_pc */
+static void
+drwrap_lean_add_post_call(void *drcontext, app_pc post_pc, app_pc target)
+{
+    lean_entry_t *lean;
+    lean_post_t *post;
+    bool flush = false;
+    dr_recurlock_lock(wrap_lock);
+    lean = hashtable_lookup(&lean_table, (void *)target);
+    if (lean == NULL) {
+        lean = hashtable_lookup(&lean_table,
+                                (void *)drwrap_lean_call_target(drcontext, target));
+    }
+    if (lean != NULL && lean->record_retval) {
+        post = hashtable_lookup(&lean_post_table, (void *)post_pc);
+        if (post == NULL) {
+            post = (lean_post_t *)dr_global_alloc(sizeof(*post));
+            post->pc = post_pc;
+            post->func = NULL;
+            hashtable_add(&lean_post_table, (void *)post_pc, post);
+        }
+        if (post->func != lean->func) {
+            post->func = lean->func;
+            /* XXX: we're assuming void* tag == pc */
+            flush = dr_fragment_exists_at(drcontext, post_pc);
+        }
+    }
+    dr_recurlock_unlock(wrap_lock);
+    if (flush) {
+        dr_atomic_add_stat_return_sum(&drwrap_stats.flush_count, 1);
+        dr_delay_flush_region(post_pc, 1, 0, NULL);
+    }
+}
+
+static void
+drwrap_lean_disable_post_call(void *payload, void *user_data)
+{
+    lean_post_t *post = (lean_post_t *)payload;
+    if (post->func == (app_pc)user_data) {
+        post->func = NULL;
+        dr_atomic_add_stat_return_sum(&drwrap_stats.flush_count, 1);
+        dr_delay_flush_region(post->pc, 1, 0, NULL);
+    }
+}
+
+/* Inserts the lean-wrap instrumentation, if any, for inst at pc */
+static void
+drwrap_lean_insert_for_instr(void *drcontext, instrlist_t *bb, instr_t *inst, app_pc pc)
+{
+    lean_entry_t lean = { 0 };
+    app_pc post_func = NULL;
+    app_pc post_pc = instr_get_app_pc(inst);
+    dr_recurlock_lock(wrap_lock);
+    lean_entry_t *entry = hashtable_lookup(&lean_table, (void *)pc);
+    if (entry != NULL)
+        lean = *entry;
+    lean_post_t *post = hashtable_lookup(&lean_post_table, (void *)post_pc);
+    if (post != NULL)
+        post_func = post->func;
+    dr_recurlock_unlock(wrap_lock);
+    if (lean.func != NULL) {
+        drwrap_lean_insert(drcontext, bb, inst, lean.func, lean.num_args, lean.callconv,
+                           NULL);
+    }
+    if (post_func != NULL)
+        drwrap_lean_insert(drcontext, bb, inst, post_func, 0, 0, post_pc);
+}
+#endif
+
+DR_EXPORT
+bool
+drwrap_wrap_lean(app_pc func, uint num_args, bool record_retval, uint flags)
+{
+#ifdef X86
+    lean_entry_t *lean;
+    bool added;
+    if (func == NULL || num_args > DRWRAP_LEAN_MAX_ARGS ||
+        EXCLUDE_CALLCONV(flags) != 0 || lean_batch_cb == NULL)
+        return false;
+    lean = (lean_entry_t *)dr_global_alloc(sizeof(*lean));
+    lean->func = func;
+    lean->num_args = num_args;
+    lean->record_retval = record_retval;
+    lean->callconv = EXTRACT_CALLCONV(flags);
+    if (lean->callconv == 0)
+        lean->callconv = DRWRAP_CALLCONV_DEFAULT;
+    if (opnd_is_null(drwrap_lean_arg(lean->callconv, 0))) {
+        lean_entry_free(lean);
+        return false;
+    }
+    dr_recurlock_lock(wrap_lock);
+    added = hashtable_add(&lean_table, (void *)func, (void *)lean);
+    if (added)
+        lean_wrap_count++;
+    dr_recurlock_unlock(wrap_lock);
+    if (!added) {
+        lean_entry_free(lean);
+        return false;
+    }
+    /* XXX: we're assuming void* tag == pc */
+    if (dr_fragment_exists_at(dr_get_current_drcontext(), func))
+        drwrap_flush_func(func);
+    return true;
+#else
+    /* XXX: the inlined code is only implemented for x86. */
+    return false;
+#endif
+}
+
+DR_EXPORT
+bool
+drwrap_unwrap_lean(app_pc func)
+{
+    bool removed;
+    dr_recurlock_lock(wrap_lock);
+    removed = hashtable_remove(&lean_table, (void *)func);
+    if (removed) {
+        lean_wrap_count--;
+        hashtable_apply_to_all_payloads_user_data(
+            &lean_post_table, drwrap_lean_disable_post_call, (void *)func);
+    }
+    dr_recurlock_unlock(wrap_lock);
+    if (removed)
+        drwrap_flush_func(func);
+    return removed;
+}
+
 static dr_emit_flags_t
 drwrap_event_bb_analysis(void *drcontext, void *tag, instrlist_t *bb, bool for_trace,
                          bool translating, OUT void **user_data)
@@ -2296,6 +2989,11 @@ drwrap_event_bb_insert(void *drcontext, void *tag, instrlist_t *bb, instr_t *ins
      * callee. By doing both we minimize flushes from the return point having already
      * been reached before the callee hook can mark it.
      */
+#ifdef X86
+    if (lean_wrap_count > 0)
+        drwrap_lean_insert_for_instr(drcontext, bb, inst, pc);
+#endif
+
     dr_recurlock_lock(wrap_lock);
     wrap = hashtable_lookup(&wrap_table, (void *)pc);
     if (wrap != NULL) {
@@ -2354,6 +3052,13 @@ drwrap_event_bb_insert(void *drcontext, void *tag, instrlist_t *bb, instr_t *ins
                                 false);
             dr_rwlock_write_unlock(post_call_rwlock);
         }
+#ifdef X86
+        if (lean_wrap_count > 0) {
+            drwrap_lean_add_post_call(
+                drcontext, instr_get_app_pc(inst) + instr_length(drcontext, inst),
+                target);
+        }
+#endif
     }
 
     return res;
@@ -2366,9 +3071,20 @@ drwrap_event_module_unload(void *drcontext, const module_data_t *info)
      * changes to app code that's being targeted for wrapping.
      */
     dr_rwlock_write_lock(post_call_rwlock);
-    hashtable_remove_range(&post_call_table, (void *)info->start, (void *)info->end);
+    for (uint i = 0; i < (1U << post_call_table->bits); i++) {
+        post_call_entry_t *e = &post_call_table->slots[i];
+        if (e->live && e->pc >= info->start && e->pc < info->end)
+            post_call_entry_remove(e);
+    }
     dr_rwlock_write_unlock(post_call_rwlock);
 
+    /* A new module mapped at the same place must not get post-call
+     * instrumentation meant for the old one.
+     */
+    dr_recurlock_lock(wrap_lock);
+    hashtable_remove_range(&lean_post_table, (void *)info->start, (void *)info->end);
+    dr_recurlock_unlock(wrap_lock);
+
     /* XXX: It's arguable whether we should remove from replace_table,
      * replace_native_table, and wrap_table: we could expect the client to un-replace
      * or un-wrap, and if they don't, and a new module is loaded at the same place
@@ -2592,9 +3308,7 @@ drwrap_is_post_wrap(app_pc pc)
     bool res = false;
     if (pc == NULL)
         return false;
-    dr_rwlock_read_lock(post_call_rwlock);
-    res = (hashtable_lookup(&post_call_table, (void *)pc) != NULL);
-    dr_rwlock_read_unlock(post_call_rwlock);
+    res = (post_call_find(pc) != NULL);
     return res;
 }
 
@@ -769,6 +769,111 @@ DR_EXPORT
 bool
 drwrap_is_post_wrap(app_pc pc);
 
+/** The maximum number of arguments recorded by a lean wrap: see drwrap_wrap_lean(). */
+#define DRWRAP_LEAN_MAX_ARGS 4
+
+/** Identifies the type of a #drwrap_lean_record_t. */
+typedef enum {
+    /** The record was written at the entry of the wrapped function. */
+    DRWRAP_LEAN_PRE,
+    /** The record was written after the wrapped function returned. */
+    DRWRAP_LEAN_POST,
+} drwrap_lean_where_t;
+
+/** A record written by a lean wrap: see drwrap_wrap_lean(). */
+typedef struct _drwrap_lean_record_t {
+    /** The wrapped function. */
+    app_pc func;
+    /** A #drwrap_lean_where_t value. */
+    ptr_uint_t where;
+    /**
+     * The application stack pointer at entry to \p func.  For a #DRWRAP_LEAN_POST
+     * record this is computed from the stack pointer at the post-call point, assuming
+     * that the callee did not remove any arguments from the stack, so that a post
+     * record can be matched with its pre record.
+     */
+    reg_t xsp;
+    /**
+     * For a #DRWRAP_LEAN_PRE record, the first \p num_args arguments passed to
+     * drwrap_wrap_lean().  For a #DRWRAP_LEAN_POST record, value[0] holds the
+     * return value.  Other entries are undefined.
+     */
+    reg_t value[DRWRAP_LEAN_MAX_ARGS];
+} drwrap_lean_record_t;
+
+DR_EXPORT
+/**
+ * Registers the callback which receives the records written by lean wraps (see
+ * drwrap_wrap_lean()).  Records are written into a per-thread buffer holding \p
+ * records_per_thread entries (or a default if 0 is passed), and \p batch_cb is
+ * invoked by the thread which fills it, with the records in the order written.
+ * Records left in the buffer are delivered at thread exit or by a call to
+ * drwrap_lean_flush().  The callback is invoked from a clean call, outside of any
+ * wrapped function's pre or post point.
+ *
+ * The inlined code obtains its scratch registers from the drreg extension, which
+ * this routine initializes on x86 and drwrap_exit() cleans up.
+ *
+ * Must be called before drwrap_wrap_lean(), and only once.
+ * \return whether successful.
+ */
+bool
+drwrap_set_lean_callback(void (*batch_cb)(void *drcontext, drwrap_lean_record_t *records,
+                                          uint num_records),
+                         uint records_per_thread);
+
+DR_EXPORT
+/**
+ * Requests a lean wrap of \p func: rather than invoking a callback through a clean
+ * call which saves the full machine context, the first \p num_args arguments
+ * (at most #DRWRAP_LEAN_MAX_ARGS) are copied by inlined code into a
+ * #DRWRAP_LEAN_PRE record at every entry to \p func.  If \p record_retval is true,
+ * a #DRWRAP_LEAN_POST record holding the return value is written after \p func
+ * returns.  The records are delivered in batches to the callback registered with
+ * drwrap_set_lean_callback().  \p flags may hold at most one #drwrap_callconv_t
+ * value and nothing else; the default calling convention is assumed if none is
+ * specified.
+ *
+ * A lean wrap is independent of any drwrap_wrap() requests for the same function.
+ * It has these limitations:
+ * - It is only supported on x86.
+ * - Arguments are read directly, regardless of #DRWRAP_SAFE_READ_ARGS.
+ * - Post-call points are identified statically: they follow a direct call to \p
+ *   func, or to a stub that jumps to \p func through a pointer in memory (such as
+ *   an ELF PLT entry) which was already resolved when the call was first
+ *   executed.  At such a point an inlined check that the return address just
+ *   popped matches the point's address separates returns from other transfers.
+ *   Returns to other points produce no #DRWRAP_LEAN_POST record.
+ * - Post-call points are learned as the blocks containing the calls are built.
+ *   Blocks already in the code cache when drwrap_wrap_lean() is called are not
+ *   flushed, so their calls produce no #DRWRAP_LEAN_POST record until they are
+ *   rebuilt.  Wrapping from the module load event avoids this.
+ * - On 32-bit, a function that pops its own stack arguments on return (stdcall,
+ *   and fastcall or thiscall with stack arguments) leaves its return address
+ *   further below the stack pointer, so it produces no #DRWRAP_LEAN_POST record.
+ *
+ * \return whether successful.
+ */
+bool
+drwrap_wrap_lean(app_pc func, uint num_args, bool record_retval, uint flags);
+
+DR_EXPORT
+/**
+ * Removes a lean wrap of \p func requested by drwrap_wrap_lean().
+ * \return whether successful.
+ */
+bool
+drwrap_unwrap_lean(app_pc func);
+
+DR_EXPORT
+/**
+ * Delivers the records in the lean-wrap buffer of the thread with the given
+ * \p drcontext to the callback registered with drwrap_set_lean_callback().
+ * Must be called by that thread, and not from that callback.
+ */
+void
+drwrap_lean_flush(void *drcontext);
+
 /** An integer sized for support by dr_atomic_addX_return_sum(). */
 typedef ptr_int_t atomic_int_t;
 
@@ -54,6 +54,7 @@
 #endif
 
 #include <limits.h>
+#include <string.h> /* for memset */
 
 #ifdef DEBUG
 #    define ASSERT(x, msg) DR_ASSERT_MSG(x, msg)
@@ -95,6 +96,11 @@ static bool soft_kills_enabled;
 static void
 soft_kills_exit(void);
 
+static void *counter_lock;
+
+static void
+counter_exit(void);
+
 /* For debugging */
 static uint verbose = 0;
 
@@ -154,6 +160,8 @@ drx_init(void)
     if (drreg_init(&ops) != DRREG_SUCCESS)
         return false;
 
+    counter_lock = dr_mutex_create();
+
 #ifdef PLATFORM_SUPPORTS_SCATTER_GATHER
     if (!drmgr_register_restore_state_ex_event_ex(drx_event_restore_state,
                                                   &fault_priority))
@@ -174,6 +182,7 @@ drx_exit()
     if (soft_kills_enabled)
         soft_kills_exit();
 
+    counter_exit();
     drx_buf_exit_library();
     drreg_exit();
     if (expand_scatter_gather_drreg_initialized)
@@ -582,6 +591,289 @@ drx_insert_counter_update(void *drcontext, instrlist_t *ilist, instr_t *where,
     return true;
 }
 
+/***************************************************************************
+ * SHARDED COUNTERS
+ */
+
+/* One thread's copy of a counter array. */
+typedef struct _counter_shard_t {
+    void *values;
+    struct _counter_shard_t *next;
+} counter_shard_t;
+
+struct _drx_counter_t {
+    uint num_counters;
+    bool is_64;
+    /* The raw TLS slot points at the thread's values for the inlined update, while
+     * the drmgr field holds its shard for thread exit.
+     */
+    int tls_idx;
+    uint tls_offs;
+    reg_id_t tls_seg;
+    counter_shard_t *shards; /* live threads' copies */
+    uint64 *retired;         /* sums of exited threads' copies */
+    struct _drx_counter_t *next;
+};
+
+/* The list of counters and each counter's shards and retired sums are protected
+ * by counter_lock.
+ */
+static drx_counter_t *counter_list;
+static bool counter_events_registered;
+
+static size_t
+counter_size(drx_counter_t *counter)
+{
+    return counter->is_64 ? sizeof(uint64) : sizeof(uint);
+}
+
+static uint64
+counter_shard_value(drx_counter_t *counter, counter_shard_t *shard, uint index)
+{
+    if (counter->is_64)
+        return ((uint64 *)shard->values)[index];
+    return ((uint *)shard->values)[index];
+}
+
+static void
+counter_shard_free(drx_counter_t *counter, counter_shard_t *shard)
+{
+    dr_global_free(shard->values, counter->num_counters * counter_size(counter));
+    dr_global_free(shard, sizeof(*shard));
+}
+
+static void
+counter_thread_init(void *drcontext)
+{
+    drx_counter_t *counter;
+    dr_mutex_lock(counter_lock);
+    for (counter = counter_list; counter != NULL; counter = counter->next) {
+        size_t size = counter->num_counters * counter_size(counter);
+        counter_shard_t *shard = dr_global_alloc(sizeof(*shard));
+        shard->values = dr_global_alloc(size);
+        memset(shard->values, 0, size);
+        shard->next = counter->shards;
+        counter->shards = shard;
+        drmgr_set_tls_field(drcontext, counter->tls_idx, shard);
+        *(void **)(dr_get_dr_segment_base(counter->tls_seg) + counter->tls_offs) =
+            shard->values;
+    }
+    dr_mutex_unlock(counter_lock);
+}
+
+static void
+counter_thread_exit(void *drcontext)
+{
+    drx_counter_t *counter;
+    dr_mutex_lock(counter_lock);
+    for (counter = counter_list; counter != NULL; counter = counter->next) {
+        counter_shard_t *shard = drmgr_get_tls_field(drcontext, counter->tls_idx);
+        counter_shard_t **prev;
+        uint i;
+        if (shard == NULL)
+            continue;
+        for (i = 0; i < counter->num_counters; i++)
+            counter->retired[i] += counter_shard_value(counter, shard, i);
+        for (prev = &counter->shards; *prev != NULL; prev = &(*prev)->next) {
+            if (*prev == shard) {
+                *prev = shard->next;
+                break;
+            }
+        }
+        drmgr_set_tls_field(drcontext, counter->tls_idx, NULL);
+        counter_shard_free(counter, shard);
+    }
+    dr_mutex_unlock(counter_lock);
+}
+
+static void
+counter_exit(void)
+{
+    if (counter_events_registered) {
+        drmgr_unregister_thread_init_event(counter_thread_init);
+        drmgr_unregister_thread_exit_event(counter_thread_exit);
+        counter_events_registered = false;
+    }
+    dr_mutex_destroy(counter_lock);
+}
+
+DR_EXPORT
+drx_counter_t *
+drx_counter_create(uint num_counters, uint flags)
+{
+    drx_counter_t *counter;
+    uint tls_offs;
+    reg_id_t tls_seg;
+    int tls_idx;
+    bool ok = true;
+    if (drx_init_count == 0) {
+        ASSERT(false, "drx_counter_create requires drx_init");
+        return NULL;
+    }
+    if (num_counters == 0)
+        return NULL;
+#ifdef ARM
+    /* FIXME i#1551: implement 64-bit counter support */
+    if (TEST(DRX_COUNTER_64BIT, flags))
+        return NULL;
+#endif
+    if (!dr_raw_tls_calloc(&tls_seg, &tls_offs, 1, 0))
+        return NULL;
+    tls_idx = drmgr_register_tls_field();
+    if (tls_idx == -1) {
+        dr_raw_tls_cfree(tls_offs, 1);
+        return NULL;
+    }
+    counter = dr_global_alloc(sizeof(*counter));
+    counter->num_counters = num_counters;
+    counter->is_64 = TEST(DRX_COUNTER_64BIT, flags);
+    counter->tls_idx = tls_idx;
+    counter->tls_offs = tls_offs;
+    counter->tls_seg = tls_seg;
+    counter->shards = NULL;
+    counter->retired = dr_global_alloc(num_counters * sizeof(uint64));
+    memset(counter->retired, 0, num_counters * sizeof(uint64));
+
+    dr_mutex_lock(counter_lock);
+    if (!counter_events_registered) {
+        ok = drmgr_register_thread_init_event(counter_thread_init) &&
+            drmgr_register_thread_exit_event(counter_thread_exit);
+        counter_events_registered = ok;
+    }
+    if (ok) {
+        counter->next = counter_list;
+        counter_list = counter;
+    }
+    dr_mutex_unlock(counter_lock);
+    if (!ok) {
+        drx_counter_destroy(counter);
+        return NULL;
+    }
+    return counter;
+}
+
+DR_EXPORT
+bool
+drx_counter_destroy(drx_counter_t *counter)
+{
+    drx_counter_t **prev;
+    counter_shard_t *shard, *next;
+    if (counter == NULL)
+        return false;
+    dr_mutex_lock(counter_lock);
+    for (prev = &counter_list; *prev != NULL; prev = &(*prev)->next) {
+        if (*prev == counter) {
+            *prev = counter->next;
+            break;
+        }
+    }
+    for (shard = counter->shards; shard != NULL; shard = next) {
+        next = shard->next;
+        counter_shard_free(counter, shard);
+    }
+    dr_mutex_unlock(counter_lock);
+    dr_global_free(counter->retired, counter->num_counters * sizeof(uint64));
+    if (!drmgr_unregister_tls_field(counter->tls_idx) ||
+        !dr_raw_tls_cfree(counter->tls_offs, 1))
+        return false;
+    dr_global_free(counter, sizeof(*counter));
+    return true;
+}
+
+DR_EXPORT
+uint64
+drx_counter_read(drx_counter_t *counter, uint index)
+{
+    counter_shard_t *shard;
+    uint64 sum;
+    if (counter == NULL || index >= counter->num_counters)
+        return 0;
+    dr_mutex_lock(counter_lock);
+    sum = counter->retired[index];
+    for (shard = counter->shards; shard != NULL; shard = shard->next)
+        sum += counter_shard_value(counter, shard, index);
+    dr_mutex_unlock(counter_lock);
+    return sum;
+}
+
+DR_EXPORT
+bool
+drx_insert_counter_update_sharded(void *drcontext, instrlist_t *ilist, instr_t *where,
+                                  drx_counter_t *counter, uint index, int value)
+{
+    reg_id_t reg1;
+#ifdef AARCHXX
+    reg_id_t reg2, val_reg;
+    opnd_size_t opsz;
+#endif
+    int disp;
+    if (drx_init_count == 0) {
+        ASSERT(false, "drx_insert_counter_update_sharded requires drx_init");
+        return false;
+    }
+    if (counter == NULL || index >= counter->num_counters) {
+        ASSERT(false, "invalid counter");
+        return false;
+    }
+    if (drmgr_current_bb_phase(drcontext) != DRMGR_PHASE_INSERTION) {
+        ASSERT(false, "must be called from drmgr's insertion phase");
+        return false;
+    }
+    disp = (int)(index * counter_size(counter));
+#ifdef X86
+    if (drreg_reserve_aflags(drcontext, ilist, where) != DRREG_SUCCESS ||
+        drreg_reserve_register(drcontext, ilist, where, NULL, &reg1) != DRREG_SUCCESS)
+        return false;
+    dr_insert_read_raw_tls(drcontext, ilist, where, counter->tls_seg, counter->tls_offs,
+                           reg1);
+    MINSERT(ilist, where,
+            INSTR_CREATE_add(drcontext,
+                             opnd_create_base_disp(
+                                 reg1, DR_REG_NULL, 0, disp,
+                                 IF_X64_ELSE(counter->is_64 ? OPSZ_8 : OPSZ_4, OPSZ_4)),
+                             OPND_CREATE_INT_32OR8(value)));
+#    ifndef X64
+    if (counter->is_64) {
+        MINSERT(ilist, where,
+                INSTR_CREATE_adc(drcontext, OPND_CREATE_MEM32(reg1, disp + 4),
+                                 OPND_CREATE_INT32(0)));
+    }
+#    endif /* !X64 */
+    if (drreg_unreserve_register(drcontext, ilist, where, reg1) != DRREG_SUCCESS ||
+        drreg_unreserve_aflags(drcontext, ilist, where) != DRREG_SUCCESS)
+        return false;
+#elif defined(AARCHXX)
+    if (drreg_reserve_register(drcontext, ilist, where, NULL, &reg1) != DRREG_SUCCESS ||
+        drreg_reserve_register(drcontext, ilist, where, NULL, &reg2) != DRREG_SUCCESS)
+        return false;
+    dr_insert_read_raw_tls(drcontext, ilist, where, counter->tls_seg, counter->tls_offs,
+                           reg1);
+    if (disp != 0) {
+        instrlist_insert_mov_immed_ptrsz(drcontext, disp, opnd_create_reg(reg2), ilist,
+                                         where, NULL, NULL);
+        MINSERT(ilist, where,
+                XINST_CREATE_add(drcontext, opnd_create_reg(reg1),
+                                 opnd_create_reg(reg2)));
+    }
+    opsz = counter->is_64 ? OPSZ_8 : OPSZ_4;
+    val_reg = IF_AARCH64_ELSE(reg_resize_to_opsz(reg2, opsz), reg2);
+    MINSERT(ilist, where,
+            XINST_CREATE_load(drcontext, opnd_create_reg(val_reg),
+                              opnd_create_base_disp(reg1, DR_REG_NULL, 0, 0, opsz)));
+    MINSERT(
+        ilist, where,
+        XINST_CREATE_add(drcontext, opnd_create_reg(val_reg), OPND_CREATE_INT(value)));
+    MINSERT(ilist, where,
+            XINST_CREATE_store(drcontext,
+                               opnd_create_base_disp(reg1, DR_REG_NULL, 0, 0, opsz),
+                               opnd_create_reg(val_reg)));
+    if (drreg_unreserve_register(drcontext, ilist, where, reg1) != DRREG_SUCCESS ||
+        drreg_unreserve_register(drcontext, ilist, where, reg2) != DRREG_SUCCESS)
+        return false;
+#endif
+    return true;
+}
+
 /***************************************************************************
  * SOFT KILLS
  */
@@ -174,6 +174,66 @@ drx_insert_counter_update(void *drcontext, instrlist_t *ilist, instr_t *where,
                           IF_NOT_X86_(dr_spill_slot_t slot2) void *addr, int value,
                           uint flags);
 
+struct _drx_counter_t;
+
+/**
+ * Opaque handle which represents an array of sharded counters created by
+ * drx_counter_create().
+ */
+typedef struct _drx_counter_t drx_counter_t;
+
+DR_EXPORT
+/**
+ * Creates an array of \p num_counters counters which are sharded per thread:
+ * each thread increments its own private copy of the array, located through a
+ * raw TLS slot, and drx_counter_read() sums the copies.  This avoids both the
+ * races of a plain drx_insert_counter_update() and the cache line contention of
+ * #DRX_COUNTER_LOCK.  Each counter is 64 bits if #DRX_COUNTER_64BIT is set in
+ * \p flags and 32 bits otherwise.  #DRX_COUNTER_64BIT is not yet supported on 32-bit
+ * ARM.
+ *
+ * Like the drx_buf buffers, the counters must be created before any thread which
+ * updates them is initialized, typically from dr_client_main().
+ *
+ * \return NULL if unsuccessful, a valid opaque struct pointer if successful.
+ */
+drx_counter_t *
+drx_counter_create(uint num_counters, uint flags);
+
+DR_EXPORT
+/**
+ * Frees the counters created by drx_counter_create().  Code which updates them must
+ * no longer be able to execute.  \returns whether successful.
+ */
+bool
+drx_counter_destroy(drx_counter_t *counter);
+
+DR_EXPORT
+/**
+ * Inserts into \p ilist prior to \p where meta-instruction(s) to add the constant
+ * \p value to the calling thread's copy of counter \p index in \p counter.
+ * The update is not atomic, but no other thread writes to the same copy.
+ *
+ * This routine must be called from drmgr's insertion phase: the drreg extension
+ * is used to reserve a scratch register (two on ARM and AArch64) and, on x86,
+ * the arithmetic flags.
+ *
+ * \return whether successful.
+ */
+bool
+drx_insert_counter_update_sharded(void *drcontext, instrlist_t *ilist, instr_t *where,
+                                  drx_counter_t *counter, uint index, int value);
+
+DR_EXPORT
+/**
+ * Returns the sum of counter \p index in \p counter across all threads, including
+ * threads which have exited.  The result is exact once the updating threads are
+ * quiescent, such as in a thread exit or process exit event.  Otherwise it is a
+ * snapshot that may miss in-flight updates.
+ */
+uint64
+drx_counter_read(drx_counter_t *counter, uint index);
+
 /***************************************************************************
  * SOFT KILLS
  */
@@ -404,6 +464,55 @@ DR_EXPORT
 drx_buf_t *
 drx_buf_create_trace_buffer(size_t buffer_size, drx_buf_full_cb_t full_cb);
 
+/**
+ * Policies for drx_buf_create_async_trace_buffer() which specify what happens
+ * when a buffer fills up while all of the thread's other buffers are still waiting
+ * to be processed.
+ */
+typedef enum {
+    /** The application thread waits until a buffer is returned to its pool. */
+    DRX_BUF_ASYNC_BLOCK,
+    /**
+     * The contents of the full buffer are discarded and it is reused.  See
+     * drx_buf_get_dropped_buffers().
+     */
+    DRX_BUF_ASYNC_DROP,
+} drx_buf_async_policy_t;
+
+DR_EXPORT
+/**
+ * Initializes the drx_buf extension with a trace buffer whose \p full_cb is
+ * invoked asynchronously.  Each thread is given a pool of \p pool_depth buffers of
+ * \p buffer_size bytes each.  When a buffer fills up it is queued and the thread
+ * continues with the next free buffer from its pool, while \p full_cb is called
+ * on a separate client thread created by drx_buf.  Once the callback returns,
+ * the buffer goes back into its pool.  \p policy selects the behavior when no
+ * free buffer is available.
+ *
+ * Buffers from one thread are delivered in order.  The \p drcontext passed to \p
+ * full_cb is that of the application thread which filled the buffer.  It may be
+ * used to look up thread-local fields such as with drmgr_get_tls_field(), but
+ * as the callback does not run on that thread it must not be used for thread-private
+ * allocation or to query machine state.  On thread exit, any buffers still
+ * queued for the thread along with its final partial buffer are delivered on the
+ * exiting thread before the drx_buf thread exit event returns.
+ *
+ * \return NULL if unsuccessful, a valid opaque struct pointer if successful.
+ */
+drx_buf_t *
+drx_buf_create_async_trace_buffer(size_t buffer_size, uint pool_depth,
+                                  drx_buf_async_policy_t policy,
+                                  drx_buf_full_cb_t full_cb);
+
+DR_EXPORT
+/**
+ * Returns the number of full buffers whose contents were discarded across all
+ * threads due to the #DRX_BUF_ASYNC_DROP policy of a buffer created by
+ * drx_buf_create_async_trace_buffer().  Returns 0 for other buffers.
+ */
+uint
+drx_buf_get_dropped_buffers(drx_buf_t *buf);
+
 DR_EXPORT
 /** Cleans up the buffer associated with \p buf. \returns whether successful. */
 bool
@@ -50,13 +50,41 @@
 #define MINSERT instrlist_meta_preinsert
 
 /* denotes the possible buffer types */
-typedef enum { DRX_BUF_CIRCULAR_FAST, DRX_BUF_CIRCULAR, DRX_BUF_TRACE } drx_buf_type_t;
+typedef enum {
+    DRX_BUF_CIRCULAR_FAST,
+    DRX_BUF_CIRCULAR,
+    DRX_BUF_TRACE,
+    DRX_BUF_TRACE_ASYNC
+} drx_buf_type_t;
+
+struct _async_pool_t;
+
+/* One of the buffers in a thread's pool for an asynchronous trace buffer. */
+typedef struct _async_slot_t {
+    byte *cli_base;
+    byte *buf_base;
+    size_t total_size;
+    size_t used; /* valid bytes, set when queued */
+    struct _async_pool_t *pool;
+    struct _async_slot_t *next; /* in the pool's free list or in the global queue */
+} async_slot_t;
+
+typedef struct _async_pool_t {
+    void *drcontext; /* of the owning thread */
+    drx_buf_full_cb_t full_cb;
+    async_slot_t *slots;
+    uint depth;
+    async_slot_t *cur;       /* the slot being filled by the owning thread */
+    async_slot_t *free_list; /* protected by async_lock */
+    void *returned;          /* signaled when a slot is put back on free_list */
+} async_pool_t;
 
 typedef struct {
     byte *seg_base;
     byte *cli_base;    /* the base of the buffer from the client's perspective */
     byte *buf_base;    /* the actual base of the buffer */
     size_t total_size; /* the actual size of the buffer */
+    async_pool_t *pool; /* only for DRX_BUF_TRACE_ASYNC */
 } per_thread_t;
 
 struct _drx_buf_t {
@@ -64,6 +92,10 @@ struct _drx_buf_t {
     size_t buf_size;
     uint vec_idx; /* index into the clients vector */
     drx_buf_full_cb_t full_cb;
+    /* for DRX_BUF_TRACE_ASYNC */
+    uint pool_depth;
+    drx_buf_async_policy_t policy;
+    volatile int dropped;
     /* tls implementation */
     int tls_idx;
     uint tls_offs;
@@ -77,6 +109,20 @@ static drvector_t clients;
 /* A flag to avoid work when no buffers were ever created. */
 static bool any_bufs_created;
 
+/* Full asynchronous trace buffers are queued in FIFO order and handed to the user's
+ * callback by a single client thread.  The queue, the pools' free lists, and the
+ * consumer state are protected by async_lock.
+ */
+static void *async_lock;
+static void *async_work; /* signaled when a slot is queued or on exit */
+static void *async_done; /* signaled when the consumer thread exits */
+static async_slot_t *async_head;
+static async_slot_t *async_tail;
+static async_slot_t *async_busy; /* the slot whose callback is in progress */
+static bool async_thread_created;
+static bool async_exiting;
+static volatile bool async_thread_running;
+
 /* called by drx_init() */
 bool
 drx_buf_init_library(void);
@@ -84,12 +130,19 @@ void
 drx_buf_exit_library(void);
 
 static drx_buf_t *
-drx_buf_init(drx_buf_type_t bt, size_t bsz, drx_buf_full_cb_t full_cb);
+drx_buf_init(drx_buf_type_t bt, size_t bsz, drx_buf_full_cb_t full_cb, uint pool_depth,
+             drx_buf_async_policy_t policy);
 
 static per_thread_t *
 per_thread_init_2byte(void *drcontext, drx_buf_t *buf);
 static per_thread_t *
 per_thread_init_fault(void *drcontext, drx_buf_t *buf);
+static per_thread_t *
+per_thread_init_async(void *drcontext, drx_buf_t *buf);
+static void
+per_thread_exit_async(void *drcontext, per_thread_t *data, byte *cli_ptr);
+static void
+async_consumer_thread(void *arg);
 
 static void
 drx_buf_insert_update_buf_ptr_2byte(void *drcontext, drx_buf_t *buf, instrlist_t *ilist,
@@ -119,8 +172,8 @@ signal_event(void *drcontext, dr_siginfo_t *info);
 static reg_id_t
 deduce_buf_ptr(instr_t *instr);
 static bool
-reset_buf_ptr(void *drcontext, dr_mcontext_t *raw_mcontext, byte *seg_base,
-              byte *cli_base, drx_buf_t *buf);
+reset_buf_ptr(void *drcontext, dr_mcontext_t *raw_mcontext, per_thread_t *data,
+              drx_buf_t *buf);
 static bool
 fault_event_helper(void *drcontext, byte *target, dr_mcontext_t *raw_mcontext);
 
@@ -155,6 +208,21 @@ drx_buf_init_library(void)
     if (global_buf_rwlock == NULL)
         return false;
 
+    async_lock = dr_mutex_create();
+    async_work = dr_event_create();
+    async_done = dr_event_create();
+    if (async_lock == NULL || async_work == NULL || async_done == NULL)
+        return false;
+    /* Clear any state left over from a prior drx_init() and drx_exit() pair, as
+     * a stale async_exiting would make a new consumer thread exit immediately.
+     */
+    async_head = NULL;
+    async_tail = NULL;
+    async_busy = NULL;
+    async_thread_created = false;
+    async_exiting = false;
+    async_thread_running = false;
+
     return true;
 }
 
@@ -172,6 +240,22 @@ drx_buf_exit_library(void)
     drmgr_unregister_thread_exit_event(event_thread_exit);
     drvector_delete(&clients);
     dr_rwlock_destroy(global_buf_rwlock);
+
+    if (async_thread_created) {
+        /* The consumer drains whatever is still queued before exiting.  It never
+         * ran if the application did not, in which case there is nothing to wait for.
+         */
+        dr_mutex_lock(async_lock);
+        async_exiting = true;
+        dr_mutex_unlock(async_lock);
+        dr_event_signal(async_work);
+        if (async_thread_running)
+            dr_event_wait(async_done);
+        async_thread_created = false;
+    }
+    dr_event_destroy(async_done);
+    dr_event_destroy(async_work);
+    dr_mutex_destroy(async_lock);
 }
 
 DR_EXPORT
@@ -182,18 +266,47 @@ drx_buf_create_circular_buffer(size_t buf_size)
     drx_buf_type_t buf_type = (buf_size == DRX_BUF_FAST_CIRCULAR_BUFSZ)
         ? DRX_BUF_CIRCULAR_FAST
         : DRX_BUF_CIRCULAR;
-    return drx_buf_init(buf_type, buf_size, NULL);
+    return drx_buf_init(buf_type, buf_size, NULL, 0, DRX_BUF_ASYNC_BLOCK);
 }
 
 DR_EXPORT
 drx_buf_t *
 drx_buf_create_trace_buffer(size_t buf_size, drx_buf_full_cb_t full_cb)
 {
-    return drx_buf_init(DRX_BUF_TRACE, buf_size, full_cb);
+    return drx_buf_init(DRX_BUF_TRACE, buf_size, full_cb, 0, DRX_BUF_ASYNC_BLOCK);
+}
+
+DR_EXPORT
+drx_buf_t *
+drx_buf_create_async_trace_buffer(size_t buf_size, uint pool_depth,
+                                  drx_buf_async_policy_t policy,
+                                  drx_buf_full_cb_t full_cb)
+{
+    bool ok = true;
+    if (full_cb == NULL || pool_depth == 0 ||
+        (policy != DRX_BUF_ASYNC_BLOCK && policy != DRX_BUF_ASYNC_DROP))
+        return NULL;
+    dr_mutex_lock(async_lock);
+    if (!async_thread_created) {
+        ok = dr_create_client_thread(async_consumer_thread, NULL);
+        async_thread_created = ok;
+    }
+    dr_mutex_unlock(async_lock);
+    if (!ok)
+        return NULL;
+    return drx_buf_init(DRX_BUF_TRACE_ASYNC, buf_size, full_cb, pool_depth, policy);
+}
+
+DR_EXPORT
+uint
+drx_buf_get_dropped_buffers(drx_buf_t *buf)
+{
+    return (uint)buf->dropped;
 }
 
 static drx_buf_t *
-drx_buf_init(drx_buf_type_t bt, size_t bsz, drx_buf_full_cb_t full_cb)
+drx_buf_init(drx_buf_type_t bt, size_t bsz, drx_buf_full_cb_t full_cb, uint pool_depth,
+             drx_buf_async_policy_t policy)
 {
     drx_buf_t *new_client;
     int tls_idx;
@@ -216,6 +329,9 @@ drx_buf_init(drx_buf_type_t bt, size_t bsz, drx_buf_full_cb_t full_cb)
     new_client->tls_seg = tls_seg;
     new_client->tls_idx = tls_idx;
     new_client->full_cb = full_cb;
+    new_client->pool_depth = pool_depth;
+    new_client->policy = policy;
+    new_client->dropped = 0;
     dr_rwlock_write_lock(global_buf_rwlock);
     /* We don't attempt to re-use NULL entries (presumably which
      * have already been freed), for simplicity.
@@ -295,6 +411,8 @@ event_thread_init(void *drcontext)
         if (buf != NULL) {
             if (buf->buf_type == DRX_BUF_CIRCULAR_FAST)
                 data = per_thread_init_2byte(drcontext, buf);
+            else if (buf->buf_type == DRX_BUF_TRACE_ASYNC)
+                data = per_thread_init_async(drcontext, buf);
             else
                 data = per_thread_init_fault(drcontext, buf);
             drmgr_set_tls_field(drcontext, buf->tls_idx, data);
@@ -314,6 +432,11 @@ event_thread_exit(void *drcontext)
         if (buf != NULL) {
             per_thread_t *data = drmgr_get_tls_field(drcontext, buf->tls_idx);
             byte *cli_ptr = BUF_PTR(data->seg_base, buf->tls_offs);
+            if (data->pool != NULL) {
+                per_thread_exit_async(drcontext, data, cli_ptr);
+                dr_thread_free(drcontext, data, sizeof(per_thread_t));
+                continue;
+            }
             /* buffer has not yet been deleted, call user callback(s) */
             if (buf->full_cb != NULL) {
                 (*buf->full_cb)(drcontext, data->cli_base,
@@ -343,36 +466,218 @@ per_thread_init_2byte(void *drcontext, drx_buf_t *buf)
                            NULL);
     per_thread->buf_base = ret;
     per_thread->cli_base = (void *)ALIGN_FORWARD(ret, buf->buf_size);
+    per_thread->pool = NULL;
     return per_thread;
 }
 
-static per_thread_t *
-per_thread_init_fault(void *drcontext, drx_buf_t *buf)
+/* Returns the client base of a new buffer followed by a read-only page. */
+static byte *
+create_fault_buffer(drx_buf_t *buf, OUT byte **buf_base, OUT size_t *total_size)
 {
     size_t page_size = dr_page_size();
-    per_thread_t *per_thread = dr_thread_alloc(drcontext, sizeof(per_thread_t));
     byte *ret;
     bool ok;
-    /* Keep seg_base in a per-thread data structure so we can get the TLS
-     * slot and find where the pointer points to in the buffer.
-     */
-    per_thread->seg_base = dr_get_dr_segment_base(buf->tls_seg);
     /* We construct a buffer right before a fault by allocating as
      * many pages as needed to fit the buffer, plus another read-only
      * page. Then, we return an address such that we have exactly
      * buf_size bytes usable before we hit the ro page.
      */
-    per_thread->total_size = ALIGN_FORWARD(buf->buf_size, page_size) + page_size;
-    ret = dr_raw_mem_alloc(per_thread->total_size, DR_MEMPROT_READ | DR_MEMPROT_WRITE,
-                           NULL);
-    ok = dr_memory_protect(ret + per_thread->total_size - page_size, page_size,
-                           DR_MEMPROT_READ);
+    *total_size = ALIGN_FORWARD(buf->buf_size, page_size) + page_size;
+    ret = dr_raw_mem_alloc(*total_size, DR_MEMPROT_READ | DR_MEMPROT_WRITE, NULL);
+    ok = dr_memory_protect(ret + *total_size - page_size, page_size, DR_MEMPROT_READ);
     DR_ASSERT(ok);
-    per_thread->buf_base = ret;
-    per_thread->cli_base = ret + ALIGN_FORWARD(buf->buf_size, page_size) - buf->buf_size;
+    *buf_base = ret;
+    return ret + ALIGN_FORWARD(buf->buf_size, page_size) - buf->buf_size;
+}
+
+static per_thread_t *
+per_thread_init_fault(void *drcontext, drx_buf_t *buf)
+{
+    per_thread_t *per_thread = dr_thread_alloc(drcontext, sizeof(per_thread_t));
+    /* Keep seg_base in a per-thread data structure so we can get the TLS
+     * slot and find where the pointer points to in the buffer.
+     */
+    per_thread->seg_base = dr_get_dr_segment_base(buf->tls_seg);
+    per_thread->cli_base =
+        create_fault_buffer(buf, &per_thread->buf_base, &per_thread->total_size);
+    per_thread->pool = NULL;
     return per_thread;
 }
 
+/* Each buffer in the pool has its own read-only page, so the fault-based overflow
+ * check works unchanged: switching buffers only updates cli_base and the TLS pointer.
+ */
+static per_thread_t *
+per_thread_init_async(void *drcontext, drx_buf_t *buf)
+{
+    per_thread_t *per_thread = dr_thread_alloc(drcontext, sizeof(per_thread_t));
+    async_pool_t *pool = dr_global_alloc(sizeof(*pool));
+    uint i;
+    per_thread->seg_base = dr_get_dr_segment_base(buf->tls_seg);
+    pool->drcontext = drcontext;
+    pool->full_cb = buf->full_cb;
+    pool->depth = buf->pool_depth;
+    pool->slots = dr_global_alloc(pool->depth * sizeof(*pool->slots));
+    pool->free_list = NULL;
+    for (i = 0; i < pool->depth; i++) {
+        async_slot_t *slot = &pool->slots[i];
+        slot->cli_base = create_fault_buffer(buf, &slot->buf_base, &slot->total_size);
+        slot->used = 0;
+        slot->pool = pool;
+        if (i > 0) {
+            slot->next = pool->free_list;
+            pool->free_list = slot;
+        } else
+            slot->next = NULL;
+    }
+    pool->cur = &pool->slots[0];
+    pool->returned = dr_event_create();
+    per_thread->cli_base = pool->cur->cli_base;
+    /* The buffers are owned by the pool. */
+    per_thread->buf_base = NULL;
+    per_thread->total_size = 0;
+    per_thread->pool = pool;
+    return per_thread;
+}
+
+/* Delivers whatever the thread still has outstanding on the exiting thread itself,
+ * so its drcontext remains valid for every callback, and frees the pool.
+ */
+static void
+per_thread_exit_async(void *drcontext, per_thread_t *data, byte *cli_ptr)
+{
+    async_pool_t *pool = data->pool;
+    async_slot_t *pending = NULL, **pending_tail = &pending, **prev, *slot, *next;
+    uint i;
+    dr_mutex_lock(async_lock);
+    /* Pull our queued slots out of the queue, preserving their order. */
+    for (prev = &async_head, slot = async_head; slot != NULL; slot = *prev) {
+        if (slot->pool == pool) {
+            *prev = slot->next;
+            *pending_tail = slot;
+            pending_tail = &slot->next;
+        } else
+            prev = &slot->next;
+    }
+    *pending_tail = NULL;
+    async_tail = NULL;
+    for (slot = async_head; slot != NULL; slot = slot->next)
+        async_tail = slot;
+    /* Any slot the consumer is processing precedes the ones we pulled. */
+    while (async_busy != NULL && async_busy->pool == pool) {
+        dr_event_reset(pool->returned);
+        dr_mutex_unlock(async_lock);
+        dr_event_wait(pool->returned);
+        dr_mutex_lock(async_lock);
+    }
+    dr_mutex_unlock(async_lock);
+    for (slot = pending; slot != NULL; slot = next) {
+        next = slot->next;
+        (*pool->full_cb)(drcontext, slot->cli_base, slot->used);
+    }
+    (*pool->full_cb)(drcontext, pool->cur->cli_base,
+                     (size_t)(cli_ptr - pool->cur->cli_base));
+    for (i = 0; i < pool->depth; i++)
+        dr_raw_mem_free(pool->slots[i].buf_base, pool->slots[i].total_size);
+    dr_event_destroy(pool->returned);
+    dr_global_free(pool->slots, pool->depth * sizeof(*pool->slots));
+    dr_global_free(pool, sizeof(*pool));
+}
+
+/* Queues the thread's current slot for the consumer and switches to a free one,
+ * applying the buffer's policy if none is available.
+ */
+static void
+async_buffer_full(drx_buf_t *buf, per_thread_t *data, byte *cli_ptr)
+{
+    async_pool_t *pool = data->pool;
+    async_slot_t *cur = pool->cur, *next;
+    cur->used = (size_t)(cli_ptr - cur->cli_base);
+    dr_mutex_lock(async_lock);
+    if (pool->free_list == NULL && buf->policy == DRX_BUF_ASYNC_DROP) {
+        dr_mutex_unlock(async_lock);
+        dr_atomic_add32_return_sum(&buf->dropped, 1);
+        next = cur;
+    } else {
+        cur->next = NULL;
+        if (async_tail == NULL)
+            async_head = cur;
+        else
+            async_tail->next = cur;
+        async_tail = cur;
+        dr_event_signal(async_work);
+        while (pool->free_list == NULL) {
+            /* The consumer signals while holding async_lock, so resetting before
+             * we drop the lock cannot lose a wakeup.
+             */
+            dr_event_reset(pool->returned);
+            dr_mutex_unlock(async_lock);
+            dr_event_wait(pool->returned);
+            dr_mutex_lock(async_lock);
+        }
+        next = pool->free_list;
+        pool->free_list = next->next;
+        dr_mutex_unlock(async_lock);
+    }
+    pool->cur = next;
+    data->cli_base = next->cli_base;
+    BUF_PTR(data->seg_base, buf->tls_offs) = next->cli_base;
+}
+
+static void
+async_consumer_thread(void *arg)
+{
+    async_slot_t *slot;
+    async_thread_running = true;
+    while (true) {
+        dr_mutex_lock(async_lock);
+        slot = async_head;
+        if (slot == NULL) {
+            bool exiting = async_exiting;
+            if (!exiting)
+                dr_event_reset(async_work);
+            dr_mutex_unlock(async_lock);
+            if (exiting)
+                break;
+            dr_event_wait(async_work);
+            continue;
+        }
+        async_head = slot->next;
+        if (async_head == NULL)
+            async_tail = NULL;
+        async_busy = slot;
+        dr_mutex_unlock(async_lock);
+
+        (*slot->pool->full_cb)(slot->pool->drcontext, slot->cli_base, slot->used);
+
+        dr_mutex_lock(async_lock);
+        async_busy = NULL;
+        slot->next = slot->pool->free_list;
+        slot->pool->free_list = slot;
+        /* Signal under the lock, as an exiting owner frees the event once it
+         * observes that async_busy no longer refers to its pool.
+         */
+        dr_event_signal(slot->pool->returned);
+        dr_mutex_unlock(async_lock);
+    }
+    dr_event_signal(async_done);
+}
+
+/* Handles a full buffer: resets the buffer pointer and either invokes the user's
+ * callback or, for an asynchronous buffer, hands the buffer to the consumer thread.
+ */
+static void
+buffer_full(void *drcontext, drx_buf_t *buf, per_thread_t *data, byte *cli_ptr)
+{
+    if (data->pool != NULL) {
+        async_buffer_full(buf, data, cli_ptr);
+        return;
+    }
+    BUF_PTR(data->seg_base, buf->tls_offs) = data->cli_base;
+    if (buf->full_cb != NULL)
+        (*buf->full_cb)(drcontext, data->cli_base, (size_t)(cli_ptr - data->cli_base));
+}
+
 DR_EXPORT
 void
 drx_buf_insert_load_buf_ptr(void *drcontext, drx_buf_t *buf, instrlist_t *ilist,
@@ -677,11 +982,8 @@ safe_memcpy(drx_buf_t *buf, void *src, size_t len)
     /* try to perform a safe memcpy */
     if (!dr_safe_write(cli_ptr, len, src, NULL)) {
         /* we overflowed the client buffer, so flush it and try again */
-        byte *cli_base = data->cli_base;
-        BUF_PTR(data->seg_base, buf->tls_offs) = cli_base;
-        if (buf->full_cb != NULL)
-            (*buf->full_cb)(drcontext, cli_base, (size_t)(cli_ptr - cli_base));
-        memcpy(cli_base, src, len);
+        buffer_full(drcontext, buf, data, cli_ptr);
+        memcpy(data->cli_base, src, len);
     }
 }
 
@@ -767,8 +1069,8 @@ deduce_buf_ptr(instr_t *instr)
 
 /* returns true if we won't intercept the fault, false otherwise */
 static bool
-reset_buf_ptr(void *drcontext, dr_mcontext_t *raw_mcontext, byte *seg_base,
-              byte *cli_base, drx_buf_t *buf)
+reset_buf_ptr(void *drcontext, dr_mcontext_t *raw_mcontext, per_thread_t *data,
+              drx_buf_t *buf)
 {
     instr_t *instr;
     reg_id_t buf_ptr;
@@ -785,13 +1087,11 @@ reset_buf_ptr(void *drcontext, dr_mcontext_t *raw_mcontext, byte *seg_base,
     /* We set the buffer pointer before the callback so it's easier
      * for the user to override it in the callback.
      */
-    tmp_base = BUF_PTR(seg_base, buf->tls_offs);
-    BUF_PTR(seg_base, buf->tls_offs) = cli_base;
-    if (buf->full_cb != NULL)
-        (*buf->full_cb)(drcontext, cli_base, (size_t)(tmp_base - cli_base));
+    tmp_base = BUF_PTR(data->seg_base, buf->tls_offs);
+    buffer_full(drcontext, buf, data, tmp_base);
 
     /* change contents of buf_ptr and retry the instruction */
-    reg_set_value(buf_ptr, raw_mcontext, (reg_t)BUF_PTR(seg_base, buf->tls_offs));
+    reg_set_value(buf_ptr, raw_mcontext, (reg_t)BUF_PTR(data->seg_base, buf->tls_offs));
     return false;
 }
 
@@ -819,8 +1119,7 @@ fault_event_helper(void *drcontext, byte *target, dr_mcontext_t *raw_mcontext)
 
             /* we found the right client */
             if (target >= ro_lo && target < ro_lo + page_size) {
-                bool ret = reset_buf_ptr(drcontext, raw_mcontext, data->seg_base,
-                                         data->cli_base, buf);
+                bool ret = reset_buf_ptr(drcontext, raw_mcontext, data, buf);
                 dr_rwlock_read_unlock(global_buf_rwlock);
                 return ret;
             }
@@ -0,0 +1,167 @@
+/* **********************************************************
+ * Copyright (c) 2020 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+/* Tests that drbbdup's case execution counts survive rebuilds of profiled blocks.
+ * The blocks of the main module are flushed periodically while they run, and the
+ * counts reported by drbbdup are compared against counts kept by the client.
+ */
+
+#include "dr_api.h"
+#include "drmgr.h"
+#include "drbbdup.h"
+#include "hashtable.h"
+
+#define CHECK(x, msg)                                                                \
+    do {                                                                             \
+        if (!(x)) {                                                                  \
+            dr_fprintf(STDERR, "CHECK failed %s:%d: %s\n", __FILE__, __LINE__, msg); \
+            dr_abort();                                                              \
+        }                                                                            \
+    } while (0);
+
+#define FLUSH_INTERVAL 10000
+
+typedef struct {
+    app_pc pc;
+    uintptr_t count;
+} bb_count_t;
+
+/* Always the default case. */
+static uintptr_t encode_val = 0;
+static app_pc exe_start;
+static size_t exe_size;
+/* Assume single threaded. */
+static uint64 total_count;
+static uint flush_count;
+static hashtable_t count_table; /* Maps a bb's pc to its bb_count_t. */
+
+static uintptr_t
+set_up_bb_dups(void *drbbdup_ctx, void *drcontext, void *tag, instrlist_t *bb,
+               bool *enable_dups, bool *enable_dynamic_handling, void *user_data)
+{
+    drbbdup_status_t res = drbbdup_register_case_encoding(drbbdup_ctx, 1);
+    CHECK(res == DRBBDUP_SUCCESS, "failed to register case 1");
+    *enable_dups = true;
+    *enable_dynamic_handling = false;
+    return 0; /* return default case */
+}
+
+static void
+count_bb(app_pc pc)
+{
+    bb_count_t *bb_count = (bb_count_t *)hashtable_lookup(&count_table, pc);
+    if (bb_count == NULL) {
+        bb_count = (bb_count_t *)dr_global_alloc(sizeof(*bb_count));
+        bb_count->pc = pc;
+        bb_count->count = 0;
+        hashtable_add(&count_table, pc, bb_count);
+    }
+    bb_count->count++;
+    /* Rebuild the module's blocks, and thus their drbbdup book-keeping, while code
+     * built from the old book-keeping is still in use.
+     */
+    if (++total_count % FLUSH_INTERVAL == 0) {
+        if (dr_delay_flush_region(exe_start, exe_size, 0, NULL))
+            flush_count++;
+    }
+}
+
+static void
+instrument_instr(void *drcontext, void *tag, instrlist_t *bb, instr_t *instr,
+                 instr_t *where, uintptr_t encoding, void *user_data,
+                 void *orig_analysis_data, void *analysis_data)
+{
+    bool is_first_nonlabel;
+    drbbdup_status_t res =
+        drbbdup_is_first_nonlabel_instr(drcontext, instr, &is_first_nonlabel);
+    CHECK(res == DRBBDUP_SUCCESS, "failed to check whether instr is first non label");
+    CHECK(encoding == 0, "only the default case should be instrumented");
+    if (is_first_nonlabel) {
+        dr_insert_clean_call(drcontext, bb, where, count_bb, false, 1,
+                             OPND_CREATE_INTPTR(instr_get_app_pc(instr)));
+    }
+}
+
+static void
+check_count(void *payload)
+{
+    bb_count_t *bb_count = (bb_count_t *)payload;
+    uint64 count = 0;
+    drbbdup_status_t res = drbbdup_get_case_execution_count(bb_count->pc, 0, &count);
+    CHECK(res == DRBBDUP_SUCCESS, "drbbdup case count query failed");
+    CHECK(count == bb_count->count, "case count lost across a rebuild");
+}
+
+static void
+free_count(void *payload)
+{
+    dr_global_free(payload, sizeof(bb_count_t));
+}
+
+static void
+event_exit(void)
+{
+    CHECK(flush_count > 0, "the module should have been flushed");
+    hashtable_apply_to_all_payloads(&count_table, check_count);
+    hashtable_delete(&count_table);
+
+    drbbdup_status_t res = drbbdup_exit();
+    CHECK(res == DRBBDUP_SUCCESS, "drbbdup exit failed");
+
+    drmgr_exit();
+}
+
+DR_EXPORT void
+dr_init(client_id_t id)
+{
+    drmgr_init();
+
+    module_data_t *exe = dr_get_main_module();
+    CHECK(exe != NULL, "failed to find the main module");
+    exe_start = exe->start;
+    exe_size = exe->end - exe->start;
+    dr_free_module_data(exe);
+
+    hashtable_init_ex(&count_table, 8, HASH_INTPTR, false, false, free_count, NULL,
+                      NULL);
+
+    drbbdup_options_t opts = { 0 };
+    opts.struct_size = sizeof(drbbdup_options_t);
+    opts.set_up_bb_dups = set_up_bb_dups;
+    opts.instrument_instr = instrument_instr;
+    opts.runtime_case_opnd = opnd_create_abs_addr(&encode_val, OPSZ_PTR);
+    opts.non_default_case_limit = 1;
+    opts.is_case_profiling_enabled = true;
+
+    drbbdup_status_t res = drbbdup_init(&opts);
+    CHECK(res == DRBBDUP_SUCCESS, "drbbdup init failed");
+    dr_register_exit_event(event_exit);
+}
@@ -0,0 +1,164 @@
+/* **********************************************************
+ * Copyright (c) 2020 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+/* Tests dynamic case generation in the drbbdup extension, including bbs whose
+ * case slots are already full when an unhandled encoding is encountered.
+ */
+
+#include "dr_api.h"
+#include "drmgr.h"
+#include "drbbdup.h"
+
+#define CHECK(x, msg)                                                                \
+    do {                                                                             \
+        if (!(x)) {                                                                  \
+            dr_fprintf(STDERR, "CHECK failed %s:%d: %s\n", __FILE__, __LINE__, msg); \
+            dr_abort();                                                              \
+        }                                                                            \
+    } while (0);
+
+#define USER_DATA_VAL (void *)222
+
+/* Assume single threaded. */
+static uintptr_t encode_val = 2;
+static bool fill_cases_flag = false;
+/* Counters to test statistics provided by drbbdup. */
+static unsigned long set_up_count = 0;
+static unsigned long allow_gen_count = 0;
+
+static uintptr_t
+set_up_bb_dups(void *drbbdup_ctx, void *drcontext, void *tag, instrlist_t *bb,
+               bool *enable_dups, bool *enable_dynamic_handling, void *user_data)
+{
+    drbbdup_status_t res;
+
+    CHECK(enable_dups != NULL, "should not be NULL");
+    CHECK(enable_dynamic_handling != NULL, "should not be NULL");
+    CHECK(user_data == USER_DATA_VAL, "user data does not match");
+
+    res = drbbdup_register_case_encoding(drbbdup_ctx, 1);
+    CHECK(res == DRBBDUP_SUCCESS, "failed to register case 1");
+    /* Every other bb starts out with both of its case slots taken. */
+    if (fill_cases_flag) {
+        res = drbbdup_register_case_encoding(drbbdup_ctx, 4);
+        CHECK(res == DRBBDUP_SUCCESS, "failed to register case 4");
+        res = drbbdup_register_case_encoding(drbbdup_ctx, 5);
+        CHECK(res == DRBBDUP_ERROR_CASE_LIMIT_REACHED, "case limit should be reached");
+    }
+    fill_cases_flag = !fill_cases_flag; /* alternate flag */
+    set_up_count++;
+
+    *enable_dups = true;
+    *enable_dynamic_handling = true;
+    return 0; /* return default case */
+}
+
+static bool
+allow_gen(void *drcontext, void *tag, instrlist_t *ilist, uintptr_t new_case,
+          bool *enable_dynamic_handling, void *user_data)
+{
+    CHECK(user_data == USER_DATA_VAL, "user data does not match");
+    CHECK(new_case == 2 || new_case == 3, "unexpected unhandled case");
+    CHECK(*enable_dynamic_handling, "dynamic handling should still be enabled");
+    allow_gen_count++;
+    return true;
+}
+
+static void
+update_encoding()
+{
+    /* Alternate between two encodings that are not registered up front. */
+    encode_val = encode_val == 2 ? 3 : 2;
+}
+
+static void
+insert_encode(void *drcontext, void *tag, instrlist_t *bb, instr_t *where,
+              void *user_data, void *orig_analysis_data)
+{
+    CHECK(user_data == USER_DATA_VAL, "user data does not match");
+    dr_insert_clean_call(drcontext, bb, where, update_encoding, false, 0);
+}
+
+static void
+instrument_instr(void *drcontext, void *tag, instrlist_t *bb, instr_t *instr,
+                 instr_t *where, uintptr_t encoding, void *user_data,
+                 void *orig_analysis_data, void *analysis_data)
+{
+    CHECK(user_data == USER_DATA_VAL, "user data does not match");
+    CHECK(encoding <= 4, "invalid encoding");
+}
+
+static void
+event_exit(void)
+{
+    drbbdup_status_t res;
+
+    drbbdup_stats_t stats = { sizeof(drbbdup_stats_t) };
+    res = drbbdup_get_stats(&stats);
+    CHECK(res == DRBBDUP_SUCCESS, "drbbdup statistics gathering failed");
+
+    CHECK(stats.gen_count > 0, "a case should have been generated");
+    /* Each bb can reach allow_gen at most once: generating a case takes its
+     * only free slot, and a bb with no free slot cannot generate one.  Either
+     * way dynamic handling is then turned off for it.
+     */
+    CHECK(allow_gen_count <= set_up_count, "dynamic handling not turned off");
+    CHECK(stats.no_dynamic_handling_count == allow_gen_count,
+          "dynamic handling should be turned off once the case slots are full");
+    CHECK(stats.gen_count < allow_gen_count,
+          "bbs with full case slots should not generate a case");
+
+    res = drbbdup_exit();
+    CHECK(res == DRBBDUP_SUCCESS, "drbbdup exit failed");
+
+    drmgr_exit();
+}
+
+DR_EXPORT void
+dr_init(client_id_t id)
+{
+    drmgr_init();
+
+    drbbdup_options_t opts = { 0 };
+    opts.struct_size = sizeof(drbbdup_options_t);
+    opts.set_up_bb_dups = set_up_bb_dups;
+    opts.insert_encode = insert_encode;
+    opts.instrument_instr = instrument_instr;
+    opts.allow_gen = allow_gen;
+    opts.runtime_case_opnd = opnd_create_abs_addr(&encode_val, OPSZ_PTR);
+    opts.user_data = USER_DATA_VAL;
+    opts.non_default_case_limit = 2;
+    opts.is_stat_enabled = true;
+
+    drbbdup_status_t res = drbbdup_init(&opts);
+    CHECK(res == DRBBDUP_SUCCESS, "drbbdup init failed");
+    dr_register_exit_event(event_exit);
+}
@@ -64,6 +64,8 @@ static bool enable_dups_flag = false;
 /* Counters to test statistics provided by drbbdup. */
 static unsigned long no_dup_count = 0;
 static unsigned long no_dynamic_handling_count = 0;
+/* The first bb with dups, which is executed once with case 2 (see expect file). */
+static app_pc first_dup_bb_pc = NULL;
 
 static uintptr_t
 set_up_bb_dups(void *drbbdup_ctx, void *drcontext, void *tag, instrlist_t *bb,
@@ -83,6 +85,8 @@ set_up_bb_dups(void *drbbdup_ctx, void *drcontext, void *tag, instrlist_t *bb,
 
     if (!enable_dups_flag)
         no_dup_count++;
+    else if (first_dup_bb_pc == NULL)
+        first_dup_bb_pc = dr_fragment_app_pc(tag);
     no_dynamic_handling_count++;
 
     *enable_dups = enable_dups_flag;
@@ -232,6 +236,14 @@ event_exit(void)
     CHECK(stats.bail_count == 0, "should be 0 since dynamic case gen is turned off");
     CHECK(stats.gen_count == 0, "should be 0 since dynamic case gen is turned off");
 
+    uint64 count = 0;
+    CHECK(first_dup_bb_pc != NULL, "a bb with dups should have been encountered");
+    res = drbbdup_get_case_execution_count(first_dup_bb_pc, 2, &count);
+    CHECK(res == DRBBDUP_SUCCESS, "drbbdup case count query failed");
+    CHECK(count > 0, "case 2 should have been executed");
+    res = drbbdup_get_case_execution_count(first_dup_bb_pc, 3, &count);
+    CHECK(res == DRBBDUP_ERROR_INVALID_PARAMETER, "case 3 should not be registered");
+
     res = drbbdup_exit();
     CHECK(res == DRBBDUP_SUCCESS, "drbbdup exit failed");
 
@@ -267,6 +279,7 @@ dr_init(client_id_t id)
     opts.user_data = USER_DATA_VAL;
     opts.non_default_case_limit = 2;
     opts.is_stat_enabled = true;
+    opts.is_case_profiling_enabled = true;
 
     drbbdup_status_t res = drbbdup_init(&opts);
     CHECK(res == DRBBDUP_SUCCESS, "drbbdup init failed");
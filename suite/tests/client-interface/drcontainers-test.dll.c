@@ -189,12 +189,69 @@ test_hashtable_apply_all_user_data(void)
     hashtable_delete(&hash_table);
 }
 
+static void
+test_hashtable_open_address(void)
+{
+    hashtable_t hash_table;
+    hashtable_config_t config = { sizeof(config), true, 75, NULL, true /*open_address*/ };
+    char key[16];
+    uintptr_t i;
+    hashtable_init_ex(&hash_table, 2, HASH_INTPTR, false, false, NULL, NULL, NULL);
+    hashtable_configure(&hash_table, &config);
+    CHECK(hash_table.table == NULL, "open addressing should not allocate buckets");
+
+    /* Pointer-aligned keys, enough to grow the table several times. */
+    for (i = 1; i <= 1000; i++)
+        CHECK(hashtable_add(&hash_table, (void *)(i * 16), (void *)i), "add failed");
+    CHECK(!hashtable_add(&hash_table, (void *)16, (void *)2), "duplicate add succeeded");
+    CHECK(hash_table.entries == 1000, "wrong entry count");
+    for (i = 1; i <= 1000; i++) {
+        CHECK(hashtable_lookup(&hash_table, (void *)(i * 16)) == (void *)i,
+              "lookup failed");
+    }
+    CHECK(hashtable_lookup(&hash_table, (void *)8) == NULL, "lookup of absent key");
+    /* Removals leave tombstones that later lookups and adds must handle. */
+    for (i = 1; i <= 1000; i += 2)
+        CHECK(hashtable_remove(&hash_table, (void *)(i * 16)), "remove failed");
+    for (i = 1; i <= 1000; i++) {
+        CHECK(hashtable_lookup(&hash_table, (void *)(i * 16)) ==
+                  (i % 2 == 0 ? (void *)i : NULL),
+              "lookup after remove failed");
+    }
+    CHECK(hashtable_add_replace(&hash_table, (void *)32, (void *)7) == (void *)2,
+          "replace failed");
+    CHECK(hashtable_remove_range(&hash_table, (void *)0, (void *)(16 * 501)),
+          "remove_range failed");
+    CHECK(hash_table.entries == 250, "wrong entry count after remove_range");
+    c = 0;
+    hashtable_apply_to_all_payloads(&hash_table, count);
+    CHECK(c == hash_table.entries, "apply on open addressing failed");
+    hashtable_delete(&hash_table);
+
+    /* Duplicated string keys, with a reservation up front. */
+    hashtable_init_ex(&hash_table, 4, HASH_STRING_NOCASE, true, false, NULL, NULL, NULL);
+    hashtable_configure(&hash_table, &config);
+    hashtable_reserve(&hash_table, 512);
+    CHECK(hash_table.table_bits == 10, "reserve did not grow the table");
+    for (i = 1; i <= 512; i++) {
+        dr_snprintf(key, sizeof(key), "Key%d", (int)i);
+        CHECK(hashtable_add(&hash_table, key, (void *)i), "string add failed");
+    }
+    CHECK(hash_table.table_bits == 10, "table grew despite reserve");
+    for (i = 1; i <= 512; i++) {
+        dr_snprintf(key, sizeof(key), "KEY%d", (int)i);
+        CHECK(hashtable_lookup(&hash_table, key) == (void *)i, "string lookup failed");
+    }
+    hashtable_delete(&hash_table);
+}
+
 DR_EXPORT void
 dr_init(client_id_t id)
 {
     test_vector();
     test_hashtable_apply_all();
     test_hashtable_apply_all_user_data();
+    test_hashtable_open_address();
 
     /* XXX: test other data structures */
 }
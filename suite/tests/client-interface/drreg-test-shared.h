@@ -124,3 +124,9 @@
 
 #define DRREG_TEST_12_ASM MAKE_HEX_ASM(DRREG_TEST_CONST(12))
 #define DRREG_TEST_12_C MAKE_HEX_C(DRREG_TEST_CONST(12))
+
+#define DRREG_TEST_13_ASM MAKE_HEX_ASM(DRREG_TEST_CONST(13))
+#define DRREG_TEST_13_C MAKE_HEX_C(DRREG_TEST_CONST(13))
+
+#define DRREG_TEST_14_ASM MAKE_HEX_ASM(DRREG_TEST_CONST(14))
+#define DRREG_TEST_14_C MAKE_HEX_C(DRREG_TEST_CONST(14))
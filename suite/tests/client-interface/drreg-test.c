@@ -309,6 +309,38 @@ GLOBAL_LABEL(FUNCNAME:)
         mov      PTRSZ [TEST_REG_ASM], TEST_REG_ASM
         jmp      test12_done
      test12_done:
+        jmp     test13
+        /* Test 13: a successor that writes TEST_REG2 before reading it, which
+         * with cross_block_liveness makes TEST_REG2 dead at the block's exit.
+         */
+     test13:
+        mov      TEST_REG_ASM, DRREG_TEST_13_ASM
+        mov      TEST_REG_ASM, DRREG_TEST_13_ASM
+        cmp      TEST_REG_ASM, TEST_REG_ASM
+        je       test13_succ
+     test13_succ:
+        mov      TEST_REG2_ASM, DRREG_TEST_13_ASM
+        jmp      test14_init
+        /* Test 14: a successor that reads TEST_REG2, so the app value set in
+         * test14_init must be restored at the exit of the test14 block.
+         */
+     test14_init:
+        mov      TEST_REG2_ASM, DRREG_TEST_14_ASM
+        cmp      TEST_REG2_ASM, TEST_REG2_ASM
+        je       test14
+     test14:
+        mov      TEST_REG_ASM, DRREG_TEST_14_ASM
+        mov      TEST_REG_ASM, DRREG_TEST_14_ASM
+        cmp      TEST_REG_ASM, TEST_REG_ASM
+        je       test14_succ
+     test14_succ:
+        cmp      TEST_REG2_ASM, DRREG_TEST_14_ASM
+        je       test14_done
+        /* Null deref if the app value of TEST_REG2 was not restored */
+        xor      TEST_REG_ASM, TEST_REG_ASM
+        mov      PTRSZ [TEST_REG_ASM], TEST_REG_ASM
+        jmp      test14_done
+     test14_done:
         jmp     epilog
 
      epilog:
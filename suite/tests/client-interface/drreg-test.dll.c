@@ -37,7 +37,7 @@
 #include "drreg.h"
 #include "client_tools.h"
 #include "drreg-test-shared.h"
-#include <string.h> /* memset */
+#include <string.h> /* memset, strcmp */
 
 #define CHECK(x, msg)                                                                \
     do {                                                                             \
@@ -49,6 +49,9 @@
 
 #define MAGIC_VAL 0xabcd
 
+/* Set by the -cross_block_liveness client option */
+static bool cross_block_liveness;
+
 static dr_emit_flags_t
 event_app2app(void *drcontext, void *tag, instrlist_t *bb, bool for_trace,
               bool translating, OUT void **user_data)
@@ -313,6 +316,34 @@ event_app_instruction(void *drcontext, void *tag, instrlist_t *bb, instr_t *inst
         }
         res = drreg_unreserve_aflags(drcontext, bb, inst);
         CHECK(res == DRREG_SUCCESS, "unreserve of aflags");
+#endif
+    } else if (subtest == DRREG_TEST_13_C || subtest == DRREG_TEST_14_C) {
+#ifdef X86
+        /* Clobber TEST_REG2 across the block and check whether drreg considers it
+         * dead at the exit.  Test 13's successor writes it first, so with
+         * cross-block liveness it need not be restored; test 14's successor reads
+         * it and the app asm faults if its value was not restored.
+         */
+        dr_log(drcontext, DR_LOG_ALL, 1, "drreg test #13/14\n");
+        drreg_set_vector_entry(&allowed, TEST_REG, false);
+        drreg_set_vector_entry(&allowed, TEST_REG2, true);
+        if (instr_is_label(inst)) {
+            res = drreg_reserve_register(drcontext, bb, inst, &allowed, &reg);
+            CHECK(res == DRREG_SUCCESS && reg == TEST_REG2, "only 1 choice");
+            instrlist_meta_preinsert(bb, inst,
+                                     XINST_CREATE_load_int(drcontext,
+                                                           opnd_create_reg(reg),
+                                                           OPND_CREATE_INT32(MAGIC_VAL)));
+        } else if (drmgr_is_last_instr(drcontext, inst)) {
+            bool dead;
+            res = drreg_is_register_dead(drcontext, TEST_REG2, inst, &dead);
+            CHECK(res == DRREG_SUCCESS, "query of liveness should work");
+            CHECK(subtest != DRREG_TEST_13_C || dead == cross_block_liveness,
+                  "successor kill not seen");
+            CHECK(subtest != DRREG_TEST_14_C || !dead, "successor read not seen");
+            res = drreg_unreserve_register(drcontext, bb, inst, TEST_REG2);
+            CHECK(res == DRREG_SUCCESS, "unreserve should work");
+        }
 #endif
     }
 
@@ -407,12 +438,15 @@ event_exit(void)
 }
 
 DR_EXPORT void
-dr_init(client_id_t id)
+dr_client_main(client_id_t id, int argc, const char *argv[])
 {
     /* We actually need 3 slots (flags + 2 scratch) but we want to test using
      * a DR slot.
      */
     drreg_options_t ops = { sizeof(ops), 2 /*max slots needed*/, false };
+    if (argc > 1 && strcmp(argv[1], "-cross_block_liveness") == 0)
+        cross_block_liveness = true;
+    ops.cross_block_liveness = cross_block_liveness;
     if (!drmgr_init() || drreg_init(&ops) != DRREG_SUCCESS)
         CHECK(false, "init failed");
 
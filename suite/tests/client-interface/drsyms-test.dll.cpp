@@ -39,6 +39,9 @@
 
 #include <limits.h>
 #include <string.h>
+#ifdef LINUX
+#    include <elf.h>
+#endif
 
 /* DR's build system usually disables warnings we're not interested in, but the
  * flags don't seem to make it to the compiler for this file, maybe because
@@ -560,6 +563,130 @@ test_line_iteration(const module_data_t *dll_data)
         dr_fprintf(STDERR, "found tools.h\n");
 }
 
+#ifdef LINUX
+#    ifdef X64
+typedef Elf64_Ehdr elf_header_t;
+typedef Elf64_Phdr elf_program_header_t;
+typedef Elf64_Nhdr elf_note_header_t;
+#    else
+typedef Elf32_Ehdr elf_header_t;
+typedef Elf32_Phdr elf_program_header_t;
+typedef Elf32_Nhdr elf_note_header_t;
+#    endif
+
+/* Reads the build id from the loaded module's notes, formatted as drsyms names
+ * its line cache files.  Returns false if the module has none.
+ */
+static bool
+get_build_id(const module_data_t *dll_data, char *buf, size_t buf_size)
+{
+    elf_header_t *ehdr = (elf_header_t *)dll_data->start;
+    elf_program_header_t *phdr =
+        (elf_program_header_t *)(dll_data->start + ehdr->e_phoff);
+    app_pc base = NULL;
+    int i;
+    for (i = 0; i < ehdr->e_phnum; i++) {
+        if (phdr[i].p_type == PT_LOAD) {
+            base = dll_data->start - ALIGN_BACKWARD(phdr[i].p_vaddr, dr_page_size());
+            break;
+        }
+    }
+    ASSERT(base != NULL);
+    for (i = 0; i < ehdr->e_phnum; i++) {
+        if (phdr[i].p_type != PT_NOTE)
+            continue;
+        byte *note = base + phdr[i].p_vaddr;
+        byte *end = note + phdr[i].p_memsz;
+        while (note + sizeof(elf_note_header_t) <= end) {
+            elf_note_header_t *nhdr = (elf_note_header_t *)note;
+            byte *desc = note + sizeof(*nhdr) + ALIGN_FORWARD(nhdr->n_namesz, 4);
+            if (nhdr->n_type == NT_GNU_BUILD_ID) {
+                size_t j, len = 0;
+                for (j = 0; j < nhdr->n_descsz && len + 3 <= buf_size; j++)
+                    len += dr_snprintf(buf + len, buf_size - len, "%02x", desc[j]);
+                buf[len] = '\0';
+                return len > 0;
+            }
+            note = desc + ALIGN_FORWARD(nhdr->n_descsz, 4);
+        }
+    }
+    return false;
+}
+
+#    define LINE_CACHE_NUM_OFFS 3
+
+/* Looks up lines with drsym_set_line_cache_dir() set, checks that the index was
+ * saved, and checks that looking up the same addresses again after reloading
+ * the module, which reads the saved index, gives identical results.
+ */
+static void
+test_line_cache(const module_data_t *dll_data, const size_t offs[LINE_CACHE_NUM_OFFS])
+{
+    static char files[2][LINE_CACHE_NUM_OFFS][MAXIMUM_PATH];
+    uint64 lines[2][LINE_CACHE_NUM_OFFS];
+    size_t line_offs[2][LINE_CACHE_NUM_OFFS];
+    char cwd[MAXIMUM_PATH];
+    char dir[MAXIMUM_PATH];
+    char path[MAXIMUM_PATH];
+    char build_id[256];
+    char name[MAX_FUNC_LEN];
+    bool have_build_id = get_build_id(dll_data, build_id, sizeof(build_id));
+    drsym_error_t r;
+    int pass, i;
+
+    bool ok = dr_get_current_directory(cwd, BUFFER_SIZE_ELEMENTS(cwd));
+    ASSERT(ok);
+    dr_snprintf(dir, BUFFER_SIZE_ELEMENTS(dir), "%s/drsyms-test.%d.linecache", cwd,
+                dr_get_process_id());
+    NULL_TERMINATE_BUFFER(dir);
+    ok = dr_create_dir(dir);
+    ASSERT(ok);
+    r = drsym_set_line_cache_dir(dir);
+    ASSERT(r == DRSYM_SUCCESS);
+    /* Discard any index built by earlier lookups so that the first pass saves one. */
+    drsym_free_resources(dll_data->full_path);
+
+    for (pass = 0; pass < 2; pass++) {
+        for (i = 0; i < LINE_CACHE_NUM_OFFS; i++) {
+            drsym_info_t sym_info;
+            sym_info.struct_size = sizeof(sym_info);
+            sym_info.name = name;
+            sym_info.name_size = BUFFER_SIZE_ELEMENTS(name);
+            sym_info.file = files[pass][i];
+            sym_info.file_size = MAXIMUM_PATH;
+            r = drsym_lookup_address(dll_data->full_path, offs[i], &sym_info,
+                                     DRSYM_DEFAULT_FLAGS);
+            ASSERT(r == DRSYM_SUCCESS);
+            ASSERT(sym_info.file_available_size > 0 && sym_info.line > 0);
+            lines[pass][i] = sym_info.line;
+            line_offs[pass][i] = sym_info.line_offs;
+        }
+        if (pass == 0) {
+            dr_snprintf(path, BUFFER_SIZE_ELEMENTS(path), "%s/%s.drsymline", dir,
+                        build_id);
+            NULL_TERMINATE_BUFFER(path);
+            ASSERT(!have_build_id || dr_file_exists(path));
+            /* Reload the module so that the second pass uses the saved index. */
+            drsym_free_resources(dll_data->full_path);
+        }
+    }
+    for (i = 0; i < LINE_CACHE_NUM_OFFS; i++) {
+        ASSERT(strcmp(files[0][i], files[1][i]) == 0);
+        ASSERT(lines[0][i] == lines[1][i]);
+        ASSERT(line_offs[0][i] == line_offs[1][i]);
+    }
+
+    r = drsym_set_line_cache_dir(NULL);
+    ASSERT(r == DRSYM_SUCCESS);
+    if (have_build_id) {
+        ok = dr_delete_file(path);
+        ASSERT(ok);
+    }
+    ok = dr_delete_dir(dir);
+    ASSERT(ok);
+}
+#endif
+
 /* Lookup symbols in the appdll and wrap them. */
 static void
 lookup_dll_syms(void *dc, const module_data_t *dll_data, bool loaded)
@@ -568,6 +695,7 @@ lookup_dll_syms(void *dc, const module_data_t *dll_data, bool loaded)
     app_pc dll_base;
     app_pc dll_export_addr;
     size_t dll_export_offs;
+    size_t dll_public_offs;
     size_t stack_trace_offs;
     drsym_error_t r;
     bool ok;
@@ -615,8 +743,8 @@ lookup_dll_syms(void *dc, const module_data_t *dll_data, bool loaded)
     /* dll_public is a function in the dll we wouldn't be able to find without
      * drsyms and debug info.
      */
-    (void)lookup_and_wrap(dll_path, dll_base, base_name, "dll_public",
-                          DRSYM_DEFAULT_FLAGS);
+    dll_public_offs =
+        lookup_and_wrap(dll_path, dll_base, base_name, "dll_public", DRSYM_DEFAULT_FLAGS);
 
     /* stack_trace is a static function in the DLL that we use to get PCs of all
      * the functions we've looked up so far.
@@ -632,6 +760,12 @@ lookup_dll_syms(void *dc, const module_data_t *dll_data, bool loaded)
 
     test_line_iteration(dll_data);
 
+#ifdef LINUX
+    size_t line_cache_offs[LINE_CACHE_NUM_OFFS] = { dll_export_offs, dll_public_offs,
+                                                    stack_trace_offs };
+    test_line_cache(dll_data, line_cache_offs);
+#endif
+
     drsym_free_resources(dll_path);
 }
 
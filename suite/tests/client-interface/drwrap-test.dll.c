@@ -102,6 +102,14 @@ static app_pc addr_long2;
 static app_pc addr_long3;
 static app_pc addr_longdone;
 
+#ifdef X86
+/* For lean wraps we use a small buffer to exercise the buffer-full path. */
+#    define LEAN_RECORDS 64
+static int lean_pre_count;
+static int lean_post_count;
+static reg_t lean_pre_xsp;
+#endif
+
 static app_pc addr_called_indirectly;
 static app_pc addr_called_indirectly_subcall;
 static app_pc addr_tailcall_test2;
@@ -216,6 +224,10 @@ module_load_event(void *drcontext, const module_data_t *mod, bool loaded)
         wrap_addr(&addr_preonly, "preonly", mod, wrap_pre, NULL, 0);
         wrap_addr(&addr_postonly, "postonly", mod, NULL, wrap_post, 0);
         wrap_addr(&addr_runlots, "runlots", mod, NULL, wrap_post, 0);
+#ifdef X86
+        CHECK(drwrap_wrap_lean(addr_runlots, 1, true, DRWRAP_CALLCONV_DEFAULT),
+              "lean wrap failed");
+#endif
 
         /* test longjmp */
         wrap_unwindtest_addr(&addr_long0, "long0", mod);
@@ -296,6 +308,12 @@ module_unload_event(void *drcontext, const module_data_t *mod)
         unwrap_addr(addr_tailcall, "makes_tailcall", mod, wrap_pre, wrap_post);
         unwrap_addr(addr_preonly, "preonly", mod, wrap_pre, NULL);
         /* skipme, postonly, and runlots were already unwrapped */
+#ifdef X86
+        drwrap_lean_flush(drcontext);
+        CHECK(lean_pre_count == 2048, "lean pre records missing");
+        CHECK(lean_post_count == 2048, "lean post records missing");
+        CHECK(drwrap_unwrap_lean(addr_runlots), "lean unwrap failed");
+#endif
 
         /* test longjmp */
         unwrap_unwindtest_addr(addr_long0, "long0", mod);
@@ -336,11 +354,37 @@ module_unload_event(void *drcontext, const module_data_t *mod)
     }
 }
 
+#ifdef X86
+static void
+lean_batch(void *drcontext, drwrap_lean_record_t *records, uint num_records)
+{
+    uint i;
+    CHECK(num_records <= LEAN_RECORDS, "lean buffer overflow");
+    for (i = 0; i < num_records; i++) {
+        CHECK(records[i].func == addr_runlots, "lean record for wrong func");
+        if (records[i].where == DRWRAP_LEAN_PRE) {
+            lean_pre_count++;
+            lean_pre_xsp = records[i].xsp;
+        } else {
+            CHECK(records[i].where == DRWRAP_LEAN_POST, "lean record has bad type");
+            lean_post_count++;
+            CHECK(lean_post_count == lean_pre_count, "lean post without pre");
+            /* runlots returns how many times it has been called. */
+            CHECK((int)records[i].value[0] == lean_post_count, "lean retval mismatch");
+            CHECK(records[i].xsp == lean_pre_xsp, "lean post xsp mismatch");
+        }
+    }
+}
+#endif
+
 DR_EXPORT void
 dr_init(client_id_t id)
 {
     drmgr_init();
     drwrap_init();
+#ifdef X86
+    CHECK(drwrap_set_lean_callback(lean_batch, LEAN_RECORDS), "lean callback failed");
+#endif
     dr_register_exit_event(event_exit);
     drmgr_register_module_load_event(module_load_event);
     drmgr_register_module_unload_event(module_unload_event);
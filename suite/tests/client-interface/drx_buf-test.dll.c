@@ -69,7 +69,9 @@ static const char test_null[TRACE_SZ];
 static drx_buf_t *circular_fast;
 static drx_buf_t *circular_slow;
 static drx_buf_t *trace;
+static drx_buf_t *trace_async;
 static volatile int num_faults;
+static volatile int num_async_faults;
 
 static void
 event_thread_init(void *drcontext)
@@ -87,6 +89,9 @@ event_thread_init(void *drcontext)
 
     buf_base = drx_buf_get_buffer_base(drcontext, trace);
     memset(buf_base, 0, TRACE_SZ);
+
+    buf_base = drx_buf_get_buffer_base(drcontext, trace_async);
+    memset(buf_base, 0, TRACE_SZ);
 }
 
 static void
@@ -118,6 +123,13 @@ verify_trace_buffer(void *drcontext, void *buf_base, size_t size)
     dr_atomic_add32_return_sum(&num_faults, 1);
 }
 
+static void
+verify_async_trace_buffer(void *drcontext, void *buf_base, size_t size)
+{
+    CHECK(size <= TRACE_SZ, "async buffer size too large");
+    dr_atomic_add32_return_sum(&num_async_faults, 1);
+}
+
 static void
 verify_store(drx_buf_t *client)
 {
@@ -272,6 +284,24 @@ event_app_instruction(void *drcontext, void *tag, instrlist_t *bb, instr_t *inst
         /* the buffer is now clean */
         dr_insert_clean_call(drcontext, bb, inst, verify_buffers_empty, false, 1,
                              OPND_CREATE_INTPTR(trace));
+
+        /* async trace buffer: the same sequence swaps in a pooled buffer */
+        dr_insert_clean_call(drcontext, bb, inst, verify_buffers_empty, false, 1,
+                             OPND_CREATE_INTPTR(trace_async));
+        drx_buf_insert_load_buf_ptr(drcontext, trace_async, bb, inst, reg_ptr);
+        drx_buf_insert_buf_store(drcontext, circular_fast, bb, inst, reg_ptr, DR_REG_NULL,
+                                 opnd_create_reg(scratch), OPSZ_4, 0);
+        drx_buf_insert_update_buf_ptr(drcontext, trace_async, bb, inst, reg_ptr,
+                                      DR_REG_NULL, sizeof(int));
+        dr_insert_clean_call(drcontext, bb, inst, verify_buffers_dirty, false, 2,
+                             OPND_CREATE_INTPTR(trace_async), opnd_create_reg(scratch));
+        drx_buf_insert_load_buf_ptr(drcontext, trace_async, bb, inst, reg_ptr);
+        drx_buf_insert_update_buf_ptr(drcontext, trace_async, bb, inst, reg_ptr,
+                                      DR_REG_NULL, TRACE_SZ - sizeof(int));
+        drx_buf_insert_buf_store(drcontext, circular_fast, bb, inst, reg_ptr, DR_REG_NULL,
+                                 opnd_create_reg(scratch), OPSZ_4, 0);
+        dr_insert_clean_call(drcontext, bb, inst, verify_buffers_empty, false, 1,
+                             OPND_CREATE_INTPTR(trace_async));
     } else if (subtest == DRX_BUF_TEST_4_C) {
         /* test immediate store: 8 bytes (if possible), 4 bytes, 2 bytes and 1 byte */
         /* "ABCDEFGH\x00" (x2 for x64) */
@@ -403,11 +433,17 @@ event_exit(void)
      * drx_buf_insert_buf_memcpy().
      */
     CHECK(num_faults == NUM_ITER * 2 + 2 + 2, "the number of faults don't match up");
+    /* The blocking policy never drops, and each thread exit delivers its queued and
+     * partial buffers before returning.
+     */
+    CHECK(num_async_faults == NUM_ITER * 2 + 2, "the number of async faults is wrong");
+    CHECK(drx_buf_get_dropped_buffers(trace_async) == 0, "async buffers were dropped");
     if (!drmgr_unregister_bb_insertion_event(event_app_instruction))
         CHECK(false, "exit failed");
     drx_buf_free(circular_fast);
     drx_buf_free(circular_slow);
     drx_buf_free(trace);
+    drx_buf_free(trace_async);
     drmgr_unregister_thread_init_event(event_thread_init);
     drmgr_exit();
     drx_exit();
@@ -424,9 +460,12 @@ dr_init(client_id_t id)
     circular_fast = drx_buf_create_circular_buffer(DRX_BUF_FAST_CIRCULAR_BUFSZ);
     circular_slow = drx_buf_create_circular_buffer(CIRCULAR_SLOW_SZ);
     trace = drx_buf_create_trace_buffer(TRACE_SZ, verify_trace_buffer);
+    trace_async = drx_buf_create_async_trace_buffer(TRACE_SZ, 2, DRX_BUF_ASYNC_BLOCK,
+                                                    verify_async_trace_buffer);
     CHECK(circular_fast != NULL, "circular fast failed");
     CHECK(circular_slow != NULL, "circular slow failed");
     CHECK(trace != NULL, "trace failed");
+    CHECK(trace_async != NULL, "async trace failed");
 
     CHECK(drmgr_register_thread_init_event(event_thread_init),
           "event thread init failed");
@@ -47,10 +47,16 @@
 
 static uint counterA;
 static uint counterB;
+static drx_counter_t *sharded;
 
 static void
 event_exit(void)
 {
+    /* The app is single-threaded, so the racy counters are exact too. */
+    CHECK(drx_counter_read(sharded, 0) == counterA, "sharded counter messed up");
+    CHECK(drx_counter_read(sharded, 1) == 3 * (uint64)counterA,
+          "sharded counter messed up");
+    CHECK(drx_counter_destroy(sharded), "drx_counter_destroy failed");
     drx_exit();
     drreg_exit();
     drmgr_exit();
@@ -69,6 +75,8 @@ event_app_instruction(void *drcontext, void *tag, instrlist_t *bb, instr_t *inst
                               IF_NOT_X86_(SPILL_SLOT_MAX + 1) & counterA, 1, 0);
     drx_insert_counter_update(drcontext, bb, inst, SPILL_SLOT_MAX + 1,
                               IF_NOT_X86_(SPILL_SLOT_MAX + 1) & counterB, 3, 0);
+    drx_insert_counter_update_sharded(drcontext, bb, inst, sharded, 0, 1);
+    drx_insert_counter_update_sharded(drcontext, bb, inst, sharded, 1, 3);
     return DR_EMIT_DEFAULT;
 }
 
@@ -83,6 +91,8 @@ dr_init(client_id_t id)
     CHECK(ok, "drx_init failed");
     res = drreg_init(&ops);
     CHECK(res == DRREG_SUCCESS, "drreg_init failed");
+    sharded = drx_counter_create(2, IF_X64_ELSE(DRX_COUNTER_64BIT, 0));
+    CHECK(sharded != NULL, "drx_counter_create failed");
     dr_register_exit_event(event_exit);
     if (!drmgr_register_bb_instrumentation_event(NULL, event_app_instruction, NULL))
         DR_ASSERT(false);
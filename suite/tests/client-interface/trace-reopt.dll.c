@@ -0,0 +1,109 @@
+/* **********************************************************
+ * Copyright (c) 2020 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* Tests the trace re-optimization event with either an explicit
+ * dr_reopt_trace() request ("-manual") or -reopt_sample_ms sampling ("-sample").
+ */
+
+#include "dr_api.h"
+#include "client_tools.h"
+#include <string.h>
+
+/* Trace executions before the manual request, to pick a trace that stays hot. */
+#define REQUEST_AFTER 1000
+
+static bool manual;
+static void *requested_tag;
+static uint trace_execs;
+static uint requested_builds;
+static bool reopt_fired;
+
+static void
+at_trace_entry(void *tag)
+{
+    void *drcontext = dr_get_current_drcontext();
+    if (requested_tag != NULL || ++trace_execs < REQUEST_AFTER)
+        return;
+    requested_tag = tag;
+    if (!dr_reopt_trace(drcontext, tag))
+        dr_fprintf(STDERR, "dr_reopt_trace failed\n");
+    /* A tag that was already selected is rejected. */
+    if (dr_reopt_trace(drcontext, tag))
+        dr_fprintf(STDERR, "dr_reopt_trace accepted a repeated request\n");
+}
+
+static dr_emit_flags_t
+trace_event(void *drcontext, void *tag, instrlist_t *trace, bool translating)
+{
+    if (!manual)
+        return DR_EMIT_DEFAULT;
+    if (tag == requested_tag && !translating)
+        requested_builds++;
+    dr_insert_clean_call(drcontext, trace, instrlist_first(trace), (void *)at_trace_entry,
+                         false, 1, OPND_CREATE_INTPTR(tag));
+    return DR_EMIT_DEFAULT;
+}
+
+static dr_emit_flags_t
+trace_reopt_event(void *drcontext, void *tag, instrlist_t *trace)
+{
+    if (manual) {
+        /* Only the requested trace is selected, and only once it is rebuilt. */
+        ASSERT_MSG(tag == requested_tag, "unrequested trace re-optimized");
+        ASSERT_MSG(requested_builds >= 2, "requested trace was not rebuilt");
+    }
+    if (!reopt_fired) {
+        reopt_fired = true;
+        dr_fprintf(STDERR, "re-optimization event fired\n");
+    }
+    return DR_EMIT_DEFAULT;
+}
+
+static void
+exit_event(void)
+{
+    if (!reopt_fired)
+        dr_fprintf(STDERR, "re-optimization event never fired\n");
+    if (!dr_unregister_trace_event(trace_event) ||
+        !dr_unregister_trace_reopt_event(trace_reopt_event))
+        dr_fprintf(STDERR, "unregister failed\n");
+}
+
+DR_EXPORT void
+dr_client_main(client_id_t id, int argc, const char *argv[])
+{
+    ASSERT_MSG(argc == 2, "expected -manual or -sample");
+    manual = (strcmp(argv[1], "-manual") == 0);
+    dr_register_exit_event(exit_event);
+    dr_register_trace_event(trace_event);
+    dr_register_trace_reopt_event(trace_reopt_event);
+}